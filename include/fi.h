@@ -126,6 +126,7 @@ void fi_create_filter(struct fi_filter *filter, const char *env_name);
 void fi_free_filter(struct fi_filter *filter);
 int fi_apply_filter(struct fi_filter *filter, const char *name);
 
+void ofi_load_providers(void);
 void fi_util_init(void);
 void fi_util_fini(void);
 void fi_log_init(void);
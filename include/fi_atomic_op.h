@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2017 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _FI_ATOMIC_OP_H_
+#define _FI_ATOMIC_OP_H_
+
+#include "config.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_atomic.h>
+#include <rdma/providers/fi_prov.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Array kernels for emulated atomics, indexed by [op][datatype].  A NULL
+ * entry means the op is not defined for the datatype.
+ *
+ * write:     dst[i] = dst[i] <op> src[i]
+ * readwrite: res[i] = dst[i]; dst[i] = dst[i] <op> src[i]
+ * swap:      res[i] = dst[i]; dst[i] = cmp[i] <cond> dst[i] ? src[i] : dst[i]
+ *
+ * res may alias cmp; dst must not overlap the other buffers.  The
+ * kernels are not atomic with respect to each other, callers serialize.
+ */
+#define OFI_WRITE_OP_LAST	FI_CSWAP
+#define OFI_SWAP_OP_START	FI_CSWAP
+#define OFI_SWAP_OP_LAST	(FI_ATOMIC_OP_LAST - FI_CSWAP)
+
+#define ofi_atomic_iswrite_op(op)	\
+	((op) < OFI_SWAP_OP_START && (op) != FI_ATOMIC_READ)
+#define ofi_atomic_isreadwrite_op(op)	((op) < OFI_SWAP_OP_START)
+#define ofi_atomic_isswap_op(op)	\
+	((op) >= OFI_SWAP_OP_START && (op) < FI_ATOMIC_OP_LAST)
+
+extern void (*ofi_atomic_write_handlers[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])
+	(void *dst, const void *src, size_t cnt);
+extern void (*ofi_atomic_readwrite_handlers[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])
+	(void *dst, const void *src, void *res, size_t cnt);
+extern void (*ofi_atomic_swap_handlers[OFI_SWAP_OP_LAST][FI_DATATYPE_LAST])
+	(void *dst, const void *src, const void *cmp, void *res, size_t cnt);
+
+#define ofi_atomic_write_handler(op, datatype, dst, src, cnt)		\
+	ofi_atomic_write_handlers[op][datatype](dst, src, cnt)
+#define ofi_atomic_readwrite_handler(op, datatype, dst, src, res, cnt)	\
+	ofi_atomic_readwrite_handlers[op][datatype](dst, src, res, cnt)
+#define ofi_atomic_swap_handler(op, datatype, dst, src, cmp, res, cnt)	\
+	ofi_atomic_swap_handlers[(op) - OFI_SWAP_OP_START][datatype]	\
+		(dst, src, cmp, res, cnt)
+
+/*
+ * Returns 0 if a kernel exists for the op/datatype pair.  Compare ops are
+ * checked against the swap table, others against the readwrite table if
+ * fetch is set and the write table otherwise.
+ */
+int ofi_atomic_valid(const struct fi_provider *prov,
+		     enum fi_datatype datatype, enum fi_op op, int fetch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FI_ATOMIC_OP_H_ */
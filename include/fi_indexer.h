@@ -38,11 +38,12 @@
 #include "config.h"
 
 #include <sys/types.h>
+#include <limits.h>
 
 /*
  * Indexer - to find a structure given an index.  Synchronization
  * must be provided by the caller.  Caller must initialize the
- * indexer by setting free_list and size to 0.
+ * indexer by setting it to 0.
  */
 
 union ofi_idx_entry {
@@ -50,15 +51,31 @@ union ofi_idx_entry {
 	int   next;
 };
 
-#define OFI_IDX_INDEX_BITS 16
+/*
+ * Indexes are split into a directory slot and a leaf offset.  Leaves are
+ * allocated as they are needed, and the directory doubles when it runs
+ * out of slots, up to the full positive int range.
+ */
+#define OFI_IDX_INDEX_BITS 31
 #define OFI_IDX_ENTRY_BITS 10
 #define OFI_IDX_ENTRY_SIZE (1 << OFI_IDX_ENTRY_BITS)
 #define OFI_IDX_ARRAY_SIZE (1 << (OFI_IDX_INDEX_BITS - OFI_IDX_ENTRY_BITS))
-#define OFI_IDX_MAX_INDEX  ((1 << OFI_IDX_INDEX_BITS) - 1)
+#define OFI_IDX_MAX_INDEX  INT_MAX
+
+/*
+ * A directory is replaced, not reallocated, when it grows.  Older
+ * directories stay allocated until reset, so a reader holding one
+ * still sees valid leaves.
+ */
+struct ofi_idx_dir {
+	struct ofi_idx_dir	*prev;
+	int			size;
+	void			*slot[];
+};
 
 struct indexer
 {
-	union ofi_idx_entry *array[OFI_IDX_ARRAY_SIZE];
+	struct ofi_idx_dir *dir;
 	int		 free_list;
 	int		 size;
 };
@@ -71,9 +88,21 @@ void *ofi_idx_remove(struct indexer *idx, int index);
 void ofi_idx_replace(struct indexer *idx, int index, void *item);
 void ofi_idx_reset(struct indexer *idx);
 
+static inline union ofi_idx_entry *ofi_idx_entry(struct indexer *idx, int index)
+{
+	return (union ofi_idx_entry *) idx->dir->slot[ofi_idx_array_index(index)] +
+		ofi_idx_entry_index(index);
+}
+
 static inline void *ofi_idx_at(struct indexer *idx, int index)
 {
-	return (idx->array[ofi_idx_array_index(index)] + ofi_idx_entry_index(index))->item;
+	return ofi_idx_entry(idx, index)->item;
+}
+
+/* Whether index lies within the allocated leaves */
+static inline int ofi_idx_valid(struct indexer *idx, int index)
+{
+	return index > 0 && ofi_idx_array_index(index) < idx->size;
 }
 
 /*
@@ -84,8 +113,8 @@ static inline void *ofi_idx_at(struct indexer *idx, int index)
 
 struct index_map
 {
-	void **array[OFI_IDX_ARRAY_SIZE];
-	int count[OFI_IDX_ARRAY_SIZE];
+	struct ofi_idx_dir *dir;
+	int *count;
 };
 
 int ofi_idm_set(struct index_map *idm, int index, void *item);
@@ -95,14 +124,20 @@ void ofi_idm_reset(struct index_map *idm);
 static inline void *ofi_idm_at(struct index_map *idm, int index)
 {
 	void **entry;
-	entry = idm->array[ofi_idx_array_index(index)];
+	entry = idm->dir->slot[ofi_idx_array_index(index)];
 	return entry[ofi_idx_entry_index(index)];
 }
 
 static inline void *ofi_idm_lookup(struct index_map *idm, int index)
 {
-	return ((index <= OFI_IDX_MAX_INDEX) && idm->array[ofi_idx_array_index(index)]) ?
-		ofi_idm_at(idm, index) : NULL;
+	struct ofi_idx_dir *dir = idm->dir;
+	void **entry;
+
+	if (index < 0 || !dir || ofi_idx_array_index(index) >= dir->size)
+		return NULL;
+
+	entry = dir->slot[ofi_idx_array_index(index)];
+	return entry ? entry[ofi_idx_entry_index(index)] : NULL;
 }
 
 #endif /* INDEXER_H */
@@ -134,6 +134,7 @@ static inline void name ## _free(struct name *fs)		\
  * Buffer Pool
  */
 struct util_buf_pool;
+struct ofi_stats;
 typedef int (*util_buf_region_alloc_hndlr) (void *pool_ctx, void *addr, size_t len,
 					    void **context);
 typedef void (*util_buf_region_free_hndlr) (void *pool_ctx, void *context);
@@ -150,6 +151,8 @@ struct util_buf_pool {
 	util_buf_region_alloc_hndlr alloc_hndlr;
 	util_buf_region_free_hndlr free_hndlr;
 	void *ctx;
+	struct ofi_stats *stats;
+	int grow_stat;
 };
 
 struct util_buf_region {
@@ -187,6 +190,14 @@ static inline struct util_buf_pool *util_buf_pool_create(size_t size,
 				       NULL, NULL, NULL);
 }
 
+/* count each growth past the initial chunk in counter id of stats */
+static inline void util_buf_pool_set_stats(struct util_buf_pool *pool,
+					   struct ofi_stats *stats, int id)
+{
+	pool->stats = stats;
+	pool->grow_stat = id;
+}
+
 static inline int util_buf_avail(struct util_buf_pool *pool)
 {
 	return !slist_empty(&pool->buf_list);
@@ -58,6 +58,7 @@ enum {
 	ofi_ctrl_ack,
 	ofi_ctrl_nack,
 	ofi_ctrl_discard,
+	ofi_ctrl_batch,
 };
 
 /*
@@ -73,6 +74,8 @@ enum {
  * seg_no:
  *     Data packets - position 0..(n-1) of segment in current message.
  *     Ctrl packets - last segment ack'ed.
+ *     Discard packets - 0, or the FI_E* error the target failed the
+ *     message with.
  * conn_id: Communication identifier.  Conn_id values are exchanged between
  *     peer endpoints as part of communication setup.  This field is valid
  *     as part of the first message in any data transfer.
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2017 Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef _FI_STATS_H_
+#define _FI_STATS_H_
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_ext_stats.h>
+#include <rdma/providers/fi_prov.h>
+#include <fi_list.h>
+
+#ifdef HAVE_ATOMICS
+#  include <stdatomic.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Statistics registry.  A provider attaches a set of named counters to a
+ * fid, increments them on the events it wants to expose, and forwards
+ * ops_open to ofi_stats_ops_open.  Every counter is split into per-thread
+ * shards on separate cache lines, which are summed when read, so counting
+ * from several progress threads does not bounce a shared line.
+ */
+#define OFI_STATS_SHARDS	8
+
+#ifdef HAVE_ATOMICS
+typedef atomic_uint_least64_t ofi_stat_t;
+#define ofi_stat_add(stat, val) \
+	atomic_fetch_add_explicit(stat, val, memory_order_relaxed)
+#define ofi_stat_load(stat) atomic_load_explicit(stat, memory_order_relaxed)
+#define ofi_stat_store(stat, val) \
+	atomic_store_explicit(stat, val, memory_order_relaxed)
+#else
+/* Threads sharing a shard may lose an update */
+typedef uint64_t ofi_stat_t;
+#define ofi_stat_add(stat, val) (*(stat) += (val))
+#define ofi_stat_load(stat) (*(stat))
+#define ofi_stat_store(stat, val) (*(stat) = (val))
+#endif
+
+struct ofi_stats {
+	struct dlist_entry	entry;
+	struct fid		*fid;
+	const struct fi_provider *prov;
+	const char		*label;
+	const char * const	*names;
+	int			cnt;
+	int			stride;
+	ofi_stat_t		*shards;
+};
+
+int ofi_stats_init(struct ofi_stats *stats, const struct fi_provider *prov,
+		   struct fid *fid, const char *label,
+		   const char * const *names, int cnt);
+void ofi_stats_close(struct ofi_stats *stats);
+uint64_t ofi_stats_get(struct ofi_stats *stats, int id);
+void ofi_stats_dump(struct ofi_stats *stats);
+int ofi_stats_ops_open(struct fid *fid, const char *name, uint64_t flags,
+		       void **ops, void *context);
+
+void ofi_stats_ini(void);
+void ofi_stats_fini(void);
+
+extern __thread int ofi_stats_tid;
+int ofi_stats_next_shard(void);
+
+static inline void ofi_stats_add(struct ofi_stats *stats, int id, uint64_t val)
+{
+	if (!stats->shards)
+		return;
+	if (ofi_stats_tid < 0)
+		ofi_stats_tid = ofi_stats_next_shard();
+	ofi_stat_add(&stats->shards[ofi_stats_tid * stats->stride + id], val);
+}
+
+static inline void ofi_stats_inc(struct ofi_stats *stats, int id)
+{
+	ofi_stats_add(stats, id, 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FI_STATS_H_ */
@@ -57,6 +57,7 @@
 #include <fi_enosys.h>
 #include <fi_osd.h>
 #include <fi_indexer.h>
+#include <fi_stats.h>
 
 #ifndef _FI_UTIL_H_
 #define _FI_UTIL_H_
@@ -151,6 +152,8 @@ struct util_domain {
 	uint64_t		mode;
 	uint32_t		addr_format;
 	enum fi_av_type		av_type;
+	size_t			max_ep_tx_ctx;
+	size_t			max_ep_rx_ctx;
 };
 
 int ofi_domain_init(struct fid_fabric *fabric_fid, const struct fi_info *info,
@@ -172,6 +175,12 @@ struct util_ep {
 	struct dlist_entry	av_entry;
 	struct util_cq		*rx_cq;
 	struct util_cq		*tx_cq;
+	struct util_cntr	*tx_cntr;
+	struct util_cntr	*rx_cntr;
+	struct util_cntr	*rd_cntr;
+	struct util_cntr	*wr_cntr;
+	struct util_cntr	*rem_rd_cntr;
+	struct util_cntr	*rem_wr_cntr;
 	uint64_t		caps;
 	uint64_t		flags;
 	ofi_ep_progress_func	progress;
@@ -179,12 +188,54 @@ struct util_ep {
 };
 
 int ofi_ep_bind_av(struct util_ep *util_ep, struct util_av *av);
+int ofi_ep_bind_cntr(struct util_ep *util_ep, struct util_cntr *cntr,
+		     uint64_t flags);
 int ofi_endpoint_init(struct fid_domain *domain, const struct util_prov *util_prov,
 		struct fi_info *info, struct util_ep *ep, void *context,
 		ofi_ep_progress_func progress, enum fi_match_type type);
 
 int ofi_endpoint_close(struct util_ep *util_ep);
 
+/*
+ * Scalable endpoint, layered over the provider's regular endpoints.
+ */
+struct util_sep;
+
+struct util_sep_ctx {
+	struct fid_ep		ep_fid;
+	struct util_sep		*sep;
+	struct fid_ep		*ep;
+	struct fid		*cq;
+	int			index;
+	int			is_tx;
+	int			enabled;
+};
+
+struct util_sep {
+	struct fid_ep		ep_fid;
+	struct util_domain	*domain;
+	fastlock_t		lock;
+	atomic_t		ref;
+	int			rx_ctx_bits;
+	struct fi_info		*info;
+	struct fid		*av;
+	struct fid		*eq;
+	uint64_t		av_flags;
+	uint64_t		eq_flags;
+
+	int			ep_cnt;
+	int			tx_ctx_cnt;
+	int			rx_ctx_cnt;
+	struct fid_ep		**eps;
+	struct util_sep_ctx	**tx_ctx;
+	struct util_sep_ctx	**rx_ctx;
+	uint8_t			*ep_enabled;
+	uint8_t			*ep_bound;
+};
+
+int ofi_scalable_ep(struct fid_domain *domain, struct fi_info *info,
+		    struct fid_ep **sep, void *context);
+
 /*
  * Completion queue
  *
@@ -223,6 +274,15 @@ struct util_cq {
 	fi_cq_read_func		read_entry;
 	int			internal_wait;
 	ofi_cq_progress_func	progress;
+	struct ofi_stats	stats;
+};
+
+/* Counters of util_cq.stats; providers count completions they could not
+ * write because the CQ was full.
+ */
+enum {
+	OFI_CQ_STAT_OVERFLOW,
+	OFI_CQ_STAT_MAX
 };
 
 int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
@@ -244,28 +304,127 @@ int ofi_cq_signal(struct fid_cq *cq_fid);
 /*
  * Counter
  */
+struct util_cntr;
+typedef void (*ofi_cntr_progress_func)(struct util_cntr *cntr);
+
+/*
+ * Counter values are 64-bit, as returned by fi_cntr_read.  atomic_t only
+ * holds an int, so it cannot be used here.
+ */
+#ifdef HAVE_ATOMICS
+typedef atomic_uint_least64_t ofi_cntr_val_t;
+#else
+typedef struct {
+	fastlock_t	lock;
+	uint64_t	val;
+} ofi_cntr_val_t;
+#endif
+
 struct util_cntr {
 	struct fid_cntr		cntr_fid;
 	struct util_domain	*domain;
+	struct util_wait	*wait;
 	atomic_t		ref;
+	ofi_cntr_val_t		cnt;
+	ofi_cntr_val_t		err;
 	uint64_t		checkpoint_cnt;
 	uint64_t		checkpoint_err;
+
+	struct dlist_entry	ep_list;
+	fastlock_t		ep_list_lock;
+	int			internal_wait;
+	ofi_cntr_progress_func	progress;
 };
 
+int ofi_cntr_open(const struct fi_provider *prov, struct fid_domain *domain,
+		  struct fi_cntr_attr *attr, struct fid_cntr **cntr_fid,
+		  ofi_cntr_progress_func progress, void *context);
+void ofi_cntr_progress(struct util_cntr *cntr);
+void ofi_cntr_signal(struct util_cntr *cntr);
+
+#ifdef HAVE_ATOMICS
+static inline void ofi_cntr_val_init(ofi_cntr_val_t *val)
+{
+	atomic_init(val, 0);
+}
+
+static inline void ofi_cntr_val_fini(ofi_cntr_val_t *val)
+{
+}
+
+static inline uint64_t ofi_cntr_val_get(ofi_cntr_val_t *val)
+{
+	return atomic_load(val);
+}
+
+static inline void ofi_cntr_val_set(ofi_cntr_val_t *val, uint64_t value)
+{
+	atomic_store(val, value);
+}
+
+static inline void ofi_cntr_val_add(ofi_cntr_val_t *val, uint64_t value)
+{
+	atomic_fetch_add_explicit(val, value, memory_order_acq_rel);
+}
+#else
+static inline void ofi_cntr_val_init(ofi_cntr_val_t *val)
+{
+	fastlock_init(&val->lock);
+	val->val = 0;
+}
+
+static inline void ofi_cntr_val_fini(ofi_cntr_val_t *val)
+{
+	fastlock_destroy(&val->lock);
+}
+
+static inline uint64_t ofi_cntr_val_get(ofi_cntr_val_t *val)
+{
+	uint64_t v;
+
+	fastlock_acquire(&val->lock);
+	v = val->val;
+	fastlock_release(&val->lock);
+	return v;
+}
+
+static inline void ofi_cntr_val_set(ofi_cntr_val_t *val, uint64_t value)
+{
+	fastlock_acquire(&val->lock);
+	val->val = value;
+	fastlock_release(&val->lock);
+}
+
+static inline void ofi_cntr_val_add(ofi_cntr_val_t *val, uint64_t value)
+{
+	fastlock_acquire(&val->lock);
+	val->val += value;
+	fastlock_release(&val->lock);
+}
+#endif
+
+static inline void ofi_cntr_inc(struct util_cntr *cntr)
+{
+	ofi_cntr_val_add(&cntr->cnt, 1);
+	if (cntr->wait)
+		ofi_cntr_signal(cntr);
+}
+
+static inline void ofi_cntr_inc_err(struct util_cntr *cntr)
+{
+	ofi_cntr_val_add(&cntr->err, 1);
+	if (cntr->wait)
+		ofi_cntr_signal(cntr);
+}
+
 
 /*
  * AV / addressing
  */
-struct util_av_hash_entry {
-	int			index;
-	int			next;
-};
-
 struct util_av_hash {
-	struct util_av_hash_entry *table;
-	int			free_list;
-	int			slots;
-	int			total_count;
+	int			*head;
+	int			*next;
+	size_t			slots;
 };
 
 struct util_av {
@@ -280,15 +439,19 @@ struct util_av {
 	uint64_t		flags;
 	size_t			count;
 	size_t			addrlen;
+	int			rx_ctx_bits;
 	ssize_t			free_list;
 	struct util_av_hash	hash;
 	void			*data;
 	struct dlist_entry	ep_list;
+	struct dlist_entry	insert_list;
+	pthread_t		insert_thread;
+	int			insert_active;
+	int			insert_joinable;
 };
 
 struct util_av_attr {
 	size_t			addrlen;
-	size_t			overhead;
 	uint64_t		flags;
 };
 
@@ -297,8 +460,33 @@ int ofi_av_init(struct util_domain *domain,
 	       struct util_av *av, void *context);
 int ofi_av_close(struct util_av *av);
 
-int ofi_av_insert_addr(struct util_av *av, const void *addr, int slot, int *index);
-int ofi_av_lookup_index(struct util_av *av, const void *addr, int slot);
+int ofi_av_insert_addr(struct util_av *av, const void *addr, int *index);
+
+/*
+ * Inserts of at least UTIL_AV_ASYNC_MIN addresses into an AV opened with
+ * FI_EVENT are queued, with the AV lock held.  One thread per AV runs
+ * the queue in order, calling func without the AV lock and then freeing
+ * the request, so the util_av_insert must be at the start of a malloc'ed
+ * request.  A smaller insert may be done by the caller only while
+ * nothing is pending, to keep indices in call order.
+ */
+#define UTIL_AV_ASYNC_MIN	1024
+
+struct util_av_insert {
+	struct dlist_entry	entry;
+	struct util_av		*av;
+	void			(*func)(struct util_av_insert *insert);
+};
+
+int ofi_av_queue_insert(struct util_av *av, struct util_av_insert *insert);
+
+static inline int ofi_av_insert_pending(struct util_av *av)
+{
+	return !dlist_empty(&av->insert_list);
+}
+
+int ofi_av_remove_addr(struct util_av *av, int index);
+int ofi_av_lookup_index(struct util_av *av, const void *addr);
 int ofi_av_bind(struct fid *av_fid, struct fid *eq_fid, uint64_t flags);
 void ofi_av_write_event(struct util_av *av, uint64_t data,
 			int err, void *context);
@@ -498,7 +686,7 @@ void ofi_mr_close(struct ofi_util_mr *in_mr_h);
  * Attributes and capabilities
  */
 #define FI_PRIMARY_CAPS	(FI_MSG | FI_RMA | FI_TAGGED | FI_ATOMICS | \
-			 FI_NAMED_RX_CTX | FI_DIRECTED_RECV | \
+			 FI_MULTICAST | FI_NAMED_RX_CTX | FI_DIRECTED_RECV | \
 			 FI_READ | FI_WRITE | FI_RECV | FI_SEND | \
 			 FI_REMOTE_READ | FI_REMOTE_WRITE)
 
@@ -519,6 +707,8 @@ int fi_check_ep_attr(const struct util_prov *util_prov,
 		     const struct fi_ep_attr *user_attr);
 int fi_check_cq_attr(const struct fi_provider *prov,
 		     const struct fi_cq_attr *attr);
+int fi_check_cntr_attr(const struct fi_provider *prov,
+		       const struct fi_cntr_attr *attr);
 int fi_check_rx_attr(const struct fi_provider *prov,
 		     const struct fi_rx_attr *prov_attr,
 		     const struct fi_rx_attr *user_attr);
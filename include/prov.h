@@ -45,7 +45,8 @@
 /* for each provider defines for three scenarios:
  * dl: externally visible ctor with known name (see fi_prov.h)
  * built-in: ctor function def, don't export symbols
- * not built: no-op call for ctor
+ * not built: no ctor
+ * The *_INIT macros name the ctor, which the core calls on first use.
 */
 
 #if (HAVE_GNI) && (HAVE_GNI_DL)
@@ -53,7 +54,7 @@
 #  define GNI_INIT NULL
 #elif (HAVE_GNI)
 #  define GNI_INI INI_SIG(fi_gni_ini)
-#  define GNI_INIT fi_gni_ini()
+#  define GNI_INIT fi_gni_ini
 GNI_INI ;
 #else
 #  define GNI_INIT NULL
@@ -64,7 +65,7 @@ GNI_INI ;
 #  define VERBS_INIT NULL
 #elif (HAVE_VERBS)
 #  define VERBS_INI INI_SIG(fi_verbs_ini)
-#  define VERBS_INIT fi_verbs_ini()
+#  define VERBS_INIT fi_verbs_ini
 VERBS_INI ;
 #else
 #  define VERBS_INIT NULL
@@ -75,7 +76,7 @@ VERBS_INI ;
 #  define PSM_INIT NULL
 #elif (HAVE_PSM)
 #  define PSM_INI INI_SIG(fi_psm_ini)
-#  define PSM_INIT fi_psm_ini()
+#  define PSM_INIT fi_psm_ini
 PSM_INI ;
 #else
 #  define PSM_INIT NULL
@@ -86,7 +87,7 @@ PSM_INI ;
 #  define PSM2_INIT NULL
 #elif (HAVE_PSM2)
 #  define PSM2_INI INI_SIG(fi_psm2_ini)
-#  define PSM2_INIT fi_psm2_ini()
+#  define PSM2_INIT fi_psm2_ini
 PSM2_INI ;
 #else
 #  define PSM2_INIT NULL
@@ -97,7 +98,7 @@ PSM2_INI ;
 #  define SOCKETS_INIT NULL
 #elif (HAVE_SOCKETS)
 #  define SOCKETS_INI INI_SIG(fi_sockets_ini)
-#  define SOCKETS_INIT fi_sockets_ini()
+#  define SOCKETS_INIT fi_sockets_ini
 SOCKETS_INI ;
 #else
 #  define SOCKETS_INIT NULL
@@ -108,7 +109,7 @@ SOCKETS_INI ;
 #  define USNIC_INIT NULL
 #elif (HAVE_USNIC)
 #  define USNIC_INI INI_SIG(fi_usnic_ini)
-#  define USNIC_INIT fi_usnic_ini()
+#  define USNIC_INIT fi_usnic_ini
 USNIC_INI ;
 #else
 #  define USNIC_INIT NULL
@@ -119,7 +120,7 @@ USNIC_INI ;
 #  define MLX_INIT NULL
 #elif (HAVE_MLX)
 #  define MLX_INI INI_SIG(fi_mlx_ini)
-#  define MLX_INIT fi_mlx_ini()
+#  define MLX_INIT fi_mlx_ini
 MLX_INI ;
 #else
 #  define MLX_INIT NULL
@@ -130,7 +131,7 @@ MLX_INI ;
 #  define UDP_INIT NULL
 #elif (HAVE_UDP)
 #  define UDP_INI INI_SIG(fi_udp_ini)
-#  define UDP_INIT fi_udp_ini()
+#  define UDP_INIT fi_udp_ini
 UDP_INI ;
 #else
 #  define UDP_INIT NULL
@@ -141,7 +142,7 @@ UDP_INI ;
 #  define RXM_INIT NULL
 #elif (HAVE_RXM)
 #  define RXM_INI INI_SIG(fi_rxm_ini)
-#  define RXM_INIT fi_rxm_ini()
+#  define RXM_INIT fi_rxm_ini
 RXM_INI ;
 #else
 #  define RXM_INIT NULL
@@ -152,18 +153,29 @@ RXM_INI ;
 #  define RXD_INIT NULL
 #elif (HAVE_RXD)
 #  define RXD_INI INI_SIG(fi_rxd_ini)
-#  define RXD_INIT fi_rxd_ini()
+#  define RXD_INIT fi_rxd_ini
 RXD_INI ;
 #else
 #  define RXD_INIT NULL
 #endif
 
+#if (HAVE_SHM) && (HAVE_SHM_DL)
+#  define SHM_INI FI_EXT_INI
+#  define SHM_INIT NULL
+#elif (HAVE_SHM)
+#  define SHM_INI INI_SIG(fi_shm_ini)
+#  define SHM_INIT fi_shm_ini
+SHM_INI ;
+#else
+#  define SHM_INIT NULL
+#endif
+
 #if (HAVE_BGQ) && (HAVE_BGQ_DL)
 #  define BGQ_INI FI_EXT_INI
 #  define BGQ_INIT NULL
 #elif (HAVE_BGQ)
 #  define BGQ_INI INI_SIG(fi_bgq_ini)
-#  define BGQ_INIT fi_bgq_ini()
+#  define BGQ_INIT fi_bgq_ini
 BGQ_INI ;
 #else
 #  define BGQ_INIT NULL
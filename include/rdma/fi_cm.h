@@ -34,6 +34,7 @@
 #define FI_CM_H
 
 #include <rdma/fi_endpoint.h>
+#include <rdma/fi_errno.h>
 
 
 #ifdef __cplusplus
@@ -53,6 +54,8 @@ struct fi_ops_cm {
 	int	(*reject)(struct fid_pep *pep, fid_t handle,
 			const void *param, size_t paramlen);
 	int	(*shutdown)(struct fid_ep *ep, uint64_t flags);
+	int	(*join)(struct fid_ep *ep, const void *addr, uint64_t flags,
+			struct fid_mc **mc, void *context);
 };
 
 
@@ -109,6 +112,19 @@ static inline int fi_shutdown(struct fid_ep *ep, uint64_t flags)
 	return ep->cm->shutdown(ep, flags);
 }
 
+static inline int
+fi_join(struct fid_ep *ep, const void *addr, uint64_t flags,
+	struct fid_mc **mc, void *context)
+{
+	return FI_CHECK_OP(ep->cm, struct fi_ops_cm, join) ?
+		ep->cm->join(ep, addr, flags, mc, context) : -FI_ENOSYS;
+}
+
+static inline fi_addr_t fi_mc_addr(struct fid_mc *mc)
+{
+	return mc->fi_addr;
+}
+
 #endif
 
 #ifdef __cplusplus
@@ -94,6 +94,14 @@ struct fid_mr {
 	uint64_t		key;
 };
 
+/*
+ * Multicast group membership, returned by fi_join.
+ */
+struct fid_mc {
+	struct fid		fid;
+	fi_addr_t		fi_addr;
+};
+
 struct fi_mr_attr {
 	const struct iovec	*mr_iov;
 	size_t			iov_count;
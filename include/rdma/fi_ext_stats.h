@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2017 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FI_EXT_STATS_H
+#define FI_EXT_STATS_H
+
+#include <rdma/fabric.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Provider statistics.  Objects that keep statistics return these ops
+ * from fi_open_ops(fid, FI_STATS_OPS_1, 0, &ops, NULL); others fail the
+ * call with -FI_ENOSYS.  Statistics are event counts since the object was
+ * opened or last reset.
+ */
+#define FI_STATS_OPS_1 "stats ops 1"
+
+struct fi_stat {
+	const char	*name;
+	uint64_t	value;
+};
+
+struct fi_ops_stats {
+	size_t	size;
+	/* Fills up to count entries and returns the number available */
+	ssize_t	(*read)(struct fid *fid, struct fi_stat *stats, size_t count);
+	int	(*reset)(struct fid *fid);
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FI_EXT_STATS_H */
@@ -52,6 +52,7 @@
 #include <fi_rbuf.h>
 #include <fi_list.h>
 #include <fi_util.h>
+#include <fi_atomic_op.h>
 
 #ifndef _RXD_H_
 #define _RXD_H_
@@ -65,6 +66,7 @@
 #define RXD_DEF_CQ_CNT		(8)
 #define RXD_DEF_EP_CNT 		(8)
 #define RXD_AV_DEF_COUNT	(128)
+#define RXD_MAX_EP_CTX		(32)
 
 #define RXD_MAX_TX_BITS 	(10)
 #define RXD_MAX_RX_BITS 	(10)
@@ -73,16 +75,25 @@
 #define RXD_TX_IDX_BITS		((1ULL << RXD_MAX_TX_BITS) - 1)
 #define RXD_RX_IDX_BITS		((1ULL << RXD_MAX_RX_BITS) - 1)
 
+/* tx index carried by injected messages, which have no tx entry */
+#define RXD_INJECT_TX_IDX	(0)
+
 #define RXD_BUF_POOL_ALIGNMENT	(16)
 #define RXD_TX_POOL_CHUNK_CNT	(1024)
 #define RXD_RX_POOL_CHUNK_CNT	(1024)
 
 #define RXD_MAX_RX_WIN		(16)
 #define RXD_MAX_OUT_TX_MSG	(8)
+#define RXD_MAX_OUT_INJECT	(32)
+#define RXD_INJECT_SIZE		(1024)
+#define RXD_MAX_COALESCE_SZ	(256)
+#define RXD_MAX_DELAYED_ACK	(4)
 #define RXD_MAX_UNACKED		(128)
 
 #define RXD_EP_MAX_UNEXP_PKT	(512)
 #define RXD_EP_MAX_UNEXP_MSG	(128)
+#define RXD_SRX_EP_RX_CNT	(2 * RXD_MAX_RX_WIN)
+#define RXD_MIN_MULTI_RECV	(64)
 
 #define RXD_USE_OP_FLAGS	(1ULL << 61)
 #define RXD_NO_COMPLETION	(1ULL << 62)
@@ -92,6 +103,7 @@
 #define RXD_RETRY_TIMEOUT	(900)
 #define RXD_WAIT_TIMEOUT	(2000)
 #define RXD_MAX_PKT_RETRY	(50)
+#define RXD_MAX_PROGRESS_SKIP	(16)
 
 #define RXD_PKT_LOCAL_ACK	(1)
 #define RXD_PKT_REMOTE_ACK	(1 << 1)
@@ -106,6 +118,9 @@ extern struct fi_info rxd_info;
 extern struct fi_fabric_attr rxd_fabric_attr;
 extern struct util_prov rxd_util_prov;
 extern struct fi_ops_rma rxd_ops_rma;
+extern struct fi_ops_atomic rxd_ops_atomic;
+extern int rxd_coalesce_us;
+extern int rxd_ack_delay_us;
 
 enum {
 	RXD_PKT_ORDR_OK = 0,
@@ -120,14 +135,31 @@ enum {
 	RXD_TX_WRITE,
 	RXD_TX_READ_REQ,
 	RXD_TX_READ_RSP,
+	RXD_TX_ATOMIC,
+	RXD_TX_ATOMIC_FETCH,
 };
 
+/* ofi_op_hdr::op_data for ofi_op_atomic: the initiator wants the old value */
+#define RXD_ATOMIC_FETCH	(1 << 0)
+
 enum {
 	RXD_PKT_STRT = 0,
 	RXD_PKT_DATA,
 	RXD_PKT_LAST,
 };
 
+/* Endpoint statistics */
+enum {
+	RXD_STAT_RETRANSMIT,
+	RXD_STAT_RETRY_FAILED,
+	RXD_STAT_PKT_POOL_GROW,
+	RXD_STAT_ACK_SENT,
+	RXD_STAT_ACK_PKT_SENT,
+	RXD_STAT_ACK_PIGGYBACK,
+	RXD_STAT_ACK_RECV,
+	RXD_STAT_MAX
+};
+
 struct rxd_fabric {
 	struct util_fabric util_fabric;
 	struct fid_fabric *dg_fabric;
@@ -148,6 +180,7 @@ struct rxd_domain {
 	struct dlist_entry cq_list;
 	struct ofi_util_mr *mr_heap;
 	fastlock_t mr_lock;
+	fastlock_t atomic_lock;
 };
 
 struct rxd_av {
@@ -182,7 +215,43 @@ struct rxd_peer {
 	uint8_t addr_published;
 	uint8_t conn_initiated;
 	uint16_t num_msg_out;
-	uint8_t pad[4];
+	uint16_t num_inject_out;
+	uint16_t num_acks;
+
+	/* open ofi_ctrl_batch packet, see rxd_ep_post_inject */
+	struct rxd_pkt_meta *batch;
+	/* acks held back for the peer, see rxd_ep_queue_ack */
+	struct rxd_pkt_meta *acks;
+};
+
+/*
+ * Receive side state that may be shared between endpoints: the pool of
+ * packet buffers posted to the DGRAM endpoints, posted application
+ * receives, and messages that arrived before a matching receive.  Each
+ * endpoint has a private context unless bound to one opened through
+ * fi_srx_context.  Lock ordering is ep->lock, then rx_ctx->lock.
+ */
+struct rxd_rx_ctx {
+	struct fid_ep ep;
+	struct rxd_domain *domain;
+	uint64_t caps;
+	size_t rx_size;
+	int do_local_mr;
+	atomic_t ref;
+	fastlock_t lock;
+
+	struct util_buf_pool *rx_pkt_pool;
+
+	struct rxd_recv_fs *recv_fs;
+	struct dlist_entry recv_list;
+
+	struct rxd_trecv_fs *trecv_fs;
+	struct dlist_entry trecv_list;
+
+	struct dlist_entry unexp_tag_list;
+	struct dlist_entry unexp_msg_list;
+	uint16_t num_unexp_msg;
+	size_t min_multi_recv;
 };
 
 struct rxd_ep {
@@ -190,10 +259,18 @@ struct rxd_ep {
 	struct fid_ep *dg_ep;
 
 	struct rxd_domain *domain;
+	struct rxd_rx_ctx *rx_ctx;
 	struct rxd_cq *rx_cq;
 	struct rxd_cq *tx_cq;
 	struct rxd_av *av;
 
+	struct util_cntr *tx_cntr;
+	struct util_cntr *rx_cntr;
+	struct util_cntr *rd_cntr;
+	struct util_cntr *wr_cntr;
+	struct util_cntr *rem_rd_cntr;
+	struct util_cntr *rem_wr_cntr;
+
 	struct rxd_peer *peer_info;
 	size_t max_peers;
 
@@ -205,34 +282,30 @@ struct rxd_ep {
 	size_t rx_size;
 	size_t credits;
 	uint64_t num_out;
+	size_t inject_size;
 
 	int do_local_mr;
 	uint64_t caps;
 
 	struct dlist_entry dom_entry;
+	int progress_skip;
 	struct dlist_entry wait_rx_list;
 
-	struct dlist_entry unexp_tag_list;
-	struct dlist_entry unexp_msg_list;
 	uint16_t num_unexp_pkt;
-	uint16_t num_unexp_msg;
 
 	struct util_buf_pool *tx_pkt_pool;
-	struct util_buf_pool *rx_pkt_pool;
 	struct slist rx_pkt_list;
 
 	struct rxd_tx_entry_fs *tx_entry_fs;
 	struct dlist_entry tx_entry_list;
+	struct dlist_entry inject_pkt_list;
+	struct dlist_entry batch_list;
+	struct dlist_entry ack_list;
 
 	struct rxd_rx_entry_fs *rx_entry_fs;
 	struct dlist_entry rx_entry_list;
-
-	struct rxd_recv_fs *recv_fs;
-	struct dlist_entry recv_list;
-
-	struct rxd_trecv_fs *trecv_fs;
-	struct dlist_entry trecv_list;
 	fastlock_t lock;
+	struct ofi_stats stats;
 };
 
 struct rxd_unexp_cq_entry {
@@ -245,10 +318,23 @@ struct rxd_rx_buf {
 	struct slist_entry entry;
 	struct rxd_ep *ep;
 	struct fid_mr *mr;
+	/* messages of an ofi_ctrl_batch packet still using the buffer */
+	uint32_t ref;
+	uint8_t pad[4];
 	char buf[];
 };
 
+struct rxd_recv_entry {
+	struct dlist_entry entry;
+	struct fi_msg msg;
+	uint64_t flags;
+	struct iovec iov[RXD_IOV_LIMIT];
+	void *desc[RXD_IOV_LIMIT];
+};
+DECLARE_FREESTACK(struct rxd_recv_entry, rxd_recv_fs);
+
 struct rxd_rx_entry {
+	struct rxd_ep *ep;
 	struct ofi_op_hdr op_hdr;
 	uint32_t exp_seg_no;
 	uint64_t msg_id;
@@ -256,10 +342,12 @@ struct rxd_rx_entry {
 	uint64_t done;
 	uint64_t peer;
 	uint16_t window;
+	uint8_t batched;
 	uint32_t last_win_seg;
 	fi_addr_t source;
 	struct rxd_peer *peer_info;
 	struct rxd_rx_buf *unexp_buf;
+	struct rxd_pkt_data_start *unexp_pkt;
 	uint64_t nack_stamp;
 	struct dlist_entry entry;
 
@@ -280,6 +368,9 @@ struct rxd_rx_entry {
 		struct dlist_entry wait_entry;
 		struct dlist_entry unexp_entry;
 	};
+
+	/* Part of an FI_MULTI_RECV buffer consumed by this message */
+	struct rxd_recv_entry multi_recv;
 };
 DECLARE_FREESTACK(struct rxd_rx_entry, rxd_rx_entry_fs);
 
@@ -329,19 +420,20 @@ struct rxd_tx_entry {
 			uint8_t iov_count;
 			struct iovec src_iov[RXD_IOV_LIMIT];
 		} read_rsp;
+
+		struct {
+			struct fi_msg_atomic msg;
+			struct iovec src_iov[RXD_IOV_LIMIT];
+			struct iovec cmp_iov[RXD_IOV_LIMIT];
+			struct iovec res_iov[RXD_IOV_LIMIT];
+			struct fi_rma_ioc dst_ioc[RXD_IOV_LIMIT];
+			uint8_t cmp_count;
+			uint8_t res_count;
+		} atomic;
 	};
 };
 DECLARE_FREESTACK(struct rxd_tx_entry, rxd_tx_entry_fs);
 
-struct rxd_recv_entry {
-	struct dlist_entry entry;
-	struct fi_msg msg;
-	uint64_t flags;
-	struct iovec iov[RXD_IOV_LIMIT];
-	void *desc[RXD_IOV_LIMIT];
-};
-DECLARE_FREESTACK(struct rxd_recv_entry, rxd_recv_fs);
-
 struct rxd_trecv_entry {
 	struct dlist_entry entry;
 	struct fi_msg_tagged msg;
@@ -367,12 +459,28 @@ struct rxd_pkt_data {
 #define RXD_DATA_PKT_SZ (sizeof(struct rxd_pkt_data))
 #define RXD_MAX_DATA_PKT_SZ(ep)	(ep->domain->max_mtu_sz - RXD_DATA_PKT_SZ)
 
+/*
+ * An ofi_ctrl_batch packet is an rxd_pkt_data whose data holds seg_no
+ * complete start packets, each padded to 8 bytes.  seg_size is the total
+ * length of those, and msg_id is that of the first one.
+ */
+#define RXD_BATCH_MSG_SZ(data_sz) \
+	fi_get_aligned_sz(RXD_START_DATA_PKT_SZ + (data_sz), 8)
+
+/*
+ * Further acks may follow the header of an ofi_ctrl_ack packet, or the
+ * payload of a start, data or batch packet, as complete ofi_ctrl_hdr's.
+ * Their number is given by the received length.
+ */
+#define RXD_ACK_SZ (sizeof(struct ofi_ctrl_hdr))
+
 struct rxd_pkt_meta {
 	struct fi_context context;
 	struct dlist_entry entry;
 	struct rxd_tx_entry *tx_entry;
 	struct rxd_ep *ep;
 	struct fid_mr *mr;
+	fi_addr_t peer;
 	uint64_t us_stamp;
 	uint8_t ref;
 	uint8_t type;
@@ -395,6 +503,10 @@ int rxd_endpoint(struct fid_domain *domain, struct fi_info *info,
 		 struct fid_ep **ep, void *context);
 int rxd_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 		struct fid_cq **cq_fid, void *context);
+int rxd_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
+		  struct fid_cntr **cntr_fid, void *context);
+int rxd_srx_context(struct fid_domain *domain, struct fi_rx_attr *attr,
+		    struct fid_ep **rx_ep, void *context);
 
 
 /* AV sub-functions */
@@ -406,12 +518,16 @@ int rxd_av_dg_reverse_lookup(struct rxd_av *av, uint64_t start_idx,
 
 /* EP sub-functions */
 void rxd_ep_lock_if_required(struct rxd_ep *rxd_ep);
+int rxd_ep_trylock_if_required(struct rxd_ep *rxd_ep);
 void rxd_ep_unlock_if_required(struct rxd_ep *rxd_ep);
 int rxd_ep_repost_buff(struct rxd_rx_buf *rx_buf);
 void rxd_ep_progress(struct rxd_ep *ep);
 int rxd_ep_reply_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *in_ctrl,
 		     uint8_t type, uint16_t seg_size, uint64_t rx_key,
 		     uint64_t source, fi_addr_t dest);
+int rxd_ep_queue_ack(struct rxd_ep *ep, struct rxd_peer *peer,
+		     struct ofi_ctrl_hdr *in_ctrl, uint64_t rx_key,
+		     fi_addr_t dest);
 int rxd_ep_reply_nack(struct rxd_ep *ep, struct ofi_ctrl_hdr *in_ctrl,
 		      uint32_t seg_no, uint64_t rx_key,
 		      uint64_t source, fi_addr_t dest);
@@ -420,8 +536,11 @@ int rxd_ep_reply_discard(struct rxd_ep *ep, struct ofi_ctrl_hdr *in_ctrl,
 			 uint64_t source, fi_addr_t dest);
 struct rxd_peer *rxd_ep_getpeer_info(struct rxd_ep *rxd_ep, fi_addr_t addr);
 
-void rxd_ep_check_unexp_msg_list(struct rxd_ep *ep, struct rxd_recv_entry *recv_entry);
-void rxd_ep_check_unexp_tag_list(struct rxd_ep *ep, struct rxd_trecv_entry *trecv_entry);
+void rxd_ep_progress_unexp_msg(struct rxd_rx_entry *rx_entry);
+struct rxd_rx_entry *rxd_rx_ctx_match_unexp_msg(struct rxd_rx_ctx *rx_ctx,
+					struct rxd_recv_entry *recv_entry);
+struct rxd_rx_entry *rxd_rx_ctx_match_unexp_tag(struct rxd_rx_ctx *rx_ctx,
+					struct rxd_trecv_entry *trecv_entry);
 void rxd_ep_handle_data_msg(struct rxd_ep *ep, struct rxd_peer *peer,
 			    struct rxd_rx_entry *rx_entry,
 			    struct iovec *iov, size_t iov_count,
@@ -429,7 +548,7 @@ void rxd_ep_handle_data_msg(struct rxd_ep *ep, struct rxd_peer *peer,
 			    struct rxd_rx_buf *rx_buf);
 void rxd_ep_free_acked_pkts(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
 			    uint32_t seg_no);
-int rxd_ep_retry_pkt(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
+int rxd_ep_retry_pkt(struct rxd_ep *ep, fi_addr_t addr,
 		     struct rxd_pkt_meta *pkt);
 void rxd_ep_copy_msg_iov(const struct iovec *src_iov,
 			 struct iovec *dst_iov, size_t iov_count);
@@ -441,6 +560,13 @@ ssize_t rxd_ep_post_conn_msg(struct rxd_ep *ep, struct rxd_peer *peer,
 			     fi_addr_t addr);
 int rxd_mr_verify(struct rxd_domain *rxd_domain, ssize_t len,
 		  uintptr_t *io_addr, uint64_t key, uint64_t access);
+void rxd_ep_handle_read_req(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
+			    struct rxd_peer *peer);
+int rxd_atomic_verify(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl,
+		      struct rxd_pkt_data_start *pkt_start);
+int rxd_ep_handle_atomic(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry,
+			 struct rxd_peer *peer, struct ofi_ctrl_hdr *ctrl,
+			 struct rxd_pkt_data_start *pkt_start);
 
 
 /* Tx/Rx entry sub-functions */
@@ -449,6 +575,8 @@ struct rxd_tx_entry *rxd_tx_entry_acquire_fast(struct rxd_ep *ep, struct rxd_pee
 int rxd_tx_entry_progress(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
 			  struct ofi_ctrl_hdr *ack);
 void rxd_tx_entry_discard(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry);
+void rxd_tx_entry_error(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
+			int err);
 void rxd_tx_entry_release(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry);
 void rxd_tx_entry_done(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry);
 
@@ -459,8 +587,15 @@ void rxd_rx_entry_release(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry);
 
 /* CQ sub-functions */
 void rxd_cq_progress(struct util_cq *util_cq);
+void rxd_cq_try_progress(struct rxd_cq *cq);
 void rxd_cq_report_error(struct rxd_cq *cq, struct fi_cq_err_entry *err_entry);
 void rxd_cq_report_tx_comp(struct rxd_cq *cq, struct rxd_tx_entry *tx_entry);
+void rxd_cq_report_tx_err(struct rxd_cq *cq, struct rxd_tx_entry *tx_entry,
+			  int err);
 void rxd_cq_report_rx_comp(struct rxd_cq *cq, struct rxd_rx_entry *rx_entry);
+void rxd_report_rx_comp(struct rxd_cq *cq, struct rxd_rx_entry *rx_entry);
+void rxd_cntr_report_tx_comp(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry);
+void rxd_cntr_report_tx_err(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry);
+void rxd_cntr_report_rx_comp(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry);
 
 #endif
@@ -0,0 +1,586 @@
+/*
+ * Copyright (c) 2013-2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rxd.h"
+
+/*
+ * Atomics are carried in a single start packet: the target ioc array,
+ * followed by the source and compare operands.  The target applies the
+ * operation once the packet is in order, so duplicates are never
+ * reapplied.  Fetched data is returned with ofi_op_read_rsp, which the
+ * target builds in the unused tail of the request buffer; fetching ops
+ * are therefore limited to half of the packet payload.
+ */
+static size_t rxd_atomic_max_len(struct rxd_ep *ep, size_t ioc_count,
+				 int fetch)
+{
+	size_t ioc_sz = sizeof(struct ofi_rma_ioc) * ioc_count;
+
+	return (RXD_MAX_STRT_DATA_PKT_SZ(ep) - ioc_sz) / (fetch ? 2 : 1);
+}
+
+static size_t rxd_ioc_to_iov(const struct fi_ioc *ioc, struct iovec *iov,
+			     size_t count, size_t dt_size)
+{
+	size_t i, len = 0;
+
+	for (i = 0; i < count; i++) {
+		iov[i].iov_base = ioc[i].addr;
+		iov[i].iov_len = ioc[i].count * dt_size;
+		len += iov[i].iov_len;
+	}
+	return len;
+}
+
+static ssize_t rxd_ep_atomic_common(struct fid_ep *ep,
+				    const struct fi_msg_atomic *msg,
+				    const struct fi_ioc *comparev,
+				    size_t compare_count,
+				    struct fi_ioc *resultv, size_t result_count,
+				    uint64_t flags)
+{
+	ssize_t ret;
+	size_t i, dt_size, len;
+	uint64_t peer_addr;
+	uint8_t op_type;
+	struct rxd_ep *rxd_ep;
+	struct rxd_peer *peer;
+	struct rxd_tx_entry *tx_entry;
+	rxd_ep = container_of(ep, struct rxd_ep, ep);
+
+#if ENABLE_DEBUG
+	if (msg->iov_count > RXD_IOV_LIMIT ||
+	    msg->rma_iov_count > RXD_IOV_LIMIT ||
+	    compare_count > RXD_IOV_LIMIT ||
+	    result_count > RXD_IOV_LIMIT)
+		return -FI_EINVAL;
+#endif
+
+	op_type = result_count ? RXD_TX_ATOMIC_FETCH : RXD_TX_ATOMIC;
+	ret = ofi_atomic_valid(&rxd_prov, msg->datatype, msg->op,
+			       op_type == RXD_TX_ATOMIC_FETCH);
+	if (ret)
+		return ret;
+
+	dt_size = fi_datatype_size(msg->datatype);
+	for (i = 0, len = 0; i < msg->iov_count; i++)
+		len += msg->msg_iov[i].count * dt_size;
+	if (len > rxd_atomic_max_len(rxd_ep, msg->rma_iov_count,
+				     op_type == RXD_TX_ATOMIC_FETCH))
+		return -FI_EINVAL;
+
+	peer_addr = rxd_av_get_dg_addr(rxd_ep->av, msg->addr);
+	peer = rxd_ep_getpeer_info(rxd_ep, peer_addr);
+
+	rxd_ep_lock_if_required(rxd_ep);
+	if (!peer->addr_published) {
+		ret = rxd_ep_post_conn_msg(rxd_ep, peer, peer_addr);
+		ret = (ret) ? ret : -FI_EAGAIN;
+		goto out;
+	}
+
+	tx_entry = rxd_tx_entry_acquire(rxd_ep, peer);
+	if (!tx_entry) {
+		ret = -FI_EAGAIN;
+		goto out;
+	}
+
+	dlist_init(&tx_entry->pkt_list);
+	tx_entry->op_type = op_type;
+	tx_entry->atomic.msg = *msg;
+	tx_entry->flags = flags;
+	tx_entry->peer = peer_addr;
+
+	/* atomic read only fetches, the source buffer is not sent */
+	if (msg->op == FI_ATOMIC_READ)
+		tx_entry->atomic.msg.iov_count = 0;
+	rxd_ioc_to_iov(msg->msg_iov, tx_entry->atomic.src_iov,
+		       tx_entry->atomic.msg.iov_count, dt_size);
+	rxd_ioc_to_iov(comparev, tx_entry->atomic.cmp_iov,
+		       compare_count, dt_size);
+	tx_entry->atomic.cmp_count = compare_count;
+	rxd_ioc_to_iov(resultv, tx_entry->atomic.res_iov,
+		       result_count, dt_size);
+	tx_entry->atomic.res_count = result_count;
+	for (i = 0; i < msg->rma_iov_count; i++)
+		tx_entry->atomic.dst_ioc[i] = msg->rma_iov[i];
+
+	ret = rxd_ep_post_start_msg(rxd_ep, peer, ofi_op_atomic, tx_entry);
+	if (ret)
+		goto err;
+
+	dlist_insert_tail(&tx_entry->entry, &rxd_ep->tx_entry_list);
+out:
+	rxd_ep_unlock_if_required(rxd_ep);
+	return ret;
+err:
+	rxd_tx_entry_release(rxd_ep, tx_entry);
+	goto out;
+}
+
+/*
+ * Check an atomic request against its start packet and the target's MRs.
+ * Fetching ops other than FI_ATOMIC_READ both read and write the target
+ * buffer, so they need FI_REMOTE_READ and FI_REMOTE_WRITE access.
+ */
+int rxd_atomic_verify(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl,
+		      struct rxd_pkt_data_start *pkt_start)
+{
+	struct ofi_op_hdr *op_hdr = &pkt_start->op;
+	struct ofi_rma_ioc *ioc;
+	size_t i, dt_size, len, src_len;
+	uint64_t access;
+	uint8_t op, datatype;
+	int fetch, ret;
+
+	op = op_hdr->atomic.op;
+	datatype = op_hdr->atomic.datatype;
+	fetch = op_hdr->op_data & RXD_ATOMIC_FETCH;
+	if (op_hdr->atomic.ioc_count > RXD_IOV_LIMIT ||
+	    ofi_atomic_valid(&rxd_prov, datatype, op, fetch))
+		goto inval;
+
+	dt_size = fi_datatype_size(datatype);
+	ioc = (struct ofi_rma_ioc *) pkt_start->data;
+	for (i = 0, len = 0; i < op_hdr->atomic.ioc_count; i++)
+		len += ioc[i].count * dt_size;
+
+	src_len = (op == FI_ATOMIC_READ) ? 0 : len;
+	if (op_hdr->size != src_len + (ofi_atomic_isswap_op(op) ? len : 0) ||
+	    ctrl->seg_size != sizeof(*ioc) * op_hdr->atomic.ioc_count +
+			      op_hdr->size ||
+	    len > rxd_atomic_max_len(ep, op_hdr->atomic.ioc_count, fetch))
+		goto inval;
+
+	if (op == FI_ATOMIC_READ)
+		access = FI_REMOTE_READ;
+	else if (fetch)
+		access = FI_REMOTE_READ | FI_REMOTE_WRITE;
+	else
+		access = FI_REMOTE_WRITE;
+
+	for (i = 0; i < op_hdr->atomic.ioc_count; i++) {
+		ret = rxd_mr_verify(ep->domain, ioc[i].count * dt_size,
+				    (uintptr_t *) &ioc[i].addr,
+				    ioc[i].key, access);
+		if (ret) {
+			FI_WARN(&rxd_prov, FI_LOG_EP_CTRL,
+				"invalid key/access permissions\n");
+			return -FI_EACCES;
+		}
+	}
+	return 0;
+
+inval:
+	FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "invalid atomic request\n");
+	return -FI_EINVAL;
+}
+
+/*
+ * A request that fails rxd_atomic_verify is not applied.  The target
+ * answers it with a discard carrying the error, which the initiator
+ * reports as a CQ error.
+ */
+int rxd_ep_handle_atomic(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry,
+			 struct rxd_peer *peer, struct ofi_ctrl_hdr *ctrl,
+			 struct rxd_pkt_data_start *pkt_start)
+{
+	struct ofi_op_hdr *op_hdr = &rx_entry->op_hdr;
+	struct ofi_rma_ioc *ioc;
+	struct rxd_tx_entry *tx_entry = NULL;
+	size_t i, dt_size, len, src_len, ioc_sz, offset;
+	uint8_t op, datatype;
+	char *src, *cmp, *res;
+	int fetch, ret;
+
+	ret = rxd_atomic_verify(ep, ctrl, pkt_start);
+	if (ret) {
+		ep->credits++;
+		rxd_ep_reply_discard(ep, ctrl, -ret, rx_entry->key,
+				     peer->conn_data, ctrl->conn_id);
+		rxd_rx_entry_release(ep, rx_entry);
+		return ret;
+	}
+
+	op = op_hdr->atomic.op;
+	datatype = op_hdr->atomic.datatype;
+	fetch = op_hdr->op_data & RXD_ATOMIC_FETCH;
+	dt_size = fi_datatype_size(datatype);
+	ioc = (struct ofi_rma_ioc *) pkt_start->data;
+	ioc_sz = sizeof(*ioc) * op_hdr->atomic.ioc_count;
+	for (i = 0, len = 0; i < op_hdr->atomic.ioc_count; i++)
+		len += ioc[i].count * dt_size;
+	src_len = (op == FI_ATOMIC_READ) ? 0 : len;
+
+	if (fetch) {
+		tx_entry = rxd_tx_entry_acquire_fast(ep, peer);
+		if (!tx_entry) {
+			FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "no free tx-entry\n");
+			return -FI_ENOMEM;
+		}
+	}
+
+	/* Results overwrite the compare operand, or the free tail */
+	src = pkt_start->data + ioc_sz;
+	cmp = src + src_len;
+	res = cmp;
+
+	fastlock_acquire(&ep->domain->atomic_lock);
+	for (i = 0, offset = 0; i < op_hdr->atomic.ioc_count; i++) {
+		if (ofi_atomic_isswap_op(op))
+			ofi_atomic_swap_handler(op, datatype,
+				(void *) (uintptr_t) ioc[i].addr, src + offset,
+				cmp + offset, res + offset, ioc[i].count);
+		else if (fetch)
+			ofi_atomic_readwrite_handler(op, datatype,
+				(void *) (uintptr_t) ioc[i].addr, src + offset,
+				res + offset, ioc[i].count);
+		else
+			ofi_atomic_write_handler(op, datatype,
+				(void *) (uintptr_t) ioc[i].addr, src + offset,
+				ioc[i].count);
+		offset += ioc[i].count * dt_size;
+	}
+	fastlock_release(&ep->domain->atomic_lock);
+
+	ep->credits++;
+	if (fetch) {
+		/* The response fits in its start packet, which copies it out
+		 * of the request buffer before that buffer is reposted. */
+		tx_entry->peer = rx_entry->peer;
+		tx_entry->read_rsp.iov_count = 1;
+		tx_entry->read_rsp.src_iov[0].iov_base = res;
+		tx_entry->read_rsp.src_iov[0].iov_len = len;
+		tx_entry->read_rsp.peer_msg_id = ctrl->msg_id;
+		rxd_ep_handle_read_req(ep, tx_entry, peer);
+	} else {
+		rxd_ep_reply_ack(ep, ctrl, ofi_ctrl_ack, 0, rx_entry->key,
+				 peer->conn_data, ctrl->conn_id);
+	}
+
+	rxd_cntr_report_rx_comp(ep, rx_entry);
+	rxd_report_rx_comp(ep->rx_cq, rx_entry);
+	rxd_rx_entry_release(ep, rx_entry);
+	return 0;
+}
+
+static ssize_t rxd_ep_atomic_writemsg(struct fid_ep *ep,
+				      const struct fi_msg_atomic *msg,
+				      uint64_t flags)
+{
+	if (!ofi_atomic_iswrite_op(msg->op))
+		return -FI_EINVAL;
+
+	return rxd_ep_atomic_common(ep, msg, NULL, 0, NULL, 0, flags);
+}
+
+static ssize_t rxd_ep_atomic_writev(struct fid_ep *ep,
+				    const struct fi_ioc *iov, void **desc,
+				    size_t count, fi_addr_t dest_addr,
+				    uint64_t addr, uint64_t key,
+				    enum fi_datatype datatype, enum fi_op op,
+				    void *context)
+{
+	size_t i;
+	struct fi_msg_atomic msg;
+	struct fi_rma_ioc rma_ioc;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.desc = desc;
+	msg.iov_count = count;
+
+	rma_ioc.addr = addr;
+	rma_ioc.key = key;
+	for (i = 0, rma_ioc.count = 0; i < count; i++)
+		rma_ioc.count += iov[i].count;
+	msg.rma_iov = &rma_ioc;
+	msg.rma_iov_count = 1;
+
+	msg.addr = dest_addr;
+	msg.datatype = datatype;
+	msg.op = op;
+	msg.context = context;
+
+	return rxd_ep_atomic_writemsg(ep, &msg, RXD_USE_OP_FLAGS);
+}
+
+static ssize_t rxd_ep_atomic_write(struct fid_ep *ep, const void *buf,
+				   size_t count, void *desc,
+				   fi_addr_t dest_addr, uint64_t addr,
+				   uint64_t key, enum fi_datatype datatype,
+				   enum fi_op op, void *context)
+{
+	struct fi_ioc ioc;
+
+	ioc.addr = (void *) buf;
+	ioc.count = count;
+	return rxd_ep_atomic_writev(ep, &ioc, &desc, 1, dest_addr, addr,
+				    key, datatype, op, context);
+}
+
+static ssize_t rxd_ep_atomic_inject(struct fid_ep *ep, const void *buf,
+				    size_t count, fi_addr_t dest_addr,
+				    uint64_t addr, uint64_t key,
+				    enum fi_datatype datatype, enum fi_op op)
+{
+	struct fi_msg_atomic msg;
+	struct fi_ioc ioc;
+	struct fi_rma_ioc rma_ioc;
+
+	memset(&msg, 0, sizeof(msg));
+	ioc.addr = (void *) buf;
+	ioc.count = count;
+	msg.msg_iov = &ioc;
+	msg.iov_count = 1;
+
+	rma_ioc.addr = addr;
+	rma_ioc.count = count;
+	rma_ioc.key = key;
+	msg.rma_iov = &rma_ioc;
+	msg.rma_iov_count = 1;
+
+	msg.addr = dest_addr;
+	msg.datatype = datatype;
+	msg.op = op;
+
+	return rxd_ep_atomic_writemsg(ep, &msg, FI_INJECT |
+				      RXD_NO_COMPLETION | RXD_USE_OP_FLAGS);
+}
+
+static ssize_t rxd_ep_atomic_readwritemsg(struct fid_ep *ep,
+					  const struct fi_msg_atomic *msg,
+					  struct fi_ioc *resultv,
+					  void **result_desc,
+					  size_t result_count, uint64_t flags)
+{
+	if (!ofi_atomic_isreadwrite_op(msg->op) || !result_count)
+		return -FI_EINVAL;
+
+	return rxd_ep_atomic_common(ep, msg, NULL, 0, resultv,
+				    result_count, flags);
+}
+
+static ssize_t rxd_ep_atomic_readwritev(struct fid_ep *ep,
+					const struct fi_ioc *iov, void **desc,
+					size_t count, struct fi_ioc *resultv,
+					void **result_desc, size_t result_count,
+					fi_addr_t dest_addr, uint64_t addr,
+					uint64_t key, enum fi_datatype datatype,
+					enum fi_op op, void *context)
+{
+	size_t i;
+	struct fi_msg_atomic msg;
+	struct fi_rma_ioc rma_ioc;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.desc = desc;
+	msg.iov_count = count;
+
+	rma_ioc.addr = addr;
+	rma_ioc.key = key;
+	for (i = 0, rma_ioc.count = 0; i < count; i++)
+		rma_ioc.count += iov[i].count;
+	msg.rma_iov = &rma_ioc;
+	msg.rma_iov_count = 1;
+
+	msg.addr = dest_addr;
+	msg.datatype = datatype;
+	msg.op = op;
+	msg.context = context;
+
+	return rxd_ep_atomic_readwritemsg(ep, &msg, resultv, result_desc,
+					  result_count, RXD_USE_OP_FLAGS);
+}
+
+static ssize_t rxd_ep_atomic_readwrite(struct fid_ep *ep, const void *buf,
+				       size_t count, void *desc, void *result,
+				       void *result_desc, fi_addr_t dest_addr,
+				       uint64_t addr, uint64_t key,
+				       enum fi_datatype datatype,
+				       enum fi_op op, void *context)
+{
+	struct fi_ioc ioc, resultv;
+
+	ioc.addr = (void *) buf;
+	ioc.count = count;
+	resultv.addr = result;
+	resultv.count = count;
+	return rxd_ep_atomic_readwritev(ep, &ioc, &desc, 1, &resultv,
+					&result_desc, 1, dest_addr, addr, key,
+					datatype, op, context);
+}
+
+static ssize_t rxd_ep_atomic_compwritemsg(struct fid_ep *ep,
+					  const struct fi_msg_atomic *msg,
+					  const struct fi_ioc *comparev,
+					  void **compare_desc,
+					  size_t compare_count,
+					  struct fi_ioc *resultv,
+					  void **result_desc,
+					  size_t result_count, uint64_t flags)
+{
+	if (!ofi_atomic_isswap_op(msg->op) || !compare_count ||
+	    !result_count)
+		return -FI_EINVAL;
+
+	return rxd_ep_atomic_common(ep, msg, comparev, compare_count,
+				    resultv, result_count, flags);
+}
+
+static ssize_t rxd_ep_atomic_compwritev(struct fid_ep *ep,
+					const struct fi_ioc *iov, void **desc,
+					size_t count,
+					const struct fi_ioc *comparev,
+					void **compare_desc,
+					size_t compare_count,
+					struct fi_ioc *resultv,
+					void **result_desc,
+					size_t result_count,
+					fi_addr_t dest_addr, uint64_t addr,
+					uint64_t key, enum fi_datatype datatype,
+					enum fi_op op, void *context)
+{
+	size_t i;
+	struct fi_msg_atomic msg;
+	struct fi_rma_ioc rma_ioc;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.desc = desc;
+	msg.iov_count = count;
+
+	rma_ioc.addr = addr;
+	rma_ioc.key = key;
+	for (i = 0, rma_ioc.count = 0; i < count; i++)
+		rma_ioc.count += iov[i].count;
+	msg.rma_iov = &rma_ioc;
+	msg.rma_iov_count = 1;
+
+	msg.addr = dest_addr;
+	msg.datatype = datatype;
+	msg.op = op;
+	msg.context = context;
+
+	return rxd_ep_atomic_compwritemsg(ep, &msg, comparev, compare_desc,
+					  compare_count, resultv, result_desc,
+					  result_count, RXD_USE_OP_FLAGS);
+}
+
+static ssize_t rxd_ep_atomic_compwrite(struct fid_ep *ep, const void *buf,
+				       size_t count, void *desc,
+				       const void *compare, void *compare_desc,
+				       void *result, void *result_desc,
+				       fi_addr_t dest_addr, uint64_t addr,
+				       uint64_t key, enum fi_datatype datatype,
+				       enum fi_op op, void *context)
+{
+	struct fi_ioc ioc, comparev, resultv;
+
+	ioc.addr = (void *) buf;
+	ioc.count = count;
+	comparev.addr = (void *) compare;
+	comparev.count = count;
+	resultv.addr = result;
+	resultv.count = count;
+	return rxd_ep_atomic_compwritev(ep, &ioc, &desc, 1, &comparev,
+					&compare_desc, 1, &resultv,
+					&result_desc, 1, dest_addr, addr, key,
+					datatype, op, context);
+}
+
+static int rxd_ep_atomic_valid_common(struct fid_ep *ep,
+				      enum fi_datatype datatype, enum fi_op op,
+				      size_t *count, int fetch)
+{
+	struct rxd_ep *rxd_ep;
+	int ret;
+
+	ret = ofi_atomic_valid(&rxd_prov, datatype, op, fetch);
+	if (ret)
+		return ret;
+
+	rxd_ep = container_of(ep, struct rxd_ep, ep);
+	*count = rxd_atomic_max_len(rxd_ep, 1, fetch) /
+		 fi_datatype_size(datatype);
+	return 0;
+}
+
+static int rxd_ep_atomic_writevalid(struct fid_ep *ep,
+				    enum fi_datatype datatype, enum fi_op op,
+				    size_t *count)
+{
+	if (!ofi_atomic_iswrite_op(op))
+		return -FI_ENOENT;
+
+	return rxd_ep_atomic_valid_common(ep, datatype, op, count, 0);
+}
+
+static int rxd_ep_atomic_readwritevalid(struct fid_ep *ep,
+					enum fi_datatype datatype,
+					enum fi_op op, size_t *count)
+{
+	if (!ofi_atomic_isreadwrite_op(op))
+		return -FI_ENOENT;
+
+	return rxd_ep_atomic_valid_common(ep, datatype, op, count, 1);
+}
+
+static int rxd_ep_atomic_compwritevalid(struct fid_ep *ep,
+					enum fi_datatype datatype,
+					enum fi_op op, size_t *count)
+{
+	if (!ofi_atomic_isswap_op(op))
+		return -FI_ENOENT;
+
+	return rxd_ep_atomic_valid_common(ep, datatype, op, count, 1);
+}
+
+struct fi_ops_atomic rxd_ops_atomic = {
+	.size = sizeof(struct fi_ops_atomic),
+	.write = rxd_ep_atomic_write,
+	.writev = rxd_ep_atomic_writev,
+	.writemsg = rxd_ep_atomic_writemsg,
+	.inject = rxd_ep_atomic_inject,
+	.readwrite = rxd_ep_atomic_readwrite,
+	.readwritev = rxd_ep_atomic_readwritev,
+	.readwritemsg = rxd_ep_atomic_readwritemsg,
+	.compwrite = rxd_ep_atomic_compwrite,
+	.compwritev = rxd_ep_atomic_compwritev,
+	.compwritemsg = rxd_ep_atomic_compwritemsg,
+	.writevalid = rxd_ep_atomic_writevalid,
+	.readwritevalid = rxd_ep_atomic_readwritevalid,
+	.compwritevalid = rxd_ep_atomic_compwritevalid,
+};
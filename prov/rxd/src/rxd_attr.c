@@ -35,12 +35,13 @@
 #define RXD_EP_CAPS (FI_MSG | FI_RMA | FI_TAGGED | FI_DIRECTED_RECV |	\
 		     FI_READ | FI_WRITE | FI_RECV | FI_SEND |		\
 		     FI_REMOTE_READ | FI_REMOTE_WRITE | FI_SOURCE |	\
-		     FI_RMA_EVENT)
+		     FI_RMA_EVENT | FI_ATOMIC | FI_NAMED_RX_CTX |	\
+		     FI_MULTI_RECV)
 
 struct fi_tx_attr rxd_tx_attr = {
 	.caps = RXD_EP_CAPS,
 	.comp_order = FI_ORDER_STRICT,
-	.inject_size = 0,
+	.inject_size = RXD_INJECT_SIZE,
 	.size = (1ULL << RXD_MAX_TX_BITS),
 	.iov_limit = RXD_IOV_LIMIT,
 };
@@ -75,8 +76,9 @@ struct fi_domain_attr rxd_domain_attr = {
 	.ep_cnt = RXD_DEF_EP_CNT,
 	.tx_ctx_cnt = 1,
 	.rx_ctx_cnt = 1,
-	.max_ep_tx_ctx = 1,
-	.max_ep_rx_ctx = 1
+	.max_ep_tx_ctx = RXD_MAX_EP_CTX,
+	.max_ep_rx_ctx = RXD_MAX_EP_CTX,
+	.max_ep_srx_ctx = 1
 };
 
 struct fi_fabric_attr rxd_fabric_attr = {
@@ -98,5 +100,5 @@ struct fi_info rxd_info = {
 struct util_prov rxd_util_prov = {
 	.prov = &rxd_prov,
 	.info = &rxd_info,
-	.flags = 0,
+	.flags = UTIL_RX_SHARED_CTX,
 };
@@ -41,8 +41,7 @@ fi_addr_t rxd_av_get_dg_addr(struct rxd_av *av, fi_addr_t fi_addr)
 
 fi_addr_t rxd_av_get_fi_addr(struct rxd_av *av, fi_addr_t dg_addr)
 {
-	int ret = ofi_av_lookup_index(&av->util_av,
-				      &dg_addr, (int) dg_addr);
+	int ret = ofi_av_lookup_index(&av->util_av, &dg_addr);
 	return (ret == -FI_ENODATA) ? FI_ADDR_UNSPEC : ret;
 }
 
@@ -112,7 +111,7 @@ int rxd_av_insert_check(struct rxd_av *av, const void *addr, size_t count,
 			}
 		}
 
-		ret = ofi_av_insert_addr(&av->util_av, &dg_av_idx, dg_av_idx, &index);
+		ret = ofi_av_insert_addr(&av->util_av, &dg_av_idx, &index);
 		if (ret) {
 			if (av->util_av.eq)
 				ofi_av_write_event(&av->util_av, i, -ret, context);
@@ -152,8 +151,7 @@ int rxd_av_insert_fast(struct rxd_av *av, const void *addr, size_t count,
 	}
 
 	for (i = 0; i < num; i++) {
-		ret = ofi_av_insert_addr(&av->util_av, &fi_addrs[i],
-					 fi_addrs[i], &index);
+		ret = ofi_av_insert_addr(&av->util_av, &fi_addrs[i], &index);
 		if (ret) {
 			if (av->util_av.eq)
 				ofi_av_write_event(&av->util_av, i, -ret, context);
@@ -299,7 +297,6 @@ int rxd_av_create(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 		return -FI_ENOMEM;
 
 	util_attr.addrlen = sizeof(fi_addr_t);
-	util_attr.overhead = attr->count;
 	util_attr.flags = FI_SOURCE;
 	av->size = attr->count ? attr->count : RXD_AV_DEF_COUNT;
 	if (attr->type == FI_AV_UNSPEC)
@@ -48,8 +48,10 @@ static int rxd_cq_write_ctx(struct rxd_cq *cq,
 			     struct fi_cq_tagged_entry *cq_entry)
 {
 	struct fi_cq_tagged_entry *comp;
-	if (ofi_cirque_isfull(cq->util_cq.cirq))
+	if (ofi_cirque_isfull(cq->util_cq.cirq)) {
+		ofi_stats_inc(&cq->util_cq.stats, OFI_CQ_STAT_OVERFLOW);
 		return -FI_ENOSPC;
+	}
 
 	comp = ofi_cirque_tail(cq->util_cq.cirq);
 	comp->op_context = cq_entry->op_context;
@@ -69,8 +71,10 @@ static int rxd_cq_write_msg(struct rxd_cq *cq,
 			     struct fi_cq_tagged_entry *cq_entry)
 {
 	struct fi_cq_tagged_entry *comp;
-	if (ofi_cirque_isfull(cq->util_cq.cirq))
+	if (ofi_cirque_isfull(cq->util_cq.cirq)) {
+		ofi_stats_inc(&cq->util_cq.stats, OFI_CQ_STAT_OVERFLOW);
 		return -FI_ENOSPC;
+	}
 
 	comp = ofi_cirque_tail(cq->util_cq.cirq);
 	comp->op_context = cq_entry->op_context;
@@ -92,8 +96,10 @@ static int rxd_cq_write_data(struct rxd_cq *cq,
 			      struct fi_cq_tagged_entry *cq_entry)
 {
 	struct fi_cq_tagged_entry *comp;
-	if (ofi_cirque_isfull(cq->util_cq.cirq))
+	if (ofi_cirque_isfull(cq->util_cq.cirq)) {
+		ofi_stats_inc(&cq->util_cq.stats, OFI_CQ_STAT_OVERFLOW);
 		return -FI_ENOSPC;
+	}
 
 	comp = ofi_cirque_tail(cq->util_cq.cirq);
 	comp->op_context = cq_entry->op_context;
@@ -117,8 +123,10 @@ static int rxd_cq_write_tagged(struct rxd_cq *cq,
 				struct fi_cq_tagged_entry *cq_entry)
 {
 	struct fi_cq_tagged_entry *comp;
-	if (ofi_cirque_isfull(cq->util_cq.cirq))
+	if (ofi_cirque_isfull(cq->util_cq.cirq)) {
+		ofi_stats_inc(&cq->util_cq.stats, OFI_CQ_STAT_OVERFLOW);
 		return -FI_ENOSPC;
+	}
 
 	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL,
 		"report completion: %p\n", cq_entry->tag);
@@ -163,12 +171,27 @@ static void rxd_handle_dup_datastart(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctr
 {
 	struct dlist_entry *item;
 	struct rxd_rx_entry *rx_entry;
+	struct rxd_pkt_data_start *pkt_start;
 	struct rxd_peer *peer;
+	int ret;
 
 	item = dlist_find_first_match(&ep->rx_entry_list,
 				      rxd_rx_entry_match, ctrl);
-	if (!item)
+	if (!item) {
+		/* The message completed and its final ack was lost */
+		peer = rxd_ep_getpeer_info(ep, ctrl->conn_id);
+		pkt_start = (struct rxd_pkt_data_start *) ctrl;
+		if (pkt_start->op.op == ofi_op_atomic &&
+		    (ret = rxd_atomic_verify(ep, ctrl, pkt_start))) {
+			/* or was rejected, and the rejection was lost */
+			rxd_ep_reply_discard(ep, ctrl, -ret, 0,
+					     peer->conn_data, ctrl->conn_id);
+			return;
+		}
+		rxd_ep_reply_ack(ep, ctrl, ofi_ctrl_ack, 0, 0,
+				 peer->conn_data, ctrl->conn_id);
 		return;
+	}
 
 	FI_INFO(&rxd_prov, FI_LOG_EP_CTRL,
 		"duplicate start-data: msg_id: %" PRIu64 ", seg_no: %d\n",
@@ -231,8 +254,47 @@ int rxd_tx_pkt_match(struct dlist_entry *item, const void *arg)
 	return (ack_ctrl->seg_no == pkt_ctrl->seg_no) ? 1 : 0;
 }
 
-int rxd_handle_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl,
-		    struct rxd_rx_buf *rx_buf)
+static int rxd_inject_pkt_match(struct dlist_entry *item, const void *arg)
+{
+	const struct ofi_ctrl_hdr *pkt_ctrl, *ack_ctrl = arg;
+	struct rxd_pkt_meta *pkt;
+
+	pkt = container_of(item, struct rxd_pkt_meta, entry);
+	pkt_ctrl = (struct ofi_ctrl_hdr *) pkt->pkt_data;
+	return (pkt->peer == ack_ctrl->conn_id &&
+		pkt_ctrl->msg_id == ack_ctrl->msg_id);
+}
+
+/* Injected messages complete silently: only the send counter is updated */
+static void rxd_handle_inject_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl)
+{
+	struct ofi_ctrl_hdr *pkt_ctrl;
+	struct dlist_entry *item;
+	struct rxd_pkt_meta *pkt;
+	struct rxd_peer *peer;
+
+	item = dlist_remove_first_match(&ep->inject_pkt_list,
+					rxd_inject_pkt_match, ctrl);
+	if (!item)
+		return;
+
+	pkt = container_of(item, struct rxd_pkt_meta, entry);
+	pkt_ctrl = (struct ofi_ctrl_hdr *) pkt->pkt_data;
+	peer = rxd_ep_getpeer_info(ep, pkt->peer);
+	peer->num_inject_out--;
+	if (ep->tx_cntr) {
+		if (pkt_ctrl->type == ofi_ctrl_batch)
+			fi_cntr_add(&ep->tx_cntr->cntr_fid, pkt_ctrl->seg_no);
+		else
+			ofi_cntr_inc(ep->tx_cntr);
+	}
+
+	RXD_PKT_MARK_REMOTE_ACK(pkt);
+	rxd_tx_pkt_release(pkt);
+}
+
+/* Caller must hold the ep lock */
+static int rxd_ep_process_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl)
 {
 	int ret = 0;
 	uint64_t idx;
@@ -240,11 +302,16 @@ int rxd_handle_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl,
 	struct dlist_entry *item;
 	struct rxd_pkt_meta *pkt;
 
-	rxd_ep_lock_if_required(ep);
 	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "got ack: msg: %p - %d\n",
 		ctrl->msg_id, ctrl->seg_no);
+	ofi_stats_inc(&ep->stats, RXD_STAT_ACK_RECV);
 
 	idx = ctrl->msg_id & RXD_TX_IDX_BITS;
+	if (idx == RXD_INJECT_TX_IDX) {
+		rxd_handle_inject_ack(ep, ctrl);
+		goto out;
+	}
+
 	tx_entry = &ep->tx_entry_fs->buf[idx];
 	if (tx_entry->msg_id != ctrl->msg_id)
 		goto out;
@@ -264,7 +331,9 @@ int rxd_handle_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl,
 	case RXD_PKT_LAST:
 		rxd_ep_free_acked_pkts(ep, tx_entry, ctrl->seg_no);
 		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "reporting TX completion : %p\n", tx_entry);
-		if (tx_entry->op_type != RXD_TX_READ_REQ) {
+		if (tx_entry->op_type != RXD_TX_READ_REQ &&
+		    tx_entry->op_type != RXD_TX_ATOMIC_FETCH) {
+			rxd_cntr_report_tx_comp(ep, tx_entry);
 			rxd_cq_report_tx_comp(ep->tx_cq, tx_entry);
 			rxd_tx_entry_done(ep, tx_entry);
 		}
@@ -274,11 +343,60 @@ int rxd_handle_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl,
 		break;
 	}
 out:
+	return ret;
+}
+
+int rxd_handle_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl,
+		    struct rxd_rx_buf *rx_buf)
+{
+	int ret;
+
+	rxd_ep_lock_if_required(ep);
+	ret = rxd_ep_process_ack(ep, ctrl);
 	rxd_ep_repost_buff(rx_buf);
 	rxd_ep_unlock_if_required(ep);
 	return ret;
 }
 
+/*
+ * Process the acks carried after the header of an ack packet or after the
+ * payload of a data packet, see RXD_ACK_SZ.
+ */
+static void rxd_handle_piggyback_acks(struct rxd_ep *ep,
+				      struct ofi_ctrl_hdr *ctrl, size_t len)
+{
+	size_t offset;
+	struct ofi_ctrl_hdr ack;
+
+	switch (ctrl->type) {
+	case ofi_ctrl_ack:
+		offset = RXD_ACK_SZ;
+		break;
+	case ofi_ctrl_start_data:
+		offset = RXD_START_DATA_PKT_SZ + ctrl->seg_size;
+		break;
+	case ofi_ctrl_data:
+	case ofi_ctrl_batch:
+		offset = RXD_DATA_PKT_SZ + ctrl->seg_size;
+		break;
+	default:
+		return;
+	}
+
+	if (offset + RXD_ACK_SZ > len)
+		return;
+
+	rxd_ep_lock_if_required(ep);
+	for (; offset + RXD_ACK_SZ <= len; offset += RXD_ACK_SZ) {
+		/* acks after a payload need not be aligned */
+		memcpy(&ack, (char *) ctrl + offset, RXD_ACK_SZ);
+		if (ack.version != OFI_CTRL_VERSION || ack.type != ofi_ctrl_ack)
+			break;
+		rxd_ep_process_ack(ep, &ack);
+	}
+	rxd_ep_unlock_if_required(ep);
+}
+
 int rxd_handle_nack(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl,
 		     struct rxd_rx_buf *rx_buf)
 {
@@ -291,6 +409,9 @@ int rxd_handle_nack(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl,
 		ctrl->msg_id, ctrl->seg_no);
 
 	idx = ctrl->msg_id & RXD_TX_IDX_BITS;
+	if (idx == RXD_INJECT_TX_IDX)
+		goto out;
+
 	tx_entry = &ep->tx_entry_fs->buf[idx];
 	if (tx_entry->msg_id != ctrl->msg_id)
 		goto out;
@@ -313,11 +434,19 @@ void rxd_handle_discard(struct rxd_ep *ep, struct ofi_ctrl_hdr *ctrl,
 		ctrl->msg_id, ctrl->seg_no);
 
 	idx = ctrl->msg_id & RXD_TX_IDX_BITS;
+	if (idx == RXD_INJECT_TX_IDX) {
+		rxd_handle_inject_ack(ep, ctrl);
+		goto out;
+	}
+
 	tx_entry = &ep->tx_entry_fs->buf[idx];
 	if (tx_entry->msg_id != ctrl->msg_id)
 		goto out;
 
-	rxd_tx_entry_discard(ep, tx_entry);
+	if (ctrl->seg_no)
+		rxd_tx_entry_error(ep, tx_entry, ctrl->seg_no);
+	else
+		rxd_tx_entry_discard(ep, tx_entry);
 out:
 	rxd_ep_repost_buff(rx_buf);
 	rxd_ep_unlock_if_required(ep);
@@ -397,6 +526,7 @@ struct rxd_rx_entry *rxd_get_rx_entry(struct rxd_ep *ep)
 		return NULL;
 
 	rx_entry = freestack_pop(ep->rx_entry_fs);
+	rx_entry->ep = ep;
 	rx_entry->key = rx_entry - &ep->rx_entry_fs->buf[0];
 	dlist_init(&rx_entry->entry);
 	dlist_init(&rx_entry->wait_entry);
@@ -464,12 +594,52 @@ static int rxd_match_recv_entry(struct dlist_entry *item, const void *arg)
 		recv_entry->msg.addr == rx_entry->source);
 }
 
-struct rxd_recv_entry *rxd_get_recv_entry(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry)
+/*
+ * Hand the matched receive to rx_entry.  An FI_MULTI_RECV buffer stays on
+ * the recv list; the message gets a slice of it in rx_entry and the buffer
+ * is released once less than min_multi_recv bytes are left.  Caller must
+ * hold the rx_ctx lock.
+ */
+static void rxd_rx_ctx_claim_recv(struct rxd_rx_ctx *rx_ctx,
+				  struct rxd_recv_entry *recv_entry,
+				  struct rxd_rx_entry *rx_entry)
+{
+	struct rxd_recv_entry *slice = &rx_entry->multi_recv;
+	size_t len;
+
+	if (!(recv_entry->flags & FI_MULTI_RECV)) {
+		dlist_remove(&recv_entry->entry);
+		rx_entry->recv = recv_entry;
+		return;
+	}
+
+	len = MIN(rx_entry->op_hdr.size, recv_entry->iov[0].iov_len);
+	slice->msg = recv_entry->msg;
+	slice->msg.iov_count = 1;
+	slice->flags = recv_entry->flags & ~FI_MULTI_RECV;
+	slice->iov[0].iov_base = recv_entry->iov[0].iov_base;
+	slice->iov[0].iov_len = len;
+	slice->desc[0] = recv_entry->desc[0];
+	rx_entry->recv = slice;
+
+	recv_entry->iov[0].iov_base = (char *) recv_entry->iov[0].iov_base + len;
+	recv_entry->iov[0].iov_len -= len;
+	if (recv_entry->iov[0].iov_len >= rx_ctx->min_multi_recv)
+		return;
+
+	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "releasing multi-recv buffer\n");
+	dlist_remove(&recv_entry->entry);
+	freestack_push(rx_ctx->recv_fs, recv_entry);
+	slice->flags |= FI_MULTI_RECV;
+}
+
+/* Caller must hold the rx_ctx lock */
+static struct rxd_recv_entry *rxd_get_recv_entry(struct rxd_rx_ctx *rx_ctx,
+					struct rxd_rx_entry *rx_entry)
 {
 	struct dlist_entry *match;
-	struct rxd_recv_entry *recv_entry;
 
-	match = dlist_find_first_match(&ep->recv_list, &rxd_match_recv_entry,
+	match = dlist_find_first_match(&rx_ctx->recv_list, &rxd_match_recv_entry,
 				       (void *) rx_entry);
 	if (!match) {
 		/*todo: queue the pkt */
@@ -477,9 +647,9 @@ struct rxd_recv_entry *rxd_get_recv_entry(struct rxd_ep *ep, struct rxd_rx_entry
 		return NULL;
 	}
 
-	dlist_remove(match);
-	recv_entry = container_of(match, struct rxd_recv_entry, entry);
-	return recv_entry;
+	rxd_rx_ctx_claim_recv(rx_ctx, container_of(match, struct rxd_recv_entry,
+						   entry), rx_entry);
+	return rx_entry->recv;
 }
 
 static int rxd_match_trecv_entry(struct dlist_entry *item, const void *arg)
@@ -496,13 +666,14 @@ static int rxd_match_trecv_entry(struct dlist_entry *item, const void *arg)
 	return 0;
 }
 
-struct rxd_trecv_entry *rxd_get_trecv_entry(struct rxd_ep *ep,
-					      struct rxd_rx_entry *rx_entry)
+/* Caller must hold the rx_ctx lock */
+static struct rxd_trecv_entry *rxd_get_trecv_entry(struct rxd_rx_ctx *rx_ctx,
+					struct rxd_rx_entry *rx_entry)
 {
 	struct dlist_entry *match;
 	struct rxd_trecv_entry *trecv_entry;
 
-	match = dlist_find_first_match(&ep->trecv_list, &rxd_match_trecv_entry,
+	match = dlist_find_first_match(&rx_ctx->trecv_list, &rxd_match_trecv_entry,
 				       (void *)rx_entry);
 	if (!match) {
 		/*todo: queue the pkt */
@@ -519,9 +690,31 @@ struct rxd_trecv_entry *rxd_get_trecv_entry(struct rxd_ep *ep,
 	return trecv_entry;
 }
 
+/* Bytes of a received message that did not fit the posted buffer */
+static size_t rxd_rx_entry_trunc(struct rxd_rx_entry *rx_entry)
+{
+	size_t len;
+
+	switch (rx_entry->op_hdr.op) {
+	case ofi_op_msg:
+		len = ofi_get_iov_len(rx_entry->recv->iov,
+					rx_entry->recv->msg.iov_count);
+		break;
+	case ofi_op_tagged:
+		len = ofi_get_iov_len(rx_entry->trecv->iov,
+					rx_entry->trecv->msg.iov_count);
+		break;
+	default:
+		return 0;
+	}
+	return rx_entry->op_hdr.size > len ? rx_entry->op_hdr.size - len : 0;
+}
+
 void rxd_report_rx_comp(struct rxd_cq *cq, struct rxd_rx_entry *rx_entry)
 {
 	struct fi_cq_tagged_entry cq_entry = {0};
+	struct fi_cq_err_entry err_entry = {0};
+	size_t trunc;
 
 	/* todo: handle FI_COMPLETION */
 	if (rx_entry->op_hdr.flags & OFI_REMOTE_CQ_DATA)
@@ -529,7 +722,7 @@ void rxd_report_rx_comp(struct rxd_cq *cq, struct rxd_rx_entry *rx_entry)
 
 	switch(rx_entry->op_hdr.op) {
 	case ofi_op_msg:
-		cq_entry.flags |= FI_RECV;
+		cq_entry.flags |= FI_RECV | (rx_entry->recv->flags & FI_MULTI_RECV);
 		cq_entry.op_context = rx_entry->recv->msg.context;
 		cq_entry.len = rx_entry->done;
 		cq_entry.buf = rx_entry->recv->iov[0].iov_base;
@@ -546,7 +739,13 @@ void rxd_report_rx_comp(struct rxd_cq *cq, struct rxd_rx_entry *rx_entry)
 		break;
 
 	case ofi_op_atomic:
-		cq_entry.flags |= FI_ATOMIC;
+		if (!(rx_entry->op_hdr.flags & OFI_REMOTE_CQ_DATA))
+			return;
+
+		cq_entry.flags |= (FI_ATOMIC | FI_REMOTE_WRITE);
+		if (rx_entry->op_hdr.op_data & RXD_ATOMIC_FETCH)
+			cq_entry.flags |= FI_REMOTE_READ;
+		cq_entry.data = rx_entry->op_hdr.data;
 		break;
 
 	case ofi_op_write:
@@ -569,6 +768,21 @@ void rxd_report_rx_comp(struct rxd_cq *cq, struct rxd_rx_entry *rx_entry)
 		break;
 	}
 
+	trunc = rxd_rx_entry_trunc(rx_entry);
+	if (trunc) {
+		FI_WARN(&rxd_prov, FI_LOG_CQ, "message truncated\n");
+		err_entry.op_context = cq_entry.op_context;
+		err_entry.flags = cq_entry.flags;
+		err_entry.len = cq_entry.len - trunc;
+		err_entry.buf = cq_entry.buf;
+		err_entry.data = cq_entry.data;
+		err_entry.tag = cq_entry.tag;
+		err_entry.olen = trunc;
+		err_entry.err = FI_ETRUNC;
+		rxd_cq_report_error(cq, &err_entry);
+		return;
+	}
+
 	cq->write_fn(cq, &cq_entry);
 }
 
@@ -588,54 +802,167 @@ void rxd_cq_report_error(struct rxd_cq *cq, struct fi_cq_err_entry *err_entry)
 	cq->write_fn(cq, &cq_entry);
 }
 
-void rxd_cq_report_tx_comp(struct rxd_cq *cq, struct rxd_tx_entry *tx_entry)
+/* Returns -FI_ENOENT for operations that never generate a completion */
+static int rxd_tx_comp_entry(struct rxd_tx_entry *tx_entry,
+			     struct fi_cq_tagged_entry *cq_entry)
 {
-	struct fi_cq_tagged_entry cq_entry = {0};
-
-	/* todo: handle FI_COMPLETION */
 	switch(tx_entry->op_type) {
 	case RXD_TX_MSG:
-		cq_entry.flags = (FI_TRANSMIT | FI_MSG);
-		cq_entry.op_context = tx_entry->msg.msg.context;
-		cq_entry.len = tx_entry->op_hdr.size;
-		cq_entry.buf = tx_entry->msg.msg_iov[0].iov_base;
-		cq_entry.data = tx_entry->op_hdr.data;
+		cq_entry->flags = (FI_TRANSMIT | FI_MSG);
+		cq_entry->op_context = tx_entry->msg.msg.context;
+		cq_entry->len = tx_entry->op_hdr.size;
+		cq_entry->buf = tx_entry->msg.msg_iov[0].iov_base;
+		cq_entry->data = tx_entry->op_hdr.data;
 		break;
 
 	case RXD_TX_TAG:
-		cq_entry.flags = (FI_TRANSMIT | FI_TAGGED);
-		cq_entry.op_context = tx_entry->tmsg.tmsg.context;
-		cq_entry.len = tx_entry->op_hdr.size;
-		cq_entry.buf = tx_entry->tmsg.msg_iov[0].iov_base;
-		cq_entry.data = tx_entry->op_hdr.data;
-		cq_entry.tag = tx_entry->tmsg.tmsg.tag;
+		cq_entry->flags = (FI_TRANSMIT | FI_TAGGED);
+		cq_entry->op_context = tx_entry->tmsg.tmsg.context;
+		cq_entry->len = tx_entry->op_hdr.size;
+		cq_entry->buf = tx_entry->tmsg.msg_iov[0].iov_base;
+		cq_entry->data = tx_entry->op_hdr.data;
+		cq_entry->tag = tx_entry->tmsg.tmsg.tag;
 		break;
 
 	case RXD_TX_WRITE:
-		cq_entry.flags = (FI_TRANSMIT | FI_RMA | FI_WRITE);
-		cq_entry.op_context = tx_entry->write.msg.context;
-		cq_entry.len = tx_entry->op_hdr.size;
-		cq_entry.buf = tx_entry->write.msg.msg_iov[0].iov_base;
-		cq_entry.data = tx_entry->op_hdr.data;
+		cq_entry->flags = (FI_TRANSMIT | FI_RMA | FI_WRITE);
+		cq_entry->op_context = tx_entry->write.msg.context;
+		cq_entry->len = tx_entry->op_hdr.size;
+		cq_entry->buf = tx_entry->write.msg.msg_iov[0].iov_base;
+		cq_entry->data = tx_entry->op_hdr.data;
 		break;
 
 	case RXD_TX_READ_REQ:
-		cq_entry.flags = (FI_TRANSMIT | FI_RMA | FI_READ);
-		cq_entry.op_context = tx_entry->read_req.msg.context;
-		cq_entry.len = tx_entry->op_hdr.size;
-		cq_entry.buf = tx_entry->read_req.msg.msg_iov[0].iov_base;
-		cq_entry.data = tx_entry->op_hdr.data;
+		cq_entry->flags = (FI_TRANSMIT | FI_RMA | FI_READ);
+		cq_entry->op_context = tx_entry->read_req.msg.context;
+		cq_entry->len = tx_entry->op_hdr.size;
+		cq_entry->buf = tx_entry->read_req.msg.msg_iov[0].iov_base;
+		cq_entry->data = tx_entry->op_hdr.data;
+		break;
+
+	case RXD_TX_ATOMIC:
+		cq_entry->flags = (FI_TRANSMIT | FI_ATOMIC | FI_WRITE);
+		cq_entry->op_context = tx_entry->atomic.msg.context;
+		cq_entry->data = tx_entry->op_hdr.data;
+		break;
+
+	case RXD_TX_ATOMIC_FETCH:
+		cq_entry->flags = (FI_TRANSMIT | FI_ATOMIC | FI_READ);
+		cq_entry->op_context = tx_entry->atomic.msg.context;
+		cq_entry->data = tx_entry->op_hdr.data;
 		break;
 
 	case RXD_TX_READ_RSP:
-		return;
+		return -FI_ENOENT;
 
 	default:
 		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "invalid op type\n");
+		return -FI_ENOENT;
+	}
+	return 0;
+}
+
+void rxd_cq_report_tx_comp(struct rxd_cq *cq, struct rxd_tx_entry *tx_entry)
+{
+	struct fi_cq_tagged_entry cq_entry = {0};
+
+	/* todo: handle FI_COMPLETION */
+	if (tx_entry->op_type == RXD_TX_ATOMIC &&
+	    (tx_entry->flags & RXD_NO_COMPLETION))
 		return;
+
+	if (!rxd_tx_comp_entry(tx_entry, &cq_entry))
+		cq->write_fn(cq, &cq_entry);
+}
+
+/* Errors are reported even for operations posted without completions */
+void rxd_cq_report_tx_err(struct rxd_cq *cq, struct rxd_tx_entry *tx_entry,
+			  int err)
+{
+	struct fi_cq_tagged_entry cq_entry = {0};
+	struct fi_cq_err_entry err_entry = {0};
+
+	if (rxd_tx_comp_entry(tx_entry, &cq_entry))
+		return;
+
+	err_entry.op_context = cq_entry.op_context;
+	err_entry.flags = cq_entry.flags;
+	err_entry.len = cq_entry.len;
+	err_entry.buf = cq_entry.buf;
+	err_entry.data = cq_entry.data;
+	err_entry.tag = cq_entry.tag;
+	err_entry.err = err;
+	err_entry.prov_errno = -err;
+	rxd_cq_report_error(cq, &err_entry);
+}
+
+static struct util_cntr *rxd_tx_entry_cntr(struct rxd_ep *ep,
+					    struct rxd_tx_entry *tx_entry)
+{
+	switch (tx_entry->op_type) {
+	case RXD_TX_MSG:
+	case RXD_TX_TAG:
+		return ep->tx_cntr;
+	case RXD_TX_WRITE:
+	case RXD_TX_ATOMIC:
+		return ep->wr_cntr;
+	case RXD_TX_READ_REQ:
+	case RXD_TX_ATOMIC_FETCH:
+		return ep->rd_cntr;
+	case RXD_TX_READ_RSP:
+		return ep->rem_rd_cntr;
+	default:
+		return NULL;
 	}
+}
 
-	cq->write_fn(cq, &cq_entry);
+void rxd_cntr_report_tx_comp(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry)
+{
+	struct util_cntr *cntr;
+
+	cntr = rxd_tx_entry_cntr(ep, tx_entry);
+	if (cntr)
+		ofi_cntr_inc(cntr);
+}
+
+void rxd_cntr_report_tx_err(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry)
+{
+	struct util_cntr *cntr;
+
+	cntr = rxd_tx_entry_cntr(ep, tx_entry);
+	if (cntr)
+		ofi_cntr_inc_err(cntr);
+}
+
+void rxd_cntr_report_rx_comp(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry)
+{
+	struct util_cntr *cntr;
+
+	switch (rx_entry->op_hdr.op) {
+	case ofi_op_msg:
+	case ofi_op_tagged:
+		if (ep->rx_cntr && rxd_rx_entry_trunc(rx_entry)) {
+			ofi_cntr_inc_err(ep->rx_cntr);
+			return;
+		}
+		cntr = ep->rx_cntr;
+		break;
+	case ofi_op_write:
+		cntr = ep->rem_wr_cntr;
+		break;
+	case ofi_op_atomic:
+		/* fetching atomics count as remote reads once the
+		 * response carrying the old value is acked */
+		if (rx_entry->op_hdr.op_data & RXD_ATOMIC_FETCH)
+			return;
+		cntr = ep->rem_wr_cntr;
+		break;
+	default:
+		return;
+	}
+
+	if (cntr)
+		ofi_cntr_inc(cntr);
 }
 
 void rxd_ep_handle_data_msg(struct rxd_ep *ep, struct rxd_peer *peer,
@@ -650,26 +977,33 @@ void rxd_ep_handle_data_msg(struct rxd_ep *ep, struct rxd_peer *peer,
 	ep->credits++;
 	done = ofi_copy_iov_buf(iov, iov_count, data, ctrl->seg_size,
 				   rx_entry->done, OFI_COPY_BUF_TO_IOV);
-	rx_entry->done += done;
+	/* done counts bytes received, so a message too large for its buffer
+	 * still completes; the truncation is reported with the completion */
+	rx_entry->done += ctrl->seg_size;
 	rx_entry->window--;
 	rx_entry->exp_seg_no++;
 
-	if (done != ctrl->seg_size) {
-		/* todo: generate truncation error */
-		/* inform peer */
-		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "TODO: message truncated\n");
-	}
+	if (done != ctrl->seg_size)
+		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "message truncated\n");
 
 	if (rx_entry->window == 0) {
 		rx_entry->window = rxd_get_window_sz(ep, rx_entry->op_hdr.size - rx_entry->done);
 
 		rx_entry->last_win_seg += rx_entry->window;
 		ep->credits -= rx_entry->window;
-		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "replying ack [%p] - %d\n",
-			ctrl->msg_id, ctrl->seg_no);
+		/* batched messages are acked with their batch packet */
+		if (!rx_entry->batched) {
+			FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "replying ack [%p] - %d\n",
+				ctrl->msg_id, ctrl->seg_no);
 
-		rxd_ep_reply_ack(ep, ctrl, ofi_ctrl_ack, rx_entry->window,
-			       rx_entry->key, peer->conn_data, ctrl->conn_id);
+			if (rx_entry->op_hdr.size == rx_entry->done)
+				rxd_ep_queue_ack(ep, peer, ctrl, rx_entry->key,
+						 ctrl->conn_id);
+			else
+				rxd_ep_reply_ack(ep, ctrl, ofi_ctrl_ack,
+						 rx_entry->window, rx_entry->key,
+						 peer->conn_data, ctrl->conn_id);
+		}
 	}
 
 	if (rx_entry->op_hdr.size != rx_entry->done) {
@@ -687,18 +1021,26 @@ void rxd_ep_handle_data_msg(struct rxd_ep *ep, struct rxd_peer *peer,
 	}
 
 	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "reporting RX completion event\n");
+	rxd_cntr_report_rx_comp(ep, rx_entry);
 	rxd_report_rx_comp(ep->rx_cq, rx_entry);
 
 	switch(rx_entry->op_hdr.op) {
 	case ofi_op_msg:
-		freestack_push(ep->recv_fs, rx_entry->recv);
+		if (rx_entry->recv == &rx_entry->multi_recv)
+			break;
+		fastlock_acquire(&ep->rx_ctx->lock);
+		freestack_push(ep->rx_ctx->recv_fs, rx_entry->recv);
+		fastlock_release(&ep->rx_ctx->lock);
 		break;
 
 	case ofi_op_tagged:
-		freestack_push(ep->trecv_fs, rx_entry->trecv);
+		fastlock_acquire(&ep->rx_ctx->lock);
+		freestack_push(ep->rx_ctx->trecv_fs, rx_entry->trecv);
+		fastlock_release(&ep->rx_ctx->lock);
 		break;
 
 	case ofi_op_read_rsp:
+		rxd_cntr_report_tx_comp(ep, rx_entry->read_rsp.tx_entry);
 		rxd_cq_report_tx_comp(ep->tx_cq, rx_entry->read_rsp.tx_entry);
 		rxd_tx_entry_done(ep, rx_entry->read_rsp.tx_entry);
 		break;
@@ -766,29 +1108,25 @@ static int rxd_match_unexp_msg(struct dlist_entry *item, const void *arg)
 		rx_entry->source == recv_entry->msg.addr);
 }
 
-void rxd_ep_check_unexp_msg_list(struct rxd_ep *ep, struct rxd_recv_entry *recv_entry)
+/* Caller must hold the rx_ctx lock */
+struct rxd_rx_entry *rxd_rx_ctx_match_unexp_msg(struct rxd_rx_ctx *rx_ctx,
+					struct rxd_recv_entry *recv_entry)
 {
 	struct dlist_entry *match;
 	struct rxd_rx_entry *rx_entry;
-	struct rxd_pkt_data_start *pkt_start;
 
-	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "ep->num_unexp_msg: %d\n", ep->num_unexp_msg);
-	match = dlist_remove_first_match(&ep->unexp_msg_list, &rxd_match_unexp_msg,
+	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "num_unexp_msg: %d\n",
+	       rx_ctx->num_unexp_msg);
+	match = dlist_remove_first_match(&rx_ctx->unexp_msg_list,
+					 &rxd_match_unexp_msg,
 					 (void *) recv_entry);
-	if (match) {
-		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "progressing unexp msg entry\n");
-		dlist_remove(&recv_entry->entry);
-		ep->num_unexp_msg--;
-
-		rx_entry = container_of(match, struct rxd_rx_entry, unexp_entry);
-		rx_entry->recv = recv_entry;
+	if (!match)
+		return NULL;
 
-		pkt_start = (struct rxd_pkt_data_start *) rx_entry->unexp_buf->buf;
-		rxd_ep_handle_data_msg(ep, rx_entry->peer_info, rx_entry, rx_entry->recv->iov,
-				     rx_entry->recv->msg.iov_count, &pkt_start->ctrl,
-				     pkt_start->data, rx_entry->unexp_buf);
-		rxd_ep_repost_buff(rx_entry->unexp_buf);
-	}
+	rx_ctx->num_unexp_msg--;
+	rx_entry = container_of(match, struct rxd_rx_entry, unexp_entry);
+	rxd_rx_ctx_claim_recv(rx_ctx, recv_entry, rx_entry);
+	return rx_entry;
 }
 
 static int rxd_match_unexp_tag(struct dlist_entry *item, const void *arg)
@@ -804,32 +1142,72 @@ static int rxd_match_unexp_tag(struct dlist_entry *item, const void *arg)
 		 (trecv_entry->msg.addr == rx_entry->source)));
 }
 
-void rxd_ep_check_unexp_tag_list(struct rxd_ep *ep, struct rxd_trecv_entry *trecv_entry)
+/* Caller must hold the rx_ctx lock */
+struct rxd_rx_entry *rxd_rx_ctx_match_unexp_tag(struct rxd_rx_ctx *rx_ctx,
+					struct rxd_trecv_entry *trecv_entry)
 {
 	struct dlist_entry *match;
 	struct rxd_rx_entry *rx_entry;
-	struct rxd_pkt_data_start *pkt_start;
 
-	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "ep->num_unexp_msg: %d\n", ep->num_unexp_msg);
-	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "ep->num_unexp_pkt: %d\n", ep->num_unexp_pkt);
-	match = dlist_find_first_match(&ep->unexp_tag_list, &rxd_match_unexp_tag,
-				       (void *) trecv_entry);
-	if (match) {
-		dlist_remove(match);
-		dlist_remove(&trecv_entry->entry);
-		ep->num_unexp_msg--;
-
-		rx_entry = container_of(match, struct rxd_rx_entry, unexp_entry);
-		rx_entry->trecv = trecv_entry;
-		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "progressing unexp tagged recv [%p]\n",
-			rx_entry->msg_id);
-
-		pkt_start = (struct rxd_pkt_data_start *) rx_entry->unexp_buf->buf;
-		rxd_ep_handle_data_msg(ep, rx_entry->peer_info, rx_entry, rx_entry->trecv->iov,
-				     rx_entry->trecv->msg.iov_count, &pkt_start->ctrl,
-				     pkt_start->data, rx_entry->unexp_buf);
-		rxd_ep_repost_buff(rx_entry->unexp_buf);
-	}
+	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "num_unexp_msg: %d\n",
+	       rx_ctx->num_unexp_msg);
+	match = dlist_remove_first_match(&rx_ctx->unexp_tag_list,
+					 &rxd_match_unexp_tag,
+					 (void *) trecv_entry);
+	if (!match)
+		return NULL;
+
+	rx_ctx->num_unexp_msg--;
+	rx_entry = container_of(match, struct rxd_rx_entry, unexp_entry);
+	rx_entry->trecv = trecv_entry;
+	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "matched unexp tagged recv [%p]\n",
+	       rx_entry->msg_id);
+	return rx_entry;
+}
+
+/*
+ * Deliver the first packet of a message that was queued as unexpected,
+ * now that a receive has been matched to it.  Takes the lock of the
+ * endpoint that received the message; rx_entry may be released on return.
+ */
+void rxd_ep_progress_unexp_msg(struct rxd_rx_entry *rx_entry)
+{
+	struct rxd_ep *ep = rx_entry->ep;
+	struct rxd_rx_buf *rx_buf = rx_entry->unexp_buf;
+	struct rxd_pkt_data_start *pkt_start = rx_entry->unexp_pkt;
+
+	rxd_ep_lock_if_required(ep);
+	if (rx_entry->op_hdr.op == ofi_op_tagged)
+		rxd_ep_handle_data_msg(ep, rx_entry->peer_info,
+				       rx_entry, rx_entry->trecv->iov,
+				       rx_entry->trecv->msg.iov_count,
+				       &pkt_start->ctrl, pkt_start->data, rx_buf);
+	else
+		rxd_ep_handle_data_msg(ep, rx_entry->peer_info,
+				       rx_entry, rx_entry->recv->iov,
+				       rx_entry->recv->msg.iov_count,
+				       &pkt_start->ctrl, pkt_start->data, rx_buf);
+	rxd_ep_repost_buff(rx_buf);
+	rxd_ep_unlock_if_required(ep);
+}
+
+static void rxd_ep_handle_read_rsp(struct rxd_ep *ep, struct rxd_peer *peer,
+				   struct rxd_rx_entry *rx_entry,
+				   struct ofi_ctrl_hdr *ctrl, void *data,
+				   struct rxd_rx_buf *rx_buf)
+{
+	struct rxd_tx_entry *tx_entry = rx_entry->read_rsp.tx_entry;
+
+	if (tx_entry->op_type == RXD_TX_ATOMIC_FETCH)
+		rxd_ep_handle_data_msg(ep, peer, rx_entry,
+				       tx_entry->atomic.res_iov,
+				       tx_entry->atomic.res_count, ctrl,
+				       data, rx_buf);
+	else
+		rxd_ep_handle_data_msg(ep, peer, rx_entry,
+				       tx_entry->read_req.dst_iov,
+				       tx_entry->read_req.msg.iov_count, ctrl,
+				       data, rx_buf);
 }
 
 void rxd_handle_data(struct rxd_ep *ep, struct rxd_peer *peer,
@@ -838,7 +1216,6 @@ void rxd_handle_data(struct rxd_ep *ep, struct rxd_peer *peer,
 {
 	int ret;
 	struct rxd_rx_entry *rx_entry;
-	struct rxd_tx_entry *tx_entry;
 	struct rxd_pkt_data *pkt_data = (struct rxd_pkt_data *) ctrl;
 	uint16_t win_sz;
 	uint64_t curr_stamp;
@@ -900,9 +1277,7 @@ void rxd_handle_data(struct rxd_ep *ep, struct rxd_peer *peer,
 		break;
 
 	case ofi_op_read_rsp:
-		tx_entry = rx_entry->read_rsp.tx_entry;
-		rxd_ep_handle_data_msg(ep, peer, rx_entry, tx_entry->read_req.dst_iov,
-				       tx_entry->read_req.msg.iov_count, ctrl,
+		rxd_ep_handle_read_rsp(ep, peer, rx_entry, ctrl,
 				       pkt_data->data, rx_buf);
 		break;
 
@@ -940,6 +1315,25 @@ err:
 	return;
 }
 
+/* Caller must hold the rx_ctx lock */
+static int rxd_rx_ctx_queue_unexp(struct rxd_rx_ctx *rx_ctx,
+				  struct dlist_entry *list,
+				  struct rxd_rx_entry *rx_entry,
+				  struct rxd_pkt_data_start *pkt_start,
+				  struct rxd_rx_buf *rx_buf)
+{
+	if (rx_ctx->num_unexp_msg >= RXD_EP_MAX_UNEXP_MSG) {
+		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "dropping msg\n");
+		return -FI_ENOMEM;
+	}
+
+	dlist_insert_tail(&rx_entry->unexp_entry, list);
+	rx_entry->unexp_buf = rx_buf;
+	rx_entry->unexp_pkt = pkt_start;
+	rx_ctx->num_unexp_msg++;
+	return -FI_ENOENT;
+}
+
 int rxd_process_start_data(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry,
 			   struct rxd_peer *peer, struct ofi_ctrl_hdr *ctrl,
 			   struct fi_cq_msg_entry *comp,
@@ -950,22 +1344,21 @@ int rxd_process_start_data(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry,
 	struct ofi_rma_iov *rma_iov;
 	struct rxd_pkt_data_start *pkt_start;
 	struct rxd_tx_entry *tx_entry;
+	struct rxd_rx_ctx *rx_ctx = ep->rx_ctx;
 	pkt_start = (struct rxd_pkt_data_start *) ctrl;
 
 	switch (rx_entry->op_hdr.op) {
 	case ofi_op_msg:
-		rx_entry->recv = rxd_get_recv_entry(ep, rx_entry);
+		fastlock_acquire(&rx_ctx->lock);
+		rx_entry->recv = rxd_get_recv_entry(rx_ctx, rx_entry);
 		if (!rx_entry->recv) {
-			if (ep->num_unexp_msg < RXD_EP_MAX_UNEXP_MSG) {
-				dlist_insert_tail(&rx_entry->unexp_entry, &ep->unexp_msg_list);
-				rx_entry->unexp_buf = rx_buf;
-				ep->num_unexp_msg++;
-				return -FI_ENOENT;
-			} else {
-				FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "dropping msg\n");
-				return -FI_ENOMEM;
-			}
+			ret = rxd_rx_ctx_queue_unexp(rx_ctx, &rx_ctx->unexp_msg_list,
+						     rx_entry, pkt_start,
+						     rx_buf);
+			fastlock_release(&rx_ctx->lock);
+			return ret;
 		}
+		fastlock_release(&rx_ctx->lock);
 
 		rxd_ep_handle_data_msg(ep, peer, rx_entry, rx_entry->recv->iov,
 				     rx_entry->recv->msg.iov_count, ctrl,
@@ -973,18 +1366,16 @@ int rxd_process_start_data(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry,
 		break;
 
 	case ofi_op_tagged:
-		rx_entry->trecv = rxd_get_trecv_entry(ep, rx_entry);
+		fastlock_acquire(&rx_ctx->lock);
+		rx_entry->trecv = rxd_get_trecv_entry(rx_ctx, rx_entry);
 		if (!rx_entry->trecv) {
-			if (ep->num_unexp_msg < RXD_EP_MAX_UNEXP_MSG) {
-				dlist_insert_tail(&rx_entry->unexp_entry, &ep->unexp_tag_list);
-				rx_entry->unexp_buf = rx_buf;
-				ep->num_unexp_msg++;
-				return -FI_ENOENT;
-			} else {
-				FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "dropping msg\n");
-				return -FI_ENOMEM;
-			}
+			ret = rxd_rx_ctx_queue_unexp(rx_ctx, &rx_ctx->unexp_tag_list,
+						     rx_entry, pkt_start,
+						     rx_buf);
+			fastlock_release(&rx_ctx->lock);
+			return ret;
 		}
+		fastlock_release(&rx_ctx->lock);
 
 		rxd_ep_handle_data_msg(ep, peer, rx_entry, rx_entry->trecv->iov,
 				     rx_entry->trecv->msg.iov_count, ctrl,
@@ -1040,6 +1431,7 @@ int rxd_process_start_data(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry,
 			tx_entry->read_rsp.src_iov[i].iov_len = rma_iov[i].len;
 		}
 		tx_entry->read_rsp.peer_msg_id = ctrl->msg_id;
+		ep->credits++;
 		rxd_ep_handle_read_req(ep, tx_entry, peer);
 		rxd_rx_entry_release(ep, rx_entry);
 		break;
@@ -1051,12 +1443,13 @@ int rxd_process_start_data(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry,
 			return -FI_ENOMEM;
 
 		rx_entry->read_rsp.tx_entry = tx_entry;
-		rxd_ep_handle_data_msg(ep, peer, rx_entry, tx_entry->read_req.dst_iov,
-				       tx_entry->read_req.msg.iov_count, ctrl,
+		rxd_ep_handle_read_rsp(ep, peer, rx_entry, ctrl,
 				       pkt_start->data, rx_buf);
 		break;
 
 	case ofi_op_atomic:
+		return rxd_ep_handle_atomic(ep, rx_entry, peer, ctrl, pkt_start);
+
 	default:
 		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "invalid op type\n");
 		return -FI_EINVAL;
@@ -1064,36 +1457,24 @@ int rxd_process_start_data(struct rxd_ep *ep, struct rxd_rx_entry *rx_entry,
 	return 0;
 }
 
-void rxd_handle_start_data(struct rxd_ep *ep, struct rxd_peer *peer,
+/*
+ * Start receiving the in-order message of a start packet.  Returns
+ * -FI_ENOMEM if the packet must be dropped and -FI_ENOENT if the message
+ * was queued as unexpected and still references rx_buf.
+ */
+static int rxd_ep_start_rx(struct rxd_ep *ep, struct rxd_peer *peer,
 			   struct ofi_ctrl_hdr *ctrl,
 			   struct fi_cq_msg_entry *comp,
-			   struct rxd_rx_buf *rx_buf)
+			   struct rxd_rx_buf *rx_buf, uint8_t batched)
 {
 	int ret;
 	struct rxd_rx_entry *rx_entry;
 	struct rxd_pkt_data_start *pkt_start;
 	pkt_start = (struct rxd_pkt_data_start *) ctrl;
 
-	rxd_ep_lock_if_required(ep);
-	if (pkt_start->op.version != OFI_OP_VERSION) {
-		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "op version mismatch\n");
-		goto repost;
-	}
-
-	ret = rxd_check_start_pkt_order(ep, peer, ctrl, comp);
-	if (ret == RXD_PKT_ORDR_DUP) {
-		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "duplicate pkt: %d\n", ctrl->seg_no);
-		rxd_handle_dup_datastart(ep, ctrl, rx_buf);
-		goto repost;
-	} else if (ret == RXD_PKT_ORDR_UNEXP) {
-		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "unexpected pkt: %d\n", ctrl->seg_no);
-		rxd_ep_enqueue_pkt(ep, ctrl, comp);
-		goto out;
-	}
-
 	rx_entry = rxd_get_rx_entry(ep);
 	if (!rx_entry)
-		goto repost;
+		return -FI_ENOMEM;
 
 	rx_entry->peer_info = peer;
 	rx_entry->op_hdr = pkt_start->op;
@@ -1105,23 +1486,54 @@ void rxd_handle_start_data(struct rxd_ep *ep, struct rxd_peer *peer,
 		rxd_av_get_fi_addr(ep->av, ctrl->conn_id) : FI_ADDR_UNSPEC;
 	rx_entry->window = 1;
 	rx_entry->last_win_seg = 1;
+	rx_entry->batched = batched;
 
 	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "Assign rx_entry :%d for  %p\n",
 	       rx_entry->key, rx_entry->msg_id);
 
 	ep->credits--;
 	ret = rxd_process_start_data(ep, rx_entry, peer, ctrl, comp, rx_buf);
-	if (ret == -FI_ENOMEM)
+	if (ret == -FI_ENOMEM) {
 		rxd_rx_entry_release(ep, rx_entry);
-	else if (ret == -FI_ENOENT) {
-		peer->exp_msg_id++;
+		return ret;
+	}
+
+	peer->exp_msg_id++;
+	return (ret == -FI_ENOENT) ? ret : 0;
+}
+
+void rxd_handle_start_data(struct rxd_ep *ep, struct rxd_peer *peer,
+			   struct ofi_ctrl_hdr *ctrl,
+			   struct fi_cq_msg_entry *comp,
+			   struct rxd_rx_buf *rx_buf)
+{
+	int ret;
+	struct rxd_pkt_data_start *pkt_start;
+	pkt_start = (struct rxd_pkt_data_start *) ctrl;
 
+	rxd_ep_lock_if_required(ep);
+	if (pkt_start->op.version != OFI_OP_VERSION) {
+		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "op version mismatch\n");
+		goto repost;
+	}
+
+	ret = rxd_check_start_pkt_order(ep, peer, ctrl, comp);
+	if (ret == RXD_PKT_ORDR_DUP) {
+		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "duplicate pkt: %d\n", ctrl->seg_no);
+		rxd_handle_dup_datastart(ep, ctrl, rx_buf);
+		goto repost;
+	} else if (ret == RXD_PKT_ORDR_UNEXP) {
+		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "unexpected pkt: %d\n", ctrl->seg_no);
+		rxd_ep_enqueue_pkt(ep, ctrl, comp);
+		goto out;
+	}
+
+	ret = rxd_ep_start_rx(ep, peer, ctrl, comp, rx_buf, 0);
+	if (ret == -FI_ENOENT) {
 		/* reply ack, with win_sz = 0 */
 		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "Sending wait-ACK [%p] - %d\n",
 			ctrl->msg_id, ctrl->seg_no);
 		goto out;
-	} else {
-		peer->exp_msg_id++;
 	}
 
 repost:
@@ -1135,6 +1547,65 @@ out:
 	return;
 }
 
+/*
+ * Deliver the messages of an ofi_ctrl_batch packet in order.  The batch is
+ * acked as a whole once every message in it has been consumed; messages
+ * queued as unexpected each keep a reference on the receive buffer.
+ */
+static void rxd_handle_batch(struct rxd_ep *ep, struct rxd_peer *peer,
+			     struct ofi_ctrl_hdr *ctrl,
+			     struct fi_cq_msg_entry *comp,
+			     struct rxd_rx_buf *rx_buf)
+{
+	int ret;
+	uint32_t i;
+	size_t offset = 0;
+	struct rxd_pkt_data *pkt = (struct rxd_pkt_data *) ctrl;
+	struct rxd_pkt_data_start *pkt_start;
+
+	rxd_ep_lock_if_required(ep);
+	ret = rxd_check_start_pkt_order(ep, peer, ctrl, comp);
+	if (ret == RXD_PKT_ORDR_UNEXP) {
+		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "unexpected batch: %p\n",
+		       ctrl->msg_id);
+		rxd_ep_enqueue_pkt(ep, ctrl, comp);
+		goto out;
+	}
+
+	rx_buf->ref = 1;
+	for (i = 0; i < ctrl->seg_no; i++) {
+		pkt_start = (struct rxd_pkt_data_start *) (pkt->data + offset);
+		offset += RXD_BATCH_MSG_SZ(pkt_start->ctrl.seg_size);
+		if (pkt_start->op.version != OFI_OP_VERSION) {
+			FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "op version mismatch\n");
+			break;
+		}
+
+		ret = rxd_check_start_pkt_order(ep, peer, &pkt_start->ctrl, comp);
+		if (ret == RXD_PKT_ORDR_DUP)
+			continue;
+		else if (ret == RXD_PKT_ORDR_UNEXP)
+			break;
+
+		ret = rxd_ep_start_rx(ep, peer, &pkt_start->ctrl, comp, rx_buf, 1);
+		if (ret == -FI_ENOMEM)
+			break;
+		else if (ret == -FI_ENOENT)
+			rx_buf->ref++;
+	}
+
+	if (i == ctrl->seg_no)
+		rxd_ep_queue_ack(ep, peer, ctrl, 0, ctrl->conn_id);
+
+	if (comp->flags & RXD_UNEXP_ENTRY) {
+		rxd_release_unexp_entry(ep->rx_cq, comp);
+		ep->num_unexp_pkt--;
+	}
+	rxd_ep_repost_buff(rx_buf);
+out:
+	rxd_ep_unlock_if_required(ep);
+}
+
 void rxd_handle_recv_comp(struct rxd_cq *cq, struct fi_cq_msg_entry *comp,
 			   int is_unexpected)
 {
@@ -1164,6 +1635,10 @@ void rxd_handle_recv_comp(struct rxd_cq *cq, struct fi_cq_msg_entry *comp,
 		return;
 	}
 
+	/* packets queued as unexpected had their acks processed on arrival */
+	if (!is_unexpected)
+		rxd_handle_piggyback_acks(ep, ctrl, comp->len);
+
 	switch(ctrl->type) {
 	case ofi_ctrl_connreq:
 		rxd_handle_conn_req(ep, ctrl, comp, rx_buf);
@@ -1197,6 +1672,12 @@ void rxd_handle_recv_comp(struct rxd_cq *cq, struct fi_cq_msg_entry *comp,
 		rxd_handle_data(ep, peer, ctrl, comp, rx_buf);
 		break;
 
+	case ofi_ctrl_batch:
+		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL,
+		       "batch of %d msgs for tx: %p\n", ctrl->seg_no, ctrl->msg_id);
+		rxd_handle_batch(ep, peer, ctrl, comp, rx_buf);
+		break;
+
 	default:
 		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL,
 			"invalid ctrl type \n", ctrl->type);
@@ -1220,17 +1701,13 @@ static inline void rxd_handle_send_comp(struct fi_cq_msg_entry *comp)
 	rxd_ep_unlock_if_required(pkt_meta->ep);
 }
 
-void rxd_cq_progress(struct util_cq *util_cq)
+static void rxd_cq_progress_locked(struct rxd_cq *cq)
 {
 	ssize_t ret = 0;
-	struct rxd_cq *cq;
 	struct fi_cq_msg_entry cq_entry;
 	struct dlist_entry *item, *next;
 	struct rxd_unexp_cq_entry *unexp;
 
-	cq = container_of(util_cq, struct rxd_cq, util_cq);
-	fastlock_acquire(&cq->lock);
-
 	do {
 		ret = fi_cq_read(cq->dg_cq, &cq_entry, 1);
 		if (ret == -FI_EAGAIN)
@@ -1250,10 +1727,58 @@ void rxd_cq_progress(struct util_cq *util_cq)
 		rxd_handle_recv_comp(cq, &unexp->cq_entry, 1);
 		item = next;
 	}
+}
 
+void rxd_cq_progress(struct util_cq *util_cq)
+{
+	struct rxd_cq *cq;
+
+	cq = container_of(util_cq, struct rxd_cq, util_cq);
+	fastlock_acquire(&cq->lock);
+	rxd_cq_progress_locked(cq);
+	fastlock_release(&cq->lock);
+}
+
+/*
+ * Used by the domain progress thread.  A CQ whose lock is held is being
+ * progressed by the thread that holds it, so skip it rather than wait:
+ * on an oversubscribed host the holder may be preempted, and waiting on
+ * each busy CQ in turn delays the endpoint timers run after them.
+ * Endpoints are not skipped indefinitely (see rxd_ep_progress).
+ */
+void rxd_cq_try_progress(struct rxd_cq *cq)
+{
+	if (fastlock_tryacquire(&cq->lock))
+		return;
+	rxd_cq_progress_locked(cq);
 	fastlock_release(&cq->lock);
 }
 
+static void rxd_cntr_progress(struct util_cntr *cntr)
+{
+	struct rxd_ep *ep;
+	struct fid_list_entry *fid_entry;
+	struct dlist_entry *item;
+
+	fastlock_acquire(&cntr->ep_list_lock);
+	dlist_foreach(&cntr->ep_list, item) {
+		fid_entry = container_of(item, struct fid_list_entry, entry);
+		ep = container_of(fid_entry->fid, struct rxd_ep, ep.fid);
+		if (ep->rx_cq)
+			rxd_cq_progress(&ep->rx_cq->util_cq);
+		if (ep->tx_cq && ep->tx_cq != ep->rx_cq)
+			rxd_cq_progress(&ep->tx_cq->util_cq);
+	}
+	fastlock_release(&cntr->ep_list_lock);
+}
+
+int rxd_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
+		  struct fid_cntr **cntr_fid, void *context)
+{
+	return ofi_cntr_open(&rxd_prov, domain, attr, cntr_fid,
+			     &rxd_cntr_progress, context);
+}
+
 static int rxd_cq_close(struct fid *fid)
 {
 	int ret;
@@ -1283,7 +1808,7 @@ static struct fi_ops rxd_cq_fi_ops = {
 	.close = rxd_cq_close,
 	.bind = fi_no_bind,
 	.control = fi_no_control,
-	.ops_open = fi_no_ops_open,
+	.ops_open = ofi_stats_ops_open,
 };
 
 static struct fi_ops_cq rxd_cq_ops = {
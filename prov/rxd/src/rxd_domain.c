@@ -33,6 +33,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
 
 #include "rxd.h"
 
@@ -42,11 +43,11 @@ static struct fi_ops_domain rxd_domain_ops = {
 	.av_open = rxd_av_create,
 	.cq_open = rxd_cq_open,
 	.endpoint = rxd_endpoint,
-	.scalable_ep = fi_no_scalable_ep,
-	.cntr_open = fi_no_cntr_open,
+	.scalable_ep = ofi_scalable_ep,
+	.cntr_open = rxd_cntr_open,
 	.poll_open = fi_poll_create,
 	.stx_ctx = fi_no_stx_context,
-	.srx_ctx = fi_no_srx_context,
+	.srx_ctx = rxd_srx_context,
 };
 
 static int rxd_domain_close(fid_t fid)
@@ -69,6 +70,7 @@ static int rxd_domain_close(fid_t fid)
 	pthread_join(rxd_domain->progress_thread, NULL);
 	fastlock_destroy(&rxd_domain->lock);
 	fastlock_destroy(&rxd_domain->mr_lock);
+	fastlock_destroy(&rxd_domain->atomic_lock);
 	free(rxd_domain);
 	return 0;
 }
@@ -92,7 +94,7 @@ void *rxd_progress(void *arg)
 		fastlock_acquire(&domain->lock);
 		dlist_foreach(&domain->cq_list, item) {
 			cq = container_of(item, struct rxd_cq, dom_entry);
-			rxd_cq_progress(&cq->util_cq);
+			rxd_cq_try_progress(cq);
 		}
 
 		dlist_foreach(&domain->ep_list, item) {
@@ -100,6 +102,8 @@ void *rxd_progress(void *arg)
 			rxd_ep_progress(ep);
 		}
 		fastlock_release(&domain->lock);
+		/* Let application threads polling this domain's CQs run. */
+		sched_yield();
 	}
 	return NULL;
 }
@@ -272,6 +276,7 @@ int rxd_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 	dlist_init(&rxd_domain->cq_list);
 	fastlock_init(&rxd_domain->lock);
 	fastlock_init(&rxd_domain->mr_lock);
+	fastlock_init(&rxd_domain->atomic_lock);
 
 	ret = ofi_mr_init(&rxd_prov, info->domain_attr->mr_mode, &rxd_domain->mr_heap);
 	if (ret)
@@ -46,7 +46,9 @@ static ssize_t	rxd_ep_cancel(fid_t fid, void *context)
 
 	ep = container_of(fid, struct rxd_ep, ep.fid);
 	rxd_ep_lock_if_required(ep);
-	for (entry = ep->recv_list.next; entry != &ep->recv_list; entry = next) {
+	fastlock_acquire(&ep->rx_ctx->lock);
+	for (entry = ep->rx_ctx->recv_list.next;
+	     entry != &ep->rx_ctx->recv_list; entry = next) {
 		next = entry->next;
 		recv_entry = container_of(entry, struct rxd_recv_entry, entry);
 		if (recv_entry->msg.context != context)
@@ -61,7 +63,8 @@ static ssize_t	rxd_ep_cancel(fid_t fid, void *context)
 		goto out;
 	}
 
-	for (entry = ep->trecv_list.next; entry != &ep->trecv_list; entry = next) {
+	for (entry = ep->rx_ctx->trecv_list.next;
+	     entry != &ep->rx_ctx->trecv_list; entry = next) {
 		next = entry->next;
 		trecv_entry = container_of(entry, struct rxd_trecv_entry, entry);
 		if (trecv_entry->msg.context != context)
@@ -78,6 +81,7 @@ static ssize_t	rxd_ep_cancel(fid_t fid, void *context)
 	}
 
 out:
+	fastlock_release(&ep->rx_ctx->lock);
 	rxd_ep_unlock_if_required(ep);
 	return 0;
 }
@@ -85,13 +89,39 @@ out:
 static int rxd_ep_getopt(fid_t fid, int level, int optname,
 		   void *optval, size_t *optlen)
 {
-	return -FI_ENOSYS;
+	struct rxd_ep *rxd_ep;
+
+	rxd_ep = container_of(fid, struct rxd_ep, ep.fid);
+
+	if (level != FI_OPT_ENDPOINT || optname != FI_OPT_MIN_MULTI_RECV)
+		return -FI_ENOPROTOOPT;
+
+	if (*optlen < sizeof(size_t)) {
+		*optlen = sizeof(size_t);
+		return -FI_ETOOSMALL;
+	}
+	*(size_t *) optval = rxd_ep->rx_ctx->min_multi_recv;
+	*optlen = sizeof(size_t);
+	return 0;
 }
 
 static int rxd_ep_setopt(fid_t fid, int level, int optname,
 		   const void *optval, size_t optlen)
 {
-	return -FI_ENOSYS;
+	struct rxd_ep *rxd_ep;
+
+	rxd_ep = container_of(fid, struct rxd_ep, ep.fid);
+
+	if (level != FI_OPT_ENDPOINT || optname != FI_OPT_MIN_MULTI_RECV)
+		return -FI_ENOPROTOOPT;
+
+	if (optlen != sizeof(size_t))
+		return -FI_EINVAL;
+
+	fastlock_acquire(&rxd_ep->rx_ctx->lock);
+	rxd_ep->rx_ctx->min_multi_recv = *(size_t *) optval;
+	fastlock_release(&rxd_ep->rx_ctx->lock);
+	return 0;
 }
 
 struct fi_ops_ep rxd_ops_ep = {
@@ -105,25 +135,37 @@ struct fi_ops_ep rxd_ops_ep = {
 	.tx_size_left = fi_no_tx_size_left,
 };
 
+static inline struct rxd_rx_ctx *rxd_ep_rx_ctx(struct fid_ep *ep)
+{
+	return (ep->fid.fclass == FI_CLASS_SRX_CTX) ?
+		container_of(ep, struct rxd_rx_ctx, ep) :
+		container_of(ep, struct rxd_ep, ep)->rx_ctx;
+}
+
 static ssize_t rxd_ep_recvmsg(struct fid_ep *ep, const struct fi_msg *msg,
 			       uint64_t flags)
 {
-	ssize_t ret = 0, i;
-	struct rxd_ep *rxd_ep;
+	ssize_t i;
+	struct rxd_rx_ctx *rx_ctx;
 	struct rxd_recv_entry *recv_entry;
+	struct rxd_rx_entry *rx_entry;
+	struct dlist_entry matched;
 
-	rxd_ep = container_of(ep, struct rxd_ep, ep);
+	if ((flags & FI_MULTI_RECV) && msg->iov_count != 1)
+		return -FI_EINVAL;
 
-	rxd_ep_lock_if_required(rxd_ep);
-	if (freestack_isempty(rxd_ep->recv_fs)) {
-		ret = -FI_EAGAIN;
-		goto out;
+	rx_ctx = rxd_ep_rx_ctx(ep);
+
+	fastlock_acquire(&rx_ctx->lock);
+	if (freestack_isempty(rx_ctx->recv_fs)) {
+		fastlock_release(&rx_ctx->lock);
+		return -FI_EAGAIN;
 	}
 
-	recv_entry = freestack_pop(rxd_ep->recv_fs);
+	recv_entry = freestack_pop(rx_ctx->recv_fs);
 	recv_entry->msg = *msg;
 	recv_entry->flags = flags;
-	recv_entry->msg.addr = (rxd_ep->caps & FI_DIRECTED_RECV) ?
+	recv_entry->msg.addr = (rx_ctx->caps & FI_DIRECTED_RECV) ?
 		recv_entry->msg.addr : FI_ADDR_UNSPEC;
 	for (i = 0; i < msg->iov_count; i++) {
 		recv_entry->iov[i].iov_base = msg->msg_iov[i].iov_base;
@@ -132,15 +174,27 @@ static ssize_t rxd_ep_recvmsg(struct fid_ep *ep, const struct fi_msg *msg,
 			msg->msg_iov[i].iov_len);
 	}
 
-	dlist_init(&recv_entry->entry);
-	dlist_insert_tail(&recv_entry->entry, &rxd_ep->recv_list);
+	/*
+	 * A multi-recv buffer can absorb several unexpected messages; stop
+	 * once the posted entry has been taken off the recv list.
+	 */
+	dlist_insert_tail(&recv_entry->entry, &rx_ctx->recv_list);
+	dlist_init(&matched);
+	while ((rx_entry = rxd_rx_ctx_match_unexp_msg(rx_ctx, recv_entry))) {
+		dlist_insert_tail(&rx_entry->unexp_entry, &matched);
+		if (!(recv_entry->flags & FI_MULTI_RECV) ||
+		    (rx_entry->recv->flags & FI_MULTI_RECV))
+			break;
+	}
+	fastlock_release(&rx_ctx->lock);
 
-	if (!dlist_empty(&rxd_ep->unexp_msg_list)) {
-		rxd_ep_check_unexp_msg_list(rxd_ep, recv_entry);
+	while (!dlist_empty(&matched)) {
+		rx_entry = container_of(matched.next, struct rxd_rx_entry,
+					unexp_entry);
+		dlist_remove(&rx_entry->unexp_entry);
+		rxd_ep_progress_unexp_msg(rx_entry);
 	}
-out:
-	rxd_ep_unlock_if_required(rxd_ep);
-	return ret;
+	return 0;
 }
 
 static ssize_t rxd_ep_recv(struct fid_ep *ep, void *buf, size_t len, void *desc,
@@ -183,6 +237,10 @@ static inline void *rxd_mr_desc(struct fid_mr *mr, struct rxd_ep *ep)
 int rxd_ep_repost_buff(struct rxd_rx_buf *buf)
 {
 	int ret;
+
+	if (buf->ref && --buf->ref)
+		return 0;
+
 	ret = fi_recv(buf->ep->dg_ep, buf->buf, buf->ep->domain->max_mtu_sz,
 		      rxd_mr_desc(buf->mr, buf->ep),
 		      FI_ADDR_UNSPEC, &buf->context);
@@ -212,8 +270,10 @@ static int rxd_ep_set_conn_id(struct rxd_ep *ep)
 int rxd_ep_enable(struct rxd_ep *ep)
 {
 	ssize_t i, ret;
+	size_t rx_cnt;
 	void *mr = NULL;
 	struct rxd_rx_buf *rx_buf;
+	struct rxd_rx_ctx *rx_ctx = ep->rx_ctx;
 
 	ret = fi_enable(ep->dg_ep);
 	if (ret)
@@ -224,11 +284,17 @@ int rxd_ep_enable(struct rxd_ep *ep)
 	if (ret)
 		goto out;
 
-	ep->credits = ep->rx_size;
-	for (i = 0; i < ep->rx_size; i++) {
+	/* Endpoints sharing a receive context draw from a common packet pool,
+	 * so each keeps only enough buffers posted to cover a few windows. */
+	rx_cnt = (rx_ctx->ep.fid.fclass == FI_CLASS_SRX_CTX) ?
+		 MIN(ep->rx_size, RXD_SRX_EP_RX_CNT) : ep->rx_size;
+	ep->credits = rx_cnt;
+	for (i = 0; i < rx_cnt; i++) {
+		fastlock_acquire(&rx_ctx->lock);
 		rx_buf = ep->do_local_mr ?
-			util_buf_get_ex(ep->rx_pkt_pool, &mr) :
-			util_buf_get(ep->rx_pkt_pool);
+			util_buf_alloc_ex(rx_ctx->rx_pkt_pool, &mr) :
+			util_buf_alloc(rx_ctx->rx_pkt_pool);
+		fastlock_release(&rx_ctx->lock);
 
 		if (!rx_buf) {
 			ret = -FI_ENOMEM;
@@ -237,6 +303,7 @@ int rxd_ep_enable(struct rxd_ep *ep)
 
 		rx_buf->mr = (struct fid_mr *) mr;
 		rx_buf->ep = ep;
+		rx_buf->ref = 0;
 		ret = rxd_ep_repost_buff(rx_buf);
 		if (ret)
 			goto out;
@@ -263,6 +330,12 @@ void rxd_ep_lock_if_required(struct rxd_ep *ep)
 	fastlock_acquire(&ep->lock);
 }
 
+int rxd_ep_trylock_if_required(struct rxd_ep *ep)
+{
+	/* todo: do locking based on threading model */
+	return fastlock_tryacquire(&ep->lock);
+}
+
 void rxd_ep_unlock_if_required(struct rxd_ep *ep)
 {
 	/* todo: do unlocking based on threading model */
@@ -372,6 +445,74 @@ static uint64_t rxd_ep_copy_data(struct rxd_tx_entry *tx_entry,
 	return done;
 }
 
+static void rxd_ep_add_ack(struct rxd_peer *peer, struct ofi_ctrl_hdr *in_ctrl,
+			   uint16_t seg_size, uint64_t rx_key, uint64_t source)
+{
+	struct ofi_ctrl_hdr *ctrl;
+
+	ctrl = (struct ofi_ctrl_hdr *) peer->acks->pkt_data + peer->num_acks++;
+	rxd_init_ctrl_hdr(ctrl, ofi_ctrl_ack, seg_size, in_ctrl->seg_no,
+			  in_ctrl->msg_id, rx_key, source);
+}
+
+static void rxd_ep_drop_acks(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	dlist_remove(&peer->acks->entry);
+	util_buf_release(ep->tx_pkt_pool, peer->acks);
+	peer->acks = NULL;
+	peer->num_acks = 0;
+}
+
+/* Send the acks held back for a peer as one ofi_ctrl_ack packet */
+static int rxd_ep_flush_acks(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	ssize_t ret;
+	uint16_t num_acks = peer->num_acks;
+	struct rxd_pkt_meta *pkt_meta = peer->acks;
+
+	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "sending %d acks\n", num_acks);
+	RXD_PKT_MARK_REMOTE_ACK(pkt_meta);
+	pkt_meta->us_stamp = fi_gettime_us();
+	ret = fi_send(ep->dg_ep, pkt_meta->pkt_data, num_acks * RXD_ACK_SZ,
+		      rxd_mr_desc(pkt_meta->mr, ep), pkt_meta->peer,
+		      &pkt_meta->context);
+	if (ret) {
+		rxd_ep_drop_acks(ep, peer);
+		return ret;
+	}
+
+	dlist_remove(&pkt_meta->entry);
+	peer->acks = NULL;
+	peer->num_acks = 0;
+	ep->num_out++;
+	ofi_stats_add(&ep->stats, RXD_STAT_ACK_SENT, num_acks);
+	ofi_stats_inc(&ep->stats, RXD_STAT_ACK_PKT_SENT);
+	return 0;
+}
+
+/*
+ * Append the acks held back for a peer to a packet of len bytes that is
+ * about to be sent to it, if they fit.  Returns the new packet length.
+ */
+static size_t rxd_ep_piggyback_acks(struct rxd_ep *ep, struct rxd_peer *peer,
+				    void *pkt, size_t len)
+{
+	size_t ack_sz;
+
+	if (!peer->acks)
+		return len;
+
+	ack_sz = peer->num_acks * RXD_ACK_SZ;
+	if (len + ack_sz > ep->domain->max_mtu_sz)
+		return len;
+
+	memcpy((char *) pkt + len, peer->acks->pkt_data, ack_sz);
+	ofi_stats_add(&ep->stats, RXD_STAT_ACK_SENT, peer->num_acks);
+	ofi_stats_add(&ep->stats, RXD_STAT_ACK_PIGGYBACK, peer->num_acks);
+	rxd_ep_drop_acks(ep, peer);
+	return len + ack_sz;
+}
+
 ssize_t rxd_ep_post_data_msg(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry)
 {
 	int ret;
@@ -397,7 +538,8 @@ ssize_t rxd_ep_post_data_msg(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry)
 		RXD_PKT_LAST : RXD_PKT_DATA;
 	pkt_meta->us_stamp = fi_gettime_us();
 
-	ret = fi_send(ep->dg_ep, pkt, data_sz + RXD_DATA_PKT_SZ,
+	ret = fi_send(ep->dg_ep, pkt,
+		      rxd_ep_piggyback_acks(ep, peer, pkt, data_sz + RXD_DATA_PKT_SZ),
 		      rxd_mr_desc(pkt_meta->mr, ep), tx_entry->peer, &pkt_meta->context);
 	if (ret) {
 		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "send %d failed\n", pkt->ctrl.seg_no);
@@ -484,10 +626,21 @@ int rxd_progress_tx(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry)
 
 void rxd_tx_entry_discard(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry)
 {
+	rxd_cntr_report_tx_comp(ep, tx_entry);
 	rxd_cq_report_tx_comp(ep->tx_cq, tx_entry);
 	rxd_tx_entry_done(ep, tx_entry);
 }
 
+void rxd_tx_entry_error(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
+			int err)
+{
+	FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "tx %p failed at target: %s\n",
+		tx_entry->msg_id, fi_strerror(err));
+	rxd_cntr_report_tx_err(ep, tx_entry);
+	rxd_cq_report_tx_err(ep->tx_cq, tx_entry, err);
+	rxd_tx_entry_done(ep, tx_entry);
+}
+
 void rxd_resend_pkt(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
 		     uint32_t seg_no)
 {
@@ -516,7 +669,7 @@ void rxd_resend_pkt(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
 				ctrl->seg_no, ctrl->msg_id);
 
 			pkt->us_stamp = fi_gettime_us();
-			rxd_ep_retry_pkt(ep, tx_entry, pkt);
+			rxd_ep_retry_pkt(ep, tx_entry->peer, pkt);
 			break;
 		}
 	}
@@ -564,6 +717,39 @@ int rxd_tx_entry_progress(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
 	return 0;
 }
 
+/*
+ * Ack a message that has been fully received.  With rxd_ack_delay_us set,
+ * the ack is held back for up to that long, or until RXD_MAX_DELAYED_ACK
+ * are pending for the peer, so that several go out in one packet or on
+ * the next packet sent to the peer.  Acks that carry a window are never
+ * delayed, since the peer is waiting on them.
+ */
+int rxd_ep_queue_ack(struct rxd_ep *ep, struct rxd_peer *peer,
+		     struct ofi_ctrl_hdr *in_ctrl, uint64_t rx_key,
+		     fi_addr_t dest)
+{
+	struct rxd_pkt_meta *pkt_meta;
+
+	if (!rxd_ack_delay_us)
+		return rxd_ep_reply_ack(ep, in_ctrl, ofi_ctrl_ack, 0, rx_key,
+					peer->conn_data, dest);
+
+	if (!peer->acks) {
+		pkt_meta = rxd_tx_pkt_acquire(ep);
+		if (!pkt_meta)
+			return -FI_ENOMEM;
+
+		pkt_meta->peer = dest;
+		pkt_meta->us_stamp = fi_gettime_us();
+		dlist_insert_tail(&pkt_meta->entry, &ep->ack_list);
+		peer->acks = pkt_meta;
+	}
+
+	rxd_ep_add_ack(peer, in_ctrl, 0, rx_key, peer->conn_data);
+	return (peer->num_acks == RXD_MAX_DELAYED_ACK) ?
+		rxd_ep_flush_acks(ep, peer) : 0;
+}
+
 int rxd_ep_reply_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *in_ctrl,
 		   uint8_t type, uint16_t seg_size, uint64_t rx_key,
 		   uint64_t source, fi_addr_t dest)
@@ -571,6 +757,15 @@ int rxd_ep_reply_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *in_ctrl,
 	ssize_t ret;
 	struct rxd_pkt_meta *pkt_meta;
 	struct rxd_pkt_data *pkt;
+	struct rxd_peer *peer;
+
+	if (type == ofi_ctrl_ack) {
+		peer = rxd_ep_getpeer_info(ep, dest);
+		if (peer->acks) {
+			rxd_ep_add_ack(peer, in_ctrl, seg_size, rx_key, source);
+			return rxd_ep_flush_acks(ep, peer);
+		}
+	}
 
 	pkt_meta = rxd_tx_pkt_acquire(ep);
 	if (!pkt_meta)
@@ -591,6 +786,10 @@ int rxd_ep_reply_ack(struct rxd_ep *ep, struct ofi_ctrl_hdr *in_ctrl,
 	if (ret)
 		goto err;
 	ep->num_out++;
+	if (type == ofi_ctrl_ack) {
+		ofi_stats_inc(&ep->stats, RXD_STAT_ACK_SENT);
+		ofi_stats_inc(&ep->stats, RXD_STAT_ACK_PKT_SENT);
+	}
 	return 0;
 err:
 	util_buf_release(ep->tx_pkt_pool, pkt_meta);
@@ -666,6 +865,7 @@ void rxd_ep_init_start_hdr(struct rxd_ep *ep, struct rxd_peer *peer,
 {
 	size_t curr_offset, i, iov_sz;
 	struct ofi_rma_iov rma_iov;
+	struct ofi_rma_ioc rma_ioc;
 
 	switch(op) {
 	case ofi_op_msg:
@@ -747,11 +947,79 @@ void rxd_ep_init_start_hdr(struct rxd_ep *ep, struct rxd_peer *peer,
 						     OFI_COPY_IOV_TO_BUF);
 		break;
 
+	case ofi_op_atomic:
+		*msg_sz = ofi_get_iov_len(tx_entry->atomic.src_iov,
+					  tx_entry->atomic.msg.iov_count) +
+			  ofi_get_iov_len(tx_entry->atomic.cmp_iov,
+					  tx_entry->atomic.cmp_count);
+
+		rxd_init_op_hdr(&pkt->op, tx_entry->atomic.msg.data, *msg_sz,
+				0, op, 0, flags);
+		pkt->op.op_data = (tx_entry->op_type == RXD_TX_ATOMIC_FETCH) ?
+				  RXD_ATOMIC_FETCH : 0;
+		pkt->op.atomic.datatype = tx_entry->atomic.msg.datatype;
+		pkt->op.atomic.op = tx_entry->atomic.msg.op;
+		pkt->op.atomic.ioc_count = tx_entry->atomic.msg.rma_iov_count;
+
+		curr_offset = 0;
+		for (i = 0; i < pkt->op.atomic.ioc_count; i++) {
+			rma_ioc.addr = tx_entry->atomic.dst_ioc[i].addr;
+			rma_ioc.count = tx_entry->atomic.dst_ioc[i].count;
+			rma_ioc.key = tx_entry->atomic.dst_ioc[i].key;
+			memcpy(pkt->data + curr_offset, &rma_ioc, sizeof(struct ofi_rma_ioc));
+			curr_offset += sizeof(struct ofi_rma_ioc);
+		}
+		curr_offset += ofi_copy_iov_buf(tx_entry->atomic.src_iov,
+						tx_entry->atomic.msg.iov_count,
+						pkt->data + curr_offset, *msg_sz, 0,
+						OFI_COPY_IOV_TO_BUF);
+		curr_offset += ofi_copy_iov_buf(tx_entry->atomic.cmp_iov,
+						tx_entry->atomic.cmp_count,
+						pkt->data + curr_offset, *msg_sz, 0,
+						OFI_COPY_IOV_TO_BUF);
+		tx_entry->done = *msg_sz;
+		*data_sz = curr_offset;
+		assert(*data_sz <= RXD_MAX_STRT_DATA_PKT_SZ(ep));
+		break;
+
 	default:
 		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "invalid op-type\n", op);
 	}
 }
 
+/*
+ * Send the open batch of a peer.  Its messages already hold sequence
+ * numbers, so if the send fails it is left to the retransmit timer.
+ */
+static void rxd_ep_flush_batch(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	ssize_t ret;
+	struct rxd_pkt_meta *pkt_meta;
+	struct rxd_pkt_data *pkt;
+
+	pkt_meta = peer->batch;
+	pkt = (struct rxd_pkt_data *) pkt_meta->pkt_data;
+	peer->batch = NULL;
+	dlist_remove(&pkt_meta->entry);
+
+	pkt_meta->us_stamp = fi_gettime_us();
+	ret = fi_send(ep->dg_ep, pkt,
+		      rxd_ep_piggyback_acks(ep, peer, pkt,
+					    pkt->ctrl.seg_size + RXD_DATA_PKT_SZ),
+		      rxd_mr_desc(pkt_meta->mr, ep), pkt_meta->peer,
+		      &pkt_meta->context);
+	if (ret) {
+		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "send batch %p failed\n",
+		       pkt->ctrl.msg_id);
+		RXD_PKT_MARK_LOCAL_ACK(pkt_meta);
+	}
+
+	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "sent batch %p, %d msgs\n",
+	       pkt->ctrl.msg_id, pkt->ctrl.seg_no);
+	dlist_insert_tail(&pkt_meta->entry, &ep->inject_pkt_list);
+	ep->num_out++;
+}
+
 ssize_t rxd_ep_post_start_msg(struct rxd_ep *ep, struct rxd_peer *peer,
 			      uint8_t op, struct rxd_tx_entry *tx_entry)
 {
@@ -762,6 +1030,9 @@ ssize_t rxd_ep_post_start_msg(struct rxd_ep *ep, struct rxd_peer *peer,
 	struct rxd_pkt_meta *pkt_meta;
 	struct rxd_pkt_data_start *pkt;
 
+	if (peer->batch)
+		rxd_ep_flush_batch(ep, peer);
+
 	pkt_meta = rxd_tx_pkt_acquire(ep);
 	if (!pkt_meta)
 		return -FI_ENOMEM;
@@ -782,7 +1053,9 @@ ssize_t rxd_ep_post_start_msg(struct rxd_ep *ep, struct rxd_peer *peer,
 		RXD_PKT_LAST : RXD_PKT_DATA;
 
 	pkt_meta->us_stamp = fi_gettime_us();
-	ret = fi_send(ep->dg_ep, pkt, data_sz + RXD_START_DATA_PKT_SZ,
+	ret = fi_send(ep->dg_ep, pkt,
+		      rxd_ep_piggyback_acks(ep, peer, pkt,
+					    data_sz + RXD_START_DATA_PKT_SZ),
 		      rxd_mr_desc(pkt_meta->mr, ep),
 		      tx_entry->peer, &pkt_meta->context);
 	if (ret)
@@ -940,6 +1213,150 @@ void rxd_ep_copy_rma_iov(const struct fi_rma_iov *src_iov,
 		dst_iov[i] = src_iov[i];
 }
 
+static void rxd_ep_init_inject(struct rxd_peer *peer,
+			       struct rxd_pkt_data_start *pkt, const void *buf,
+			       size_t len, uint64_t data, uint8_t op,
+			       uint64_t tag, uint64_t flags)
+{
+	rxd_init_op_hdr(&pkt->op, data, len, 0, op, tag,
+			rxd_prepare_tx_flags(flags));
+	memcpy(pkt->data, buf, len);
+	rxd_init_ctrl_hdr(&pkt->ctrl, ofi_ctrl_start_data, len, 0,
+			  RXD_TX_ID(peer->nxt_msg_id, RXD_INJECT_TX_IDX),
+			  peer->conn_data, peer->conn_data);
+}
+
+/*
+ * Append an injected message to the open ofi_ctrl_batch packet of the peer,
+ * opening a new one if there is none or the message does not fit.  The
+ * batch is sent once full, after rxd_coalesce_us, or before any other
+ * message to the peer, and is acked as a whole.
+ */
+static ssize_t rxd_ep_batch_inject(struct rxd_ep *ep, struct rxd_peer *peer,
+				   fi_addr_t peer_addr, const void *buf,
+				   size_t len, uint64_t data, uint8_t op,
+				   uint64_t tag, uint64_t flags)
+{
+	size_t msg_sz = RXD_BATCH_MSG_SZ(len);
+	struct rxd_pkt_meta *pkt_meta;
+	struct rxd_pkt_data *pkt;
+
+	pkt_meta = peer->batch;
+	if (pkt_meta) {
+		pkt = (struct rxd_pkt_data *) pkt_meta->pkt_data;
+		if (RXD_DATA_PKT_SZ + pkt->ctrl.seg_size + msg_sz >
+		    ep->domain->max_mtu_sz) {
+			rxd_ep_flush_batch(ep, peer);
+			pkt_meta = NULL;
+		}
+	}
+
+	if (!pkt_meta) {
+		if (peer->num_inject_out == RXD_MAX_OUT_INJECT)
+			return -FI_EAGAIN;
+
+		pkt_meta = rxd_tx_pkt_acquire(ep);
+		if (!pkt_meta)
+			return -FI_ENOMEM;
+
+		pkt = (struct rxd_pkt_data *) pkt_meta->pkt_data;
+		rxd_init_ctrl_hdr(&pkt->ctrl, ofi_ctrl_batch, 0, 0,
+				  RXD_TX_ID(peer->nxt_msg_id, RXD_INJECT_TX_IDX),
+				  peer->conn_data, peer->conn_data);
+		pkt_meta->tx_entry = NULL;
+		pkt_meta->peer = peer_addr;
+		pkt_meta->type = RXD_PKT_LAST;
+		pkt_meta->us_stamp = fi_gettime_us();
+		dlist_insert_tail(&pkt_meta->entry, &ep->batch_list);
+		peer->batch = pkt_meta;
+		peer->num_inject_out++;
+	}
+
+	rxd_ep_init_inject(peer, (struct rxd_pkt_data_start *)
+			   (pkt->data + pkt->ctrl.seg_size),
+			   buf, len, data, op, tag, flags);
+	pkt->ctrl.seg_size += msg_sz;
+	pkt->ctrl.seg_no++;
+	peer->nxt_msg_id++;
+	return 0;
+}
+
+/*
+ * Injected messages that fit in a single start packet are built directly in
+ * a tx packet buffer and tracked on ep->inject_pkt_list until acked.  They
+ * do not consume a tx entry and never generate a CQ entry.
+ */
+static ssize_t rxd_ep_post_inject(struct rxd_ep *ep, const void *buf, size_t len,
+				  uint64_t data, fi_addr_t addr, uint8_t op,
+				  uint64_t tag, uint64_t flags)
+{
+	ssize_t ret;
+	uint64_t peer_addr;
+	struct rxd_peer *peer;
+	struct rxd_pkt_meta *pkt_meta;
+	struct rxd_pkt_data_start *pkt;
+
+	if (len > ep->inject_size)
+		return -FI_EINVAL;
+
+	peer_addr = rxd_av_get_dg_addr(ep->av, addr);
+	peer = rxd_ep_getpeer_info(ep, peer_addr);
+
+	rxd_ep_lock_if_required(ep);
+	if (!peer->addr_published) {
+		ret = rxd_ep_post_conn_msg(ep, peer, peer_addr);
+		ret = (ret) ? ret : -FI_EAGAIN;
+		goto out;
+	}
+
+	if (rxd_coalesce_us && len <= RXD_MAX_COALESCE_SZ &&
+	    RXD_DATA_PKT_SZ + RXD_BATCH_MSG_SZ(len) <= ep->domain->max_mtu_sz) {
+		ret = rxd_ep_batch_inject(ep, peer, peer_addr, buf, len, data,
+					  op, tag, flags);
+		goto out;
+	}
+
+	if (peer->batch)
+		rxd_ep_flush_batch(ep, peer);
+
+	if (peer->num_inject_out == RXD_MAX_OUT_INJECT) {
+		ret = -FI_EAGAIN;
+		goto out;
+	}
+
+	pkt_meta = rxd_tx_pkt_acquire(ep);
+	if (!pkt_meta) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	pkt = (struct rxd_pkt_data_start *) pkt_meta->pkt_data;
+	rxd_ep_init_inject(peer, pkt, buf, len, data, op, tag, flags);
+
+	pkt_meta->tx_entry = NULL;
+	pkt_meta->peer = peer_addr;
+	pkt_meta->type = RXD_PKT_LAST;
+	pkt_meta->us_stamp = fi_gettime_us();
+	ret = fi_send(ep->dg_ep, pkt,
+		      rxd_ep_piggyback_acks(ep, peer, pkt,
+					    len + RXD_START_DATA_PKT_SZ),
+		      rxd_mr_desc(pkt_meta->mr, ep), peer_addr,
+		      &pkt_meta->context);
+	if (ret) {
+		util_buf_release(ep->tx_pkt_pool, pkt_meta);
+		goto out;
+	}
+
+	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "sent inject %p\n", pkt->ctrl.msg_id);
+	dlist_insert_tail(&pkt_meta->entry, &ep->inject_pkt_list);
+	peer->nxt_msg_id++;
+	peer->num_inject_out++;
+	ep->num_out++;
+out:
+	rxd_ep_unlock_if_required(ep);
+	return ret;
+}
+
 static ssize_t rxd_ep_sendmsg(struct fid_ep *ep, const struct fi_msg *msg,
 			       uint64_t flags)
 {
@@ -1019,18 +1436,11 @@ static ssize_t rxd_ep_sendv(struct fid_ep *ep, const struct iovec *iov, void **d
 static ssize_t	rxd_ep_inject(struct fid_ep *ep, const void *buf, size_t len,
 			       fi_addr_t dest_addr)
 {
-	struct fi_msg msg;
-	struct iovec msg_iov;
-
-	memset(&msg, 0, sizeof(msg));
-	msg_iov.iov_base = (void *) buf;
-	msg_iov.iov_len = len;
-	msg.msg_iov = &msg_iov;
-	msg.iov_count = 1;
-	msg.addr = dest_addr;
+	struct rxd_ep *rxd_ep;
+	rxd_ep = container_of(ep, struct rxd_ep, ep);
 
-	return rxd_ep_sendmsg(ep, &msg, FI_INJECT |
-			       RXD_NO_COMPLETION | RXD_USE_OP_FLAGS);
+	return rxd_ep_post_inject(rxd_ep, buf, len, 0, dest_addr,
+				  ofi_op_msg, 0, FI_INJECT);
 }
 
 static ssize_t rxd_ep_senddata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
@@ -1055,20 +1465,11 @@ static ssize_t rxd_ep_senddata(struct fid_ep *ep, const void *buf, size_t len, v
 static ssize_t	rxd_ep_injectdata(struct fid_ep *ep, const void *buf, size_t len,
 				   uint64_t data, fi_addr_t dest_addr)
 {
-	struct fi_msg msg;
-	struct iovec msg_iov;
-
-	memset(&msg, 0, sizeof(msg));
-	msg_iov.iov_base = (void *) buf;
-	msg_iov.iov_len = len;
-	msg.msg_iov = &msg_iov;
-
-	msg.iov_count = 1;
-	msg.addr = dest_addr;
-	msg.data = data;
+	struct rxd_ep *rxd_ep;
+	rxd_ep = container_of(ep, struct rxd_ep, ep);
 
-	return rxd_ep_sendmsg(ep, &msg, FI_REMOTE_CQ_DATA | FI_INJECT |
-			       RXD_NO_COMPLETION | RXD_USE_OP_FLAGS);
+	return rxd_ep_post_inject(rxd_ep, buf, len, data, dest_addr,
+				  ofi_op_msg, 0, FI_REMOTE_CQ_DATA | FI_INJECT);
 }
 
 static struct fi_ops_msg rxd_ops_msg = {
@@ -1097,23 +1498,26 @@ static int rxd_peek_trecv(struct dlist_entry *item, const void *arg)
                  (rx_entry->source == msg->addr)));
 }
 
-static void rxd_trx_discard_recv(struct rxd_ep *ep,
-				  struct rxd_rx_entry *rx_entry)
+/* The unexpected entry must already be removed from the rx_ctx */
+static void rxd_trx_discard_recv(struct rxd_rx_entry *rx_entry)
 {
+	struct rxd_ep *ep = rx_entry->ep;
 	struct rxd_rx_buf *rx_buf;
 	struct ofi_ctrl_hdr *ctrl;
 	struct rxd_peer *peer;
 
+	rxd_ep_lock_if_required(ep);
 	rx_buf = rx_entry->unexp_buf;
-	ctrl = (struct ofi_ctrl_hdr *) rx_buf->buf;
+	ctrl = &rx_entry->unexp_pkt->ctrl;
 	peer = rxd_ep_getpeer_info(ep, ctrl->conn_id);
 
-	dlist_remove(&rx_entry->unexp_entry);
-	ep->num_unexp_msg--;
-
-	rxd_ep_reply_discard(ep, ctrl, 0, ctrl->rx_key, peer->conn_data, ctrl->conn_id);
+	/* the batch of a batched message has already been acked */
+	if (!rx_entry->batched)
+		rxd_ep_reply_discard(ep, ctrl, 0, ctrl->rx_key,
+				     peer->conn_data, ctrl->conn_id);
 	rxd_rx_entry_release(ep, rx_entry);
 	rxd_ep_repost_buff(rx_buf);
+	rxd_ep_unlock_if_required(ep);
 }
 
 static ssize_t rxd_trx_peek_recv(struct rxd_ep *ep,
@@ -1124,16 +1528,21 @@ static ssize_t rxd_trx_peek_recv(struct rxd_ep *ep,
 	struct fi_cq_err_entry err_entry = {0};
 	struct fi_cq_tagged_entry cq_entry = {0};
 	struct fi_context *context;
+	struct rxd_rx_ctx *rx_ctx = ep->rx_ctx;
 
-	match = dlist_find_first_match(&ep->unexp_tag_list,
+	fastlock_acquire(&rx_ctx->lock);
+	match = dlist_find_first_match(&rx_ctx->unexp_tag_list,
 				       &rxd_peek_trecv, msg);
 	if (!match) {
+		fastlock_release(&rx_ctx->lock);
 		err_entry.op_context = msg->context;
 		err_entry.flags = (FI_MSG | FI_RECV | FI_TAGGED);
 		err_entry.tag = msg->tag;
 		err_entry.err = FI_ENOMSG;
 		err_entry.prov_errno = -FI_ENOMSG;
+		rxd_ep_lock_if_required(ep);
 		rxd_cq_report_error(ep->rx_cq, &err_entry);
+		rxd_ep_unlock_if_required(ep);
 		return 0;
 	}
 
@@ -1145,39 +1554,45 @@ static ssize_t rxd_trx_peek_recv(struct rxd_ep *ep,
 	cq_entry.data = rx_entry->op_hdr.data;
 	cq_entry.tag = rx_entry->op_hdr.tag;
 
+	if (flags & (FI_CLAIM | FI_DISCARD)) {
+		dlist_remove(match);
+		rx_ctx->num_unexp_msg--;
+	}
+	fastlock_release(&rx_ctx->lock);
+
 	if (flags & FI_CLAIM) {
 		context = (struct fi_context *)msg->context;
 		context->internal[0] = rx_entry;
-		dlist_remove(match);
 	} else if (flags & FI_DISCARD) {
-		rxd_trx_discard_recv(ep, rx_entry);
+		rxd_trx_discard_recv(rx_entry);
 	}
 
+	rxd_ep_lock_if_required(ep);
 	ep->rx_cq->write_fn(ep->rx_cq, &cq_entry);
+	rxd_ep_unlock_if_required(ep);
 	return 0;
 }
 
 ssize_t rxd_trx_claim_recv(struct rxd_ep *ep, const struct fi_msg_tagged *msg,
 			    uint64_t flags)
 {
-	int ret = 0, i;
+	int i;
 	struct fi_context *context;
 	struct rxd_rx_entry *rx_entry;
 	struct rxd_trecv_entry *trecv_entry;
-	struct rxd_peer *peer;
-	struct rxd_rx_buf *rx_buf;
-	struct ofi_ctrl_hdr *ctrl;
-	struct rxd_pkt_data_start *pkt_start;
+	struct rxd_rx_ctx *rx_ctx = ep->rx_ctx;
 
-	rxd_ep_lock_if_required(ep);
-	if (freestack_isempty(ep->trecv_fs)) {
-		ret = -FI_EAGAIN;
-		goto out;
+	fastlock_acquire(&rx_ctx->lock);
+	if (freestack_isempty(rx_ctx->trecv_fs)) {
+		fastlock_release(&rx_ctx->lock);
+		return -FI_EAGAIN;
 	}
 
-	trecv_entry = freestack_pop(ep->trecv_fs);
+	trecv_entry = freestack_pop(rx_ctx->trecv_fs);
+	fastlock_release(&rx_ctx->lock);
+
 	trecv_entry->msg = *msg;
-	trecv_entry->msg.addr = (ep->caps & FI_DIRECTED_RECV) ?
+	trecv_entry->msg.addr = (rx_ctx->caps & FI_DIRECTED_RECV) ?
 		msg->addr : FI_ADDR_UNSPEC;
 	trecv_entry->flags = flags;
 	for (i = 0; i < msg->iov_count; i++) {
@@ -1191,45 +1606,40 @@ ssize_t rxd_trx_claim_recv(struct rxd_ep *ep, const struct fi_msg_tagged *msg,
 	rx_entry = context->internal[0];
 	rx_entry->trecv = trecv_entry;
 
-	rx_buf = rx_entry->unexp_buf;
-	peer = rx_entry->peer_info;
-	ctrl = (struct ofi_ctrl_hdr *) rx_buf->buf;
-	pkt_start = (struct rxd_pkt_data_start *) ctrl;
-
-	rxd_ep_handle_data_msg(ep, peer, rx_entry, rx_entry->trecv->iov,
-			     rx_entry->trecv->msg.iov_count, ctrl,
-			     pkt_start->data, rx_buf);
-out:
-	rxd_ep_unlock_if_required(ep);
-	return ret;
+	rxd_ep_progress_unexp_msg(rx_entry);
+	return 0;
 }
 
 ssize_t rxd_ep_trecvmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 			 uint64_t flags)
 {
-	ssize_t ret = 0, i;
-	struct rxd_ep *rxd_ep;
+	ssize_t i;
+	struct rxd_rx_ctx *rx_ctx;
 	struct rxd_trecv_entry *trecv_entry;
+	struct rxd_rx_entry *rx_entry;
 
-	rxd_ep = container_of(ep, struct rxd_ep, ep);
-	rxd_ep_lock_if_required(rxd_ep);
+	if (flags & (FI_PEEK | FI_CLAIM)) {
+		/* Peek completions need an endpoint CQ to report to */
+		if (ep->fid.fclass == FI_CLASS_SRX_CTX)
+			return -FI_EOPNOTSUPP;
 
-	if (flags & FI_PEEK) {
-		ret = rxd_trx_peek_recv(rxd_ep, msg, flags);
-		goto out;
-	} else if (flags & FI_CLAIM) {
-		ret = rxd_trx_claim_recv(rxd_ep, msg, flags);
-		goto out;
+		return (flags & FI_PEEK) ?
+			rxd_trx_peek_recv(container_of(ep, struct rxd_ep, ep),
+					  msg, flags) :
+			rxd_trx_claim_recv(container_of(ep, struct rxd_ep, ep),
+					   msg, flags);
 	}
 
-	if (freestack_isempty(rxd_ep->trecv_fs)) {
-		ret = -FI_EAGAIN;
-		goto out;
+	rx_ctx = rxd_ep_rx_ctx(ep);
+	fastlock_acquire(&rx_ctx->lock);
+	if (freestack_isempty(rx_ctx->trecv_fs)) {
+		fastlock_release(&rx_ctx->lock);
+		return -FI_EAGAIN;
 	}
 
-	trecv_entry = freestack_pop(rxd_ep->trecv_fs);
+	trecv_entry = freestack_pop(rx_ctx->trecv_fs);
 	trecv_entry->msg = *msg;
-	trecv_entry->msg.addr = (rxd_ep->caps & FI_DIRECTED_RECV) ?
+	trecv_entry->msg.addr = (rx_ctx->caps & FI_DIRECTED_RECV) ?
 		msg->addr : FI_ADDR_UNSPEC;
 	trecv_entry->flags = flags;
 	for (i = 0; i < msg->iov_count; i++) {
@@ -1238,15 +1648,14 @@ ssize_t rxd_ep_trecvmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "post trecv: %u, tag: %p\n",
 			msg->msg_iov[i].iov_len, msg->tag);
 	}
-	dlist_init(&trecv_entry->entry);
-	dlist_insert_tail(&trecv_entry->entry, &rxd_ep->trecv_list);
+	rx_entry = rxd_rx_ctx_match_unexp_tag(rx_ctx, trecv_entry);
+	if (!rx_entry)
+		dlist_insert_tail(&trecv_entry->entry, &rx_ctx->trecv_list);
+	fastlock_release(&rx_ctx->lock);
 
-	if (!dlist_empty(&rxd_ep->unexp_tag_list)) {
-		rxd_ep_check_unexp_tag_list(rxd_ep, trecv_entry);
-	}
-out:
-	rxd_ep_unlock_if_required(rxd_ep);
-	return ret;
+	if (rx_entry)
+		rxd_ep_progress_unexp_msg(rx_entry);
+	return 0;
 }
 
 static ssize_t rxd_ep_trecv(struct fid_ep *ep, void *buf, size_t len, void *desc,
@@ -1372,18 +1781,11 @@ ssize_t rxd_ep_tsendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 ssize_t	rxd_ep_tinject(struct fid_ep *ep, const void *buf, size_t len,
 			fi_addr_t dest_addr, uint64_t tag)
 {
-	struct fi_msg_tagged msg;
-	struct iovec msg_iov;
+	struct rxd_ep *rxd_ep;
+	rxd_ep = container_of(ep, struct rxd_ep, ep);
 
-	memset(&msg, 0, sizeof(msg));
-	msg_iov.iov_base = (void *) buf;
-	msg_iov.iov_len = len;
-	msg.msg_iov = &msg_iov;
-	msg.iov_count = 1;
-	msg.addr = dest_addr;
-	msg.tag = tag;
-	return rxd_ep_tsendmsg(ep, &msg, FI_INJECT |
-				RXD_NO_COMPLETION | RXD_USE_OP_FLAGS);
+	return rxd_ep_post_inject(rxd_ep, buf, len, 0, dest_addr,
+				  ofi_op_tagged, tag, FI_INJECT);
 }
 
 ssize_t rxd_ep_tsenddata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
@@ -1409,21 +1811,11 @@ ssize_t rxd_ep_tsenddata(struct fid_ep *ep, const void *buf, size_t len, void *d
 ssize_t	rxd_ep_tinjectdata(struct fid_ep *ep, const void *buf, size_t len,
 			    uint64_t data, fi_addr_t dest_addr, uint64_t tag)
 {
-	struct fi_msg_tagged msg;
-	struct iovec msg_iov;
-
-	memset(&msg, 0, sizeof(msg));
-	msg_iov.iov_base = (void *) buf;
-	msg_iov.iov_len = len;
-	msg.msg_iov = &msg_iov;
-
-	msg.iov_count = 1;
-	msg.addr = dest_addr;
-	msg.data = data;
-	msg.tag = tag;
+	struct rxd_ep *rxd_ep;
+	rxd_ep = container_of(ep, struct rxd_ep, ep);
 
-	return rxd_ep_tsendmsg(ep, &msg, FI_REMOTE_CQ_DATA | FI_INJECT |
-				RXD_NO_COMPLETION | RXD_USE_OP_FLAGS);
+	return rxd_ep_post_inject(rxd_ep, buf, len, data, dest_addr,
+				  ofi_op_tagged, tag, FI_REMOTE_CQ_DATA | FI_INJECT);
 }
 
 struct fi_ops_tagged rxd_ops_tagged = {
@@ -1442,19 +1834,68 @@ struct fi_ops_tagged rxd_ops_tagged = {
 static void rxd_ep_free_buf_pools(struct rxd_ep *ep)
 {
 	util_buf_pool_destroy(ep->tx_pkt_pool);
-	util_buf_pool_destroy(ep->rx_pkt_pool);
 
 	if (ep->tx_entry_fs)
 		rxd_tx_entry_fs_free(ep->tx_entry_fs);
 
 	if (ep->rx_entry_fs)
 		rxd_rx_entry_fs_free(ep->rx_entry_fs);
+}
+
+static void rxd_rx_ctx_cleanup(struct rxd_rx_ctx *rx_ctx)
+{
+	if (rx_ctx->rx_pkt_pool)
+		util_buf_pool_destroy(rx_ctx->rx_pkt_pool);
+
+	if (rx_ctx->recv_fs)
+		rxd_recv_fs_free(rx_ctx->recv_fs);
+
+	if (rx_ctx->trecv_fs)
+		rxd_trecv_fs_free(rx_ctx->trecv_fs);
+
+	fastlock_destroy(&rx_ctx->lock);
+}
 
-	if (ep->recv_fs)
-		rxd_recv_fs_free(ep->recv_fs);
+/* Drop messages this endpoint left queued on a shared receive context */
+static void rxd_rx_ctx_purge_unexp(struct rxd_rx_ctx *rx_ctx,
+				   struct dlist_entry *list, struct rxd_ep *ep)
+{
+	struct dlist_entry *entry, *next;
+	struct rxd_rx_entry *rx_entry;
+
+	for (entry = list->next; entry != list; entry = next) {
+		next = entry->next;
+		rx_entry = container_of(entry, struct rxd_rx_entry, unexp_entry);
+		if (rx_entry->ep != ep)
+			continue;
+
+		dlist_remove(entry);
+		rx_ctx->num_unexp_msg--;
+	}
+}
+
+static void rxd_ep_release_rx_ctx(struct rxd_ep *ep)
+{
+	if (ep->rx_ctx->ep.fid.fclass == FI_CLASS_SRX_CTX) {
+		fastlock_acquire(&ep->rx_ctx->lock);
+		rxd_rx_ctx_purge_unexp(ep->rx_ctx, &ep->rx_ctx->unexp_msg_list, ep);
+		rxd_rx_ctx_purge_unexp(ep->rx_ctx, &ep->rx_ctx->unexp_tag_list, ep);
+		fastlock_release(&ep->rx_ctx->lock);
+		atomic_dec(&ep->rx_ctx->ref);
+	} else {
+		rxd_rx_ctx_cleanup(ep->rx_ctx);
+		free(ep->rx_ctx);
+	}
+	ep->rx_ctx = NULL;
+}
 
-	if (ep->trecv_fs)
-		rxd_trecv_fs_free(ep->trecv_fs);
+static void rxd_ep_unbind_cntr(struct rxd_ep *ep, struct util_cntr *cntr)
+{
+	if (!cntr)
+		return;
+
+	fid_list_remove(&cntr->ep_list, &cntr->ep_list_lock, &ep->ep.fid);
+	atomic_dec(&cntr->ref);
 }
 
 static int rxd_ep_close(struct fid *fid)
@@ -1477,11 +1918,13 @@ static int rxd_ep_close(struct fid *fid)
 	dlist_remove(&ep->dom_entry);
 	fastlock_release(&ep->domain->lock);
 
+	fastlock_acquire(&ep->rx_ctx->lock);
 	while(!slist_empty(&ep->rx_pkt_list)) {
 		entry = slist_remove_head(&ep->rx_pkt_list);
 		buf = container_of(entry, struct rxd_rx_buf, entry);
-		util_buf_release(ep->rx_pkt_pool, buf);
+		util_buf_release(ep->rx_ctx->rx_pkt_pool, buf);
 	}
+	fastlock_release(&ep->rx_ctx->lock);
 
 	if (ep->tx_cq)
 		atomic_dec(&ep->tx_cq->util_cq.ref);
@@ -1489,8 +1932,17 @@ static int rxd_ep_close(struct fid *fid)
 	if (ep->rx_cq)
 		atomic_dec(&ep->rx_cq->util_cq.ref);
 
+	rxd_ep_unbind_cntr(ep, ep->tx_cntr);
+	rxd_ep_unbind_cntr(ep, ep->rx_cntr);
+	rxd_ep_unbind_cntr(ep, ep->rd_cntr);
+	rxd_ep_unbind_cntr(ep, ep->wr_cntr);
+	rxd_ep_unbind_cntr(ep, ep->rem_rd_cntr);
+	rxd_ep_unbind_cntr(ep, ep->rem_wr_cntr);
+
 	atomic_dec(&ep->domain->util_domain.ref);
 	fastlock_destroy(&ep->lock);
+	ofi_stats_close(&ep->stats);
+	rxd_ep_release_rx_ctx(ep);
 	rxd_ep_free_buf_pools(ep);
 	free(ep->peer_info);
 	free(ep->name);
@@ -1537,6 +1989,83 @@ static int rxd_ep_bind_cq(struct rxd_ep *ep, struct rxd_cq *cq, uint64_t flags)
 	return 0;
 }
 
+static int rxd_ep_bind_cntr(struct rxd_ep *ep, struct util_cntr *cntr,
+			    uint64_t flags)
+{
+	int ret;
+
+	if (flags & ~(FI_SEND | FI_RECV | FI_READ | FI_WRITE |
+		      FI_REMOTE_READ | FI_REMOTE_WRITE)) {
+		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "unsupported flags\n");
+		return -FI_EBADFLAGS;
+	}
+
+	if (((flags & FI_SEND) && ep->tx_cntr) ||
+	    ((flags & FI_RECV) && ep->rx_cntr) ||
+	    ((flags & FI_READ) && ep->rd_cntr) ||
+	    ((flags & FI_WRITE) && ep->wr_cntr) ||
+	    ((flags & FI_REMOTE_READ) && ep->rem_rd_cntr) ||
+	    ((flags & FI_REMOTE_WRITE) && ep->rem_wr_cntr)) {
+		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL,
+			"duplicate counter binding\n");
+		return -FI_EINVAL;
+	}
+
+	ret = fid_list_insert(&cntr->ep_list, &cntr->ep_list_lock,
+			      &ep->ep.fid);
+	if (ret)
+		return ret;
+
+	if (flags & FI_SEND) {
+		ep->tx_cntr = cntr;
+		atomic_inc(&cntr->ref);
+	}
+	if (flags & FI_RECV) {
+		ep->rx_cntr = cntr;
+		atomic_inc(&cntr->ref);
+	}
+	if (flags & FI_READ) {
+		ep->rd_cntr = cntr;
+		atomic_inc(&cntr->ref);
+	}
+	if (flags & FI_WRITE) {
+		ep->wr_cntr = cntr;
+		atomic_inc(&cntr->ref);
+	}
+	if (flags & FI_REMOTE_READ) {
+		ep->rem_rd_cntr = cntr;
+		atomic_inc(&cntr->ref);
+	}
+	if (flags & FI_REMOTE_WRITE) {
+		ep->rem_wr_cntr = cntr;
+		atomic_inc(&cntr->ref);
+	}
+	return 0;
+}
+
+static int rxd_ep_bind_srx(struct rxd_ep *ep, struct rxd_rx_ctx *srx)
+{
+	if (ep->rx_ctx->ep.fid.fclass == FI_CLASS_SRX_CTX) {
+		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL,
+			"duplicate shared rx context binding\n");
+		return -FI_EINVAL;
+	}
+
+	if (!slist_empty(&ep->rx_pkt_list)) {
+		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL,
+			"cannot bind shared rx context to enabled ep\n");
+		return -FI_EOPBADSTATE;
+	}
+
+	if (srx->domain != ep->domain)
+		return -FI_EINVAL;
+
+	rxd_ep_release_rx_ctx(ep);
+	ep->rx_ctx = srx;
+	atomic_inc(&srx->ref);
+	return 0;
+}
+
 static int rxd_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 {
 	struct rxd_ep *ep;
@@ -1569,6 +2098,14 @@ static int rxd_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 		ret = rxd_ep_bind_cq(ep, container_of(bfid, struct rxd_cq,
 						       util_cq.cq_fid.fid), flags);
 		break;
+	case FI_CLASS_CNTR:
+		ret = rxd_ep_bind_cntr(ep, container_of(bfid, struct util_cntr,
+							 cntr_fid.fid), flags);
+		break;
+	case FI_CLASS_SRX_CTX:
+		ret = rxd_ep_bind_srx(ep, container_of(bfid, struct rxd_rx_ctx,
+							ep.fid));
+		break;
 	case FI_CLASS_EQ:
 		break;
 	default:
@@ -1597,12 +2134,22 @@ static int rxd_ep_control(struct fid *fid, int command, void *arg)
 	return ret;
 }
 
+static const char * const rxd_ep_stat_names[] = {
+	[RXD_STAT_RETRANSMIT] = "retransmits",
+	[RXD_STAT_RETRY_FAILED] = "retry_failures",
+	[RXD_STAT_PKT_POOL_GROW] = "pkt_pool_grow",
+	[RXD_STAT_ACK_SENT] = "acks_sent",
+	[RXD_STAT_ACK_PKT_SENT] = "ack_pkts_sent",
+	[RXD_STAT_ACK_PIGGYBACK] = "acks_piggybacked",
+	[RXD_STAT_ACK_RECV] = "acks_recv",
+};
+
 static struct fi_ops rxd_ep_fi_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = rxd_ep_close,
 	.bind = rxd_ep_bind,
 	.control = rxd_ep_control,
-	.ops_open = fi_no_ops_open,
+	.ops_open = ofi_stats_ops_open,
 };
 
 static int rxd_ep_cm_setname(fid_t fid, void *addr, size_t addrlen)
@@ -1660,58 +2207,172 @@ int rxd_ep_create_buf_pools(struct rxd_ep *ep, struct fi_info *fi_info)
 	if (!ep->tx_pkt_pool)
 		return -FI_ENOMEM;
 
-	ep->rx_pkt_pool = util_buf_pool_create_ex(
-		ep->domain->max_mtu_sz + sizeof (struct rxd_rx_buf),
-		RXD_BUF_POOL_ALIGNMENT, 0, RXD_RX_POOL_CHUNK_CNT,
-	        (fi_info->mode & FI_LOCAL_MR) ? rxd_buf_region_alloc_hndlr : NULL,
-		(fi_info->mode & FI_LOCAL_MR) ? rxd_buf_region_free_hndlr : NULL,
-		ep->domain);
-	if (!ep->rx_pkt_pool)
-		goto err;
-
 	ep->tx_entry_fs = rxd_tx_entry_fs_create(1ULL << RXD_MAX_TX_BITS);
 	if (!ep->tx_entry_fs)
 		goto err;
 
+	/* A new freestack hands out buf[0] first: keep it reserved so that
+	 * acks for injected messages never resolve to a tx entry. */
+	freestack_pop(ep->tx_entry_fs);
+
 	ep->rx_entry_fs = rxd_rx_entry_fs_create(1ULL << RXD_MAX_RX_BITS);
 	if (!ep->rx_entry_fs)
 		goto err;
 
-	if (ep->caps & FI_MSG) {
-		ep->recv_fs = rxd_recv_fs_create(ep->rx_size);
-		dlist_init(&ep->recv_list);
-		if (!ep->recv_fs)
+	return 0;
+err:
+	if (ep->tx_pkt_pool)
+		util_buf_pool_destroy(ep->tx_pkt_pool);
+
+	if (ep->tx_entry_fs)
+		rxd_tx_entry_fs_free(ep->tx_entry_fs);
+
+	return -FI_ENOMEM;
+}
+
+static int rxd_rx_ctx_init(struct rxd_rx_ctx *rx_ctx, struct rxd_domain *domain,
+			   uint64_t caps, size_t rx_size, int do_local_mr)
+{
+	rx_ctx->domain = domain;
+	rx_ctx->caps = caps;
+	rx_ctx->rx_size = rx_size;
+	rx_ctx->do_local_mr = do_local_mr;
+	rx_ctx->min_multi_recv = RXD_MIN_MULTI_RECV;
+	atomic_initialize(&rx_ctx->ref, 0);
+	dlist_init(&rx_ctx->recv_list);
+	dlist_init(&rx_ctx->trecv_list);
+	dlist_init(&rx_ctx->unexp_msg_list);
+	dlist_init(&rx_ctx->unexp_tag_list);
+	fastlock_init(&rx_ctx->lock);
+
+	rx_ctx->rx_pkt_pool = util_buf_pool_create_ex(
+		domain->max_mtu_sz + sizeof (struct rxd_rx_buf),
+		RXD_BUF_POOL_ALIGNMENT, 0, RXD_RX_POOL_CHUNK_CNT,
+		do_local_mr ? rxd_buf_region_alloc_hndlr : NULL,
+		do_local_mr ? rxd_buf_region_free_hndlr : NULL,
+		domain);
+	if (!rx_ctx->rx_pkt_pool)
+		goto err;
+
+	if (caps & FI_MSG) {
+		rx_ctx->recv_fs = rxd_recv_fs_create(rx_size);
+		if (!rx_ctx->recv_fs)
 			goto err;
 	}
 
-	if (ep->caps & FI_TAGGED) {
-		ep->trecv_fs = rxd_trecv_fs_create(ep->rx_size);
-		dlist_init(&ep->trecv_list);
-		if (!ep->trecv_fs)
+	if (caps & FI_TAGGED) {
+		rx_ctx->trecv_fs = rxd_trecv_fs_create(rx_size);
+		if (!rx_ctx->trecv_fs)
 			goto err;
 	}
-
 	return 0;
 err:
-	if (ep->tx_pkt_pool)
-		util_buf_pool_destroy(ep->tx_pkt_pool);
+	rxd_rx_ctx_cleanup(rx_ctx);
+	return -FI_ENOMEM;
+}
 
-	if (ep->rx_pkt_pool)
-		util_buf_pool_destroy(ep->rx_pkt_pool);
+static int rxd_srx_close(struct fid *fid)
+{
+	struct rxd_rx_ctx *rx_ctx;
 
-	if (ep->tx_entry_fs)
-		rxd_tx_entry_fs_free(ep->tx_entry_fs);
+	rx_ctx = container_of(fid, struct rxd_rx_ctx, ep.fid);
+	if (atomic_get(&rx_ctx->ref))
+		return -FI_EBUSY;
 
-	if (ep->rx_entry_fs)
-		rxd_rx_entry_fs_free(ep->rx_entry_fs);
+	atomic_dec(&rx_ctx->domain->util_domain.ref);
+	rxd_rx_ctx_cleanup(rx_ctx);
+	free(rx_ctx);
+	return 0;
+}
 
-	if (ep->recv_fs)
-		rxd_recv_fs_free(ep->recv_fs);
+static struct fi_ops rxd_srx_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = rxd_srx_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
 
-	if (ep->trecv_fs)
-		rxd_trecv_fs_free(ep->trecv_fs);
+static struct fi_ops_ep rxd_srx_ops_ep = {
+	.size = sizeof(struct fi_ops_ep),
+	.cancel = fi_no_cancel,
+	.getopt = fi_no_getopt,
+	.setopt = fi_no_setopt,
+	.tx_ctx = fi_no_tx_ctx,
+	.rx_ctx = fi_no_rx_ctx,
+	.rx_size_left = fi_no_rx_size_left,
+	.tx_size_left = fi_no_tx_size_left,
+};
 
-	return -FI_ENOMEM;
+static struct fi_ops_msg rxd_srx_ops_msg = {
+	.size = sizeof(struct fi_ops_msg),
+	.recv = rxd_ep_recv,
+	.recvv = rxd_ep_recvv,
+	.recvmsg = rxd_ep_recvmsg,
+	.send = fi_no_msg_send,
+	.sendv = fi_no_msg_sendv,
+	.sendmsg = fi_no_msg_sendmsg,
+	.inject = fi_no_msg_inject,
+	.senddata = fi_no_msg_senddata,
+	.injectdata = fi_no_msg_injectdata,
+};
+
+static struct fi_ops_tagged rxd_srx_ops_tagged = {
+	.size = sizeof(struct fi_ops_tagged),
+	.recv = rxd_ep_trecv,
+	.recvv = rxd_ep_trecvv,
+	.recvmsg = rxd_ep_trecvmsg,
+	.send = fi_no_tagged_send,
+	.sendv = fi_no_tagged_sendv,
+	.sendmsg = fi_no_tagged_sendmsg,
+	.inject = fi_no_tagged_inject,
+	.senddata = fi_no_tagged_senddata,
+	.injectdata = fi_no_tagged_injectdata,
+};
+
+int rxd_srx_context(struct fid_domain *domain, struct fi_rx_attr *attr,
+		    struct fid_ep **rx_ep, void *context)
+{
+	int ret;
+	uint64_t caps;
+	struct rxd_rx_ctx *rx_ctx;
+	struct rxd_domain *rxd_domain;
+
+	if (attr) {
+		ret = fi_check_rx_attr(&rxd_prov, rxd_info.rx_attr, attr);
+		if (ret)
+			return ret;
+	}
+
+	rxd_domain = container_of(domain, struct rxd_domain, util_domain.domain_fid);
+
+	rx_ctx = calloc(1, sizeof(*rx_ctx));
+	if (!rx_ctx)
+		return -FI_ENOMEM;
+
+	/* rx_attr caps need not repeat the endpoint's primary capabilities */
+	caps = attr ? attr->caps : 0;
+	if (!(caps & (FI_MSG | FI_TAGGED)))
+		caps |= FI_MSG | FI_TAGGED;
+
+	ret = rxd_rx_ctx_init(rx_ctx, rxd_domain, caps,
+			      (attr && attr->size) ? attr->size : rxd_info.rx_attr->size,
+			      (rxd_domain->dg_mode & FI_LOCAL_MR) ? 1 : 0);
+	if (ret) {
+		free(rx_ctx);
+		return ret;
+	}
+
+	rx_ctx->ep.fid.fclass = FI_CLASS_SRX_CTX;
+	rx_ctx->ep.fid.context = context;
+	rx_ctx->ep.fid.ops = &rxd_srx_fi_ops;
+	rx_ctx->ep.ops = &rxd_srx_ops_ep;
+	rx_ctx->ep.msg = &rxd_srx_ops_msg;
+	rx_ctx->ep.tagged = &rxd_srx_ops_tagged;
+	atomic_inc(&rxd_domain->util_domain.ref);
+
+	*rx_ep = &rx_ctx->ep;
+	return 0;
 }
 
 int rxd_endpoint(struct fid_domain *domain, struct fi_info *info,
@@ -1748,10 +2409,34 @@ int rxd_endpoint(struct fid_domain *domain, struct fi_info *info,
 	rxd_ep->caps = info->caps;
 	rxd_ep->domain = rxd_domain;
 	rxd_ep->rx_size = info->rx_attr->size;
+	rxd_ep->inject_size = MIN(info->tx_attr->inject_size,
+				  RXD_MAX_STRT_DATA_PKT_SZ(rxd_ep));
 	ret = rxd_ep_create_buf_pools(rxd_ep, info);
 	if (ret)
 		goto err3;
 
+	rxd_ep->rx_ctx = calloc(1, sizeof(*rxd_ep->rx_ctx));
+	if (!rxd_ep->rx_ctx) {
+		ret = -FI_ENOMEM;
+		goto err4;
+	}
+
+	ret = rxd_rx_ctx_init(rxd_ep->rx_ctx, rxd_domain, info->caps,
+			      rxd_ep->rx_size, (info->mode & FI_LOCAL_MR) ? 1 : 0);
+	if (ret) {
+		free(rxd_ep->rx_ctx);
+		goto err4;
+	}
+
+	ret = ofi_stats_init(&rxd_ep->stats, &rxd_prov, &rxd_ep->ep.fid, "ep",
+			     rxd_ep_stat_names, RXD_STAT_MAX);
+	if (ret)
+		goto err5;
+	util_buf_pool_set_stats(rxd_ep->tx_pkt_pool, &rxd_ep->stats,
+				RXD_STAT_PKT_POOL_GROW);
+	util_buf_pool_set_stats(rxd_ep->rx_ctx->rx_pkt_pool, &rxd_ep->stats,
+				RXD_STAT_PKT_POOL_GROW);
+
 	rxd_ep->dg_ep = *ep;
 	rxd_ep->ep.fid.ops = &rxd_ep_fi_ops;
 	rxd_ep->ep.cm = &rxd_ep_cm;
@@ -1759,12 +2444,14 @@ int rxd_endpoint(struct fid_domain *domain, struct fi_info *info,
 	rxd_ep->ep.msg = &rxd_ops_msg;
 	rxd_ep->ep.tagged = &rxd_ops_tagged;
 	rxd_ep->ep.rma = &rxd_ops_rma;
+	rxd_ep->ep.atomic = &rxd_ops_atomic;
 
 	dlist_init(&rxd_ep->tx_entry_list);
+	dlist_init(&rxd_ep->inject_pkt_list);
+	dlist_init(&rxd_ep->batch_list);
+	dlist_init(&rxd_ep->ack_list);
 	dlist_init(&rxd_ep->rx_entry_list);
 	dlist_init(&rxd_ep->wait_rx_list);
-	dlist_init(&rxd_ep->unexp_msg_list);
-	dlist_init(&rxd_ep->unexp_tag_list);
 	slist_init(&rxd_ep->rx_pkt_list);
 	fastlock_init(&rxd_ep->lock);
 
@@ -1775,6 +2462,10 @@ int rxd_endpoint(struct fid_domain *domain, struct fi_info *info,
 	fi_freeinfo(dg_info);
 	return 0;
 
+err5:
+	rxd_ep_release_rx_ctx(rxd_ep);
+err4:
+	rxd_ep_free_buf_pools(rxd_ep);
 err3:
 	fi_close(&(*ep)->fid);
 err2:
@@ -1784,7 +2475,7 @@ err1:
 	return ret;
 }
 
-int rxd_ep_retry_pkt(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
+int rxd_ep_retry_pkt(struct rxd_ep *ep, fi_addr_t addr,
 		   struct rxd_pkt_meta *pkt)
 {
 	int ret;
@@ -1794,9 +2485,15 @@ int rxd_ep_retry_pkt(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
 	if (pkt->retries > RXD_MAX_PKT_RETRY) {
 		/* todo: report error */
 		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "Pkt delivery failed\n", ctrl->seg_no);
+		ofi_stats_inc(&ep->stats, RXD_STAT_RETRY_FAILED);
 		return -FI_EIO;
 	}
 
+	/* A packet is only in flight once at a time; otherwise a late send
+	 * completion could release it again after it was acked and reused. */
+	if (!(pkt->ref & RXD_PKT_LOCAL_ACK))
+		return -FI_EAGAIN;
+
 	FI_DBG(&rxd_prov, FI_LOG_EP_CTRL, "retry packet : %2d, size: %d, tx_id :%p\n",
 		ctrl->seg_no, ctrl->type == ofi_ctrl_start_data ?
 		ctrl->seg_size + RXD_START_DATA_PKT_SZ :
@@ -1808,10 +2505,14 @@ int rxd_ep_retry_pkt(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
 		      ctrl->seg_size + RXD_START_DATA_PKT_SZ :
 		      ctrl->seg_size + RXD_DATA_PKT_SZ,
 		      rxd_mr_desc(pkt->mr, ep),
-		      tx_entry->peer, &pkt->context);
+		      addr, &pkt->context);
+	if (!ret)
+		pkt->ref &= ~RXD_PKT_LOCAL_ACK;
 
-	if (ret != -FI_EAGAIN)
+	if (ret != -FI_EAGAIN) {
 		pkt->retries++;
+		ofi_stats_inc(&ep->stats, RXD_STAT_RETRANSMIT);
+	}
 
 	if (ret && ret != -FI_EAGAIN) {
 		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "Pkt sent failed seg: %d, ret: %d\n",
@@ -1821,14 +2522,30 @@ int rxd_ep_retry_pkt(struct rxd_ep *ep, struct rxd_tx_entry *tx_entry,
 	return ret;
 }
 
+/*
+ * Run the endpoint's timers: retransmits, waiting entries and delayed
+ * batches and acks.  Called only from the domain progress thread, under
+ * the domain lock.  Nothing else runs these timers, so an endpoint that
+ * another thread has locked is skipped for at most RXD_MAX_PROGRESS_SKIP
+ * passes; after that the progress thread waits for its lock.
+ */
 void rxd_ep_progress(struct rxd_ep *ep)
 {
-	struct dlist_entry *tx_item, *pkt_item;
+	struct dlist_entry *tx_item, *pkt_item, *next;
 	struct rxd_tx_entry *tx_entry;
 	struct rxd_pkt_meta *pkt;
 	uint64_t curr_stamp;
 
-	rxd_ep_lock_if_required(ep);
+	if (ep->progress_skip < RXD_MAX_PROGRESS_SKIP) {
+		if (rxd_ep_trylock_if_required(ep)) {
+			ep->progress_skip++;
+			return;
+		}
+	} else {
+		rxd_ep_lock_if_required(ep);
+	}
+	ep->progress_skip = 0;
+
 	curr_stamp = fi_gettime_us();
 	dlist_foreach(&ep->tx_entry_list, tx_item) {
 
@@ -1861,9 +2578,36 @@ void rxd_ep_progress(struct rxd_ep *ep)
 			    (((uint64_t) 1) << ((uint64_t) pkt->retries + 1)) *
 			     RXD_RETRY_TIMEOUT) {
 				pkt->us_stamp = curr_stamp;
-				rxd_ep_retry_pkt(ep, tx_entry, pkt);
+				rxd_ep_retry_pkt(ep, tx_entry->peer, pkt);
 			}
 		}
 	}
+
+	for (pkt_item = ep->batch_list.next; pkt_item != &ep->batch_list;
+	     pkt_item = next) {
+		next = pkt_item->next;
+		pkt = container_of(pkt_item, struct rxd_pkt_meta, entry);
+		if (curr_stamp - pkt->us_stamp >= rxd_coalesce_us)
+			rxd_ep_flush_batch(ep, rxd_ep_getpeer_info(ep, pkt->peer));
+	}
+
+	for (pkt_item = ep->ack_list.next; pkt_item != &ep->ack_list;
+	     pkt_item = next) {
+		next = pkt_item->next;
+		pkt = container_of(pkt_item, struct rxd_pkt_meta, entry);
+		if (curr_stamp - pkt->us_stamp >= rxd_ack_delay_us)
+			rxd_ep_flush_acks(ep, rxd_ep_getpeer_info(ep, pkt->peer));
+	}
+
+	dlist_foreach(&ep->inject_pkt_list, pkt_item) {
+		pkt = container_of(pkt_item, struct rxd_pkt_meta, entry);
+		if (curr_stamp > pkt->us_stamp &&
+		    curr_stamp - pkt->us_stamp >
+		    (((uint64_t) 1) << ((uint64_t) pkt->retries + 1)) *
+		     RXD_RETRY_TIMEOUT) {
+			pkt->us_stamp = curr_stamp;
+			rxd_ep_retry_pkt(ep, pkt->peer, pkt);
+		}
+	}
 	rxd_ep_unlock_if_required(ep);
 }
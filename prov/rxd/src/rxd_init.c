@@ -35,6 +35,9 @@
 #include <prov.h>
 #include "rxd.h"
 
+int rxd_coalesce_us = 0;
+int rxd_ack_delay_us = 0;
+
 int rxd_alter_layer_info(struct fi_info *layer_info, struct fi_info *base_info)
 {
 	base_info->caps = FI_MSG;
@@ -49,6 +52,8 @@ int rxd_alter_base_info(struct fi_info *base_info, struct fi_info *layer_info)
 	layer_info->mode = rxd_info.mode;
 
 	*layer_info->tx_attr = *rxd_info.tx_attr;
+	layer_info->tx_attr->inject_size = MIN(rxd_info.tx_attr->inject_size,
+		base_info->ep_attr->max_msg_size - RXD_START_DATA_PKT_SZ);
 	*layer_info->rx_attr = *rxd_info.rx_attr;
 	*layer_info->ep_attr = *rxd_info.ep_attr;
 	*layer_info->domain_attr = *rxd_info.domain_attr;
@@ -78,5 +83,19 @@ struct fi_provider rxd_prov = {
 
 RXD_INI
 {
+	fi_param_define(&rxd_prov, "coalesce_us", FI_PARAM_INT,
+			"Hold injected messages of up to 256 bytes for up to "
+			"this many microseconds so that several to the same "
+			"peer share one packet (default: 0, disabled)");
+	fi_param_get_int(&rxd_prov, "coalesce_us", &rxd_coalesce_us);
+
+	/* held acks must go out before the peer starts retransmitting */
+	fi_param_define(&rxd_prov, "ack_delay_us", FI_PARAM_INT,
+			"Hold acks of completed messages for up to this many "
+			"microseconds, at most 900, so that they share a packet "
+			"or ride on data sent back to the peer (default: 0, "
+			"disabled)");
+	fi_param_get_int(&rxd_prov, "ack_delay_us", &rxd_ack_delay_us);
+	rxd_ack_delay_us = MIN(rxd_ack_delay_us, RXD_RETRY_TIMEOUT);
 	return &rxd_prov;
 }
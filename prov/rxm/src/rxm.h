@@ -61,6 +61,8 @@
 #define RXM_MINOR_VERSION 0
 
 #define RXM_IOV_LIMIT 4
+#define RXM_MAX_EP_CTX 32
+#define RXM_MIN_MULTI_RECV 64
 
 /*
  * Macros to generate enums and associated string values
@@ -147,6 +149,14 @@ enum rxm_ctx_type {
 	RXM_RX_BUF,
 };
 
+/* Endpoint statistics */
+enum {
+	RXM_STAT_RNDV_TX,
+	RXM_STAT_RNDV_RX,
+	RXM_STAT_BUF_POOL_GROW,
+	RXM_STAT_MAX
+};
+
 struct rxm_unexp_msg {
 	struct dlist_entry entry;
 	fi_addr_t addr;
@@ -167,6 +177,19 @@ struct rxm_iovx_entry {
 	uint8_t count;
 };
 
+struct rxm_recv_entry {
+	struct dlist_entry entry;
+	struct iovec iov[RXM_IOV_LIMIT];
+	void *desc[RXM_IOV_LIMIT];
+	uint8_t count;
+	fi_addr_t addr;
+	void *context;
+	uint64_t flags;
+	uint64_t tag;
+	uint64_t ignore;
+};
+DECLARE_FREESTACK(struct rxm_recv_entry, rxm_recv_fs);
+
 struct rxm_rx_buf {
 	enum rxm_ctx_type ctx_type;
 	struct slist_entry entry;
@@ -176,6 +199,9 @@ struct rxm_rx_buf {
 	struct rxm_recv_entry *recv_entry;
 	struct rxm_unexp_msg unexp_msg;
 
+	/* Part of an FI_MULTI_RECV buffer consumed by this message */
+	struct rxm_recv_entry multi_recv;
+
 	/* Used for large messages */
 	enum rxm_lmt_state state;
 	struct rxm_match_iov match_iov;
@@ -193,6 +219,7 @@ struct rxm_tx_entry {
 	struct rxm_ep *ep;
 	void *context;
 	uint64_t flags;
+	uint64_t comp_flags;
 	// TODO use a tx_buf instead. Add posted tx_buf to list for clean up
 	// on endpont close: similar to rx_buf
 	struct rxm_pkt *pkt;
@@ -203,19 +230,6 @@ struct rxm_tx_entry {
 };
 DECLARE_FREESTACK(struct rxm_tx_entry, rxm_txe_fs);
 
-struct rxm_recv_entry {
-	struct dlist_entry entry;
-	struct iovec iov[RXM_IOV_LIMIT];
-	void *desc[RXM_IOV_LIMIT];
-	uint8_t count;
-	fi_addr_t addr;
-	void *context;
-	uint64_t flags;
-	uint64_t tag;
-	uint64_t ignore;
-};
-DECLARE_FREESTACK(struct rxm_recv_entry, rxm_recv_fs);
-
 struct rxm_recv_queue {
 	struct rxm_recv_fs *recv_fs;
 	struct dlist_entry recv_list;
@@ -241,6 +255,8 @@ struct rxm_ep {
 
 	struct rxm_recv_queue recv_queue;
 	struct rxm_recv_queue trecv_queue;
+	size_t min_multi_recv;
+	struct ofi_stats stats;
 };
 
 extern struct fi_provider rxm_prov;
@@ -270,10 +286,14 @@ int rxm_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 			     struct fid_domain **dom, void *context);
 int rxm_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 			 struct fid_cq **cq_fid, void *context);
-void rxm_cq_progress(struct fid_cq *msg_cq);
+void rxm_cq_progress(struct rxm_ep *rxm_ep);
+int rxm_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
+		  struct fid_cntr **cntr_fid, void *context);
 int rxm_cq_comp(struct util_cq *util_cq, void *context, uint64_t flags, size_t len,
 		void *buf, uint64_t data, uint64_t tag);
 int rxm_cq_report_error(struct util_cq *util_cq, struct fi_cq_err_entry *err_entry);
+int rxm_cq_claim_recv(struct rxm_rx_buf *rx_buf, struct rxm_recv_queue *recv_queue,
+		      struct rxm_recv_entry *recv_entry);
 int rxm_cq_handle_data(struct rxm_rx_buf *rx_buf);
 
 int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
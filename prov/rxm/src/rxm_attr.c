@@ -33,15 +33,18 @@
 #include "rxm.h"
 
 struct fi_tx_attr rxm_tx_attr = {
-	.caps = FI_MSG | FI_TAGGED | FI_SEND,
+	.caps = FI_MSG | FI_TAGGED | FI_RMA | FI_SEND | FI_READ | FI_WRITE |
+		FI_NAMED_RX_CTX,
 	.comp_order = FI_ORDER_STRICT,
 	.inject_size = RXM_TX_DATA_SIZE,
 	.size = 1024,
 	.iov_limit = RXM_IOV_LIMIT,
+	.rma_iov_limit = RXM_IOV_LIMIT,
 };
 
 struct fi_rx_attr rxm_rx_attr = {
-	.caps = FI_MSG | FI_TAGGED | FI_RECV,
+	.caps = FI_MSG | FI_TAGGED | FI_RMA | FI_RECV | FI_REMOTE_READ |
+		FI_REMOTE_WRITE | FI_MULTI_RECV,
 	.comp_order = FI_ORDER_STRICT,
 	.size = 1024,
 	.iov_limit= RXM_IOV_LIMIT,
@@ -68,8 +71,8 @@ struct fi_domain_attr rxm_domain_attr = {
 	.ep_cnt = (1 << 15),
 	.tx_ctx_cnt = 1,
 	.rx_ctx_cnt = 1,
-	.max_ep_tx_ctx = 1,
-	.max_ep_rx_ctx = 1
+	.max_ep_tx_ctx = RXM_MAX_EP_CTX,
+	.max_ep_rx_ctx = RXM_MAX_EP_CTX
 };
 
 struct fi_fabric_attr rxm_fabric_attr = {
@@ -79,7 +82,9 @@ struct fi_fabric_attr rxm_fabric_attr = {
 };
 
 struct fi_info rxm_info = {
-	.caps = FI_MSG | FI_TAGGED | FI_SEND | FI_RECV | FI_SOURCE | FI_DIRECTED_RECV,
+	.caps = FI_MSG | FI_TAGGED | FI_RMA | FI_SEND | FI_RECV | FI_READ |
+		FI_WRITE | FI_REMOTE_READ | FI_REMOTE_WRITE | FI_SOURCE |
+		FI_DIRECTED_RECV | FI_NAMED_RX_CTX | FI_MULTI_RECV,
 	.mode = FI_LOCAL_MR, // TODO remove this requirement
 	.addr_format = FI_SOCKADDR,
 	.tx_attr = &rxm_tx_attr,
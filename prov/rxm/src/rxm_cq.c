@@ -122,6 +122,7 @@ int rxm_cq_comp(struct util_cq *util_cq, void *context, uint64_t flags, size_t l
 	fastlock_acquire(&util_cq->cq_lock);
 	if (ofi_cirque_isfull(util_cq->cirq)) {
 		FI_DBG(&rxm_prov, FI_LOG_CQ, "util_cq cirq is full!\n");
+		ofi_stats_inc(&util_cq->stats, OFI_CQ_STAT_OVERFLOW);
 		ret = -FI_EAGAIN;
 		goto out;
 	}
@@ -138,15 +139,50 @@ out:
 	return ret;
 }
 
+/* The receive buffer, or its multi-recv slice, was too short. */
+static int rxm_finish_recv_trunc(struct rxm_rx_buf *rx_buf, size_t len)
+{
+	struct fi_cq_err_entry err_entry;
+	int ret;
+
+	FI_WARN(&rxm_prov, FI_LOG_CQ, "message truncated\n");
+	memset(&err_entry, 0, sizeof(err_entry));
+	err_entry.op_context = rx_buf->recv_entry->context;
+	err_entry.flags = FI_RECV | (rx_buf->recv_entry->flags & FI_MULTI_RECV);
+	err_entry.len = len;
+	err_entry.buf = rx_buf->recv_fs ? NULL : rx_buf->recv_entry->iov[0].iov_base;
+	err_entry.data = rx_buf->pkt.hdr.data;
+	err_entry.tag = rx_buf->pkt.hdr.tag;
+	err_entry.olen = rx_buf->pkt.hdr.size - len;
+	err_entry.err = FI_ETRUNC;
+	ret = rxm_cq_report_error(rx_buf->ep->util_ep.rx_cq, &err_entry);
+	if (ret)
+		return ret;
+
+	if (rx_buf->ep->util_ep.rx_cntr)
+		ofi_cntr_inc_err(rx_buf->ep->util_ep.rx_cntr);
+
+	if (rx_buf->recv_fs)
+		freestack_push(rx_buf->recv_fs, rx_buf->recv_entry);
+	return rxm_ep_repost_buf(rx_buf);
+}
+
 int rxm_finish_recv(struct rxm_rx_buf *rx_buf)
 {
+	size_t len;
 	int ret;
 
+	len = ofi_get_iov_len(rx_buf->recv_entry->iov, rx_buf->recv_entry->count);
+	if (rx_buf->pkt.hdr.size > len)
+		return rxm_finish_recv_trunc(rx_buf, len);
+
 	if (rx_buf->recv_entry->flags & FI_COMPLETION) {
 		FI_DBG(&rxm_prov, FI_LOG_CQ, "writing recv completion\n");
 		ret = rxm_cq_comp(rx_buf->ep->util_ep.rx_cq,
 				rx_buf->recv_entry->context,
-				FI_RECV, rx_buf->pkt.hdr.size, NULL,
+				FI_RECV | (rx_buf->recv_entry->flags & FI_MULTI_RECV),
+				rx_buf->pkt.hdr.size,
+				rx_buf->recv_fs ? NULL : rx_buf->recv_entry->iov[0].iov_base,
 				rx_buf->pkt.hdr.data, rx_buf->pkt.hdr.tag);
 		if (ret) {
 			FI_WARN(&rxm_prov, FI_LOG_CQ,
@@ -155,7 +191,11 @@ int rxm_finish_recv(struct rxm_rx_buf *rx_buf)
 		}
 	}
 
-	freestack_push(rx_buf->recv_fs, rx_buf->recv_entry);
+	if (rx_buf->ep->util_ep.rx_cntr)
+		ofi_cntr_inc(rx_buf->ep->util_ep.rx_cntr);
+
+	if (rx_buf->recv_fs)
+		freestack_push(rx_buf->recv_fs, rx_buf->recv_entry);
 	return rxm_ep_repost_buf(rx_buf);
 }
 
@@ -173,11 +213,77 @@ int rxm_finish_send(struct rxm_tx_entry *tx_entry)
 			return ret;
 		}
 	}
+	if (tx_entry->ep->util_ep.tx_cntr)
+		ofi_cntr_inc(tx_entry->ep->util_ep.tx_cntr);
+
 	util_buf_release(tx_entry->ep->tx_pool, tx_entry->pkt);
 	freestack_push(tx_entry->ep->txe_fs, tx_entry);
 	return 0;
 }
 
+static struct util_cntr *rxm_tx_entry_cntr(struct rxm_tx_entry *tx_entry)
+{
+	struct util_ep *util_ep = &tx_entry->ep->util_ep;
+
+	if (tx_entry->comp_flags & FI_READ)
+		return util_ep->rd_cntr;
+	else if (tx_entry->comp_flags & FI_WRITE)
+		return util_ep->wr_cntr;
+	else
+		return util_ep->tx_cntr;
+}
+
+static int rxm_finish_rma(struct rxm_tx_entry *tx_entry)
+{
+	struct util_cntr *cntr;
+	int ret;
+
+	if (tx_entry->flags & FI_COMPLETION) {
+		FI_DBG(&rxm_prov, FI_LOG_CQ, "writing RMA completion\n");
+		ret = rxm_cq_comp(tx_entry->ep->util_ep.tx_cq, tx_entry->context,
+				tx_entry->comp_flags, 0, NULL, 0, 0);
+		if (ret) {
+			FI_WARN(&rxm_prov, FI_LOG_CQ,
+					"Unable to write RMA completion\n");
+			return ret;
+		}
+	}
+	cntr = rxm_tx_entry_cntr(tx_entry);
+	if (cntr)
+		ofi_cntr_inc(cntr);
+
+	/* pkt is only set for injected writes that were copied */
+	if (tx_entry->pkt)
+		util_buf_release(tx_entry->ep->tx_pool, tx_entry->pkt);
+	freestack_push(tx_entry->ep->txe_fs, tx_entry);
+	return 0;
+}
+
+static int rxm_handle_remote_write(struct rxm_ep *rxm_ep,
+		struct fi_cq_data_entry *comp)
+{
+	struct util_cq *util_cq = rxm_ep->util_ep.rx_cq;
+	int ret;
+
+	/* Only writes carrying remote CQ data generate a completion */
+	if (!(comp->flags & FI_REMOTE_CQ_DATA))
+		return 0;
+
+	FI_DBG(&rxm_prov, FI_LOG_CQ, "writing remote write completion\n");
+	if (rxm_ep->rxm_info->caps & FI_SOURCE)
+		util_cq->src[ofi_cirque_windex(util_cq->cirq)] = FI_ADDR_NOTAVAIL;
+	ret = rxm_cq_comp(util_cq, NULL, FI_RMA | FI_REMOTE_WRITE | FI_REMOTE_CQ_DATA,
+			comp->len, NULL, comp->data, 0);
+	if (ret)
+		return ret;
+
+	/* The MSG provider may have consumed a posted buffer for the data */
+	if (comp->op_context &&
+	    *(enum rxm_ctx_type *)comp->op_context == RXM_RX_BUF)
+		return rxm_ep_repost_buf(comp->op_context);
+	return 0;
+}
+
 /* Get an iov whose size matches given length */
 static int rxm_match_iov(struct rxm_match_iov *match_iov, size_t len,
 		struct rxm_iovx_entry *iovx)
@@ -222,7 +328,8 @@ static int rxm_lmt_rma_read(struct rxm_rx_buf *rx_buf)
 		iovx.desc[i] = fi_mr_desc(iovx.desc[i]);
 
 	ret = fi_readv(rx_buf->conn->msg_ep, iovx.iov, iovx.desc, iovx.count, 0,
-			rx_buf->rma_iov->iov[0].addr, rx_buf->rma_iov->iov[0].key, rx_buf);
+			rx_buf->rma_iov->iov[rx_buf->index].addr,
+			rx_buf->rma_iov->iov[rx_buf->index].key, rx_buf);
 	// TODO do any cleanup?
 	if (ret)
 		return ret;
@@ -254,6 +361,44 @@ int rxm_cq_handle_ack(struct rxm_rx_buf *rx_buf)
 	return rxm_ep_repost_buf(rx_buf);
 }
 
+/*
+ * Attach a matching posted receive to rx_buf.  An FI_MULTI_RECV buffer
+ * stays on the recv list; the message gets a slice of it in rx_buf and the
+ * buffer is released once less than min_multi_recv bytes are left.
+ * Returns 1 if recv_entry was taken off the recv list.
+ */
+int rxm_cq_claim_recv(struct rxm_rx_buf *rx_buf, struct rxm_recv_queue *recv_queue,
+		      struct rxm_recv_entry *recv_entry)
+{
+	struct rxm_recv_entry *slice = &rx_buf->multi_recv;
+	size_t len;
+
+	if (!(recv_entry->flags & FI_MULTI_RECV)) {
+		dlist_remove(&recv_entry->entry);
+		rx_buf->recv_fs = recv_queue->recv_fs;
+		rx_buf->recv_entry = recv_entry;
+		return 1;
+	}
+
+	len = MIN(rx_buf->pkt.hdr.size, recv_entry->iov[0].iov_len);
+	*slice = *recv_entry;
+	slice->iov[0].iov_len = len;
+	slice->flags &= ~FI_MULTI_RECV;
+	recv_entry->iov[0].iov_base = (char *)recv_entry->iov[0].iov_base + len;
+	recv_entry->iov[0].iov_len -= len;
+
+	rx_buf->recv_fs = NULL;
+	rx_buf->recv_entry = slice;
+	if (recv_entry->iov[0].iov_len >= rx_buf->ep->min_multi_recv)
+		return 0;
+
+	FI_DBG(&rxm_prov, FI_LOG_CQ, "Releasing multi-recv buffer\n");
+	dlist_remove(&recv_entry->entry);
+	freestack_push(recv_queue->recv_fs, recv_entry);
+	slice->flags |= FI_MULTI_RECV;
+	return 1;
+}
+
 int rxm_cq_handle_data(struct rxm_rx_buf *rx_buf)
 {
 	if (rx_buf->pkt.ctrl_hdr.type == ofi_ctrl_large_data) {
@@ -265,6 +410,7 @@ int rxm_cq_handle_data(struct rxm_rx_buf *rx_buf)
 
 		FI_DBG(&rxm_prov, FI_LOG_CQ, "rx_buf->state -> RXM_LMT_START\n");
 		rx_buf->state = RXM_LMT_START;
+		ofi_stats_inc(&rx_buf->ep->stats, RXM_STAT_RNDV_RX);
 
 		memset(&rx_buf->match_iov, 0, sizeof(rx_buf->match_iov));
 		rx_buf->match_iov.iov = rx_buf->recv_entry->iov;
@@ -330,9 +476,7 @@ int rxm_handle_recv_comp(struct rxm_rx_buf *rx_buf)
 		return -FI_EINVAL;
 	}
 
-	rx_buf->recv_fs = recv_queue->recv_fs;
-
-	entry = dlist_remove_first_match(&recv_queue->recv_list, match, &match_attr);
+	entry = dlist_find_first_match(&recv_queue->recv_list, match, &match_attr);
 	if (!entry) {
 		FI_DBG(&rxm_prov, FI_LOG_CQ,
 				"No matching recv found. Enqueueing msg to unexpected queue\n");
@@ -342,7 +486,8 @@ int rxm_handle_recv_comp(struct rxm_rx_buf *rx_buf)
 		return 0;
 	}
 
-	rx_buf->recv_entry = container_of(entry, struct rxm_recv_entry, entry);
+	rxm_cq_claim_recv(rx_buf, recv_queue,
+			  container_of(entry, struct rxm_recv_entry, entry));
 	return rxm_cq_handle_data(rx_buf);
 }
 
@@ -385,13 +530,18 @@ int rxm_handle_send_comp(void *op_context)
 	return ret;
 }
 
-static int rxm_handle_read_comp(struct rxm_rx_buf *rx_buf)
+static int rxm_handle_read_comp(void *op_context)
 {
+	struct rxm_rx_buf *rx_buf;
 	struct iovec iov;
 	struct fi_msg msg;
 	struct rxm_pkt pkt;
 	int ret;
 
+	if (*(enum rxm_ctx_type *)op_context == RXM_TX_ENTRY)
+		return rxm_finish_rma(op_context);
+
+	rx_buf = op_context;
 	if (rx_buf->pkt.ctrl_hdr.type == ofi_ctrl_large_data) {
 		if (rx_buf->state != RXM_LMT_START) {
 			FI_WARN(&rxm_prov, FI_LOG_CQ,
@@ -429,56 +579,79 @@ static int rxm_handle_read_comp(struct rxm_rx_buf *rx_buf)
 			return ret;
 		}
 	}
-	// TODO process app RMA read
 	return 0;
 }
 
-static ssize_t rxm_cq_read(struct fid_cq *msg_cq, struct fi_cq_msg_entry *comp)
+/*
+ * Report an error entry read from the MSG CQ to the owning RxM CQ and
+ * counter, releasing the transmit entry it belonged to.
+ */
+static ssize_t rxm_cq_handle_error(struct fid_cq *msg_cq)
 {
 	struct rxm_tx_entry *tx_entry;
 	struct rxm_rx_buf *rx_buf;
+	struct util_cntr *cntr;
 	struct fi_cq_err_entry err_entry;
 	ssize_t ret;
 
-	ret = fi_cq_read(msg_cq, comp, 1);
-	if (ret == -FI_EAVAIL) {
-		OFI_CQ_READERR(&rxm_prov, FI_LOG_CQ, msg_cq,
-				ret, err_entry);
-		if (ret < 0) {
-			FI_WARN(&rxm_prov, FI_LOG_CQ,
-					"Unable to fi_cq_readerr on msg cq\n");
-			return ret;
-		}
-		switch (*(enum rxm_ctx_type *)comp->op_context) {
-		case RXM_TX_ENTRY:
-			tx_entry = (struct rxm_tx_entry *)comp->op_context;
-			return rxm_cq_report_error(tx_entry->ep->util_ep.tx_cq, &err_entry);
-		case RXM_RX_BUF:
-			rx_buf = (struct rxm_rx_buf *)comp->op_context;
-			return rxm_cq_report_error(rx_buf->ep->util_ep.rx_cq, &err_entry);
-		default:
-			FI_WARN(&rxm_prov, FI_LOG_CQ, "Unknown ctx type!\n");
-			FI_WARN(&rxm_prov, FI_LOG_CQ, "msg cq readerr: %s\n",
-					fi_cq_strerror(msg_cq, err_entry.prov_errno,
-						err_entry.err_data, NULL, 0));
-			assert(0);
-			return err_entry.err;
-		}
+	OFI_CQ_READERR(&rxm_prov, FI_LOG_CQ, msg_cq, ret, err_entry);
+	if (ret < 0) {
+		FI_WARN(&rxm_prov, FI_LOG_CQ,
+				"Unable to fi_cq_readerr on msg cq\n");
+		return ret;
+	}
+
+	switch (*(enum rxm_ctx_type *)err_entry.op_context) {
+	case RXM_TX_ENTRY:
+		tx_entry = (struct rxm_tx_entry *)err_entry.op_context;
+		cntr = rxm_tx_entry_cntr(tx_entry);
+		if (cntr)
+			ofi_cntr_inc_err(cntr);
+		err_entry.op_context = tx_entry->context;
+		ret = rxm_cq_report_error(tx_entry->ep->util_ep.tx_cq, &err_entry);
+		/* pkt is NULL for RMA that was not copied into a buffer */
+		if (tx_entry->pkt)
+			util_buf_release(tx_entry->ep->tx_pool, tx_entry->pkt);
+		freestack_push(tx_entry->ep->txe_fs, tx_entry);
+		return ret;
+	case RXM_RX_BUF:
+		rx_buf = (struct rxm_rx_buf *)err_entry.op_context;
+		if (rx_buf->ep->util_ep.rx_cntr)
+			ofi_cntr_inc_err(rx_buf->ep->util_ep.rx_cntr);
+		return rxm_cq_report_error(rx_buf->ep->util_ep.rx_cq, &err_entry);
+	default:
+		FI_WARN(&rxm_prov, FI_LOG_CQ, "Unknown ctx type!\n");
+		FI_WARN(&rxm_prov, FI_LOG_CQ, "msg cq readerr: %s\n",
+				fi_cq_strerror(msg_cq, err_entry.prov_errno,
+					err_entry.err_data, NULL, 0));
+		assert(0);
+		return err_entry.err;
 	}
-	return ret;
 }
 
-void rxm_cq_progress(struct fid_cq *msg_cq)
+void rxm_cq_progress(struct rxm_ep *rxm_ep)
 {
-	struct fi_cq_msg_entry comp;
+	struct fi_cq_data_entry comp;
 	ssize_t ret = 0;
 
 	do {
-		ret = rxm_cq_read(msg_cq, &comp);
+		ret = fi_cq_read(rxm_ep->msg_cq, &comp, 1);
+		if (ret == -FI_EAVAIL) {
+			/* comp is not filled in on error; nothing to dispatch */
+			ret = rxm_cq_handle_error(rxm_ep->msg_cq);
+			if (ret)
+				goto err;
+			ret = 1;
+			continue;
+		}
 		if (ret < 0)
 			goto err;
 
-		if (comp.flags & FI_RECV) {
+		if (comp.flags & FI_REMOTE_WRITE) {
+			ret = rxm_handle_remote_write(rxm_ep, &comp);
+			if (ret)
+				goto err;
+		} else if (comp.flags & FI_RECV) {
 			ret = rxm_handle_recv_comp(comp.op_context);
 			if (ret)
 				goto err;
@@ -490,6 +663,10 @@ void rxm_cq_progress(struct fid_cq *msg_cq)
 			ret = rxm_handle_read_comp(comp.op_context);
 			if (ret)
 				goto err;
+		} else if (comp.flags & FI_WRITE) {
+			ret = rxm_finish_rma(comp.op_context);
+			if (ret)
+				goto err;
 		} else {
 			FI_WARN(&rxm_prov, FI_LOG_CQ, "Unknown completion!\n");
 			goto err;
@@ -521,7 +698,7 @@ static struct fi_ops rxm_cq_fi_ops = {
 	.close = rxm_cq_close,
 	.bind = fi_no_bind,
 	.control = fi_no_control,
-	.ops_open = fi_no_ops_open,
+	.ops_open = ofi_stats_ops_open,
 };
 
 static struct fi_ops_cq rxm_cq_ops = {
@@ -559,3 +736,17 @@ err1:
 	free(util_cq);
 	return ret;
 }
+
+int rxm_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
+		  struct fid_cntr **cntr_fid, void *context)
+{
+	/* Progress is only driven by reading the counter; nothing would
+	 * wake a thread blocked on a wait object. */
+	if (attr && attr->wait_obj != FI_WAIT_NONE) {
+		FI_WARN(&rxm_prov, FI_LOG_CQ, "unsupported wait object\n");
+		return -FI_ENOSYS;
+	}
+
+	return ofi_cntr_open(&rxm_prov, domain, attr, cntr_fid,
+			     &ofi_cntr_progress, context);
+}
@@ -42,8 +42,8 @@ static struct fi_ops_domain rxm_domain_ops = {
 	.av_open = ip_av_create,
 	.cq_open = rxm_cq_open,
 	.endpoint = rxm_endpoint,
-	.scalable_ep = fi_no_scalable_ep,
-	.cntr_open = fi_no_cntr_open,
+	.scalable_ep = ofi_scalable_ep,
+	.cntr_open = rxm_cntr_open,
 	.poll_open = fi_poll_create,
 	.stx_ctx = fi_no_stx_context,
 	.srx_ctx = fi_no_srx_context,
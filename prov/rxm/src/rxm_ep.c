@@ -85,6 +85,12 @@ static void rxm_recv_queue_close(struct rxm_recv_queue *recv_queue)
 	// TODO cleanup recv_list and unexp msg list
 }
 
+static const char * const rxm_ep_stat_names[] = {
+	[RXM_STAT_RNDV_TX] = "rndv_tx",
+	[RXM_STAT_RNDV_RX] = "rndv_rx",
+	[RXM_STAT_BUF_POOL_GROW] = "buf_pool_grow",
+};
+
 static int rxm_ep_txrx_res_open(struct rxm_ep *rxm_ep)
 {
 	struct rxm_domain *rxm_domain;
@@ -123,7 +129,16 @@ static int rxm_ep_txrx_res_open(struct rxm_ep *rxm_ep)
 	if (ret)
 		goto err4;
 
+	ret = ofi_stats_init(&rxm_ep->stats, &rxm_prov, &rxm_ep->util_ep.ep_fid.fid,
+			"ep", rxm_ep_stat_names, RXM_STAT_MAX);
+	if (ret)
+		goto err5;
+	util_buf_pool_set_stats(rxm_ep->tx_pool, &rxm_ep->stats, RXM_STAT_BUF_POOL_GROW);
+	util_buf_pool_set_stats(rxm_ep->rx_pool, &rxm_ep->stats, RXM_STAT_BUF_POOL_GROW);
+
 	return 0;
+err5:
+	rxm_recv_queue_close(&rxm_ep->trecv_queue);
 err4:
 	rxm_recv_queue_close(&rxm_ep->recv_queue);
 err3:
@@ -140,6 +155,7 @@ static void rxm_ep_txrx_res_close(struct rxm_ep *rxm_ep)
 	struct slist_entry *entry;
 	struct rxm_rx_buf *rx_buf;
 
+	ofi_stats_close(&rxm_ep->stats);
 	rxm_recv_queue_close(&rxm_ep->trecv_queue);
 	rxm_recv_queue_close(&rxm_ep->recv_queue);
 
@@ -233,13 +249,37 @@ static struct fi_ops_cm rxm_ops_cm = {
 int rxm_getopt(fid_t fid, int level, int optname,
 		void *optval, size_t *optlen)
 {
-	return -FI_ENOPROTOOPT;
+	struct rxm_ep *rxm_ep;
+
+	rxm_ep = container_of(fid, struct rxm_ep, util_ep.ep_fid.fid);
+
+	if (level != FI_OPT_ENDPOINT || optname != FI_OPT_MIN_MULTI_RECV)
+		return -FI_ENOPROTOOPT;
+
+	if (*optlen < sizeof(size_t)) {
+		*optlen = sizeof(size_t);
+		return -FI_ETOOSMALL;
+	}
+	*(size_t *)optval = rxm_ep->min_multi_recv;
+	*optlen = sizeof(size_t);
+	return 0;
 }
 
 int rxm_setopt(fid_t fid, int level, int optname,
 		const void *optval, size_t optlen)
 {
-	return -FI_ENOPROTOOPT;
+	struct rxm_ep *rxm_ep;
+
+	rxm_ep = container_of(fid, struct rxm_ep, util_ep.ep_fid.fid);
+
+	if (level != FI_OPT_ENDPOINT || optname != FI_OPT_MIN_MULTI_RECV)
+		return -FI_ENOPROTOOPT;
+
+	if (optlen != sizeof(size_t))
+		return -FI_EINVAL;
+
+	rxm_ep->min_multi_recv = *(size_t *)optval;
+	return 0;
 }
 
 static struct fi_ops_ep rxm_ops_ep = {
@@ -282,39 +322,41 @@ static int ofi_match_unexp_msg_tagged(struct dlist_entry *item, const void *arg)
 		rxm_match_tag(attr->tag, attr->ignore, unexp_msg->tag);
 }
 
-static int rxm_check_unexp_msg_list(struct util_cq *util_cq, struct rxm_recv_queue *recv_queue,
+static int rxm_check_unexp_msg_list(struct rxm_recv_queue *recv_queue,
 		struct rxm_recv_entry *recv_entry, dlist_func_t *match)
 {
 	struct dlist_entry *entry;
-	struct rxm_unexp_msg *unexp_msg;
 	struct rxm_recv_match_attr match_attr;
 	struct rxm_rx_buf *rx_buf;
-	int ret = 0;
-
-	fastlock_acquire(&util_cq->cq_lock);
-	if (ofi_cirque_isfull(util_cq->cirq)) {
-		ret = -FI_EAGAIN;
-		goto out;
-	}
+	int released, ret;
 
 	match_attr.addr = recv_entry->addr;
 	match_attr.tag = recv_entry->tag;
 	match_attr.ignore = recv_entry->ignore;
 
-	entry = dlist_remove_first_match(&recv_queue->unexp_msg_list, match, &match_attr);
-	if (!entry)
-		goto out;
-	FI_DBG(&rxm_prov, FI_LOG_EP_DATA, "Match for posted recv found in unexp msg list\n");
+	/* An FI_MULTI_RECV buffer may absorb several unexpected messages */
+	do {
+		entry = dlist_remove_first_match(&recv_queue->unexp_msg_list,
+						 match, &match_attr);
+		if (!entry)
+			return 0;
+		FI_DBG(&rxm_prov, FI_LOG_EP_DATA, "Match for posted recv found in unexp msg list\n");
 
-	unexp_msg = container_of(entry, struct rxm_unexp_msg, entry);
-	rx_buf = container_of(unexp_msg, struct rxm_rx_buf, unexp_msg);
-	rx_buf->recv_entry = recv_entry;
+		rx_buf = container_of(entry, struct rxm_rx_buf, unexp_msg.entry);
+		released = rxm_cq_claim_recv(rx_buf, recv_queue, recv_entry);
 
-	ret = rxm_cq_handle_data(rx_buf);
-	free(unexp_msg);
-out:
-	fastlock_release(&util_cq->cq_lock);
-	return ret;
+		ret = rxm_cq_handle_data(rx_buf);
+		if (ret) {
+			/* the caller fails the post, so don't leave it posted */
+			if (!released) {
+				dlist_remove(&recv_entry->entry);
+				freestack_push(recv_queue->recv_fs, recv_entry);
+			}
+			return ret;
+		}
+	} while (!released);
+
+	return 0;
 }
 
 int rxm_ep_recv_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
@@ -341,6 +383,12 @@ int rxm_ep_recv_common(struct fid_ep *ep_fid, const struct iovec *iov, void **de
 		return -FI_EINVAL;
 	}
 
+	if ((flags & FI_MULTI_RECV) && (op != ofi_op_msg || count != 1)) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+			"FI_MULTI_RECV requires a single iov msg receive\n");
+		return -FI_EINVAL;
+	}
+
 	if (freestack_isempty(recv_queue->recv_fs)) {
 		FI_DBG(&rxm_prov, FI_LOG_CQ, "Exhaused recv_entry freestack\n");
 		return -FI_EAGAIN;
@@ -356,6 +404,7 @@ int rxm_ep_recv_common(struct fid_ep *ep_fid, const struct iovec *iov, void **de
 			iov[i].iov_len);
 	}
 	recv_entry->count = count;
+	recv_entry->context = context;
 	recv_entry->addr = (rxm_ep->rxm_info->caps & FI_DIRECTED_RECV) ?
 		src_addr : FI_ADDR_UNSPEC;
 	recv_entry->flags = flags;
@@ -364,17 +413,16 @@ int rxm_ep_recv_common(struct fid_ep *ep_fid, const struct iovec *iov, void **de
 		recv_entry->ignore = ignore;
 	}
 
+	dlist_insert_tail(&recv_entry->entry, &recv_queue->recv_list);
+
 	if (!dlist_empty(&recv_queue->unexp_msg_list)) {
-		ret = rxm_check_unexp_msg_list(rxm_ep->util_ep.rx_cq, recv_queue,
-				recv_entry, match);
+		ret = rxm_check_unexp_msg_list(recv_queue, recv_entry, match);
 		if (ret) {
 			FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
 					"Unable to check unexp msg list\n");
 			return ret;
 		}
 	}
-
-	dlist_insert_tail(&recv_entry->entry, &recv_queue->recv_list);
 	return 0;
 }
 
@@ -458,6 +506,7 @@ static ssize_t rxm_ep_send_common(struct fid_ep *ep_fid, const struct iovec *iov
 	tx_entry->ep = rxm_ep;
 	tx_entry->context = context;
 	tx_entry->flags = flags;
+	tx_entry->comp_flags = FI_SEND;
 
 	if (rxm_ep->msg_info->mode & FI_LOCAL_MR) {
 		pkt = util_buf_get_ex(rxm_ep->tx_pool, (void **)&mr);
@@ -495,8 +544,8 @@ static ssize_t rxm_ep_send_common(struct fid_ep *ep_fid, const struct iovec *iov
 		rma_iov->count = count;
 		for (i = 0; i < count; i++) {
 			rma_iov->iov[i].addr = rxm_ep->msg_info->domain_attr->mr_mode == FI_MR_SCALABLE ?
-				0 : (uintptr_t)iov->iov_base;
-			rma_iov->iov[i].len = (uint64_t)iov->iov_len;
+				0 : (uintptr_t)iov[i].iov_base;
+			rma_iov->iov[i].len = (uint64_t)iov[i].iov_len;
 			rma_iov->iov[i].key = fi_mr_key(desc[i]);
 		}
 		pkt_size = sizeof(*pkt) + sizeof(*rma_iov) + sizeof(*rma_iov->iov) * count;
@@ -505,6 +554,7 @@ static ssize_t rxm_ep_send_common(struct fid_ep *ep_fid, const struct iovec *iov
 				tx_entry->msg_id);
 		FI_DBG(&rxm_prov, FI_LOG_CQ, "tx_entry->state -> RXM_LMT_START\n");
 		tx_entry->state = RXM_LMT_START;
+		ofi_stats_inc(&rxm_ep->stats, RXM_STAT_RNDV_TX);
 	} else {
 		pkt->ctrl_hdr.type = ofi_ctrl_data;
 		ofi_copy_iov_buf(iov, count, pkt->data, pkt->hdr.size, 0,
@@ -708,6 +758,289 @@ struct fi_ops_tagged rxm_ops_tagged = {
 	.injectdata = rxm_ep_tinjectdata,
 };
 
+typedef ssize_t (*rxm_rma_msg_fn)(struct fid_ep *ep_fid,
+		const struct fi_msg_rma *msg, uint64_t flags);
+
+/* Flags handed down to the MSG endpoint along with an RMA operation */
+#define RXM_RMA_MSG_FLAGS (FI_INJECT | FI_REMOTE_CQ_DATA | FI_FENCE | \
+		FI_TRANSMIT_COMPLETE | FI_DELIVERY_COMPLETE)
+
+static struct rxm_tx_entry *rxm_ep_rma_tx_entry(struct rxm_ep *rxm_ep,
+		void *context, uint64_t flags, uint64_t comp_flags)
+{
+	struct rxm_tx_entry *tx_entry;
+
+	if (freestack_isempty(rxm_ep->txe_fs)) {
+		FI_DBG(&rxm_prov, FI_LOG_EP_DATA, "Exhaused tx_entry freestack\n");
+		return NULL;
+	}
+
+	tx_entry = freestack_pop(rxm_ep->txe_fs);
+	tx_entry->ctx_type = RXM_TX_ENTRY;
+	tx_entry->ep = rxm_ep;
+	tx_entry->context = context;
+	tx_entry->flags = flags;
+	tx_entry->comp_flags = comp_flags;
+	tx_entry->pkt = NULL;
+	tx_entry->state = RXM_LMT_NONE;
+	return tx_entry;
+}
+
+/* RMA is issued directly on the MSG endpoint connected to the peer */
+static ssize_t rxm_ep_rma_common(struct fid_ep *ep_fid,
+		const struct fi_msg_rma *msg, uint64_t flags,
+		rxm_rma_msg_fn rma_msg, uint64_t comp_flags)
+{
+	struct rxm_ep *rxm_ep;
+	struct rxm_conn *rxm_conn;
+	struct rxm_tx_entry *tx_entry;
+	struct fi_msg_rma msg_rma;
+	void *mr_desc[RXM_IOV_LIMIT];
+	size_t i;
+	int ret;
+
+	rxm_ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid.fid);
+
+	if (msg->iov_count > RXM_IOV_LIMIT || msg->rma_iov_count > RXM_IOV_LIMIT)
+		return -FI_EINVAL;
+
+	ret = rxm_get_conn(rxm_ep, msg->addr, &rxm_conn);
+	if (ret)
+		return ret;
+
+	tx_entry = rxm_ep_rma_tx_entry(rxm_ep, msg->context, flags, comp_flags);
+	if (!tx_entry)
+		return -FI_EAGAIN;
+
+	msg_rma = *msg;
+	msg_rma.addr = 0;
+	msg_rma.context = tx_entry;
+	if (msg->desc) {
+		/* rxm MR descriptors are the MSG provider's MRs */
+		for (i = 0; i < msg->iov_count; i++)
+			mr_desc[i] = msg->desc[i] ? fi_mr_desc(msg->desc[i]) : NULL;
+		msg_rma.desc = mr_desc;
+	}
+
+	ret = rma_msg(rxm_conn->msg_ep, &msg_rma,
+			(flags & RXM_RMA_MSG_FLAGS) | FI_COMPLETION);
+	if (ret) {
+		FI_DBG(&rxm_prov, FI_LOG_EP_DATA, "MSG provider RMA failed\n");
+		freestack_push(rxm_ep->txe_fs, tx_entry);
+	}
+	return ret;
+}
+
+static ssize_t rxm_ep_readmsg(struct fid_ep *ep_fid, const struct fi_msg_rma *msg,
+		uint64_t flags)
+{
+	return rxm_ep_rma_common(ep_fid, msg,
+			flags | (rxm_ep_tx_flags(ep_fid) & FI_COMPLETION),
+			fi_readmsg, FI_RMA | FI_READ);
+}
+
+static ssize_t rxm_ep_readv(struct fid_ep *ep_fid, const struct iovec *iov,
+		void **desc, size_t count, fi_addr_t src_addr, uint64_t addr,
+		uint64_t key, void *context)
+{
+	struct fi_rma_iov rma_iov;
+	struct fi_msg_rma msg;
+
+	rma_iov.addr = addr;
+	rma_iov.len = ofi_get_iov_len(iov, count);
+	rma_iov.key = key;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.desc = desc;
+	msg.iov_count = count;
+	msg.addr = src_addr;
+	msg.rma_iov = &rma_iov;
+	msg.rma_iov_count = 1;
+	msg.context = context;
+
+	return rxm_ep_rma_common(ep_fid, &msg, rxm_ep_tx_flags(ep_fid),
+			fi_readmsg, FI_RMA | FI_READ);
+}
+
+static ssize_t rxm_ep_read(struct fid_ep *ep_fid, void *buf, size_t len,
+		void *desc, fi_addr_t src_addr, uint64_t addr, uint64_t key,
+		void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = buf;
+	iov.iov_len = len;
+
+	return rxm_ep_readv(ep_fid, &iov, &desc, 1, src_addr, addr, key,
+			context);
+}
+
+static ssize_t rxm_ep_writemsg(struct fid_ep *ep_fid,
+		const struct fi_msg_rma *msg, uint64_t flags)
+{
+	return rxm_ep_rma_common(ep_fid, msg,
+			flags | (rxm_ep_tx_flags(ep_fid) & FI_COMPLETION),
+			fi_writemsg, FI_RMA | FI_WRITE);
+}
+
+static ssize_t rxm_ep_writev_common(struct fid_ep *ep_fid,
+		const struct iovec *iov, void **desc, size_t count,
+		fi_addr_t dest_addr, uint64_t addr, uint64_t key, uint64_t data,
+		void *context, uint64_t flags)
+{
+	struct fi_rma_iov rma_iov;
+	struct fi_msg_rma msg;
+
+	rma_iov.addr = addr;
+	rma_iov.len = ofi_get_iov_len(iov, count);
+	rma_iov.key = key;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.desc = desc;
+	msg.iov_count = count;
+	msg.addr = dest_addr;
+	msg.rma_iov = &rma_iov;
+	msg.rma_iov_count = 1;
+	msg.context = context;
+	msg.data = data;
+
+	return rxm_ep_rma_common(ep_fid, &msg, flags, fi_writemsg,
+			FI_RMA | FI_WRITE);
+}
+
+static ssize_t rxm_ep_writev(struct fid_ep *ep_fid, const struct iovec *iov,
+		void **desc, size_t count, fi_addr_t dest_addr, uint64_t addr,
+		uint64_t key, void *context)
+{
+	return rxm_ep_writev_common(ep_fid, iov, desc, count, dest_addr, addr,
+			key, 0, context, rxm_ep_tx_flags(ep_fid));
+}
+
+static ssize_t rxm_ep_write(struct fid_ep *ep_fid, const void *buf,
+		size_t len, void *desc, fi_addr_t dest_addr, uint64_t addr,
+		uint64_t key, void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+
+	return rxm_ep_writev_common(ep_fid, &iov, &desc, 1, dest_addr, addr,
+			key, 0, context, rxm_ep_tx_flags(ep_fid));
+}
+
+static ssize_t rxm_ep_writedata(struct fid_ep *ep_fid, const void *buf,
+		size_t len, void *desc, uint64_t data, fi_addr_t dest_addr,
+		uint64_t addr, uint64_t key, void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+
+	return rxm_ep_writev_common(ep_fid, &iov, &desc, 1, dest_addr, addr,
+			key, data, context,
+			rxm_ep_tx_flags(ep_fid) | FI_REMOTE_CQ_DATA);
+}
+
+/*
+ * Small writes go straight to the MSG provider's inject.  Larger ones,
+ * up to our inject_size, are copied into a tx buffer that is released
+ * when the MSG write completes.
+ */
+static ssize_t rxm_ep_inject_write_common(struct fid_ep *ep_fid,
+		const void *buf, size_t len, uint64_t data, fi_addr_t dest_addr,
+		uint64_t addr, uint64_t key, uint64_t flags)
+{
+	struct rxm_ep *rxm_ep;
+	struct rxm_conn *rxm_conn;
+	struct rxm_tx_entry *tx_entry;
+	struct fid_mr *mr;
+	void *desc = NULL;
+	void *tx_buf;
+	int ret;
+
+	rxm_ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid.fid);
+
+	if (len > rxm_tx_attr.inject_size) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+				"inject size supported: %d, write size: %zu\n",
+				rxm_tx_attr.inject_size, len);
+		return -FI_EMSGSIZE;
+	}
+
+	ret = rxm_get_conn(rxm_ep, dest_addr, &rxm_conn);
+	if (ret)
+		return ret;
+
+	if (len <= rxm_ep->msg_info->tx_attr->inject_size) {
+		ret = (flags & FI_REMOTE_CQ_DATA) ?
+			fi_inject_writedata(rxm_conn->msg_ep, buf, len, data, 0,
+					addr, key) :
+			fi_inject_write(rxm_conn->msg_ep, buf, len, 0, addr, key);
+		if (!ret && rxm_ep->util_ep.wr_cntr)
+			ofi_cntr_inc(rxm_ep->util_ep.wr_cntr);
+		return ret;
+	}
+
+	tx_entry = rxm_ep_rma_tx_entry(rxm_ep, NULL, flags & ~FI_COMPLETION,
+			FI_RMA | FI_WRITE);
+	if (!tx_entry)
+		return -FI_EAGAIN;
+
+	if (rxm_ep->msg_info->mode & FI_LOCAL_MR) {
+		tx_buf = util_buf_get_ex(rxm_ep->tx_pool, (void **)&mr);
+		desc = fi_mr_desc(mr);
+	} else {
+		tx_buf = util_buf_get(rxm_ep->tx_pool);
+	}
+	assert(tx_buf);
+	memcpy(tx_buf, buf, len);
+	tx_entry->pkt = tx_buf;
+
+	ret = (flags & FI_REMOTE_CQ_DATA) ?
+		fi_writedata(rxm_conn->msg_ep, tx_buf, len, desc, data, 0,
+				addr, key, tx_entry) :
+		fi_write(rxm_conn->msg_ep, tx_buf, len, desc, 0, addr, key,
+				tx_entry);
+	if (ret) {
+		FI_DBG(&rxm_prov, FI_LOG_EP_DATA, "MSG provider RMA failed\n");
+		util_buf_release(rxm_ep->tx_pool, tx_buf);
+		freestack_push(rxm_ep->txe_fs, tx_entry);
+	}
+	return ret;
+}
+
+static ssize_t rxm_ep_inject_write(struct fid_ep *ep_fid, const void *buf,
+		size_t len, fi_addr_t dest_addr, uint64_t addr, uint64_t key)
+{
+	return rxm_ep_inject_write_common(ep_fid, buf, len, 0, dest_addr,
+			addr, key, FI_INJECT);
+}
+
+static ssize_t rxm_ep_inject_writedata(struct fid_ep *ep_fid, const void *buf,
+		size_t len, uint64_t data, fi_addr_t dest_addr, uint64_t addr,
+		uint64_t key)
+{
+	return rxm_ep_inject_write_common(ep_fid, buf, len, data, dest_addr,
+			addr, key, FI_INJECT | FI_REMOTE_CQ_DATA);
+}
+
+static struct fi_ops_rma rxm_ops_rma = {
+	.size = sizeof(struct fi_ops_rma),
+	.read = rxm_ep_read,
+	.readv = rxm_ep_readv,
+	.readmsg = rxm_ep_readmsg,
+	.write = rxm_ep_write,
+	.writev = rxm_ep_writev,
+	.writemsg = rxm_ep_writemsg,
+	.inject = rxm_ep_inject_write,
+	.writedata = rxm_ep_writedata,
+	.injectdata = rxm_ep_inject_writedata,
+};
+
 static int rxm_ep_msg_res_close(struct rxm_ep *rxm_ep)
 {
 	int ret, retv = 0;
@@ -770,7 +1103,7 @@ static int rxm_ep_bind_cq(struct rxm_ep *rxm_ep, struct util_cq *util_cq, uint64
 {
 	int ret;
 
-	if (flags & ~(FI_TRANSMIT | FI_RECV)) {
+	if (flags & ~(FI_TRANSMIT | FI_RECV | FI_SELECTIVE_COMPLETION)) {
 		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "unsupported flags\n");
 		return -FI_EBADFLAGS;
 	}
@@ -808,6 +1141,23 @@ static int rxm_ep_bind_cq(struct rxm_ep *rxm_ep, struct util_cq *util_cq, uint64
 	return 0;
 }
 
+static int rxm_ep_bind_cntr(struct rxm_ep *rxm_ep, struct util_cntr *cntr,
+			    uint64_t flags)
+{
+	int ret;
+
+	/* Remote RMA completes in the MSG provider without reaching RxM */
+	if (flags & ~(FI_SEND | FI_RECV | FI_READ | FI_WRITE)) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "unsupported flags\n");
+		return -FI_EBADFLAGS;
+	}
+
+	ret = ofi_ep_bind_cntr(&rxm_ep->util_ep, cntr, flags);
+	if (ret)
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "duplicate counter binding\n");
+	return ret;
+}
+
 static int rxm_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 {
 	struct rxm_ep *rxm_ep;
@@ -829,6 +1179,10 @@ static int rxm_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 		ret = rxm_ep_bind_cq(rxm_ep, container_of(bfid, struct util_cq,
 					cq_fid.fid), flags);
 		break;
+	case FI_CLASS_CNTR:
+		ret = rxm_ep_bind_cntr(rxm_ep, container_of(bfid,
+					struct util_cntr, cntr_fid.fid), flags);
+		break;
 	case FI_CLASS_EQ:
 		break;
 	default:
@@ -886,7 +1240,7 @@ static struct fi_ops rxm_ep_fi_ops = {
 	.close = rxm_ep_close,
 	.bind = rxm_ep_bind,
 	.control = rxm_ep_ctrl,
-	.ops_open = fi_no_ops_open,
+	.ops_open = ofi_stats_ops_open,
 };
 
 static int rxm_ep_msg_res_open(struct fi_info *rxm_info,
@@ -914,7 +1268,7 @@ static int rxm_ep_msg_res_open(struct fi_info *rxm_info,
 
 	memset(&cq_attr, 0, sizeof(cq_attr));
 	cq_attr.size = rxm_info->tx_attr->size + rxm_info->rx_attr->size;
-	cq_attr.format = FI_CQ_FORMAT_MSG;
+	cq_attr.format = FI_CQ_FORMAT_DATA;
 
 	ret = fi_cq_open(rxm_domain->msg_domain, &cq_attr, &rxm_ep->msg_cq, NULL);
 	if (ret) {
@@ -954,7 +1308,7 @@ void rxm_ep_progress(struct util_ep *util_ep)
 	struct rxm_ep *rxm_ep;
 
 	rxm_ep = container_of(util_ep, struct rxm_ep, util_ep);
-	rxm_cq_progress(rxm_ep->msg_cq);
+	rxm_cq_progress(rxm_ep);
 }
 
 int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
@@ -979,6 +1333,7 @@ int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
 		goto err1;
 
 	util_domain = container_of(domain, struct util_domain, domain_fid);
+	rxm_ep->min_multi_recv = RXM_MIN_MULTI_RECV;
 
 	ret = rxm_ep_msg_res_open(info, util_domain, rxm_ep);
 	if (ret)
@@ -994,6 +1349,7 @@ int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
 	(*ep_fid)->cm = &rxm_ops_cm;
 	(*ep_fid)->msg = &rxm_ops_msg;
 	(*ep_fid)->tagged = &rxm_ops_tagged;
+	(*ep_fid)->rma = &rxm_ops_rma;
 
 	return 0;
 err3:
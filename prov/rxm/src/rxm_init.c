@@ -38,10 +38,12 @@
 int rxm_alter_layer_info(struct fi_info *layer_info, struct fi_info *base_info)
 {
 	/* TODO choose base_info attr based on layer_info attr */
-	base_info->caps = FI_MSG;
+	base_info->caps = FI_MSG | FI_RMA;
 	base_info->mode = FI_LOCAL_MR;
 	base_info->ep_attr->rx_ctx_cnt = FI_SHARED_CONTEXT;
 	base_info->ep_attr->type = FI_EP_MSG;
+	/* RMA targets are passed through as virtual addresses */
+	base_info->domain_attr->mr_mode = FI_MR_BASIC;
 
 	return 0;
 }
@@ -56,6 +58,8 @@ int rxm_alter_base_info(struct fi_info *base_info, struct fi_info *layer_info)
 	layer_info->tx_attr->iov_limit = MIN(MIN(layer_info->tx_attr->iov_limit,
 			base_info->tx_attr->iov_limit),
 			base_info->tx_attr->rma_iov_limit);
+	layer_info->tx_attr->rma_iov_limit = MIN(layer_info->tx_attr->rma_iov_limit,
+			base_info->tx_attr->rma_iov_limit);
 
 	*layer_info->rx_attr = *rxm_info.rx_attr;
 	layer_info->rx_attr->iov_limit = MIN(layer_info->rx_attr->iov_limit,
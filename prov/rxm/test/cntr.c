@@ -0,0 +1,568 @@
+/*
+ * Copyright (c) 2017 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Exercises the util counters through rxm.  The same sends are run on
+ * a pair of endpoints that complete through CQs and on a pair bound with
+ * FI_SELECTIVE_COMPLETION that completes through counters alone.  Also
+ * checks duplicate binds, wait thresholds and timeouts, error counts,
+ * add/set with values past 32 bits, and closing a bound counter.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_errno.h>
+
+#define CT_MSG_SIZE	64
+#define CT_MSG_CNT	5
+#define CT_TIMEOUT	5000
+#define CT_SHORT_WAIT	200
+
+/* automake's exit status for a skipped test */
+#define CT_SKIP		77
+
+enum {
+	CT_CQ,
+	CT_CNTR_ONLY,
+	CT_PAIRS
+};
+
+/* ep[0] sends to ep[1]; tx_cntr counts ep[0]'s sends, rx_cntr ep[1]'s receives */
+struct ct_pair {
+	struct fid_ep *ep[2];
+	struct fid_cq *cq[2];
+	struct fid_cntr *tx_cntr;
+	struct fid_cntr *rx_cntr;
+	fi_addr_t peer;
+};
+
+static struct fi_info *info;
+static struct fid_fabric *fabric;
+static struct fid_domain *domain;
+static struct fid_av *av;
+static struct ct_pair pairs[CT_PAIRS];
+
+static char tx_buf[CT_MSG_SIZE];
+static char rx_buf[CT_MSG_CNT][CT_MSG_SIZE];
+static struct fi_context tx_ctx[CT_MSG_CNT], rx_ctx[CT_MSG_CNT];
+
+static const char *ct_name[CT_PAIRS] = { "cq", "counter-only" };
+
+static uint64_t ct_now_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int ct_cntr_open(struct fid_cntr **cntr)
+{
+	struct fi_cntr_attr attr;
+
+	memset(&attr, 0, sizeof attr);
+	attr.events = FI_CNTR_EVENTS_COMP;
+	attr.wait_obj = FI_WAIT_NONE;
+	return fi_cntr_open(domain, &attr, cntr, NULL);
+}
+
+/* Retries while rxm connects, reading the counters to drive progress */
+static int ct_send(struct ct_pair *pair, size_t len, void *context, int inject)
+{
+	ssize_t ret;
+	uint64_t start = ct_now_ms();
+
+	do {
+		if (inject)
+			ret = fi_inject(pair->ep[0], tx_buf, len, pair->peer);
+		else
+			ret = fi_send(pair->ep[0], tx_buf, len, NULL,
+				      pair->peer, context);
+		if (ret != -FI_EAGAIN)
+			return (int) ret;
+
+		fi_cntr_read(pair->tx_cntr);
+		fi_cntr_read(pair->rx_cntr);
+	} while (ct_now_ms() - start < CT_TIMEOUT);
+	return -FI_ETIMEDOUT;
+}
+
+/* Counts the completions on cq, or returns an error */
+static int ct_cq_drain(struct fid_cq *cq)
+{
+	struct fi_cq_entry comp;
+	ssize_t ret;
+	int cnt = 0;
+
+	while ((ret = fi_cq_read(cq, &comp, 1)) == 1)
+		cnt++;
+	return ret == -FI_EAGAIN ? cnt : (int) ret;
+}
+
+/*
+ * CT_MSG_CNT messages, the last one injected, must move both counters by
+ * CT_MSG_CNT.  Only the CQ pair gets CQ entries: one per receive and one
+ * per send that was not injected.
+ */
+static int check_completion(int mode)
+{
+	struct ct_pair *pair = &pairs[mode];
+	uint64_t tx_base, rx_base;
+	int i, ret, expect;
+
+	tx_base = fi_cntr_read(pair->tx_cntr);
+	rx_base = fi_cntr_read(pair->rx_cntr);
+
+	for (i = 0; i < CT_MSG_CNT; i++) {
+		ret = (int) fi_recv(pair->ep[1], rx_buf[i], CT_MSG_SIZE, NULL,
+				    FI_ADDR_UNSPEC, &rx_ctx[i]);
+		if (ret) {
+			printf("%s: recv: %s\n", ct_name[mode], fi_strerror(-ret));
+			return 1;
+		}
+	}
+
+	for (i = 0; i < CT_MSG_CNT; i++) {
+		ret = ct_send(pair, CT_MSG_SIZE, &tx_ctx[i],
+			      i == CT_MSG_CNT - 1);
+		if (ret) {
+			printf("%s: send %d: %s\n", ct_name[mode], i,
+			       fi_strerror(-ret));
+			return 1;
+		}
+	}
+
+	ret = fi_cntr_wait(pair->rx_cntr, rx_base + CT_MSG_CNT, CT_TIMEOUT);
+	if (ret) {
+		printf("%s: rx wait(%d): %s\n", ct_name[mode], CT_MSG_CNT,
+		       fi_strerror(-ret));
+		return 1;
+	}
+
+	ret = fi_cntr_wait(pair->tx_cntr, tx_base + CT_MSG_CNT, CT_TIMEOUT);
+	if (ret) {
+		printf("%s: tx wait(%d): %s\n", ct_name[mode], CT_MSG_CNT,
+		       fi_strerror(-ret));
+		return 1;
+	}
+
+	if (fi_cntr_read(pair->rx_cntr) != rx_base + CT_MSG_CNT ||
+	    fi_cntr_read(pair->tx_cntr) != tx_base + CT_MSG_CNT) {
+		printf("%s: counters moved past %d\n", ct_name[mode],
+		       CT_MSG_CNT);
+		return 1;
+	}
+
+	expect = (mode == CT_CQ) ? CT_MSG_CNT - 1 : 0;
+	ret = ct_cq_drain(pair->cq[0]);
+	if (ret != expect) {
+		printf("%s: %d send completions, expected %d\n",
+		       ct_name[mode], ret, expect);
+		return 1;
+	}
+
+	expect = (mode == CT_CQ) ? CT_MSG_CNT : 0;
+	ret = ct_cq_drain(pair->cq[1]);
+	if (ret != expect) {
+		printf("%s: %d recv completions, expected %d\n",
+		       ct_name[mode], ret, expect);
+		return 1;
+	}
+	return 0;
+}
+
+/* A wait past the counter's value times out after the given period */
+static int check_timeout(void)
+{
+	struct ct_pair *pair = &pairs[CT_CNTR_ONLY];
+	uint64_t start, elapsed;
+	int ret;
+
+	start = ct_now_ms();
+	ret = fi_cntr_wait(pair->rx_cntr, fi_cntr_read(pair->rx_cntr) + 1,
+			   CT_SHORT_WAIT);
+	elapsed = ct_now_ms() - start;
+	if (ret != -FI_ETIMEDOUT) {
+		printf("wait with nothing to arrive: %s\n", fi_strerror(-ret));
+		return 1;
+	}
+	if (elapsed < CT_SHORT_WAIT - 10) {
+		printf("wait timed out after %d ms, expected %d\n",
+		       (int) elapsed, CT_SHORT_WAIT);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * A truncated receive counts as an error, which fails a wait in
+ * progress with -FI_EAVAIL and shows in fi_cntr_readerr.
+ */
+static int check_error(void)
+{
+	struct ct_pair *pair = &pairs[CT_CNTR_ONLY];
+	struct fi_cq_err_entry err;
+	uint64_t rx_base, err_base, tx_base;
+	int ret;
+
+	tx_base = fi_cntr_read(pair->tx_cntr);
+	rx_base = fi_cntr_read(pair->rx_cntr);
+	err_base = fi_cntr_readerr(pair->rx_cntr);
+
+	ret = (int) fi_recv(pair->ep[1], rx_buf[0], CT_MSG_SIZE / 8, NULL,
+			    FI_ADDR_UNSPEC, &rx_ctx[0]);
+	if (!ret)
+		ret = ct_send(pair, CT_MSG_SIZE, &tx_ctx[0], 0);
+	if (ret) {
+		printf("truncated transfer: %s\n", fi_strerror(-ret));
+		return 1;
+	}
+
+	ret = fi_cntr_wait(pair->rx_cntr, rx_base + 1, CT_TIMEOUT);
+	if (ret != -FI_EAVAIL) {
+		printf("wait on a truncated receive: %s\n", fi_strerror(-ret));
+		return 1;
+	}
+	if (fi_cntr_readerr(pair->rx_cntr) != err_base + 1 ||
+	    fi_cntr_read(pair->rx_cntr) != rx_base) {
+		printf("truncated receive was not counted as an error\n");
+		return 1;
+	}
+
+	ret = fi_cntr_wait(pair->tx_cntr, tx_base + 1, CT_TIMEOUT);
+	if (ret) {
+		printf("send of a truncated message: %s\n", fi_strerror(-ret));
+		return 1;
+	}
+
+	/* the error entry is still written to the CQ */
+	if (fi_cq_read(pair->cq[1], &err, 1) != -FI_EAVAIL ||
+	    fi_cq_readerr(pair->cq[1], &err, 0) < 0 || err.err != FI_ETRUNC) {
+		printf("truncated receive has no CQ error entry\n");
+		return 1;
+	}
+	return 0;
+}
+
+/* A counter can be bound once per event type on an endpoint */
+static int check_dup_bind(void)
+{
+	struct ct_pair *pair = &pairs[CT_CQ];
+	struct fid_cntr *cntr;
+	int ret, failed = 0;
+
+	ret = fi_ep_bind(pair->ep[0], &pair->tx_cntr->fid, FI_SEND);
+	if (ret != -FI_EINVAL) {
+		printf("bind of the same counter again: %s\n", fi_strerror(-ret));
+		failed++;
+	}
+
+	ret = ct_cntr_open(&cntr);
+	if (ret) {
+		printf("cntr open: %s\n", fi_strerror(-ret));
+		return failed + 1;
+	}
+
+	ret = fi_ep_bind(pair->ep[0], &cntr->fid, FI_SEND);
+	if (ret != -FI_EINVAL) {
+		printf("bind of a second send counter: %s\n", fi_strerror(-ret));
+		failed++;
+	}
+
+	ret = fi_close(&cntr->fid);
+	if (ret) {
+		printf("close after a rejected bind: %s\n", fi_strerror(-ret));
+		failed++;
+	}
+	return failed;
+}
+
+/*
+ * add and set on an unbound counter, including values that need all
+ * 64 bits, and waits whose threshold is already met or never will be.
+ */
+static int check_add_set(void)
+{
+	const uint64_t big = 1ULL << 32;
+	struct fid_cntr *cntr;
+	uint64_t val;
+	int ret, failed = 0;
+
+	ret = ct_cntr_open(&cntr);
+	if (ret) {
+		printf("cntr open: %s\n", fi_strerror(-ret));
+		return 1;
+	}
+
+	fi_cntr_set(cntr, 10);
+	fi_cntr_add(cntr, 5);
+	val = fi_cntr_read(cntr);
+	if (val != 15) {
+		printf("set(10) + add(5) read %llu\n", (unsigned long long) val);
+		failed++;
+	}
+
+	fi_cntr_set(cntr, INT32_MAX);
+	fi_cntr_add(cntr, 2);
+	val = fi_cntr_read(cntr);
+	if (val != (uint64_t) INT32_MAX + 2) {
+		printf("set(2^31 - 1) + add(2) read %llu\n",
+		       (unsigned long long) val);
+		failed++;
+	}
+
+	fi_cntr_set(cntr, big + 5);
+	fi_cntr_add(cntr, big);
+	val = fi_cntr_read(cntr);
+	if (val != 2 * big + 5) {
+		printf("set(2^32 + 5) + add(2^32) read %llu\n",
+		       (unsigned long long) val);
+		failed++;
+	}
+
+	ret = fi_cntr_wait(cntr, 2 * big, 0);
+	if (ret) {
+		printf("wait(2^33) at 2^33 + 5: %s\n", fi_strerror(-ret));
+		failed++;
+	}
+
+	ret = fi_cntr_wait(cntr, 3 * big, 0);
+	if (ret != -FI_ETIMEDOUT) {
+		printf("wait(3 * 2^32) at 2^33 + 5: %s\n", fi_strerror(-ret));
+		failed++;
+	}
+
+	if (fi_cntr_readerr(cntr)) {
+		printf("add/set moved the error count\n");
+		failed++;
+	}
+
+	ret = fi_close(&cntr->fid);
+	if (ret) {
+		printf("close of an unbound counter: %s\n", fi_strerror(-ret));
+		failed++;
+	}
+	return failed;
+}
+
+/* A bound counter can only be closed once its endpoint is closed */
+static int check_busy_close(void)
+{
+	struct ct_pair *pair = &pairs[CT_CQ];
+	int ret;
+
+	ret = fi_close(&pair->tx_cntr->fid);
+	if (ret != -FI_EBUSY) {
+		printf("close of a bound counter: %s\n", fi_strerror(-ret));
+		return 1;
+	}
+
+	ret = fi_close(&pair->ep[0]->fid);
+	if (ret) {
+		printf("ep close: %s\n", fi_strerror(-ret));
+		return 1;
+	}
+	pair->ep[0] = NULL;
+
+	ret = fi_close(&pair->tx_cntr->fid);
+	if (ret) {
+		printf("close after the ep closed: %s\n", fi_strerror(-ret));
+		return 1;
+	}
+	pair->tx_cntr = NULL;
+	return 0;
+}
+
+static int ct_ep_open(struct fid_ep **ep, struct fid_cq **cq,
+		      struct fid_cntr *cntr, uint64_t cntr_flags,
+		      uint64_t cq_flags)
+{
+	struct fi_cq_attr cq_attr;
+	int ret;
+
+	memset(&cq_attr, 0, sizeof cq_attr);
+	cq_attr.format = FI_CQ_FORMAT_CONTEXT;
+	cq_attr.wait_obj = FI_WAIT_NONE;
+	ret = fi_cq_open(domain, &cq_attr, cq, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_endpoint(domain, info, ep, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_ep_bind(*ep, &av->fid, 0);
+	if (ret)
+		return ret;
+
+	ret = fi_ep_bind(*ep, &(*cq)->fid, FI_TRANSMIT | FI_RECV | cq_flags);
+	if (ret)
+		return ret;
+
+	ret = fi_ep_bind(*ep, &cntr->fid, cntr_flags);
+	if (ret)
+		return ret;
+
+	return fi_enable(*ep);
+}
+
+static int ct_pair_open(struct ct_pair *pair, uint64_t cq_flags)
+{
+	char name[64];
+	size_t len = sizeof name;
+	int ret;
+
+	ret = ct_cntr_open(&pair->tx_cntr);
+	if (ret)
+		return ret;
+
+	ret = ct_cntr_open(&pair->rx_cntr);
+	if (ret)
+		return ret;
+
+	ret = ct_ep_open(&pair->ep[0], &pair->cq[0], pair->tx_cntr, FI_SEND,
+			 cq_flags);
+	if (ret)
+		return ret;
+
+	ret = ct_ep_open(&pair->ep[1], &pair->cq[1], pair->rx_cntr, FI_RECV,
+			 cq_flags);
+	if (ret)
+		return ret;
+
+	ret = fi_getname(&pair->ep[1]->fid, name, &len);
+	if (ret)
+		return ret;
+
+	ret = fi_av_insert(av, name, 1, &pair->peer, 0, NULL);
+	return ret == 1 ? 0 : -FI_EINVAL;
+}
+
+static int ct_init(void)
+{
+	struct fi_info *hints;
+	struct fi_av_attr av_attr;
+	int ret;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return -FI_ENOMEM;
+
+	hints->fabric_attr->prov_name = strdup("rxm");
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG;
+	hints->mode = FI_CONTEXT | FI_LOCAL_MR;
+
+	ret = fi_getinfo(FI_VERSION(1, 4), NULL, NULL, 0, hints, &info);
+	fi_freeinfo(hints);
+	if (ret)
+		return ret;
+
+	ret = fi_fabric(info->fabric_attr, &fabric, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_domain(fabric, info, &domain, NULL);
+	if (ret)
+		return ret;
+
+	memset(&av_attr, 0, sizeof av_attr);
+	av_attr.type = FI_AV_TABLE;
+	ret = fi_av_open(domain, &av_attr, &av, NULL);
+	if (ret)
+		return ret;
+
+	ret = ct_pair_open(&pairs[CT_CQ], 0);
+	if (ret)
+		return ret;
+
+	return ct_pair_open(&pairs[CT_CNTR_ONLY], FI_SELECTIVE_COMPLETION);
+}
+
+static void ct_fini(void)
+{
+	struct ct_pair *pair;
+	int i, j;
+
+	for (i = 0; i < CT_PAIRS; i++) {
+		pair = &pairs[i];
+		for (j = 0; j < 2; j++) {
+			if (pair->ep[j])
+				fi_close(&pair->ep[j]->fid);
+		}
+		for (j = 0; j < 2; j++) {
+			if (pair->cq[j])
+				fi_close(&pair->cq[j]->fid);
+		}
+		if (pair->tx_cntr)
+			fi_close(&pair->tx_cntr->fid);
+		if (pair->rx_cntr)
+			fi_close(&pair->rx_cntr->fid);
+	}
+	if (av)
+		fi_close(&av->fid);
+	if (domain)
+		fi_close(&domain->fid);
+	if (fabric)
+		fi_close(&fabric->fid);
+	fi_freeinfo(info);
+}
+
+int main(int argc, char **argv)
+{
+	int ret, failed = 0;
+
+	ret = ct_init();
+	if (ret) {
+		printf("rxm provider setup failed: %s\n", fi_strerror(-ret));
+		ct_fini();
+		return ret == -FI_ENODATA ? CT_SKIP : EXIT_FAILURE;
+	}
+
+	failed += check_completion(CT_CQ);
+	failed += check_completion(CT_CNTR_ONLY);
+	failed += check_timeout();
+	failed += check_error();
+	failed += check_dup_bind();
+	failed += check_add_set();
+	failed += check_busy_close();
+	ct_fini();
+
+	printf("%d checks failed\n", failed);
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
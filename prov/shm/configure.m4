@@ -0,0 +1,40 @@
+dnl Configury specific to the libfabric shm provider
+
+dnl Called to configure this provider
+dnl
+dnl Arguments:
+dnl
+dnl $1: action if configured successfully
+dnl $2: action if not configured successfully
+dnl
+AC_DEFUN([FI_SHM_CONFIGURE],[
+	# Determine if we can support the shm provider
+	shm_happy=0
+	shm_rt_happy=0
+	AS_IF([test x"$enable_shm" != x"no"],
+	      [# process_vm_readv/writev are Linux specific
+	       AC_CHECK_FUNCS([process_vm_readv process_vm_writev],
+			      [shm_happy=1],
+			      [shm_happy=0])
+
+	       # check if shm_open is already present
+	       AC_CHECK_FUNC([shm_open],
+			     [shm_rt_happy=1],
+			     [shm_rt_happy=0])
+
+	       # look for shm_open in librt if not already present
+	       AS_IF([test $shm_rt_happy -eq 0],
+		     [FI_CHECK_PACKAGE([shm_rt],
+				[sys/mman.h],
+				[rt],
+				[shm_open],
+				[],
+				[],
+				[],
+				[shm_rt_happy=1],
+				[shm_rt_happy=0])])
+	      ])
+
+	AS_IF([test $shm_happy -eq 1 && \
+	       test $shm_rt_happy -eq 1], [$1], [$2])
+])
@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <pthread.h>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_eq.h>
+#include <rdma/fi_errno.h>
+#include <rdma/fi_rma.h>
+#include <rdma/fi_tagged.h>
+
+#include <fi.h>
+#include <fi_enosys.h>
+#include <fi_iov.h>
+#include <fi_list.h>
+#include <fi_mem.h>
+#include <fi_proto.h>
+#include <fi_rbuf.h>
+#include <fi_util.h>
+
+#ifndef _SMR_H_
+#define _SMR_H_
+
+
+#define SMR_MAJOR_VERSION 1
+#define SMR_MINOR_VERSION 0
+
+#define SMR_VERSION	1
+#define SMR_NAME_SIZE	32
+#define SMR_IOV_LIMIT	4
+#define SMR_CMD_SIZE	256	/* multiple of 64-byte cache line */
+#define SMR_CMD_HDR_SIZE 64
+#define SMR_MSG_DATA_LEN (SMR_CMD_SIZE - SMR_CMD_HDR_SIZE)
+
+#define SMR_NO_COMPLETION (1ULL << 62)
+
+/* Orders the region header before its version is published */
+#ifdef HAVE_ATOMICS
+#define smr_release_fence()	atomic_thread_fence(memory_order_release)
+#define smr_acquire_fence()	atomic_thread_fence(memory_order_acquire)
+#else
+#define smr_release_fence()	__sync_synchronize()
+#define smr_acquire_fence()	__sync_synchronize()
+#endif
+
+extern struct fi_provider smr_prov;
+extern struct util_prov smr_util_prov;
+extern struct fi_info smr_info;
+
+
+/*
+ * Shared memory region, one per endpoint.  The region is named after
+ * the endpoint address, so that a peer can map it given only the address.
+ * Peers append commands to the region's command queue under the region
+ * lock; the owning endpoint drains the queue as part of progress.
+ */
+enum {
+	smr_src_inline,	/* command data carries the payload */
+	smr_src_iov,	/* payload is read from the peer's iov */
+};
+
+struct smr_cmd_hdr {
+	struct ofi_op_hdr	op;
+	int32_t			pid;
+	uint8_t			iov_count;
+	uint8_t			rma_count;
+	uint8_t			resv[2];
+	/* address of the tx entry status word in the sender's process */
+	uint64_t		resp;
+	uint64_t		resv2[2];
+};
+
+struct smr_cmd {
+	struct smr_cmd_hdr	hdr;
+	union {
+		uint8_t		msg[SMR_MSG_DATA_LEN];
+		struct {
+			struct iovec		iov[SMR_IOV_LIMIT];
+			struct ofi_rma_iov	rma_iov[SMR_IOV_LIMIT];
+		};
+	};
+};
+
+OFI_DECLARE_CIRQUE(struct smr_cmd, smr_cmd_queue);
+
+struct smr_region {
+	uint8_t			version;
+	uint8_t			resv[3];
+	int32_t			pid;
+	size_t			total_size;
+	size_t			cmd_queue_offset;
+	pthread_spinlock_t	lock;	/* PTHREAD_PROCESS_SHARED */
+};
+
+static inline struct smr_cmd_queue *smr_cmd_queue(struct smr_region *region)
+{
+	return (struct smr_cmd_queue *) ((char *) region +
+					 region->cmd_queue_offset);
+}
+
+int smr_region_create(const char *name, size_t cmd_cnt,
+		      struct util_shm *shm, struct smr_region **region);
+void smr_region_free(struct util_shm *shm);
+int smr_region_map(const char *name, struct util_shm *shm,
+		   struct smr_region **region);
+void smr_region_unmap(struct util_shm *shm);
+
+
+int smr_check_info(struct fi_info *info);
+int smr_fabric(struct fi_fabric_attr *attr, struct fid_fabric **fabric,
+		void *context);
+
+struct smr_domain {
+	struct util_domain	util_domain;
+	struct ofi_util_mr	*mr_heap;
+	fastlock_t		mr_lock;
+};
+
+int smr_domain_open(struct fid_fabric *fabric, struct fi_info *info,
+		struct fid_domain **dom, void *context);
+int smr_mr_verify(struct smr_domain *domain, size_t len, uintptr_t *addr,
+		  uint64_t key, uint64_t access);
+
+
+struct smr_peer {
+	struct util_shm		shm;
+	struct smr_region	*region;
+};
+
+struct smr_av {
+	struct util_av		util_av;
+	struct smr_peer		*peers;
+};
+
+int smr_av_open(struct fid_domain *domain, struct fi_av_attr *attr,
+		struct fid_av **av, void *context);
+
+static inline struct smr_region *smr_peer_region(struct util_av *av,
+						 fi_addr_t addr)
+{
+	if (addr >= av->count)
+		return NULL;
+	return container_of(av, struct smr_av, util_av)->peers[addr].region;
+}
+
+
+int smr_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
+		struct fid_cq **cq, void *context);
+
+
+#define SMR_STATUS_BUSY	1
+#define SMR_CLOSE_TIMEOUT 1000	/* ms to wait for peer responses */
+
+struct smr_tx_entry {
+	struct dlist_entry	entry;
+	void			*context;
+	uint64_t		flags;
+	size_t			size;
+	/* written by the peer through process_vm_writev */
+	volatile int64_t	status;
+};
+DECLARE_FREESTACK(struct smr_tx_entry, smr_tx_fs);
+
+struct smr_rx_entry {
+	struct dlist_entry	entry;
+	void			*context;
+	fi_addr_t		addr;
+	uint64_t		tag;
+	uint64_t		ignore;
+	uint64_t		flags;
+	struct iovec		iov[SMR_IOV_LIMIT];
+	uint8_t			iov_count;
+};
+DECLARE_FREESTACK(struct smr_rx_entry, smr_rx_fs);
+
+struct smr_unexp_msg {
+	struct dlist_entry	entry;
+	struct smr_cmd		cmd;
+};
+
+struct smr_ep {
+	struct util_ep		util_ep;
+	fastlock_t		lock;
+	char			name[SMR_NAME_SIZE];
+	struct util_shm		shm;
+	struct smr_region	*region;
+
+	struct smr_tx_fs	*tx_fs;
+	struct dlist_entry	tx_pend_list;
+
+	struct smr_rx_fs	*rx_fs;
+	struct dlist_entry	recv_list;
+	struct dlist_entry	trecv_list;
+	struct dlist_entry	unexp_list;
+	struct dlist_entry	unexp_tagged_list;
+};
+
+extern struct fi_ops_msg smr_msg_ops;
+extern struct fi_ops_tagged smr_tagged_ops;
+extern struct fi_ops_rma smr_rma_ops;
+
+int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
+		 struct fid_ep **ep, void *context);
+void smr_ep_progress(struct util_ep *util_ep);
+
+void smr_init_cmd(struct smr_cmd *cmd, uint32_t op, uint64_t tag,
+		  uint64_t data, uint64_t op_flags);
+ssize_t smr_post_cmd(struct smr_ep *ep, fi_addr_t addr, struct smr_cmd *cmd,
+		     const struct iovec *iov, size_t iov_count,
+		     void *context, uint64_t flags);
+ssize_t smr_generic_recv(struct smr_ep *ep, const struct iovec *iov,
+			 size_t iov_count, uint64_t tag, uint64_t ignore,
+			 void *context, uint32_t op);
+
+int smr_complete_tx(struct smr_ep *ep, void *context, uint64_t flags,
+		    int err);
+int smr_complete_rx(struct smr_ep *ep, void *context, uint64_t flags,
+		    size_t len, uint64_t tag, uint64_t data, int err);
+
+static inline uint64_t smr_tx_comp_flags(uint32_t op)
+{
+	switch (op) {
+	case ofi_op_msg:
+		return FI_MSG | FI_SEND;
+	case ofi_op_tagged:
+		return FI_TAGGED | FI_SEND;
+	case ofi_op_read_req:
+		return FI_RMA | FI_READ;
+	default:
+		return FI_RMA | FI_WRITE;
+	}
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "smr.h"
+
+#define SMR_TX_CAPS (FI_MSG | FI_TAGGED | FI_SEND | FI_RMA | FI_READ | FI_WRITE)
+#define SMR_RX_CAPS (FI_MSG | FI_TAGGED | FI_RECV | FI_RMA | \
+		     FI_REMOTE_READ | FI_REMOTE_WRITE)
+
+struct fi_tx_attr smr_tx_attr = {
+	.caps = SMR_TX_CAPS,
+	.comp_order = FI_ORDER_STRICT,
+	.msg_order = FI_ORDER_SAS,
+	.inject_size = SMR_MSG_DATA_LEN,
+	.size = 1024,
+	.iov_limit = SMR_IOV_LIMIT,
+	.rma_iov_limit = SMR_IOV_LIMIT
+};
+
+struct fi_rx_attr smr_rx_attr = {
+	.caps = SMR_RX_CAPS,
+	.comp_order = FI_ORDER_STRICT,
+	.msg_order = FI_ORDER_SAS,
+	.total_buffered_recv = 0,
+	.size = 1024,
+	.iov_limit = SMR_IOV_LIMIT
+};
+
+struct fi_ep_attr smr_ep_attr = {
+	.type = FI_EP_RDM,
+	.protocol = FI_PROTO_SHM,
+	.protocol_version = SMR_VERSION,
+	.max_msg_size = SIZE_MAX,
+	.max_order_raw_size = SIZE_MAX,
+	.max_order_waw_size = SIZE_MAX,
+	.max_order_war_size = SIZE_MAX,
+	.mem_tag_format = FI_TAG_GENERIC,
+	.tx_ctx_cnt = 1,
+	.rx_ctx_cnt = 1
+};
+
+struct fi_domain_attr smr_domain_attr = {
+	.name = "shm",
+	.threading = FI_THREAD_SAFE,
+	.control_progress = FI_PROGRESS_MANUAL,
+	.data_progress = FI_PROGRESS_MANUAL,
+	.resource_mgmt = FI_RM_ENABLED,
+	.av_type = FI_AV_UNSPEC,
+	.mr_mode = FI_MR_SCALABLE,
+	.mr_key_size = sizeof(uint64_t),
+	.cq_data_size = sizeof(uint64_t),
+	.cq_cnt = (1 << 10),
+	.ep_cnt = (1 << 10),
+	.tx_ctx_cnt = (1 << 10),
+	.rx_ctx_cnt = (1 << 10),
+	.max_ep_tx_ctx = 1,
+	.max_ep_rx_ctx = 1
+};
+
+struct fi_fabric_attr smr_fabric_attr = {
+	.name = "shm",
+	.prov_version = FI_VERSION(SMR_MAJOR_VERSION, SMR_MINOR_VERSION)
+};
+
+struct fi_info smr_info = {
+	.caps = SMR_TX_CAPS | SMR_RX_CAPS,
+	.addr_format = FI_FORMAT_UNSPEC,
+	.tx_attr = &smr_tx_attr,
+	.rx_attr = &smr_rx_attr,
+	.ep_attr = &smr_ep_attr,
+	.domain_attr = &smr_domain_attr,
+	.fabric_attr = &smr_fabric_attr
+};
+
+struct util_prov smr_util_prov = {
+	.prov = &smr_prov,
+	.info = &smr_info,
+	.flags = 0,
+};
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "smr.h"
+
+
+static int smr_av_insert_addr(struct smr_av *av, const char *name,
+			      fi_addr_t *fi_addr)
+{
+	struct smr_peer *peer;
+	int ret, index = -1;
+
+	if (!memchr(name, '\0', SMR_NAME_SIZE)) {
+		FI_WARN(&smr_prov, FI_LOG_AV, "invalid address\n");
+		ret = -FI_EADDRNOTAVAIL;
+		goto out;
+	}
+
+	ret = ofi_av_insert_addr(&av->util_av, name, &index);
+	if (ret)
+		goto out;
+
+	peer = &av->peers[index];
+	ret = smr_region_map(name, &peer->shm, &peer->region);
+	if (ret) {
+		ofi_av_remove_addr(&av->util_av, index);
+		index = -1;
+	}
+out:
+	if (fi_addr)
+		*fi_addr = !ret ? index : FI_ADDR_NOTAVAIL;
+	return ret;
+}
+
+static int smr_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
+			 fi_addr_t *fi_addr, uint64_t flags, void *context)
+{
+	struct smr_av *av;
+	int i, ret, success_cnt = 0;
+
+	av = container_of(av_fid, struct smr_av, util_av.av_fid);
+	if (flags) {
+		FI_WARN(&smr_prov, FI_LOG_AV, "invalid flags\n");
+		return -FI_EBADFLAGS;
+	}
+
+	FI_DBG(&smr_prov, FI_LOG_AV, "inserting %zu addresses\n", count);
+	for (i = 0; i < count; i++) {
+		ret = smr_av_insert_addr(av, (const char *) addr +
+					 i * SMR_NAME_SIZE,
+					 fi_addr ? &fi_addr[i] : NULL);
+		if (!ret)
+			success_cnt++;
+		else if (av->util_av.eq)
+			ofi_av_write_event(&av->util_av, i, -ret, context);
+	}
+
+	FI_DBG(&smr_prov, FI_LOG_AV, "%d addresses successful\n", success_cnt);
+	if (av->util_av.eq) {
+		ofi_av_write_event(&av->util_av, success_cnt, 0, context);
+		ret = 0;
+	} else {
+		ret = success_cnt;
+	}
+	return ret;
+}
+
+static int smr_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr,
+			 size_t count, uint64_t flags)
+{
+	struct smr_av *av;
+	int i, index, ret;
+
+	av = container_of(av_fid, struct smr_av, util_av.av_fid);
+	if (flags) {
+		FI_WARN(&smr_prov, FI_LOG_AV, "invalid flags\n");
+		return -FI_EBADFLAGS;
+	}
+
+	for (i = count - 1; i >= 0; i--) {
+		index = (int) fi_addr[i];
+		if (index < 0 || index >= av->util_av.count ||
+		    !av->peers[index].region) {
+			FI_WARN(&smr_prov, FI_LOG_AV,
+				"removal of fi_addr %d failed\n", index);
+			continue;
+		}
+
+		smr_region_unmap(&av->peers[index].shm);
+		av->peers[index].region = NULL;
+		ret = ofi_av_remove_addr(&av->util_av, index);
+		if (ret) {
+			FI_WARN(&smr_prov, FI_LOG_AV,
+				"removal of fi_addr %d failed\n", index);
+		}
+	}
+	return 0;
+}
+
+static int smr_av_lookup(struct fid_av *av_fid, fi_addr_t fi_addr, void *addr,
+			 size_t *addrlen)
+{
+	struct smr_av *av;
+	int index;
+
+	av = container_of(av_fid, struct smr_av, util_av.av_fid);
+	index = (int) fi_addr;
+	if (index < 0 || index >= av->util_av.count ||
+	    !av->peers[index].region) {
+		FI_WARN(&smr_prov, FI_LOG_AV, "unknown address\n");
+		return -FI_EINVAL;
+	}
+
+	memcpy(addr, ofi_av_get_addr(&av->util_av, index),
+	       MIN(*addrlen, SMR_NAME_SIZE));
+	*addrlen = SMR_NAME_SIZE;
+	return 0;
+}
+
+static const char *smr_av_straddr(struct fid_av *av, const void *addr,
+				  char *buf, size_t *len)
+{
+	size_t size;
+
+	size = strnlen(addr, SMR_NAME_SIZE);
+	memcpy(buf, addr, MIN(*len, size));
+	if (*len > size)
+		buf[size] = '\0';
+	*len = size + 1;
+	return buf;
+}
+
+static struct fi_ops_av smr_av_ops = {
+	.size = sizeof(struct fi_ops_av),
+	.insert = smr_av_insert,
+	.insertsvc = fi_no_av_insertsvc,
+	.insertsym = fi_no_av_insertsym,
+	.remove = smr_av_remove,
+	.lookup = smr_av_lookup,
+	.straddr = smr_av_straddr,
+};
+
+static int smr_av_close(struct fid *fid)
+{
+	struct smr_av *av;
+	int i, ret;
+
+	av = container_of(fid, struct smr_av, util_av.av_fid.fid);
+	ret = ofi_av_close(&av->util_av);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < av->util_av.count; i++) {
+		if (av->peers[i].region)
+			smr_region_unmap(&av->peers[i].shm);
+	}
+	free(av->peers);
+	free(av);
+	return 0;
+}
+
+static struct fi_ops smr_av_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = smr_av_close,
+	.bind = ofi_av_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+int smr_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
+		struct fid_av **av_fid, void *context)
+{
+	struct util_domain *domain;
+	struct util_av_attr util_attr;
+	struct smr_av *av;
+	int ret;
+
+	domain = container_of(domain_fid, struct util_domain, domain_fid);
+	util_attr.addrlen = SMR_NAME_SIZE;
+	util_attr.flags = 0;
+
+	if (attr->type == FI_AV_UNSPEC)
+		attr->type = FI_AV_TABLE;
+
+	av = calloc(1, sizeof(*av));
+	if (!av)
+		return -FI_ENOMEM;
+
+	ret = ofi_av_init(domain, attr, &util_attr, &av->util_av, context);
+	if (ret)
+		goto err1;
+
+	av->peers = calloc(av->util_av.count, sizeof(*av->peers));
+	if (!av->peers) {
+		ret = -FI_ENOMEM;
+		goto err2;
+	}
+
+	*av_fid = &av->util_av.av_fid;
+	(*av_fid)->fid.ops = &smr_av_fi_ops;
+	(*av_fid)->ops = &smr_av_ops;
+	return 0;
+err2:
+	ofi_av_close(&av->util_av);
+err1:
+	free(av);
+	return ret;
+}
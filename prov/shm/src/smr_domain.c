@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "smr.h"
+
+
+static struct fi_ops_domain smr_domain_ops = {
+	.size = sizeof(struct fi_ops_domain),
+	.av_open = smr_av_open,
+	.cq_open = smr_cq_open,
+	.endpoint = smr_endpoint,
+	.scalable_ep = fi_no_scalable_ep,
+	.cntr_open = fi_no_cntr_open,
+	.poll_open = fi_poll_create,
+	.stx_ctx = fi_no_stx_context,
+	.srx_ctx = fi_no_srx_context,
+};
+
+static int smr_domain_close(fid_t fid)
+{
+	int ret;
+	struct smr_domain *domain;
+
+	domain = container_of(fid, struct smr_domain, util_domain.domain_fid.fid);
+	ret = ofi_domain_close(&domain->util_domain);
+	if (ret)
+		return ret;
+
+	ofi_mr_close(domain->mr_heap);
+	fastlock_destroy(&domain->mr_lock);
+	free(domain);
+	return 0;
+}
+
+static struct fi_ops smr_domain_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = smr_domain_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+struct smr_mr {
+	struct fid_mr		mr_fid;
+	struct smr_domain	*domain;
+	uint64_t		key;
+};
+
+static int smr_mr_close(struct fid *fid)
+{
+	struct smr_domain *domain;
+	struct smr_mr *mr;
+	int ret;
+
+	mr = container_of(fid, struct smr_mr, mr_fid.fid);
+	domain = mr->domain;
+
+	fastlock_acquire(&domain->mr_lock);
+	ret = ofi_mr_erase(domain->mr_heap, mr->key);
+	fastlock_release(&domain->mr_lock);
+	if (ret)
+		return ret;
+
+	atomic_dec(&domain->util_domain.ref);
+	free(mr);
+	return 0;
+}
+
+static struct fi_ops smr_mr_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = smr_mr_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+static int smr_mr_regattr(struct fid *fid, const struct fi_mr_attr *attr,
+			  uint64_t flags, struct fid_mr **mr_fid)
+{
+	struct smr_domain *domain;
+	struct smr_mr *mr;
+	uint64_t key;
+	int ret;
+
+	if (fid->fclass != FI_CLASS_DOMAIN || !attr || attr->iov_count <= 0)
+		return -FI_EINVAL;
+
+	domain = container_of(fid, struct smr_domain,
+			      util_domain.domain_fid.fid);
+	mr = calloc(1, sizeof(*mr));
+	if (!mr)
+		return -FI_ENOMEM;
+
+	mr->mr_fid.fid.fclass = FI_CLASS_MR;
+	mr->mr_fid.fid.context = attr->context;
+	mr->mr_fid.fid.ops = &smr_mr_fi_ops;
+	mr->domain = domain;
+
+	fastlock_acquire(&domain->mr_lock);
+	ret = ofi_mr_insert(domain->mr_heap, attr, &key, mr);
+	fastlock_release(&domain->mr_lock);
+	if (ret) {
+		free(mr);
+		return ret;
+	}
+
+	mr->mr_fid.key = mr->key = key;
+	mr->mr_fid.mem_desc = (void *) (uintptr_t) key;
+	*mr_fid = &mr->mr_fid;
+	atomic_inc(&domain->util_domain.ref);
+	return 0;
+}
+
+static int smr_mr_regv(struct fid *fid, const struct iovec *iov,
+		       size_t count, uint64_t access,
+		       uint64_t offset, uint64_t requested_key,
+		       uint64_t flags, struct fid_mr **mr, void *context)
+{
+	struct fi_mr_attr attr;
+
+	attr.mr_iov = iov;
+	attr.iov_count = count;
+	attr.access = access;
+	attr.offset = offset;
+	attr.requested_key = requested_key;
+	attr.context = context;
+	return smr_mr_regattr(fid, &attr, flags, mr);
+}
+
+static int smr_mr_reg(struct fid *fid, const void *buf, size_t len,
+		      uint64_t access, uint64_t offset, uint64_t requested_key,
+		      uint64_t flags, struct fid_mr **mr, void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return smr_mr_regv(fid, &iov, 1, access, offset, requested_key,
+			   flags, mr, context);
+}
+
+static struct fi_ops_mr smr_mr_ops = {
+	.size = sizeof(struct fi_ops_mr),
+	.reg = smr_mr_reg,
+	.regv = smr_mr_regv,
+	.regattr = smr_mr_regattr,
+};
+
+int smr_mr_verify(struct smr_domain *domain, size_t len, uintptr_t *addr,
+		  uint64_t key, uint64_t access)
+{
+	int ret;
+
+	fastlock_acquire(&domain->mr_lock);
+	ret = ofi_mr_retrieve_and_verify(domain->mr_heap, len, addr, key,
+					 access, NULL);
+	fastlock_release(&domain->mr_lock);
+	return ret;
+}
+
+int smr_domain_open(struct fid_fabric *fabric, struct fi_info *info,
+		struct fid_domain **domain_fid, void *context)
+{
+	int ret;
+	struct smr_domain *domain;
+
+	ret = smr_check_info(info);
+	if (ret)
+		return ret;
+
+	domain = calloc(1, sizeof(*domain));
+	if (!domain)
+		return -FI_ENOMEM;
+
+	ret = ofi_domain_init(fabric, info, &domain->util_domain, context);
+	if (ret)
+		goto err1;
+
+	ret = ofi_mr_init(&smr_prov, info->domain_attr->mr_mode,
+			  &domain->mr_heap);
+	if (ret)
+		goto err2;
+	fastlock_init(&domain->mr_lock);
+
+	*domain_fid = &domain->util_domain.domain_fid;
+	(*domain_fid)->fid.ops = &smr_domain_fi_ops;
+	(*domain_fid)->ops = &smr_domain_ops;
+	(*domain_fid)->mr = &smr_mr_ops;
+	return 0;
+err2:
+	ofi_domain_close(&domain->util_domain);
+err1:
+	free(domain);
+	return ret;
+}
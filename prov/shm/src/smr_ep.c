@@ -0,0 +1,544 @@
+/*
+ * Copyright (c) 2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include "smr.h"
+
+
+static pthread_mutex_t smr_ep_lock = PTHREAD_MUTEX_INITIALIZER;
+static int smr_ep_idx;
+
+static int smr_getname(fid_t fid, void *addr, size_t *addrlen)
+{
+	struct smr_ep *ep;
+	int ret = 0;
+
+	ep = container_of(fid, struct smr_ep, util_ep.ep_fid.fid);
+	if (*addrlen < SMR_NAME_SIZE)
+		ret = -FI_ETOOSMALL;
+	else
+		memcpy(addr, ep->name, SMR_NAME_SIZE);
+	*addrlen = SMR_NAME_SIZE;
+	return ret;
+}
+
+static struct fi_ops_cm smr_cm_ops = {
+	.size = sizeof(struct fi_ops_cm),
+	.setname = fi_no_setname,
+	.getname = smr_getname,
+	.getpeer = fi_no_getpeer,
+	.connect = fi_no_connect,
+	.listen = fi_no_listen,
+	.accept = fi_no_accept,
+	.reject = fi_no_reject,
+	.shutdown = fi_no_shutdown,
+};
+
+static int smr_getopt(fid_t fid, int level, int optname,
+		      void *optval, size_t *optlen)
+{
+	return -FI_ENOPROTOOPT;
+}
+
+static int smr_setopt(fid_t fid, int level, int optname,
+		      const void *optval, size_t optlen)
+{
+	return -FI_ENOPROTOOPT;
+}
+
+static struct fi_ops_ep smr_ep_ops = {
+	.size = sizeof(struct fi_ops_ep),
+	.cancel = fi_no_cancel,
+	.getopt = smr_getopt,
+	.setopt = smr_setopt,
+	.tx_ctx = fi_no_tx_ctx,
+	.rx_ctx = fi_no_rx_ctx,
+	.rx_size_left = fi_no_rx_size_left,
+	.tx_size_left = fi_no_tx_size_left,
+};
+
+int smr_complete_tx(struct smr_ep *ep, void *context, uint64_t flags,
+		    int err)
+{
+	struct util_cq *cq = ep->util_ep.tx_cq;
+	struct util_cq_err_entry *err_entry;
+	struct fi_cq_tagged_entry *comp;
+	int ret = 0;
+
+	fastlock_acquire(&cq->cq_lock);
+	if (ofi_cirque_isfull(cq->cirq)) {
+		FI_DBG(&smr_prov, FI_LOG_CQ, "tx cq is full\n");
+		ofi_stats_inc(&cq->stats, OFI_CQ_STAT_OVERFLOW);
+		ret = -FI_EAGAIN;
+		goto out;
+	}
+
+	comp = ofi_cirque_tail(cq->cirq);
+	if (err) {
+		err_entry = calloc(1, sizeof(*err_entry));
+		if (!err_entry) {
+			ret = -FI_ENOMEM;
+			goto out;
+		}
+		err_entry->err_entry.op_context = context;
+		err_entry->err_entry.flags = flags;
+		err_entry->err_entry.err = err;
+		slist_insert_tail(&err_entry->list_entry, &cq->err_list);
+		comp->flags = UTIL_FLAG_ERROR;
+	} else {
+		comp->op_context = context;
+		comp->flags = flags;
+		comp->len = 0;
+		comp->buf = NULL;
+		comp->data = 0;
+		comp->tag = 0;
+	}
+	ofi_cirque_commit(cq->cirq);
+	if (cq->wait)
+		cq->wait->signal(cq->wait);
+out:
+	fastlock_release(&cq->cq_lock);
+	return ret;
+}
+
+int smr_complete_rx(struct smr_ep *ep, void *context, uint64_t flags,
+		    size_t len, uint64_t tag, uint64_t data, int err)
+{
+	struct util_cq *cq = ep->util_ep.rx_cq;
+	struct util_cq_err_entry *err_entry;
+	struct fi_cq_tagged_entry *comp;
+	int ret = 0;
+
+	fastlock_acquire(&cq->cq_lock);
+	if (ofi_cirque_isfull(cq->cirq)) {
+		FI_DBG(&smr_prov, FI_LOG_CQ, "rx cq is full\n");
+		ofi_stats_inc(&cq->stats, OFI_CQ_STAT_OVERFLOW);
+		ret = -FI_EAGAIN;
+		goto out;
+	}
+
+	comp = ofi_cirque_tail(cq->cirq);
+	if (err) {
+		err_entry = calloc(1, sizeof(*err_entry));
+		if (!err_entry) {
+			ret = -FI_ENOMEM;
+			goto out;
+		}
+		err_entry->err_entry.op_context = context;
+		err_entry->err_entry.flags = flags;
+		err_entry->err_entry.len = len;
+		err_entry->err_entry.tag = tag;
+		err_entry->err_entry.data = data;
+		err_entry->err_entry.err = err;
+		slist_insert_tail(&err_entry->list_entry, &cq->err_list);
+		comp->flags = UTIL_FLAG_ERROR;
+	} else {
+		comp->op_context = context;
+		comp->flags = flags;
+		comp->len = len;
+		comp->buf = NULL;
+		comp->data = data;
+		comp->tag = tag;
+	}
+	ofi_cirque_commit(cq->cirq);
+	if (cq->wait)
+		cq->wait->signal(cq->wait);
+out:
+	fastlock_release(&cq->cq_lock);
+	return ret;
+}
+
+void smr_init_cmd(struct smr_cmd *cmd, uint32_t op, uint64_t tag,
+		  uint64_t data, uint64_t op_flags)
+{
+	cmd->hdr.op.version = OFI_OP_VERSION;
+	cmd->hdr.op.rx_index = 0;
+	cmd->hdr.op.op = op;
+	cmd->hdr.op.op_data = smr_src_inline;
+	cmd->hdr.op.flags = (op_flags & FI_REMOTE_CQ_DATA) ?
+			    OFI_REMOTE_CQ_DATA : 0;
+	cmd->hdr.op.size = 0;
+	cmd->hdr.op.data = data;
+	cmd->hdr.op.tag = tag;
+	cmd->hdr.pid = getpid();
+	cmd->hdr.iov_count = 0;
+	cmd->hdr.rma_count = 0;
+	cmd->hdr.resp = 0;
+}
+
+/*
+ * Messages that fit in the command are copied inline and complete as soon
+ * as the command is queued.  Larger transfers, and all RMA, only pass the
+ * initiator's iov; the target moves the data with process_vm_readv/writev
+ * and reports back through the tx entry status word.
+ */
+ssize_t smr_post_cmd(struct smr_ep *ep, fi_addr_t addr, struct smr_cmd *cmd,
+		     const struct iovec *iov, size_t iov_count,
+		     void *context, uint64_t flags)
+{
+	struct smr_region *peer;
+	struct smr_cmd_queue *queue;
+	struct smr_tx_entry *tx_entry = NULL;
+	uint64_t comp_flags;
+	ssize_t ret = 0;
+	int i;
+
+	if (iov_count > SMR_IOV_LIMIT)
+		return -FI_EINVAL;
+
+	peer = smr_peer_region(ep->util_ep.av, addr);
+	if (!peer)
+		return -FI_EINVAL;
+
+	comp_flags = smr_tx_comp_flags(cmd->hdr.op.op);
+	cmd->hdr.op.size = ofi_get_iov_len(iov, iov_count);
+
+	fastlock_acquire(&ep->lock);
+	if (!(flags & SMR_NO_COMPLETION) &&
+	    ofi_cirque_isfull(ep->util_ep.tx_cq->cirq)) {
+		ofi_stats_inc(&ep->util_ep.tx_cq->stats, OFI_CQ_STAT_OVERFLOW);
+		ret = -FI_EAGAIN;
+		goto unlock_ep;
+	}
+
+	if ((cmd->hdr.op.op == ofi_op_msg || cmd->hdr.op.op == ofi_op_tagged) &&
+	    cmd->hdr.op.size <= SMR_MSG_DATA_LEN) {
+		cmd->hdr.op.op_data = smr_src_inline;
+		ofi_copy_iov_buf(iov, iov_count, cmd->msg, cmd->hdr.op.size, 0,
+				 OFI_COPY_IOV_TO_BUF);
+	} else {
+		if (freestack_isempty(ep->tx_fs)) {
+			ret = -FI_EAGAIN;
+			goto unlock_ep;
+		}
+		tx_entry = freestack_pop(ep->tx_fs);
+		tx_entry->context = context;
+		tx_entry->flags = comp_flags;
+		tx_entry->size = cmd->hdr.op.size;
+		tx_entry->status = SMR_STATUS_BUSY;
+
+		cmd->hdr.op.op_data = smr_src_iov;
+		cmd->hdr.resp = (uintptr_t) &tx_entry->status;
+		cmd->hdr.iov_count = iov_count;
+		for (i = 0; i < iov_count; i++)
+			cmd->iov[i] = iov[i];
+	}
+
+	pthread_spin_lock(&peer->lock);
+	queue = smr_cmd_queue(peer);
+	if (ofi_cirque_isfull(queue)) {
+		pthread_spin_unlock(&peer->lock);
+		ret = -FI_EAGAIN;
+		goto free_entry;
+	}
+	memcpy(ofi_cirque_tail(queue), cmd, sizeof(*cmd));
+	ofi_cirque_commit(queue);
+	pthread_spin_unlock(&peer->lock);
+
+	if (tx_entry)
+		dlist_insert_tail(&tx_entry->entry, &ep->tx_pend_list);
+	else if (!(flags & SMR_NO_COMPLETION))
+		ret = smr_complete_tx(ep, context, comp_flags, 0);
+	fastlock_release(&ep->lock);
+	return ret;
+
+free_entry:
+	if (tx_entry)
+		freestack_push(ep->tx_fs, tx_entry);
+unlock_ep:
+	fastlock_release(&ep->lock);
+	return ret;
+}
+
+/*
+ * Peers write the status of a send into its tx entry, so the entries must
+ * stay allocated until every peer has responded.
+ */
+static int smr_ep_tx_busy(struct smr_ep *ep)
+{
+	struct smr_tx_entry *tx_entry;
+	struct dlist_entry *item;
+
+	dlist_foreach(&ep->tx_pend_list, item) {
+		tx_entry = container_of(item, struct smr_tx_entry, entry);
+		if (tx_entry->status == SMR_STATUS_BUSY)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Drive progress until every peer has responded to our sends, or give up
+ * after SMR_CLOSE_TIMEOUT if a peer has died or never matches a message.
+ * Returns nonzero if sends are still outstanding.
+ */
+static int smr_ep_drain_tx(struct smr_ep *ep)
+{
+	uint64_t end;
+	int busy;
+
+	end = fi_gettime_ms() + SMR_CLOSE_TIMEOUT;
+	for (;;) {
+		smr_ep_progress(&ep->util_ep);
+
+		fastlock_acquire(&ep->lock);
+		busy = smr_ep_tx_busy(ep);
+		fastlock_release(&ep->lock);
+		if (!busy || fi_gettime_ms() >= end)
+			return busy;
+		sched_yield();
+	}
+}
+
+static int smr_ep_close(struct fid *fid)
+{
+	struct smr_ep *ep;
+	int busy;
+
+	ep = container_of(fid, struct smr_ep, util_ep.ep_fid.fid);
+
+	busy = smr_ep_drain_tx(ep);
+	if (busy) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"closing with sends still awaiting a peer response\n");
+	}
+
+	if (ep->util_ep.rx_cq) {
+		fid_list_remove(&ep->util_ep.rx_cq->ep_list,
+				&ep->util_ep.rx_cq->ep_list_lock,
+				&ep->util_ep.ep_fid.fid);
+		atomic_dec(&ep->util_ep.rx_cq->ref);
+	}
+
+	if (ep->util_ep.tx_cq) {
+		fid_list_remove(&ep->util_ep.tx_cq->ep_list,
+				&ep->util_ep.tx_cq->ep_list_lock,
+				&ep->util_ep.ep_fid.fid);
+		atomic_dec(&ep->util_ep.tx_cq->ref);
+	}
+
+	while (!dlist_empty(&ep->unexp_list)) {
+		struct dlist_entry *entry = ep->unexp_list.next;
+		dlist_remove(entry);
+		free(container_of(entry, struct smr_unexp_msg, entry));
+	}
+	while (!dlist_empty(&ep->unexp_tagged_list)) {
+		struct dlist_entry *entry = ep->unexp_tagged_list.next;
+		dlist_remove(entry);
+		free(container_of(entry, struct smr_unexp_msg, entry));
+	}
+
+	smr_region_free(&ep->shm);
+	/* A peer that responds late still writes into the tx entries, so
+	 * leave them allocated rather than let the write land in reused
+	 * memory. */
+	if (!busy)
+		smr_tx_fs_free(ep->tx_fs);
+	smr_rx_fs_free(ep->rx_fs);
+	fastlock_destroy(&ep->lock);
+	ofi_endpoint_close(&ep->util_ep);
+	free(ep);
+	return 0;
+}
+
+static int smr_ep_bind_cq(struct smr_ep *ep, struct util_cq *cq, uint64_t flags)
+{
+	int ret;
+
+	if (flags & ~(FI_TRANSMIT | FI_RECV)) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"unsupported flags\n");
+		return -FI_EBADFLAGS;
+	}
+
+	if (((flags & FI_TRANSMIT) && ep->util_ep.tx_cq) ||
+	    ((flags & FI_RECV) && ep->util_ep.rx_cq)) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"duplicate CQ binding\n");
+		return -FI_EINVAL;
+	}
+
+	if (flags & FI_TRANSMIT) {
+		ep->util_ep.tx_cq = cq;
+		atomic_inc(&cq->ref);
+	}
+
+	if (flags & FI_RECV) {
+		ep->util_ep.rx_cq = cq;
+		atomic_inc(&cq->ref);
+	}
+
+	/* Both CQs drive progress: tx completions depend on the peer. */
+	ret = fid_list_insert(&cq->ep_list,
+			      &cq->ep_list_lock,
+			      &ep->util_ep.ep_fid.fid);
+	return ret;
+}
+
+static int smr_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
+{
+	struct smr_ep *ep;
+	struct util_av *av;
+	int ret;
+
+	ret = ofi_ep_bind_valid(&smr_prov, bfid, flags);
+	if (ret)
+		return ret;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
+	switch (bfid->fclass) {
+	case FI_CLASS_AV:
+		av = container_of(bfid, struct util_av, av_fid.fid);
+		ret = ofi_ep_bind_av(&ep->util_ep, av);
+		break;
+	case FI_CLASS_CQ:
+		ret = smr_ep_bind_cq(ep, container_of(bfid, struct util_cq,
+						      cq_fid.fid), flags);
+		break;
+	case FI_CLASS_EQ:
+		break;
+	default:
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"invalid fid class\n");
+		ret = -FI_EINVAL;
+		break;
+	}
+	return ret;
+}
+
+static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
+{
+	struct smr_ep *ep;
+
+	ep = container_of(fid, struct smr_ep, util_ep.ep_fid.fid);
+	switch (command) {
+	case FI_ENABLE:
+		if (!ep->util_ep.rx_cq || !ep->util_ep.tx_cq)
+			return -FI_ENOCQ;
+		if (!ep->util_ep.av)
+			return -FI_ENOAV;
+		break;
+	default:
+		return -FI_ENOSYS;
+	}
+	return 0;
+}
+
+static struct fi_ops smr_ep_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = smr_ep_close,
+	.bind = smr_ep_bind,
+	.control = smr_ep_ctrl,
+	.ops_open = fi_no_ops_open,
+};
+
+static int smr_ep_init(struct smr_ep *ep, struct fi_info *info)
+{
+	int ret;
+
+	if (info->src_addr && info->src_addrlen &&
+	    memchr(info->src_addr, '\0', MIN(info->src_addrlen,
+					    SMR_NAME_SIZE))) {
+		strcpy(ep->name, info->src_addr);
+	} else {
+		pthread_mutex_lock(&smr_ep_lock);
+		snprintf(ep->name, SMR_NAME_SIZE, "fi_shm_%d_%d", getpid(),
+			 smr_ep_idx++);
+		pthread_mutex_unlock(&smr_ep_lock);
+	}
+
+	ep->tx_fs = smr_tx_fs_create(info->tx_attr->size);
+	if (!ep->tx_fs)
+		return -FI_ENOMEM;
+
+	ep->rx_fs = smr_rx_fs_create(info->rx_attr->size);
+	if (!ep->rx_fs) {
+		ret = -FI_ENOMEM;
+		goto err1;
+	}
+
+	ret = smr_region_create(ep->name, info->rx_attr->size,
+				&ep->shm, &ep->region);
+	if (ret)
+		goto err2;
+
+	fastlock_init(&ep->lock);
+	dlist_init(&ep->tx_pend_list);
+	dlist_init(&ep->recv_list);
+	dlist_init(&ep->trecv_list);
+	dlist_init(&ep->unexp_list);
+	dlist_init(&ep->unexp_tagged_list);
+	return 0;
+err2:
+	smr_rx_fs_free(ep->rx_fs);
+err1:
+	smr_tx_fs_free(ep->tx_fs);
+	return ret;
+}
+
+int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
+		 struct fid_ep **ep_fid, void *context)
+{
+	struct smr_ep *ep;
+	int ret;
+
+	ep = calloc(1, sizeof(*ep));
+	if (!ep)
+		return -FI_ENOMEM;
+
+	ret = ofi_endpoint_init(domain, &smr_util_prov, info, &ep->util_ep,
+				context, smr_ep_progress, FI_MATCH_EXACT);
+	if (ret)
+		goto err;
+
+	ret = smr_ep_init(ep, info);
+	if (ret) {
+		ofi_endpoint_close(&ep->util_ep);
+		goto err;
+	}
+
+	*ep_fid = &ep->util_ep.ep_fid;
+	(*ep_fid)->fid.ops = &smr_ep_fi_ops;
+	(*ep_fid)->ops = &smr_ep_ops;
+	(*ep_fid)->cm = &smr_cm_ops;
+	(*ep_fid)->msg = &smr_msg_ops;
+	(*ep_fid)->tagged = &smr_tagged_ops;
+	(*ep_fid)->rma = &smr_rma_ops;
+	return 0;
+err:
+	free(ep);
+	return ret;
+}
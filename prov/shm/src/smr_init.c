@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <rdma/fi_errno.h>
+
+#include <prov.h>
+#include "smr.h"
+
+
+int smr_check_info(struct fi_info *info)
+{
+	return fi_check_info(&smr_util_prov, info, FI_MATCH_EXACT);
+}
+
+static int smr_getinfo(uint32_t version, const char *node, const char *service,
+		       uint64_t flags, struct fi_info *hints, struct fi_info **info)
+{
+	/* Addresses are region names, which cannot be resolved from
+	 * node/service.  Only FI_SOURCE, if given, is accepted and ignored. */
+	if ((node || service) && !(flags & FI_SOURCE))
+		return -FI_ENODATA;
+
+	return util_getinfo(&smr_util_prov, version, NULL, NULL, 0,
+			    hints, info);
+}
+
+static void smr_fini(void)
+{
+	/* yawn */
+}
+
+struct fi_provider smr_prov = {
+	.name = "shm",
+	.version = FI_VERSION(SMR_MAJOR_VERSION, SMR_MINOR_VERSION),
+	.fi_version = FI_VERSION(1, 3),
+	.getinfo = smr_getinfo,
+	.fabric = smr_fabric,
+	.cleanup = smr_fini
+};
+
+SHM_INI
+{
+	return &smr_prov;
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "smr.h"
+
+
+static ssize_t smr_generic_send(struct fid_ep *ep_fid, const struct iovec *iov,
+				size_t iov_count, fi_addr_t addr, uint64_t tag,
+				uint64_t data, void *context, uint32_t op,
+				uint64_t op_flags)
+{
+	struct smr_ep *ep;
+	struct smr_cmd cmd;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
+	if ((op_flags & FI_INJECT) &&
+	    ofi_get_iov_len(iov, iov_count) > SMR_MSG_DATA_LEN)
+		return -FI_EINVAL;
+
+	smr_init_cmd(&cmd, op, tag, data, op_flags);
+	return smr_post_cmd(ep, addr, &cmd, iov, iov_count, context, op_flags);
+}
+
+static ssize_t smr_recvmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
+			   uint64_t flags)
+{
+	struct smr_ep *ep;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
+	return smr_generic_recv(ep, msg->msg_iov, msg->iov_count, 0, 0,
+				msg->context, ofi_op_msg);
+}
+
+static ssize_t smr_recvv(struct fid_ep *ep_fid, const struct iovec *iov,
+			 void **desc, size_t count, fi_addr_t src_addr,
+			 void *context)
+{
+	struct smr_ep *ep;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
+	return smr_generic_recv(ep, iov, count, 0, 0, context, ofi_op_msg);
+}
+
+static ssize_t smr_recv(struct fid_ep *ep_fid, void *buf, size_t len,
+			void *desc, fi_addr_t src_addr, void *context)
+{
+	struct smr_ep *ep;
+	struct iovec iov;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
+	iov.iov_base = buf;
+	iov.iov_len = len;
+	return smr_generic_recv(ep, &iov, 1, 0, 0, context, ofi_op_msg);
+}
+
+static ssize_t smr_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
+			   uint64_t flags)
+{
+	return smr_generic_send(ep_fid, msg->msg_iov, msg->iov_count,
+				msg->addr, 0, msg->data, msg->context,
+				ofi_op_msg, flags);
+}
+
+static ssize_t smr_sendv(struct fid_ep *ep_fid, const struct iovec *iov,
+			 void **desc, size_t count, fi_addr_t dest_addr,
+			 void *context)
+{
+	return smr_generic_send(ep_fid, iov, count, dest_addr, 0, 0, context,
+				ofi_op_msg, 0);
+}
+
+static ssize_t smr_send(struct fid_ep *ep_fid, const void *buf, size_t len,
+			void *desc, fi_addr_t dest_addr, void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return smr_generic_send(ep_fid, &iov, 1, dest_addr, 0, 0, context,
+				ofi_op_msg, 0);
+}
+
+static ssize_t smr_inject(struct fid_ep *ep_fid, const void *buf, size_t len,
+			  fi_addr_t dest_addr)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return smr_generic_send(ep_fid, &iov, 1, dest_addr, 0, 0, NULL,
+				ofi_op_msg, FI_INJECT | SMR_NO_COMPLETION);
+}
+
+static ssize_t smr_senddata(struct fid_ep *ep_fid, const void *buf, size_t len,
+			    void *desc, uint64_t data, fi_addr_t dest_addr,
+			    void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return smr_generic_send(ep_fid, &iov, 1, dest_addr, 0, data, context,
+				ofi_op_msg, FI_REMOTE_CQ_DATA);
+}
+
+static ssize_t smr_injectdata(struct fid_ep *ep_fid, const void *buf,
+			      size_t len, uint64_t data, fi_addr_t dest_addr)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return smr_generic_send(ep_fid, &iov, 1, dest_addr, 0, data, NULL,
+				ofi_op_msg, FI_INJECT | FI_REMOTE_CQ_DATA |
+				SMR_NO_COMPLETION);
+}
+
+struct fi_ops_msg smr_msg_ops = {
+	.size = sizeof(struct fi_ops_msg),
+	.recv = smr_recv,
+	.recvv = smr_recvv,
+	.recvmsg = smr_recvmsg,
+	.send = smr_send,
+	.sendv = smr_sendv,
+	.sendmsg = smr_sendmsg,
+	.inject = smr_inject,
+	.senddata = smr_senddata,
+	.injectdata = smr_injectdata,
+};
+
+static ssize_t smr_trecv(struct fid_ep *ep_fid, void *buf, size_t len,
+			 void *desc, fi_addr_t src_addr, uint64_t tag,
+			 uint64_t ignore, void *context)
+{
+	struct smr_ep *ep;
+	struct iovec iov;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
+	iov.iov_base = buf;
+	iov.iov_len = len;
+	return smr_generic_recv(ep, &iov, 1, tag, ignore, context,
+				ofi_op_tagged);
+}
+
+static ssize_t smr_trecvv(struct fid_ep *ep_fid, const struct iovec *iov,
+			  void **desc, size_t count, fi_addr_t src_addr,
+			  uint64_t tag, uint64_t ignore, void *context)
+{
+	struct smr_ep *ep;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
+	return smr_generic_recv(ep, iov, count, tag, ignore, context,
+				ofi_op_tagged);
+}
+
+static ssize_t smr_trecvmsg(struct fid_ep *ep_fid,
+			    const struct fi_msg_tagged *msg, uint64_t flags)
+{
+	struct smr_ep *ep;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
+	return smr_generic_recv(ep, msg->msg_iov, msg->iov_count, msg->tag,
+				msg->ignore, msg->context, ofi_op_tagged);
+}
+
+static ssize_t smr_tsend(struct fid_ep *ep_fid, const void *buf, size_t len,
+			 void *desc, fi_addr_t dest_addr, uint64_t tag,
+			 void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return smr_generic_send(ep_fid, &iov, 1, dest_addr, tag, 0, context,
+				ofi_op_tagged, 0);
+}
+
+static ssize_t smr_tsendv(struct fid_ep *ep_fid, const struct iovec *iov,
+			  void **desc, size_t count, fi_addr_t dest_addr,
+			  uint64_t tag, void *context)
+{
+	return smr_generic_send(ep_fid, iov, count, dest_addr, tag, 0,
+				context, ofi_op_tagged, 0);
+}
+
+static ssize_t smr_tsendmsg(struct fid_ep *ep_fid,
+			    const struct fi_msg_tagged *msg, uint64_t flags)
+{
+	return smr_generic_send(ep_fid, msg->msg_iov, msg->iov_count,
+				msg->addr, msg->tag, msg->data, msg->context,
+				ofi_op_tagged, flags);
+}
+
+static ssize_t smr_tinject(struct fid_ep *ep_fid, const void *buf, size_t len,
+			   fi_addr_t dest_addr, uint64_t tag)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return smr_generic_send(ep_fid, &iov, 1, dest_addr, tag, 0, NULL,
+				ofi_op_tagged, FI_INJECT | SMR_NO_COMPLETION);
+}
+
+static ssize_t smr_tsenddata(struct fid_ep *ep_fid, const void *buf,
+			     size_t len, void *desc, uint64_t data,
+			     fi_addr_t dest_addr, uint64_t tag, void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return smr_generic_send(ep_fid, &iov, 1, dest_addr, tag, data,
+				context, ofi_op_tagged, FI_REMOTE_CQ_DATA);
+}
+
+static ssize_t smr_tinjectdata(struct fid_ep *ep_fid, const void *buf,
+			       size_t len, uint64_t data, fi_addr_t dest_addr,
+			       uint64_t tag)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return smr_generic_send(ep_fid, &iov, 1, dest_addr, tag, data, NULL,
+				ofi_op_tagged, FI_INJECT | FI_REMOTE_CQ_DATA |
+				SMR_NO_COMPLETION);
+}
+
+struct fi_ops_tagged smr_tagged_ops = {
+	.size = sizeof(struct fi_ops_tagged),
+	.recv = smr_trecv,
+	.recvv = smr_trecvv,
+	.recvmsg = smr_trecvmsg,
+	.send = smr_tsend,
+	.sendv = smr_tsendv,
+	.sendmsg = smr_tsendmsg,
+	.inject = smr_tinject,
+	.senddata = smr_tsenddata,
+	.injectdata = smr_tinjectdata,
+};
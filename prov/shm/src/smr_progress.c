@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "smr.h"
+
+
+static void smr_progress_resp(struct smr_ep *ep)
+{
+	struct smr_tx_entry *tx_entry;
+	struct dlist_entry *item, *next;
+	int ret;
+
+	for (item = ep->tx_pend_list.next; item != &ep->tx_pend_list;
+	     item = next) {
+		next = item->next;
+		tx_entry = container_of(item, struct smr_tx_entry, entry);
+		if (tx_entry->status == SMR_STATUS_BUSY)
+			continue;
+
+		ret = smr_complete_tx(ep, tx_entry->context, tx_entry->flags,
+				      (int) -tx_entry->status);
+		if (ret == -FI_EAGAIN)
+			break;
+
+		dlist_remove(item);
+		freestack_push(ep->tx_fs, tx_entry);
+	}
+}
+
+static void smr_send_resp(struct smr_cmd *cmd, int64_t status)
+{
+	struct iovec local, remote;
+
+	local.iov_base = &status;
+	local.iov_len = sizeof(status);
+	remote.iov_base = (void *) (uintptr_t) cmd->hdr.resp;
+	remote.iov_len = sizeof(status);
+
+	if (process_vm_writev(cmd->hdr.pid, &local, 1, &remote, 1, 0) !=
+	    sizeof(status)) {
+		FI_WARN(&smr_prov, FI_LOG_EP_DATA,
+			"unable to post response to pid %d: %s\n",
+			cmd->hdr.pid, strerror(errno));
+	}
+}
+
+/* Returns the number of bytes received or a negative error code. */
+static ssize_t smr_copy_from_peer(struct smr_cmd *cmd, struct iovec *iov,
+				  size_t iov_count)
+{
+	size_t len;
+	ssize_t ret;
+
+	len = MIN(ofi_get_iov_len(iov, iov_count), cmd->hdr.op.size);
+	if (cmd->hdr.op.op_data == smr_src_inline) {
+		if (cmd->hdr.op.size > SMR_MSG_DATA_LEN)
+			return -FI_EINVAL;
+		ofi_copy_iov_buf(iov, iov_count, cmd->msg, len, 0,
+				 OFI_COPY_BUF_TO_IOV);
+		return len;
+	}
+
+	if (cmd->hdr.iov_count > SMR_IOV_LIMIT)
+		return -FI_EINVAL;
+
+	ret = process_vm_readv(cmd->hdr.pid, iov, iov_count,
+			       cmd->iov, cmd->hdr.iov_count, 0);
+	if (ret < 0) {
+		FI_WARN(&smr_prov, FI_LOG_EP_DATA,
+			"process_vm_readv from pid %d failed: %s\n",
+			cmd->hdr.pid, strerror(errno));
+		return -errno;
+	}
+	return ret == (ssize_t) len ? ret : -FI_EIO;
+}
+
+static int smr_progress_msg(struct smr_ep *ep, struct smr_cmd *cmd,
+			    struct smr_rx_entry *rx_entry)
+{
+	uint64_t flags;
+	ssize_t len;
+	int err = 0;
+
+	len = smr_copy_from_peer(cmd, rx_entry->iov, rx_entry->iov_count);
+	if (len < 0) {
+		err = (int) len;
+		len = 0;
+	} else if (len < cmd->hdr.op.size) {
+		err = -FI_ETRUNC;
+	}
+
+	if (cmd->hdr.op.op_data == smr_src_iov)
+		smr_send_resp(cmd, err);
+
+	flags = FI_RECV | (cmd->hdr.op.op == ofi_op_tagged ?
+			   FI_TAGGED : FI_MSG);
+	if (cmd->hdr.op.flags & OFI_REMOTE_CQ_DATA)
+		flags |= FI_REMOTE_CQ_DATA;
+
+	return smr_complete_rx(ep, rx_entry->context, flags, len,
+			       cmd->hdr.op.tag, cmd->hdr.op.data, -err);
+}
+
+static int smr_match_msg(struct dlist_entry *item, const void *arg)
+{
+	return 1;
+}
+
+static int smr_match_tagged(struct dlist_entry *item, const void *arg)
+{
+	struct smr_rx_entry *rx_entry;
+	const uint64_t *tag = arg;
+
+	rx_entry = container_of(item, struct smr_rx_entry, entry);
+	return (rx_entry->tag | rx_entry->ignore) == (*tag | rx_entry->ignore);
+}
+
+static int smr_match_unexp(struct dlist_entry *item, const void *arg)
+{
+	const struct smr_rx_entry *rx_entry = arg;
+	struct smr_unexp_msg *unexp;
+
+	unexp = container_of(item, struct smr_unexp_msg, entry);
+	return (unexp->cmd.hdr.op.tag | rx_entry->ignore) ==
+	       (rx_entry->tag | rx_entry->ignore);
+}
+
+/*
+ * Returns 1 if the command could not be taken yet and must stay queued,
+ * otherwise 0 or a negative error once the command has been consumed.
+ */
+static int smr_progress_cmd_msg(struct smr_ep *ep, struct smr_cmd *cmd)
+{
+	struct smr_unexp_msg *unexp;
+	struct smr_rx_entry *rx_entry;
+	struct dlist_entry *item;
+	int ret;
+
+	if (cmd->hdr.op.op == ofi_op_tagged)
+		item = dlist_remove_first_match(&ep->trecv_list,
+						smr_match_tagged,
+						&cmd->hdr.op.tag);
+	else
+		item = dlist_remove_first_match(&ep->recv_list,
+						smr_match_msg, NULL);
+
+	if (!item) {
+		unexp = malloc(sizeof(*unexp));
+		if (!unexp)
+			return 1;
+		memcpy(&unexp->cmd, cmd, sizeof(*cmd));
+		dlist_insert_tail(&unexp->entry,
+				  cmd->hdr.op.op == ofi_op_tagged ?
+				  &ep->unexp_tagged_list : &ep->unexp_list);
+		return 0;
+	}
+
+	rx_entry = container_of(item, struct smr_rx_entry, entry);
+	ret = smr_progress_msg(ep, cmd, rx_entry);
+	freestack_push(ep->rx_fs, rx_entry);
+	return ret;
+}
+
+static int smr_progress_cmd_rma(struct smr_ep *ep, struct smr_cmd *cmd)
+{
+	struct smr_domain *domain;
+	struct iovec iov[SMR_IOV_LIMIT];
+	uint64_t access;
+	uintptr_t addr;
+	ssize_t ret;
+	int i, err = 0;
+
+	domain = container_of(ep->util_ep.domain, struct smr_domain,
+			      util_domain);
+	access = (cmd->hdr.op.op == ofi_op_write) ?
+		 FI_REMOTE_WRITE : FI_REMOTE_READ;
+
+	/* The counts come from the peer, and size iov and cmd->iov */
+	if (cmd->hdr.rma_count > SMR_IOV_LIMIT ||
+	    cmd->hdr.iov_count > SMR_IOV_LIMIT) {
+		FI_WARN(&smr_prov, FI_LOG_EP_DATA,
+			"RMA command from pid %d exceeds the iov limit\n",
+			cmd->hdr.pid);
+		err = -FI_EINVAL;
+		goto out;
+	}
+
+	for (i = 0; i < cmd->hdr.rma_count; i++) {
+		addr = (uintptr_t) cmd->rma_iov[i].addr;
+		ret = smr_mr_verify(domain, cmd->rma_iov[i].len, &addr,
+				    cmd->rma_iov[i].key, access);
+		if (ret) {
+			FI_WARN(&smr_prov, FI_LOG_EP_DATA,
+				"invalid RMA key or access\n");
+			err = -FI_EACCES;
+			goto out;
+		}
+		iov[i].iov_base = (void *) addr;
+		iov[i].iov_len = cmd->rma_iov[i].len;
+	}
+
+	if (cmd->hdr.op.op == ofi_op_write)
+		ret = process_vm_readv(cmd->hdr.pid, iov, cmd->hdr.rma_count,
+				       cmd->iov, cmd->hdr.iov_count, 0);
+	else
+		ret = process_vm_writev(cmd->hdr.pid, iov, cmd->hdr.rma_count,
+					cmd->iov, cmd->hdr.iov_count, 0);
+	if (ret != (ssize_t) cmd->hdr.op.size) {
+		FI_WARN(&smr_prov, FI_LOG_EP_DATA,
+			"RMA transfer with pid %d failed\n", cmd->hdr.pid);
+		err = -FI_EIO;
+	}
+out:
+	smr_send_resp(cmd, err);
+
+	if (!err && (cmd->hdr.op.flags & OFI_REMOTE_CQ_DATA)) {
+		return smr_complete_rx(ep, NULL, FI_RMA | FI_REMOTE_WRITE |
+				       FI_REMOTE_CQ_DATA, 0, 0,
+				       cmd->hdr.op.data, 0);
+	}
+	return 0;
+}
+
+static void smr_progress_cmd(struct smr_ep *ep)
+{
+	struct smr_cmd_queue *queue = smr_cmd_queue(ep->region);
+	struct smr_cmd cmd;
+	int ret;
+
+	if (!ep->util_ep.rx_cq)
+		return;
+
+	for (;;) {
+		/* keep the command queued until its completion has room */
+		if (ofi_cirque_isfull(ep->util_ep.rx_cq->cirq))
+			break;
+
+		pthread_spin_lock(&ep->region->lock);
+		if (ofi_cirque_isempty(queue)) {
+			pthread_spin_unlock(&ep->region->lock);
+			break;
+		}
+		/* Only this endpoint consumes its queue, under ep->lock, so
+		 * the head stays put until it is discarded below. */
+		memcpy(&cmd, ofi_cirque_head(queue), sizeof(cmd));
+		pthread_spin_unlock(&ep->region->lock);
+
+		switch (cmd.hdr.op.op) {
+		case ofi_op_msg:
+		case ofi_op_tagged:
+			ret = smr_progress_cmd_msg(ep, &cmd);
+			break;
+		case ofi_op_write:
+		case ofi_op_read_req:
+			ret = smr_progress_cmd_rma(ep, &cmd);
+			break;
+		default:
+			FI_WARN(&smr_prov, FI_LOG_EP_DATA,
+				"unknown command %d\n", cmd.hdr.op.op);
+			ret = -FI_EINVAL;
+			break;
+		}
+		if (ret > 0)
+			break;
+
+		pthread_spin_lock(&ep->region->lock);
+		ofi_cirque_discard(queue);
+		pthread_spin_unlock(&ep->region->lock);
+
+		if (ret) {
+			FI_WARN(&smr_prov, FI_LOG_EP_DATA,
+				"error processing command: %s\n",
+				fi_strerror(-ret));
+		}
+	}
+}
+
+void smr_ep_progress(struct util_ep *util_ep)
+{
+	struct smr_ep *ep;
+
+	ep = container_of(util_ep, struct smr_ep, util_ep);
+	fastlock_acquire(&ep->lock);
+	smr_progress_resp(ep);
+	smr_progress_cmd(ep);
+	fastlock_release(&ep->lock);
+}
+
+ssize_t smr_generic_recv(struct smr_ep *ep, const struct iovec *iov,
+			 size_t iov_count, uint64_t tag, uint64_t ignore,
+			 void *context, uint32_t op)
+{
+	struct smr_unexp_msg *unexp;
+	struct smr_rx_entry *rx_entry;
+	struct dlist_entry *item, *unexp_list;
+	ssize_t ret = 0;
+	int i;
+
+	if (iov_count > SMR_IOV_LIMIT)
+		return -FI_EINVAL;
+
+	unexp_list = (op == ofi_op_tagged) ?
+		     &ep->unexp_tagged_list : &ep->unexp_list;
+
+	fastlock_acquire(&ep->lock);
+	if (freestack_isempty(ep->rx_fs)) {
+		ret = -FI_EAGAIN;
+		goto out;
+	}
+
+	/* An unexpected message is consumed on a match, so its completion
+	 * must have room first, as in smr_progress_cmd. */
+	if (!dlist_empty(unexp_list) &&
+	    ofi_cirque_isfull(ep->util_ep.rx_cq->cirq)) {
+		ret = -FI_EAGAIN;
+		goto out;
+	}
+
+	rx_entry = freestack_pop(ep->rx_fs);
+	rx_entry->context = context;
+	rx_entry->addr = FI_ADDR_UNSPEC;
+	rx_entry->tag = tag;
+	rx_entry->ignore = ignore;
+	rx_entry->flags = 0;
+	rx_entry->iov_count = iov_count;
+	for (i = 0; i < iov_count; i++)
+		rx_entry->iov[i] = iov[i];
+
+	if (op == ofi_op_tagged)
+		item = dlist_remove_first_match(unexp_list, smr_match_unexp,
+						rx_entry);
+	else
+		item = dlist_remove_first_match(unexp_list, smr_match_msg,
+						NULL);
+
+	if (!item) {
+		dlist_insert_tail(&rx_entry->entry, op == ofi_op_tagged ?
+				  &ep->trecv_list : &ep->recv_list);
+		goto out;
+	}
+
+	unexp = container_of(item, struct smr_unexp_msg, entry);
+	ret = smr_progress_msg(ep, &unexp->cmd, rx_entry);
+	freestack_push(ep->rx_fs, rx_entry);
+	free(unexp);
+out:
+	fastlock_release(&ep->lock);
+	return ret;
+}
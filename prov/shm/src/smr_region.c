@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "smr.h"
+
+
+/*
+ * A region that already exists belongs to a live endpoint unless the
+ * process that created it has gone away.  Regions still being set up
+ * (version not yet published) with no owner recorded are treated as live.
+ */
+static int smr_region_stale(const char *fname)
+{
+	struct smr_region hdr;
+	int fd, stale = 0;
+
+	fd = shm_open(fname, O_RDONLY, 0);
+	if (fd < 0)
+		return errno == ENOENT;
+
+	if (pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr) && hdr.pid > 0 &&
+	    kill(hdr.pid, 0) && errno == ESRCH)
+		stale = 1;
+
+	close(fd);
+	return stale;
+}
+
+/*
+ * Regions are created exclusively, so that a second endpoint using the
+ * same name cannot reinitialize a region that a live peer is using.  A
+ * region left behind by a process that exited without closing its
+ * endpoint is removed and created again.
+ */
+static int smr_region_open(struct util_shm *shm, const char *name, size_t size)
+{
+	char *fname;
+	int retry, err;
+
+	memset(shm, 0, sizeof(*shm));
+	fname = calloc(1, strlen(name) + 2);
+	if (!fname)
+		return -FI_ENOMEM;
+
+	strcpy(fname, "/");
+	strcat(fname, name);
+
+	for (retry = 1;; retry--) {
+		shm->shared_fd = shm_open(fname, O_RDWR | O_CREAT | O_EXCL,
+					  S_IRUSR | S_IWUSR);
+		if (shm->shared_fd >= 0)
+			break;
+
+		err = errno;
+		if (err != EEXIST || !retry || !smr_region_stale(fname)) {
+			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+				"shm_open %s failed: %s\n", fname,
+				strerror(err == EEXIST ? EADDRINUSE : err));
+			free(fname);
+			return err == EEXIST ? -FI_EADDRINUSE : -FI_EINVAL;
+		}
+
+		FI_INFO(&smr_prov, FI_LOG_EP_CTRL,
+			"removing stale region %s\n", fname);
+		shm_unlink(fname);
+	}
+
+	shm->name = fname;
+	if (ftruncate(shm->shared_fd, size)) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "ftruncate %s failed: %s\n",
+			fname, strerror(errno));
+		goto err;
+	}
+
+	shm->ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			shm->shared_fd, 0);
+	if (shm->ptr == MAP_FAILED) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "mmap %s failed: %s\n",
+			fname, strerror(errno));
+		goto err;
+	}
+
+	shm->size = size;
+	return 0;
+err:
+	close(shm->shared_fd);
+	shm_unlink(fname);
+	free(fname);
+	memset(shm, 0, sizeof(*shm));
+	return -FI_EINVAL;
+}
+
+int smr_region_create(const char *name, size_t cmd_cnt,
+		      struct util_shm *shm, struct smr_region **region)
+{
+	struct smr_cmd_queue *queue;
+	size_t queue_offset, total_size;
+	int ret;
+
+	cmd_cnt = roundup_power_of_two(cmd_cnt);
+	queue_offset = (sizeof(**region) + SMR_CMD_HDR_SIZE - 1) &
+		       ~(SMR_CMD_HDR_SIZE - 1);
+	total_size = queue_offset + sizeof(*queue) +
+		     cmd_cnt * sizeof(struct smr_cmd);
+
+	ret = smr_region_open(shm, name, total_size);
+	if (ret) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"unable to create region %s\n", name);
+		return ret;
+	}
+
+	/* the object is zero filled, so version reads 0 until published */
+	*region = shm->ptr;
+	(*region)->pid = getpid();
+	(*region)->total_size = total_size;
+	(*region)->cmd_queue_offset = queue_offset;
+	pthread_spin_init(&(*region)->lock, PTHREAD_PROCESS_SHARED);
+
+	queue = smr_cmd_queue(*region);
+	smr_cmd_queue_init(queue, cmd_cnt);
+
+	smr_release_fence();
+	(*region)->version = SMR_VERSION;
+	return 0;
+}
+
+void smr_region_free(struct util_shm *shm)
+{
+	struct smr_region *region = shm->ptr;
+
+	if (region && region != MAP_FAILED)
+		pthread_spin_destroy(&region->lock);
+	ofi_shm_unmap(shm);
+}
+
+/*
+ * Map a peer's region.  The size of the region is only known once the
+ * header has been read, so the object is sized with fstat rather than
+ * through ofi_shm_map, and is never unlinked on unmap.
+ */
+int smr_region_map(const char *name, struct util_shm *shm,
+		   struct smr_region **region)
+{
+	struct stat st;
+	char *fname;
+
+	memset(shm, 0, sizeof(*shm));
+	fname = calloc(1, strlen(name) + 2);
+	if (!fname)
+		return -FI_ENOMEM;
+
+	strcpy(fname, "/");
+	strcat(fname, name);
+	shm->name = fname;
+
+	shm->shared_fd = shm_open(fname, O_RDWR, S_IRUSR | S_IWUSR);
+	if (shm->shared_fd < 0) {
+		FI_WARN(&smr_prov, FI_LOG_AV, "shm_open %s failed: %s\n",
+			fname, strerror(errno));
+		goto err1;
+	}
+
+	if (fstat(shm->shared_fd, &st) || st.st_size < sizeof(**region)) {
+		FI_WARN(&smr_prov, FI_LOG_AV, "invalid region %s\n", fname);
+		goto err2;
+	}
+
+	shm->size = st.st_size;
+	shm->ptr = mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			shm->shared_fd, 0);
+	if (shm->ptr == MAP_FAILED) {
+		FI_WARN(&smr_prov, FI_LOG_AV, "mmap %s failed: %s\n",
+			fname, strerror(errno));
+		goto err2;
+	}
+
+	*region = shm->ptr;
+	if (*(volatile uint8_t *) &(*region)->version != SMR_VERSION)
+		goto err3;
+
+	/* pairs with the release in smr_region_create */
+	smr_acquire_fence();
+	if ((*region)->total_size > shm->size)
+		goto err3;
+	return 0;
+err3:
+	FI_WARN(&smr_prov, FI_LOG_AV, "incompatible region %s\n", fname);
+	munmap(shm->ptr, shm->size);
+err2:
+	close(shm->shared_fd);
+err1:
+	free(fname);
+	memset(shm, 0, sizeof(*shm));
+	return -FI_EADDRNOTAVAIL;
+}
+
+void smr_region_unmap(struct util_shm *shm)
+{
+	if (shm->ptr && shm->ptr != MAP_FAILED)
+		munmap(shm->ptr, shm->size);
+	if (shm->shared_fd > 0)
+		close(shm->shared_fd);
+	free((void *) shm->name);
+	memset(shm, 0, sizeof(*shm));
+}
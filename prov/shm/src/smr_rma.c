@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2016 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "smr.h"
+
+
+static ssize_t smr_generic_rma(struct fid_ep *ep_fid, const struct iovec *iov,
+			       size_t iov_count, fi_addr_t addr,
+			       const struct fi_rma_iov *rma_iov,
+			       size_t rma_count, uint64_t data, void *context,
+			       uint32_t op, uint64_t op_flags)
+{
+	struct smr_ep *ep;
+	struct smr_cmd cmd;
+	int i;
+
+	if (rma_count > SMR_IOV_LIMIT)
+		return -FI_EINVAL;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
+	smr_init_cmd(&cmd, op, 0, data, op_flags);
+	cmd.hdr.rma_count = rma_count;
+	for (i = 0; i < rma_count; i++) {
+		cmd.rma_iov[i].addr = rma_iov[i].addr;
+		cmd.rma_iov[i].len = rma_iov[i].len;
+		cmd.rma_iov[i].key = rma_iov[i].key;
+	}
+
+	return smr_post_cmd(ep, addr, &cmd, iov, iov_count, context, op_flags);
+}
+
+static ssize_t smr_readmsg(struct fid_ep *ep_fid, const struct fi_msg_rma *msg,
+			   uint64_t flags)
+{
+	return smr_generic_rma(ep_fid, msg->msg_iov, msg->iov_count,
+			       msg->addr, msg->rma_iov, msg->rma_iov_count, 0,
+			       msg->context, ofi_op_read_req, 0);
+}
+
+static ssize_t smr_readv(struct fid_ep *ep_fid, const struct iovec *iov,
+			 void **desc, size_t count, fi_addr_t src_addr,
+			 uint64_t addr, uint64_t key, void *context)
+{
+	struct fi_rma_iov rma_iov;
+
+	rma_iov.addr = addr;
+	rma_iov.len = ofi_get_iov_len(iov, count);
+	rma_iov.key = key;
+	return smr_generic_rma(ep_fid, iov, count, src_addr, &rma_iov, 1, 0,
+			       context, ofi_op_read_req, 0);
+}
+
+static ssize_t smr_read(struct fid_ep *ep_fid, void *buf, size_t len,
+			void *desc, fi_addr_t src_addr, uint64_t addr,
+			uint64_t key, void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = buf;
+	iov.iov_len = len;
+	return smr_readv(ep_fid, &iov, &desc, 1, src_addr, addr, key, context);
+}
+
+static ssize_t smr_writemsg(struct fid_ep *ep_fid,
+			    const struct fi_msg_rma *msg, uint64_t flags)
+{
+	return smr_generic_rma(ep_fid, msg->msg_iov, msg->iov_count,
+			       msg->addr, msg->rma_iov, msg->rma_iov_count,
+			       msg->data, msg->context, ofi_op_write,
+			       flags & FI_REMOTE_CQ_DATA);
+}
+
+static ssize_t smr_writev(struct fid_ep *ep_fid, const struct iovec *iov,
+			  void **desc, size_t count, fi_addr_t dest_addr,
+			  uint64_t addr, uint64_t key, void *context)
+{
+	struct fi_rma_iov rma_iov;
+
+	rma_iov.addr = addr;
+	rma_iov.len = ofi_get_iov_len(iov, count);
+	rma_iov.key = key;
+	return smr_generic_rma(ep_fid, iov, count, dest_addr, &rma_iov, 1, 0,
+			       context, ofi_op_write, 0);
+}
+
+static ssize_t smr_write(struct fid_ep *ep_fid, const void *buf, size_t len,
+			 void *desc, fi_addr_t dest_addr, uint64_t addr,
+			 uint64_t key, void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return smr_writev(ep_fid, &iov, &desc, 1, dest_addr, addr, key,
+			  context);
+}
+
+static ssize_t smr_writedata(struct fid_ep *ep_fid, const void *buf,
+			     size_t len, void *desc, uint64_t data,
+			     fi_addr_t dest_addr, uint64_t addr, uint64_t key,
+			     void *context)
+{
+	struct fi_rma_iov rma_iov;
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	rma_iov.addr = addr;
+	rma_iov.len = len;
+	rma_iov.key = key;
+	return smr_generic_rma(ep_fid, &iov, 1, dest_addr, &rma_iov, 1, data,
+			       context, ofi_op_write, FI_REMOTE_CQ_DATA);
+}
+
+struct fi_ops_rma smr_rma_ops = {
+	.size = sizeof(struct fi_ops_rma),
+	.read = smr_read,
+	.readv = smr_readv,
+	.readmsg = smr_readmsg,
+	.write = smr_write,
+	.writev = smr_writev,
+	.writemsg = smr_writemsg,
+	.inject = fi_no_rma_inject,
+	.writedata = smr_writedata,
+	.injectdata = fi_no_rma_injectdata,
+};
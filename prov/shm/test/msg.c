@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2017 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks that a receive posted against an unexpected shm message while
+ * the CQ is full is refused with -FI_EAGAIN, and leaves the message
+ * queued for the receive that is posted once the CQ has been drained.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_errno.h>
+
+#define MT_CQ_SIZE	8
+#define MT_MSG_SIZE	16
+#define MT_POLL_MAX	1000000
+
+static struct fi_info *info;
+static struct fid_fabric *fabric;
+static struct fid_domain *domain;
+static struct fid_av *av;
+static struct fid_cq *cq;
+static struct fid_ep *ep[2];
+static fi_addr_t peer;
+
+static char rx_buf[MT_MSG_SIZE];
+static int rx_ctx;
+
+static void mt_fill(char *buf, int seed)
+{
+	int i;
+
+	for (i = 0; i < MT_MSG_SIZE; i++)
+		buf[i] = (char) (i + seed);
+}
+
+/* Reads completions until the one for context, or returns an error */
+static int mt_wait(void *context)
+{
+	struct fi_cq_entry comp;
+	ssize_t ret;
+	int i;
+
+	for (i = 0; i < MT_POLL_MAX; i++) {
+		ret = fi_cq_read(cq, &comp, 1);
+		if (ret == 1 && comp.op_context == context)
+			return 0;
+		if (ret < 0 && ret != -FI_EAGAIN)
+			return (int) ret;
+	}
+	return -FI_ETIMEDOUT;
+}
+
+static int check_unexp_cq_full(void)
+{
+	char msg[MT_MSG_SIZE], expect[MT_MSG_SIZE];
+	struct fi_cq_entry comp;
+	ssize_t ret;
+	int seed;
+
+	/* queue the first message at the receiver as unexpected */
+	mt_fill(expect, 0);
+	ret = fi_send(ep[0], expect, MT_MSG_SIZE, NULL, peer, NULL);
+	if (ret) {
+		printf("send: %s\n", fi_strerror((int) -ret));
+		return 1;
+	}
+	ret = mt_wait(NULL);
+	if (ret) {
+		printf("send completion: %s\n", fi_strerror((int) -ret));
+		return 1;
+	}
+
+	/* a read of the empty CQ drives the receiver's progress */
+	if (fi_cq_read(cq, &comp, 1) != -FI_EAGAIN) {
+		printf("unexpected completion\n");
+		return 1;
+	}
+
+	/* fill the CQ with the completions of further sends */
+	for (seed = 1;; seed++) {
+		mt_fill(msg, seed);
+		ret = fi_send(ep[0], msg, MT_MSG_SIZE, NULL, peer, NULL);
+		if (ret == -FI_EAGAIN)
+			break;
+		if (ret) {
+			printf("send %d: %s\n", seed, fi_strerror((int) -ret));
+			return 1;
+		}
+	}
+
+	ret = fi_recv(ep[1], rx_buf, MT_MSG_SIZE, NULL, 0, &rx_ctx);
+	if (ret != -FI_EAGAIN) {
+		printf("recv with a full CQ: %s\n", fi_strerror((int) -ret));
+		return 1;
+	}
+
+	while (fi_cq_read(cq, &comp, 1) == 1)
+		;
+
+	ret = fi_recv(ep[1], rx_buf, MT_MSG_SIZE, NULL, 0, &rx_ctx);
+	if (!ret)
+		ret = mt_wait(&rx_ctx);
+	if (ret) {
+		printf("recv: %s\n", fi_strerror((int) -ret));
+		return 1;
+	}
+	if (memcmp(rx_buf, expect, MT_MSG_SIZE)) {
+		printf("recv did not get the first unexpected message\n");
+		return 1;
+	}
+	return 0;
+}
+
+static int mt_init(void)
+{
+	struct fi_info *hints;
+	struct fi_cq_attr cq_attr;
+	struct fi_av_attr av_attr;
+	char name[64];
+	size_t len = sizeof name;
+	int i, ret;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return -FI_ENOMEM;
+
+	hints->fabric_attr->prov_name = strdup("shm");
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG;
+
+	ret = fi_getinfo(FI_VERSION(1, 4), NULL, NULL, 0, hints, &info);
+	fi_freeinfo(hints);
+	if (ret)
+		return ret;
+
+	ret = fi_fabric(info->fabric_attr, &fabric, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_domain(fabric, info, &domain, NULL);
+	if (ret)
+		return ret;
+
+	memset(&cq_attr, 0, sizeof cq_attr);
+	cq_attr.format = FI_CQ_FORMAT_CONTEXT;
+	cq_attr.size = MT_CQ_SIZE;
+	ret = fi_cq_open(domain, &cq_attr, &cq, NULL);
+	if (ret)
+		return ret;
+
+	memset(&av_attr, 0, sizeof av_attr);
+	av_attr.type = FI_AV_MAP;
+	ret = fi_av_open(domain, &av_attr, &av, NULL);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < 2; i++) {
+		ret = fi_endpoint(domain, info, &ep[i], NULL);
+		if (ret)
+			return ret;
+
+		ret = fi_ep_bind(ep[i], &av->fid, 0);
+		if (ret)
+			return ret;
+
+		ret = fi_ep_bind(ep[i], &cq->fid, FI_TRANSMIT | FI_RECV);
+		if (ret)
+			return ret;
+
+		ret = fi_enable(ep[i]);
+		if (ret)
+			return ret;
+	}
+
+	ret = fi_getname(&ep[1]->fid, name, &len);
+	if (ret)
+		return ret;
+
+	ret = fi_av_insert(av, name, 1, &peer, 0, NULL);
+	return ret == 1 ? 0 : -FI_EINVAL;
+}
+
+static void mt_fini(void)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (ep[i])
+			fi_close(&ep[i]->fid);
+	}
+	if (av)
+		fi_close(&av->fid);
+	if (cq)
+		fi_close(&cq->fid);
+	if (domain)
+		fi_close(&domain->fid);
+	if (fabric)
+		fi_close(&fabric->fid);
+	fi_freeinfo(info);
+}
+
+int main(int argc, char **argv)
+{
+	int ret, failed;
+
+	ret = mt_init();
+	if (ret) {
+		printf("shm provider setup failed: %s\n", fi_strerror(-ret));
+		mt_fini();
+		return EXIT_FAILURE;
+	}
+
+	failed = check_unexp_cq_full();
+	mt_fini();
+
+	printf("%d checks failed\n", failed);
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,436 @@
+/*
+ * Copyright (c) 2017 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks the shm RMA path at SMR_IOV_LIMIT, between two endpoints of
+ * one process.  Reads and writes use the full number of local and
+ * remote iovs, one more than the limit must be refused, and commands
+ * that a peer queues with counts past the limit must fail back to it
+ * without touching the target buffer.
+ */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "smr.h"
+
+#define RT_KEY		0x5d
+#define RT_BUF_SIZE	8192
+#define RT_POLL_MAX	1000000
+
+static const size_t rt_local_len[SMR_IOV_LIMIT] = { 7, 64, 300, 4000 };
+static const size_t rt_remote_len[SMR_IOV_LIMIT] = { 1000, 13, 2000, 1358 };
+static const uint64_t rt_remote_off[SMR_IOV_LIMIT] = { 17, 1500, 2048, 6000 };
+
+static struct fi_info *info;
+static struct fid_fabric *fabric;
+static struct fid_domain *domain;
+static struct fid_av *av;
+static struct fid_cq *cq;
+static struct fid_ep *ep[2];
+static struct fid_mr *mr;
+static fi_addr_t peer;
+static char peer_name[SMR_NAME_SIZE];
+
+static char target[RT_BUF_SIZE], local[RT_BUF_SIZE];
+static struct iovec local_iov[SMR_IOV_LIMIT + 1];
+static struct fi_rma_iov remote_iov[SMR_IOV_LIMIT + 1];
+
+static void rt_fill(char *buf, size_t len, int seed)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (char) (i * 7 + seed);
+}
+
+/* Sets up the iovs for a transfer of the full iov limit */
+static size_t rt_init_iov(void)
+{
+	size_t i, off, len = 0;
+
+	for (i = 0, off = 0; i < SMR_IOV_LIMIT; i++) {
+		local_iov[i].iov_base = &local[off];
+		local_iov[i].iov_len = rt_local_len[i];
+		off += rt_local_len[i] + 32;
+		len += rt_local_len[i];
+
+		remote_iov[i].addr = rt_remote_off[i];
+		remote_iov[i].len = rt_remote_len[i];
+		remote_iov[i].key = RT_KEY;
+	}
+	return len;
+}
+
+/* Copies between the gathered local and remote iovs, for the reference */
+static void rt_expect(char *remote, char *lbuf, int to_remote)
+{
+	size_t l = 0, r = 0, loff = 0, roff = 0, n;
+	char *lp, *rp;
+
+	while (l < SMR_IOV_LIMIT && r < SMR_IOV_LIMIT) {
+		n = MIN(rt_local_len[l] - loff, rt_remote_len[r] - roff);
+		lp = lbuf + ((char *) local_iov[l].iov_base - local) + loff;
+		rp = remote + rt_remote_off[r] + roff;
+		if (to_remote)
+			memcpy(rp, lp, n);
+		else
+			memcpy(lp, rp, n);
+
+		loff += n;
+		roff += n;
+		if (loff == rt_local_len[l]) {
+			l++;
+			loff = 0;
+		}
+		if (roff == rt_remote_len[r]) {
+			r++;
+			roff = 0;
+		}
+	}
+}
+
+static int rt_wait(void)
+{
+	struct fi_cq_err_entry err;
+	struct fi_cq_entry comp;
+	ssize_t ret;
+	int i;
+
+	for (i = 0; i < RT_POLL_MAX; i++) {
+		ret = fi_cq_read(cq, &comp, 1);
+		if (ret != -FI_EAGAIN)
+			break;
+	}
+
+	if (ret == -FI_EAVAIL) {
+		memset(&err, 0, sizeof err);
+		fi_cq_readerr(cq, &err, 0);
+		return -err.err;
+	}
+	return ret == 1 ? 0 : (int) ret;
+}
+
+static int rt_rma(int write, size_t iov_count, size_t rma_count)
+{
+	struct fi_msg_rma msg;
+	ssize_t ret;
+
+	memset(&msg, 0, sizeof msg);
+	msg.msg_iov = local_iov;
+	msg.iov_count = iov_count;
+	msg.addr = peer;
+	msg.rma_iov = remote_iov;
+	msg.rma_iov_count = rma_count;
+
+	ret = write ? fi_writemsg(ep[0], &msg, 0) : fi_readmsg(ep[0], &msg, 0);
+	return ret ? (int) ret : rt_wait();
+}
+
+static int check_write(void)
+{
+	static char expect[RT_BUF_SIZE];
+	int ret;
+
+	rt_init_iov();
+	rt_fill(local, sizeof local, 1);
+	memset(target, 0, sizeof target);
+	memset(expect, 0, sizeof expect);
+	rt_expect(expect, local, 1);
+
+	ret = rt_rma(1, SMR_IOV_LIMIT, SMR_IOV_LIMIT);
+	if (ret) {
+		printf("write: %s\n", fi_strerror(-ret));
+		return 1;
+	}
+	if (memcmp(target, expect, sizeof target)) {
+		printf("write: target does not match\n");
+		return 1;
+	}
+	return 0;
+}
+
+static int check_read(void)
+{
+	static char expect[RT_BUF_SIZE];
+	int ret;
+
+	rt_init_iov();
+	rt_fill(target, sizeof target, 3);
+	memset(local, 0, sizeof local);
+	memset(expect, 0, sizeof expect);
+	rt_expect(target, expect, 0);
+
+	ret = rt_rma(0, SMR_IOV_LIMIT, SMR_IOV_LIMIT);
+	if (ret) {
+		printf("read: %s\n", fi_strerror(-ret));
+		return 1;
+	}
+	if (memcmp(local, expect, sizeof local)) {
+		printf("read: local buffer does not match\n");
+		return 1;
+	}
+	return 0;
+}
+
+static int check_over_limit(void)
+{
+	int ret, failed = 0;
+
+	rt_init_iov();
+	local_iov[SMR_IOV_LIMIT] = local_iov[0];
+	remote_iov[SMR_IOV_LIMIT] = remote_iov[0];
+
+	ret = rt_rma(1, SMR_IOV_LIMIT + 1, SMR_IOV_LIMIT);
+	if (ret != -FI_EINVAL) {
+		printf("write with %d local iovs: %s\n", SMR_IOV_LIMIT + 1,
+		       fi_strerror(-ret));
+		failed++;
+	}
+
+	ret = rt_rma(0, SMR_IOV_LIMIT, SMR_IOV_LIMIT + 1);
+	if (ret != -FI_EINVAL) {
+		printf("read with %d remote iovs: %s\n", SMR_IOV_LIMIT + 1,
+		       fi_strerror(-ret));
+		failed++;
+	}
+	return failed;
+}
+
+/*
+ * Queues cmd straight into the target endpoint's region, as a peer
+ * would, and returns the status the target reports back.
+ */
+static int64_t rt_post_raw(struct smr_cmd *cmd)
+{
+	volatile int64_t status = SMR_STATUS_BUSY;
+	struct smr_region *region;
+	struct smr_cmd_queue *queue;
+	struct fi_cq_entry comp;
+	struct stat st;
+	char fname[SMR_NAME_SIZE + 1];
+	int fd, i;
+
+	snprintf(fname, sizeof fname, "/%s", peer_name);
+	fd = shm_open(fname, O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd < 0 || fstat(fd, &st)) {
+		printf("shm_open %s failed\n", fname);
+		return -FI_EINVAL;
+	}
+
+	region = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		      fd, 0);
+	close(fd);
+	if (region == MAP_FAILED) {
+		printf("mmap %s failed\n", fname);
+		return -FI_EINVAL;
+	}
+
+	cmd->hdr.resp = (uintptr_t) &status;
+	pthread_spin_lock(&region->lock);
+	queue = smr_cmd_queue(region);
+	memcpy(ofi_cirque_tail(queue), cmd, sizeof(*cmd));
+	ofi_cirque_commit(queue);
+	pthread_spin_unlock(&region->lock);
+	munmap(region, st.st_size);
+
+	for (i = 0; i < RT_POLL_MAX && status == SMR_STATUS_BUSY; i++)
+		fi_cq_read(cq, &comp, 0);
+	return status;
+}
+
+static int check_bad_counts(void)
+{
+	static char zero[RT_BUF_SIZE];
+	static const struct {
+		uint8_t iov_count;
+		uint8_t rma_count;
+	} bad[] = {
+		{ SMR_IOV_LIMIT, SMR_IOV_LIMIT + 1 },
+		{ SMR_IOV_LIMIT + 1, SMR_IOV_LIMIT },
+		{ UINT8_MAX, UINT8_MAX },
+	};
+	struct smr_cmd cmd;
+	size_t i, len;
+	int64_t status;
+	int failed = 0;
+
+	len = rt_init_iov();
+	for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+		memset(target, 0, sizeof target);
+		rt_fill(local, sizeof local, 5);
+
+		memset(&cmd, 0, sizeof cmd);
+		cmd.hdr.op.version = OFI_OP_VERSION;
+		cmd.hdr.op.op = ofi_op_write;
+		cmd.hdr.op.op_data = smr_src_iov;
+		cmd.hdr.op.size = len;
+		cmd.hdr.iov_count = bad[i].iov_count;
+		cmd.hdr.rma_count = bad[i].rma_count;
+		cmd.hdr.pid = getpid();
+		memcpy(cmd.iov, local_iov, sizeof(cmd.iov));
+		memcpy(cmd.rma_iov, remote_iov, sizeof(cmd.rma_iov));
+
+		status = rt_post_raw(&cmd);
+		if (status != -FI_EINVAL) {
+			printf("command with %d iovs and %d rma iovs: "
+			       "status %lld\n", bad[i].iov_count,
+			       bad[i].rma_count, (long long) status);
+			failed++;
+		} else if (memcmp(target, zero, sizeof target)) {
+			printf("command with %d iovs and %d rma iovs "
+			       "wrote to the target\n", bad[i].iov_count,
+			       bad[i].rma_count);
+			failed++;
+		}
+	}
+	return failed;
+}
+
+static int rt_init(void)
+{
+	struct fi_info *hints;
+	struct fi_cq_attr cq_attr;
+	struct fi_av_attr av_attr;
+	size_t len = sizeof peer_name;
+	int i, ret;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return -FI_ENOMEM;
+
+	hints->fabric_attr->prov_name = strdup("shm");
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_RMA;
+	hints->domain_attr->mr_mode = FI_MR_SCALABLE;
+
+	ret = fi_getinfo(FI_VERSION(1, 4), NULL, NULL, 0, hints, &info);
+	fi_freeinfo(hints);
+	if (ret)
+		return ret;
+
+	ret = fi_fabric(info->fabric_attr, &fabric, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_domain(fabric, info, &domain, NULL);
+	if (ret)
+		return ret;
+
+	memset(&cq_attr, 0, sizeof cq_attr);
+	cq_attr.format = FI_CQ_FORMAT_CONTEXT;
+	ret = fi_cq_open(domain, &cq_attr, &cq, NULL);
+	if (ret)
+		return ret;
+
+	memset(&av_attr, 0, sizeof av_attr);
+	av_attr.type = FI_AV_MAP;
+	ret = fi_av_open(domain, &av_attr, &av, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_mr_reg(domain, target, sizeof target,
+			FI_REMOTE_READ | FI_REMOTE_WRITE, 0, RT_KEY, 0,
+			&mr, NULL);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < 2; i++) {
+		ret = fi_endpoint(domain, info, &ep[i], NULL);
+		if (ret)
+			return ret;
+
+		ret = fi_ep_bind(ep[i], &av->fid, 0);
+		if (ret)
+			return ret;
+
+		ret = fi_ep_bind(ep[i], &cq->fid, FI_TRANSMIT | FI_RECV);
+		if (ret)
+			return ret;
+
+		ret = fi_enable(ep[i]);
+		if (ret)
+			return ret;
+	}
+
+	ret = fi_getname(&ep[1]->fid, peer_name, &len);
+	if (ret)
+		return ret;
+
+	ret = fi_av_insert(av, peer_name, 1, &peer, 0, NULL);
+	return ret == 1 ? 0 : -FI_EINVAL;
+}
+
+static void rt_fini(void)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (ep[i])
+			fi_close(&ep[i]->fid);
+	}
+	if (mr)
+		fi_close(&mr->fid);
+	if (av)
+		fi_close(&av->fid);
+	if (cq)
+		fi_close(&cq->fid);
+	if (domain)
+		fi_close(&domain->fid);
+	if (fabric)
+		fi_close(&fabric->fid);
+	fi_freeinfo(info);
+}
+
+int main(int argc, char **argv)
+{
+	int ret, failed = 0;
+
+	ret = rt_init();
+	if (ret) {
+		printf("shm provider setup failed: %s\n", fi_strerror(-ret));
+		rt_fini();
+		return EXIT_FAILURE;
+	}
+
+	failed += check_write();
+	failed += check_read();
+	failed += check_over_limit();
+	failed += check_bad_counts();
+	rt_fini();
+
+	printf("%d checks failed\n", failed);
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -60,6 +60,12 @@
 #ifndef _SOCK_H_
 #define _SOCK_H_
 
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define SOCK_HAVE_ZEROCOPY 1
+#else
+#define SOCK_HAVE_ZEROCOPY 0
+#endif
+
 #define SOCK_EP_MAX_MSG_SZ (1<<23)
 #define SOCK_EP_MAX_INJECT_SZ ((1<<8) - 1)
 #define SOCK_EP_MAX_BUFF_RECV (1<<26)
@@ -72,6 +78,7 @@
 #define SOCK_EP_MAX_TX_CNT (16)
 #define SOCK_EP_MAX_RX_CNT (16)
 #define SOCK_EP_MAX_IOV_LIMIT (8)
+#define SOCK_COMM_MAX_IOV (SOCK_EP_MAX_IOV_LIMIT + 4)
 #define SOCK_EP_TX_SZ (256)
 #define SOCK_EP_RX_SZ (256)
 #define SOCK_EP_MIN_MULTI_RECV (64)
@@ -157,6 +164,13 @@ enum {
 	SOCK_SIGNAL_WR_FD
 };
 
+/* Domain statistics */
+enum {
+	SOCK_STAT_PE_ENTRY_EXHAUSTED,
+	SOCK_STAT_PE_POOL_GROW,
+	SOCK_STAT_MAX
+};
+
 #define SOCK_MAJOR_VERSION 2
 #define SOCK_MINOR_VERSION 0
 
@@ -203,6 +217,9 @@ struct sock_conn {
 	struct sock_ep_attr *ep_attr;
 	fi_addr_t av_index;
 	struct dlist_entry ep_entry;
+	int zerocopy;
+	uint32_t zc_issued;
+	uint32_t zc_done;
 };
 
 struct sock_conn_map {
@@ -228,6 +245,7 @@ struct sock_domain {
 	struct sock_pe *pe;
 	struct dlist_entry dom_list_entry;
 	struct fi_domain_attr attr;
+	struct ofi_stats stats;
 };
 
 struct sock_trigger {
@@ -738,7 +756,9 @@ struct sock_tx_pe_entry {
 	struct sock_comp *comp;
 	uint8_t header_sent;
 	uint8_t send_done;
-	uint8_t reserved[6];
+	uint8_t zc_pending;
+	uint8_t reserved[1];
+	uint32_t zc_id;
 
 	struct sock_tx_ctx *tx_ctx;
 	struct sock_tx_iov tx_iov[SOCK_EP_MAX_IOV_LIMIT];
@@ -1099,6 +1119,7 @@ int fd_set_nonblock(int fd);
 void sock_set_sockopt_reuseaddr(int sock);
 int sock_conn_map_init(struct sock_ep *ep, int init_size);
 void sock_set_sockopts_conn(int sock);
+int sock_set_sockopt_zerocopy(int sock);
 
 struct sock_pe *sock_pe_init(struct sock_domain *domain);
 void sock_pe_add_tx_ctx(struct sock_pe *pe, struct sock_tx_ctx *ctx);
@@ -1133,9 +1154,14 @@ void sock_rx_release_entry(struct sock_rx_entry *rx_entry);
 
 ssize_t sock_comm_send(struct sock_pe_entry *pe_entry, const void *buf, size_t len);
 ssize_t sock_comm_recv(struct sock_pe_entry *pe_entry, void *buf, size_t len);
+ssize_t sock_comm_sendv(struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt);
+ssize_t sock_comm_recvv(struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt);
 ssize_t sock_comm_peek(struct sock_conn *conn, void *buf, size_t len);
 ssize_t sock_comm_discard(struct sock_pe_entry *pe_entry, size_t len);
 int sock_comm_tx_done(struct sock_pe_entry *pe_entry);
+int sock_comm_zerocopy_done(struct sock_pe_entry *pe_entry);
 ssize_t sock_comm_flush(struct sock_pe_entry *pe_entry);
 int sock_comm_is_disconnected(struct sock_pe_entry *pe_entry);
 
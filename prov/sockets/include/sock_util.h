@@ -49,6 +49,7 @@ extern int sock_av_def_sz;
 extern int sock_cq_def_sz;
 extern int sock_eq_def_sz;
 extern char *sock_pe_affinity_str;
+extern int sock_zerocopy_thresh;
 #if ENABLE_DEBUG
 extern int sock_dgram_drop_rate;
 #endif
@@ -51,12 +51,23 @@
 #include <arpa/inet.h>
 #include <limits.h>
 
+#include <fi_atomic_op.h>
+
 #include "sock.h"
 #include "sock_util.h"
 
 #define SOCK_LOG_DBG(...) _SOCK_LOG_DBG(FI_LOG_EP_DATA, __VA_ARGS__)
 #define SOCK_LOG_ERROR(...) _SOCK_LOG_ERROR(FI_LOG_EP_DATA, __VA_ARGS__)
 
+static size_t sock_atomic_ioc_count(const struct fi_ioc *iov, size_t count)
+{
+	size_t i, total = 0;
+
+	for (i = 0; i < count; i++)
+		total += iov[i].count;
+	return total;
+}
+
 ssize_t sock_ep_tx_atomic(struct fid_ep *ep,
 			  const struct fi_msg_atomic *msg,
 			  const struct fi_ioc *comparev, void **compare_desc,
@@ -320,7 +331,7 @@ static ssize_t sock_ep_atomic_writev(struct fid_ep *ep,
 
 	rma_iov.addr = addr;
 	rma_iov.key = key;
-	rma_iov.count = count;
+	rma_iov.count = sock_atomic_ioc_count(iov, count);
 	msg.rma_iov = &rma_iov;
 	msg.rma_iov_count = 1;
 
@@ -416,7 +427,7 @@ static ssize_t sock_ep_atomic_readwrite(struct fid_ep *ep,
 	msg.addr = dest_addr;
 
 	rma_iov.addr = addr;
-	rma_iov.count = 1;
+	rma_iov.count = count;
 	rma_iov.key = key;
 	msg.rma_iov = &rma_iov;
 	msg.rma_iov_count = 1;
@@ -425,7 +436,7 @@ static ssize_t sock_ep_atomic_readwrite(struct fid_ep *ep,
 	msg.context = context;
 
 	resultv.addr = result;
-	resultv.count = 1;
+	resultv.count = count;
 
 	return sock_ep_atomic_readwritemsg(ep, &msg, &resultv, &result_desc, 1,
 						SOCK_USE_OP_FLAGS);
@@ -447,7 +458,7 @@ static ssize_t sock_ep_atomic_readwritev(struct fid_ep *ep,
 	msg.addr = dest_addr;
 
 	rma_iov.addr = addr;
-	rma_iov.count = 1;
+	rma_iov.count = sock_atomic_ioc_count(iov, count);
 	rma_iov.key = key;
 	msg.rma_iov = &rma_iov;
 	msg.rma_iov_count = 1;
@@ -507,7 +518,7 @@ static ssize_t sock_ep_atomic_compwrite(struct fid_ep *ep,
 	msg.addr = dest_addr;
 
 	rma_iov.addr = addr;
-	rma_iov.count = 1;
+	rma_iov.count = count;
 	rma_iov.key = key;
 	msg.rma_iov = &rma_iov;
 	msg.rma_iov_count = 1;
@@ -516,9 +527,9 @@ static ssize_t sock_ep_atomic_compwrite(struct fid_ep *ep,
 	msg.context = context;
 
 	resultv.addr = result;
-	resultv.count = 1;
+	resultv.count = count;
 	comparev.addr = (void *)compare;
-	comparev.count = 1;
+	comparev.count = count;
 
 	return sock_ep_atomic_compwritemsg(ep, &msg, &comparev, &compare_desc,
 			1, &resultv, &result_desc, 1, SOCK_USE_OP_FLAGS);
@@ -541,7 +552,7 @@ static ssize_t sock_ep_atomic_compwritev(struct fid_ep *ep,
 	msg.addr = dest_addr;
 
 	rma_iov.addr = addr;
-	rma_iov.count = 1;
+	rma_iov.count = sock_atomic_ioc_count(iov, count);
 	rma_iov.key = key;
 	msg.rma_iov = &rma_iov;
 	msg.rma_iov_count = 1;
@@ -549,38 +560,21 @@ static ssize_t sock_ep_atomic_compwritev(struct fid_ep *ep,
 	msg.op = op;
 	msg.context = context;
 
-	return sock_ep_atomic_compwritemsg(ep, &msg, comparev, compare_desc, 1,
-					   resultv, result_desc, 1,
+	return sock_ep_atomic_compwritemsg(ep, &msg, comparev, compare_desc,
+					   compare_count, resultv, result_desc,
+					   result_count,
 					   SOCK_USE_OP_FLAGS);
 }
 
 static int sock_ep_atomic_valid(struct fid_ep *ep, enum fi_datatype datatype,
-			      enum fi_op op, size_t *count)
+				enum fi_op op, size_t *count, int fetch)
 {
 	size_t datatype_sz;
+	int ret;
 
-	switch (datatype) {
-	case FI_FLOAT:
-	case FI_DOUBLE:
-	case FI_LONG_DOUBLE:
-		if (op == FI_BOR || op == FI_BAND ||
-		    op == FI_BXOR || op == FI_MSWAP)
-			return -FI_ENOENT;
-		break;
-
-	case FI_FLOAT_COMPLEX:
-	case FI_DOUBLE_COMPLEX:
-	case FI_LONG_DOUBLE_COMPLEX:
-		if (op == FI_BOR      || op == FI_BAND     ||
-		    op == FI_BXOR     || op == FI_MSWAP    ||
-		    op == FI_MIN      || op == FI_MAX      ||
-		    op == FI_CSWAP_LE || op == FI_CSWAP_LT ||
-		    op == FI_CSWAP_GE || op == FI_CSWAP_GT)
-			return -FI_ENOENT;
-	break;
-	default:
-		break;
-	}
+	ret = ofi_atomic_valid(&sock_prov, datatype, op, fetch);
+	if (ret)
+		return ret;
 
 	datatype_sz = fi_datatype_size(datatype);
 	if (datatype_sz == 0)
@@ -590,6 +584,36 @@ static int sock_ep_atomic_valid(struct fid_ep *ep, enum fi_datatype datatype,
 	return 0;
 }
 
+static int sock_ep_atomic_writevalid(struct fid_ep *ep,
+				     enum fi_datatype datatype, enum fi_op op,
+				     size_t *count)
+{
+	if (!ofi_atomic_iswrite_op(op))
+		return -FI_ENOENT;
+
+	return sock_ep_atomic_valid(ep, datatype, op, count, 0);
+}
+
+static int sock_ep_atomic_readwritevalid(struct fid_ep *ep,
+					 enum fi_datatype datatype,
+					 enum fi_op op, size_t *count)
+{
+	if (!ofi_atomic_isreadwrite_op(op))
+		return -FI_ENOENT;
+
+	return sock_ep_atomic_valid(ep, datatype, op, count, 1);
+}
+
+static int sock_ep_atomic_compwritevalid(struct fid_ep *ep,
+					 enum fi_datatype datatype,
+					 enum fi_op op, size_t *count)
+{
+	if (!ofi_atomic_isswap_op(op))
+		return -FI_ENOENT;
+
+	return sock_ep_atomic_valid(ep, datatype, op, count, 1);
+}
+
 struct fi_ops_atomic sock_ep_atomic = {
 	.size = sizeof(struct fi_ops_atomic),
 	.write = sock_ep_atomic_write,
@@ -602,7 +626,7 @@ struct fi_ops_atomic sock_ep_atomic = {
 	.compwrite = sock_ep_atomic_compwrite,
 	.compwritev = sock_ep_atomic_compwritev,
 	.compwritemsg = sock_ep_atomic_compwritemsg,
-	.writevalid = sock_ep_atomic_valid,
-	.readwritevalid = sock_ep_atomic_valid,
-	.compwritevalid = sock_ep_atomic_valid,
+	.writevalid = sock_ep_atomic_writevalid,
+	.readwritevalid = sock_ep_atomic_readwritevalid,
+	.compwritevalid = sock_ep_atomic_compwritevalid,
 };
@@ -138,12 +138,11 @@ static void sock_update_av_table(struct sock_av *_av, size_t count)
 		sizeof(struct sock_av_table_hdr));
 }
 
-static int sock_resize_av_table(struct sock_av *av)
+static int sock_resize_av_table(struct sock_av *av, size_t new_count)
 {
 	void *new_addr;
-	size_t new_count, table_sz, old_sz;
+	size_t table_sz, old_sz;
 
-	new_count = av->table_hdr->size * 2;
 	table_sz = SOCK_AV_TABLE_SZ(new_count, av->attr.name);
 	old_sz = SOCK_AV_TABLE_SZ(av->table_hdr->size, av->attr.name);
 
@@ -166,13 +165,41 @@ static int sock_resize_av_table(struct sock_av *av)
 	return 0;
 }
 
-static int sock_av_get_next_index(struct sock_av *av)
+/*
+ * Make sure count more addresses fit, reusing entries freed by
+ * fi_av_remove before growing the table.  The table is resized at most
+ * once per insert call.
+ */
+static int sock_av_reserve(struct sock_av *av, size_t count)
 {
-	int i;
+	size_t i, avail, new_count;
 
-	for (i = 0; i < av->table_hdr->size; i++) {
+	avail = av->table_hdr->size - av->table_hdr->stored;
+	if (avail >= count)
+		return 0;
+
+	for (i = 0; i < av->table_hdr->stored && avail < count; i++) {
 		if (!av->table[i].valid)
-			return i;
+			avail++;
+	}
+	if (avail >= count)
+		return 0;
+
+	new_count = av->table_hdr->size * 2;
+	while (new_count - av->table_hdr->size + avail < count)
+		new_count *= 2;
+
+	return sock_resize_av_table(av, new_count);
+}
+
+static int sock_av_get_next_index(struct sock_av *av, int *hole)
+{
+	if (av->table_hdr->stored < av->table_hdr->size)
+		return av->table_hdr->stored++;
+
+	for (; *hole < av->table_hdr->size; (*hole)++) {
+		if (!av->table[*hole].valid)
+			return (*hole)++;
 	}
 
 	return -1;
@@ -183,9 +210,8 @@ static int sock_check_table_in(struct sock_av *_av, struct sockaddr_in *addr,
 			       void *context)
 {
 	int i, j, ret = 0;
-	char sa_ip[INET_ADDRSTRLEN];
 	struct sock_av_addr *av_addr;
-	int index;
+	int index, hole;
 
 	if ((_av->attr.flags & FI_EVENT) && !_av->eq)
 		return -FI_ENOEQ;
@@ -216,33 +242,30 @@ static int sock_check_table_in(struct sock_av *_av, struct sockaddr_in *addr,
 		return (_av->attr.flags & FI_EVENT) ? 0 : ret;
 	}
 
-	for (i = 0, ret = 0; i < count; i++) {
+	if (sock_av_reserve(_av, count)) {
+		for (i = 0; i < count; i++) {
+			if (fi_addr)
+				fi_addr[i] = FI_ADDR_NOTAVAIL;
+			sock_av_report_error(_av, context, i, FI_ENOMEM);
+		}
+		sock_av_report_success(_av, context, 0, flags);
+		return 0;
+	}
+
+	for (i = 0, ret = 0, hole = 0; i < count; i++) {
 		if (!sock_av_is_valid_address(&addr[i])) {
 			if (fi_addr)
 				fi_addr[i] = FI_ADDR_NOTAVAIL;
 			sock_av_report_error(_av, context, i, FI_EINVAL);
 			continue;
 		}
-		if (_av->table_hdr->stored == _av->table_hdr->size) {
-			index = sock_av_get_next_index(_av);
-			if (index < 0) {
-				if (sock_resize_av_table(_av)) {
-					if (fi_addr)
-						fi_addr[i] = FI_ADDR_NOTAVAIL;
-					sock_av_report_error(_av, context, i, FI_ENOMEM);
-					continue;
-				}
-				index = _av->table_hdr->stored++;
-			}
-		} else {
-			index = _av->table_hdr->stored++;
-		}
 
+		index = sock_av_get_next_index(_av, &hole);
+		assert(index >= 0);
 		av_addr = &_av->table[index];
-		memcpy(sa_ip, inet_ntoa((&addr[i])->sin_addr), INET_ADDRSTRLEN);
 		SOCK_LOG_DBG("AV-INSERT: dst_addr family: %d, IP %s, port: %d\n",
-			      ((struct sockaddr_in *)&addr[i])->sin_family,
-				sa_ip, ntohs(((struct sockaddr_in *)&addr[i])->sin_port));
+			      addr[i].sin_family, inet_ntoa(addr[i].sin_addr),
+			      ntohs(addr[i].sin_port));
 
 		memcpy(&av_addr->addr, &addr[i], sizeof(struct sockaddr_in));
 		if (fi_addr)
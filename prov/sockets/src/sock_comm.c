@@ -41,6 +41,10 @@
 #include "sock.h"
 #include "sock_util.h"
 
+#if SOCK_HAVE_ZEROCOPY
+#include <linux/errqueue.h>
+#endif
+
 #define SOCK_LOG_DBG(...) _SOCK_LOG_DBG(FI_LOG_EP_DATA, __VA_ARGS__)
 #define SOCK_LOG_ERROR(...) _SOCK_LOG_ERROR(FI_LOG_EP_DATA, __VA_ARGS__)
 
@@ -71,6 +75,9 @@ ssize_t sock_comm_flush(struct sock_pe_entry *pe_entry)
 	size_t endlen, len, xfer_len;
 
 	len = ofi_rbused(&pe_entry->comm_buf);
+	if (!len)
+		return 0;
+
 	endlen = pe_entry->comm_buf.size -
 		(pe_entry->comm_buf.rcnt & pe_entry->comm_buf.size_mask);
 
@@ -121,11 +128,162 @@ ssize_t sock_comm_send(struct sock_pe_entry *pe_entry,
 	return ret;
 }
 
+/*
+ * On return *flags has MSG_ZEROCOPY cleared if the data was copied after
+ * all, in which case the kernel did not consume a zerocopy notification id.
+ */
+static ssize_t sock_comm_sendv_socket(struct sock_conn *conn,
+				      struct iovec *iov, size_t iov_cnt,
+				      int *flags)
+{
+	struct msghdr msg;
+	ssize_t ret;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iov_cnt;
+
+	ret = sendmsg(conn->sock_fd, &msg, MSG_NOSIGNAL | *flags);
+#if SOCK_HAVE_ZEROCOPY
+	if (ret < 0 && (*flags & MSG_ZEROCOPY) && errno == ENOBUFS) {
+		SOCK_LOG_DBG("zerocopy send out of optmem, copying\n");
+		*flags &= ~MSG_ZEROCOPY;
+		ret = sendmsg(conn->sock_fd, &msg, MSG_NOSIGNAL);
+	}
+#endif
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			ret = 0;
+		else if (errno == EPIPE) {
+			conn->connected = 0;
+			SOCK_LOG_DBG("Disconnected: %s:%d\n", inet_ntoa(conn->addr.sin_addr),
+                               ntohs(conn->addr.sin_port));
+		} else
+			SOCK_LOG_DBG("writev error: %s\n", strerror(errno));
+	}
+	if (ret > 0)
+		SOCK_LOG_DBG("wrote to network: %lu\n", ret);
+	return ret;
+}
+
+/*
+ * Send the data still staged in comm_buf followed by the given iovs with
+ * a single gather write.  Returns the number of bytes consumed from iov;
+ * staged bytes are accounted for in comm_buf only.
+ */
+ssize_t sock_comm_sendv(struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt)
+{
+	struct iovec sv[SOCK_COMM_MAX_IOV];
+	struct ofi_ringbuf *rb = &pe_entry->comm_buf;
+	size_t i, cnt = 0, used, endlen;
+	int flags = 0;
+	ssize_t ret;
+
+	assert(iov_cnt <= SOCK_COMM_MAX_IOV - 2);
+	used = ofi_rbused(rb);
+	if (used) {
+		endlen = rb->size - (rb->rcnt & rb->size_mask);
+		sv[cnt].iov_base = (char *) rb->buf + (rb->rcnt & rb->size_mask);
+		sv[cnt++].iov_len = MIN(used, endlen);
+		if (used > endlen) {
+			sv[cnt].iov_base = rb->buf;
+			sv[cnt++].iov_len = used - endlen;
+		}
+	}
+
+	for (i = 0; i < iov_cnt; i++)
+		sv[cnt++] = iov[i];
+
+#if SOCK_HAVE_ZEROCOPY
+	if (pe_entry->conn->zerocopy && !(pe_entry->flags & FI_INJECT) &&
+	    pe_entry->data_len >= (uint64_t) sock_zerocopy_thresh)
+		flags = MSG_ZEROCOPY;
+#endif
+	ret = sock_comm_sendv_socket(pe_entry->conn, sv, cnt, &flags);
+	if (ret <= 0)
+		return 0;
+
+	if (flags & MSG_ZEROCOPY) {
+		pe_entry->pe.tx.zc_id = pe_entry->conn->zc_issued++;
+		pe_entry->pe.tx.zc_pending = 1;
+	}
+
+	if ((size_t) ret <= used) {
+		rb->rcnt += ret;
+		return 0;
+	}
+
+	rb->rcnt += used;
+	return ret - used;
+}
+
 int sock_comm_tx_done(struct sock_pe_entry *pe_entry)
 {
 	return ofi_rbempty(&pe_entry->comm_buf);
 }
 
+#if SOCK_HAVE_ZEROCOPY
+static void sock_comm_zerocopy_reap(struct sock_conn *conn)
+{
+	char control[CMSG_SPACE(sizeof(struct sock_extended_err) +
+				sizeof(struct sockaddr_in6))];
+	struct sock_extended_err *serr;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+
+	for (;;) {
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if (recvmsg(conn->sock_fd, &msg, MSG_ERRQUEUE) < 0)
+			return;
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+		     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if (!((cmsg->cmsg_level == SOL_IP &&
+			       cmsg->cmsg_type == IP_RECVERR) ||
+			      (cmsg->cmsg_level == SOL_IPV6 &&
+			       cmsg->cmsg_type == IPV6_RECVERR)))
+				continue;
+
+			serr = (struct sock_extended_err *) CMSG_DATA(cmsg);
+			if (serr->ee_errno || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+
+			/* ee_info..ee_data is the range of completed sends */
+			conn->zc_done = serr->ee_data + 1;
+			if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+				SOCK_LOG_DBG("zerocopy sends %u-%u were copied\n",
+					     serr->ee_info, serr->ee_data);
+		}
+	}
+}
+#endif
+
+/*
+ * The user buffer of a MSG_ZEROCOPY send stays pinned by the kernel until
+ * the completion notification for it is read from the socket error queue.
+ */
+int sock_comm_zerocopy_done(struct sock_pe_entry *pe_entry)
+{
+#if SOCK_HAVE_ZEROCOPY
+	struct sock_conn *conn = pe_entry->conn;
+
+	if (!pe_entry->pe.tx.zc_pending)
+		return 1;
+
+	if ((int32_t) (conn->zc_done - pe_entry->pe.tx.zc_id) <= 0)
+		sock_comm_zerocopy_reap(conn);
+
+	if ((int32_t) (conn->zc_done - pe_entry->pe.tx.zc_id) <= 0)
+		return 0;
+
+	pe_entry->pe.tx.zc_pending = 0;
+#endif
+	return 1;
+}
+
 static ssize_t sock_comm_recv_socket(struct sock_conn *conn,
 			      void *buf, size_t len)
 {
@@ -148,6 +306,34 @@ static ssize_t sock_comm_recv_socket(struct sock_conn *conn,
 	return ret;
 }
 
+static ssize_t sock_comm_recvv_socket(struct sock_conn *conn,
+				      struct iovec *iov, size_t iov_cnt)
+{
+	struct msghdr msg;
+	ssize_t ret;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iov_cnt;
+
+	ret = recvmsg(conn->sock_fd, &msg, 0);
+	if (ret == 0) {
+		conn->connected = 0;
+		SOCK_LOG_DBG("Disconnected: %s:%d\n", inet_ntoa(conn->addr.sin_addr),
+                               ntohs(conn->addr.sin_port));
+		return ret;
+	}
+
+	if (ret < 0) {
+		SOCK_LOG_DBG("readv %s\n", strerror(errno));
+		ret = 0;
+	}
+
+	if (ret > 0)
+		SOCK_LOG_DBG("read from network: %lu\n", ret);
+	return ret;
+}
+
 static void sock_comm_recv_buffer(struct sock_pe_entry *pe_entry)
 {
 	int ret;
@@ -184,6 +370,34 @@ ssize_t sock_comm_recv(struct sock_pe_entry *pe_entry, void *buf, size_t len)
 	return read_len;
 }
 
+/*
+ * Scatter received data directly into the given iovs.  Data already
+ * staged in comm_buf is drained first; the socket is only read once the
+ * staging buffer is empty, so payloads land in the user buffers without
+ * a bounce copy.
+ */
+ssize_t sock_comm_recvv(struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt)
+{
+	struct iovec rv[SOCK_COMM_MAX_IOV];
+	size_t i, read_len, done = 0;
+
+	assert(iov_cnt <= SOCK_COMM_MAX_IOV);
+	if (ofi_rbempty(&pe_entry->comm_buf)) {
+		for (i = 0; i < iov_cnt; i++)
+			rv[i] = iov[i];
+		return sock_comm_recvv_socket(pe_entry->conn, rv, iov_cnt);
+	}
+
+	for (i = 0; i < iov_cnt && !ofi_rbempty(&pe_entry->comm_buf); i++) {
+		read_len = MIN(iov[i].iov_len, ofi_rbused(&pe_entry->comm_buf));
+		ofi_rbread(&pe_entry->comm_buf, iov[i].iov_base, read_len);
+		done += read_len;
+	}
+	SOCK_LOG_DBG("read from buffer: %lu\n", done);
+	return done;
+}
+
 ssize_t sock_comm_peek(struct sock_conn *conn, void *buf, size_t len)
 {
 	ssize_t ret;
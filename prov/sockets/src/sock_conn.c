@@ -187,6 +187,8 @@ static struct sock_conn *sock_conn_map_insert(struct sock_ep_attr *ep_attr,
 	map->table[index].sock_fd = conn_fd;
 	map->table[index].ep_attr = ep_attr;
 	sock_set_sockopts(conn_fd);
+	map->table[index].zerocopy = sock_set_sockopt_zerocopy(conn_fd);
+	map->table[index].zc_issued = map->table[index].zc_done = 0;
 
 
 	if (ofi_idm_set(&ep_attr->conn_idm, conn_fd, &map->table[index]) < 0)
@@ -220,6 +222,24 @@ void sock_set_sockopt_reuseaddr(int sock)
 		SOCK_LOG_ERROR("setsockopt reuseaddr failed\n");
 }
 
+int sock_set_sockopt_zerocopy(int sock)
+{
+#if SOCK_HAVE_ZEROCOPY
+	int optval = 1;
+
+	if (!sock_zerocopy_thresh)
+		return 0;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval))) {
+		SOCK_LOG_DBG("SO_ZEROCOPY not supported, using copy path\n");
+		return 0;
+	}
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 void sock_set_sockopts_conn(int sock)
 {
 	int optval;
@@ -161,6 +161,7 @@ static int sock_dom_close(struct fid *fid)
 		return -FI_EBUSY;
 
 	sock_pe_finalize(dom->pe);
+	ofi_stats_close(&dom->stats);
 	fastlock_destroy(&dom->lock);
 	ofi_mr_close(dom->mr_heap);
 	sock_dom_remove_from_list(dom);
@@ -389,12 +390,17 @@ static int sock_scalable_ep(struct fid_domain *domain, struct fi_info *info,
 	}
 }
 
+static const char * const sock_dom_stat_names[] = {
+	[SOCK_STAT_PE_ENTRY_EXHAUSTED] = "pe_entry_exhausted",
+	[SOCK_STAT_PE_POOL_GROW] = "pe_pool_grow",
+};
+
 static struct fi_ops sock_dom_fi_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = sock_dom_close,
 	.bind = sock_dom_bind,
 	.control = fi_no_control,
-	.ops_open = fi_no_ops_open,
+	.ops_open = ofi_stats_ops_open,
 };
 
 static struct fi_ops_domain sock_dom_ops = {
@@ -456,9 +462,15 @@ int sock_domain(struct fid_fabric *fabric, struct fi_info *info,
 	else
 		sock_domain->progress_mode = info->domain_attr->data_progress;
 
+	if (ofi_stats_init(&sock_domain->stats, &sock_prov,
+			   &sock_domain->dom_fid.fid, "domain",
+			   sock_dom_stat_names, SOCK_STAT_MAX))
+		goto err;
+
 	sock_domain->pe = sock_pe_init(sock_domain);
 	if (!sock_domain->pe) {
 		SOCK_LOG_ERROR("Failed to init PE\n");
+		ofi_stats_close(&sock_domain->stats);
 		goto err;
 	}
 
@@ -64,6 +64,7 @@ int sock_av_def_sz = SOCK_AV_DEF_SZ;
 int sock_cq_def_sz = SOCK_CQ_DEF_SZ;
 int sock_eq_def_sz = SOCK_EQ_DEF_SZ;
 char *sock_pe_affinity_str = NULL;
+int sock_zerocopy_thresh = 0;
 #if ENABLE_DEBUG
 int sock_dgram_drop_rate = 0;
 #endif
@@ -341,6 +342,7 @@ static void sock_read_default_params()
 		fi_param_get_int(&sock_prov, "def_eq_sz", &sock_eq_def_sz);
 		if (fi_param_get_str(&sock_prov, "pe_affinity", &sock_pe_affinity_str) != FI_SUCCESS)
 			sock_pe_affinity_str = NULL;
+		fi_param_get_int(&sock_prov, "zerocopy_thresh", &sock_zerocopy_thresh);
 #if ENABLE_DEBUG
 		fi_param_get_int(&sock_prov, "dgram_drop_rate", &sock_dgram_drop_rate);
 #endif
@@ -760,6 +762,10 @@ SOCKETS_INI
 			"If specified, bind the progress thread to the indicated range(s) of Linux virtual processor ID(s). "
 			"This option is currently not supported on OS X. Usage: id_start[-id_end[:stride]][,]");
 
+	fi_param_define(&sock_prov, "zerocopy_thresh", FI_PARAM_INT,
+			"Payload size in bytes at or above which sends use "
+			"MSG_ZEROCOPY (Linux only, default: 0, disabled)");
+
 	fastlock_init(&sock_list_lock);
 	dlist_init(&sock_fab_list);
 	dlist_init(&sock_dom_list);
@@ -52,11 +52,11 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <inttypes.h>
-#include <complex.h>
 #include <arpa/inet.h>
 #include <net/if.h>
 
 #include <fi_mem.h>
+#include <fi_atomic_op.h>
 #include "sock.h"
 #include "sock_util.h"
 
@@ -122,6 +122,72 @@ static inline ssize_t sock_pe_recv_field(struct sock_pe_entry *pe_entry,
 	return (ret == data_len) ? 0 : -1;
 }
 
+static size_t sock_pe_trim_iov(struct iovec *dst, const struct iovec *src,
+			       size_t iov_cnt, size_t offset, size_t *len)
+{
+	size_t i, cnt = 0;
+
+	*len = 0;
+	for (i = 0; i < iov_cnt; i++) {
+		if (offset >= src[i].iov_len) {
+			offset -= src[i].iov_len;
+			continue;
+		}
+		dst[cnt].iov_base = (char *) src[i].iov_base + offset;
+		dst[cnt].iov_len = src[i].iov_len - offset;
+		*len += dst[cnt++].iov_len;
+		offset = 0;
+	}
+	return cnt;
+}
+
+/*
+ * Gather variants of sock_pe_send_field/sock_pe_recv_field: the iovs
+ * describe consecutive fields on the wire starting at start_offset, and
+ * are transferred with a single writev/readv where possible.
+ */
+static inline ssize_t sock_pe_send_iov(struct sock_pe_entry *pe_entry,
+				       const struct iovec *iov, size_t iov_cnt,
+				       size_t start_offset)
+{
+	struct iovec sv[SOCK_COMM_MAX_IOV - 2];
+	size_t cnt, data_len;
+	ssize_t ret;
+
+	cnt = sock_pe_trim_iov(sv, iov, iov_cnt,
+			       pe_entry->done_len - start_offset, &data_len);
+	if (!cnt)
+		return 0;
+
+	ret = sock_comm_sendv(pe_entry, sv, cnt);
+	if (ret <= 0)
+		return -1;
+
+	pe_entry->done_len += ret;
+	return (ret == data_len) ? 0 : -1;
+}
+
+static inline ssize_t sock_pe_recv_iov(struct sock_pe_entry *pe_entry,
+				       const struct iovec *iov, size_t iov_cnt,
+				       size_t start_offset)
+{
+	struct iovec rv[SOCK_COMM_MAX_IOV];
+	size_t cnt, data_len;
+	ssize_t ret;
+
+	cnt = sock_pe_trim_iov(rv, iov, iov_cnt,
+			       pe_entry->done_len - start_offset, &data_len);
+	if (!cnt)
+		return 0;
+
+	ret = sock_comm_recvv(pe_entry, rv, cnt);
+	if (ret <= 0)
+		return -1;
+
+	pe_entry->done_len += ret;
+	return (ret == data_len) ? 0 : -1;
+}
+
 static inline void sock_pe_discard_field(struct sock_pe_entry *pe_entry)
 {
 	size_t ret;
@@ -195,6 +261,7 @@ static struct sock_pe_entry *sock_pe_acquire_entry(struct sock_pe *pe)
 	struct sock_pe_entry *pe_entry;
 
 	if (dlist_empty(&pe->free_list)) {
+		ofi_stats_inc(&pe->domain->stats, SOCK_STAT_PE_ENTRY_EXHAUSTED);
 		pe_entry = util_buf_alloc(pe->pe_rx_pool);
 		SOCK_LOG_DBG("Getting rx pool entry\n");
 		if (pe_entry) {
@@ -704,7 +771,9 @@ static int sock_pe_process_rx_write(struct sock_pe *pe,
 {
 	int i, ret = 0;
 	struct sock_mr *mr;
+	struct iovec iov[SOCK_EP_MAX_IOV_LIMIT];
 	uint64_t rem, len, entry_len;
+	size_t iov_cnt;
 
 	len = sizeof(struct sock_msg_hdr);
 	if (pe_entry->msg_hdr.flags & FI_REMOTE_CQ_DATA) {
@@ -741,13 +810,13 @@ static int sock_pe_process_rx_write(struct sock_pe *pe,
 
 	rem = pe_entry->msg_hdr.msg_len - len;
 	for (i = 0; rem > 0 && i < pe_entry->msg_hdr.dest_iov_len; i++) {
-		if (sock_pe_recv_field(pe_entry,
-				       (void *) (uintptr_t) pe_entry->pe.rx.rx_iov[i].iov.addr,
-				       pe_entry->pe.rx.rx_iov[i].iov.len, len))
-			return 0;
-		len += pe_entry->pe.rx.rx_iov[i].iov.len;
+		iov[i].iov_base = (void *) (uintptr_t) pe_entry->pe.rx.rx_iov[i].iov.addr;
+		iov[i].iov_len = pe_entry->pe.rx.rx_iov[i].iov.len;
 		rem -= pe_entry->pe.rx.rx_iov[i].iov.len;
 	}
+	iov_cnt = i;
+	if (sock_pe_recv_iov(pe_entry, iov, iov_cnt, len))
+		return 0;
 	pe_entry->buf = pe_entry->pe.rx.rx_iov[0].iov.addr;
 	pe_entry->data_len = 0;
 	for (i = 0; i < pe_entry->msg_hdr.dest_iov_len; i++) {
@@ -769,396 +838,22 @@ out:
 	return ret;
 }
 
-#define SOCK_ATOMIC_UPDATE_INT(_cmp, _src, _dst, _tmp) do {		\
-	switch (op) {							\
-	case FI_MIN:							\
-		*_cmp = *_dst;						\
-		if (*_src < *_dst)					\
-			*_dst = *_src;					\
-		break;							\
-									\
-	case FI_MAX:							\
-		*_cmp = *_dst;						\
-		if (*_src > *_dst)					\
-			*_dst = *_src;					\
-		break;							\
-									\
-	case FI_SUM:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst + *_src;					\
-		break;							\
-									\
-	case FI_PROD:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst * *_src;					\
-		break;							\
-									\
-	case FI_LOR:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst || *_src;					\
-		break;							\
-									\
-	case FI_LAND:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst && *_src;					\
-		break;							\
-									\
-	case FI_BOR:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst | *_src;					\
-		break;							\
-									\
-	case FI_BAND:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst & *_src;					\
-		break;							\
-									\
-	case FI_LXOR:							\
-		*_cmp = *_dst;						\
-									\
-		*_dst = ((*_dst && !*_src) || (!*_dst && *_src));	\
-		break;							\
-									\
-	case FI_BXOR:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst ^ *_src;					\
-		break;							\
-									\
-	case FI_ATOMIC_READ:						\
-		*_cmp = *_dst;						\
-		break;							\
-									\
-	case FI_ATOMIC_WRITE:						\
-		*_cmp = *_dst;						\
-		*_dst = *_src;						\
-		break;							\
-									\
-	case FI_CSWAP:							\
-		if (*_cmp == *_dst)					\
-			*_dst = *_src;					\
-		else							\
-			*_cmp = *_dst;					\
-		break;							\
-									\
-	case FI_CSWAP_NE:						\
-		_tmp = *_dst;						\
-		if (*_cmp != *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	case FI_CSWAP_LE:						\
-		_tmp = *_dst;						\
-		if (*_cmp <= *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	case FI_CSWAP_LT:						\
-		_tmp = *_dst;						\
-		if (*_cmp < *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	case FI_CSWAP_GE:						\
-		_tmp = *_dst;						\
-		if (*_cmp >= *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	case FI_CSWAP_GT:						\
-		_tmp = *_dst;						\
-		if (*_cmp > *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	case FI_MSWAP:							\
-		_tmp = *_dst;						\
-		*_dst = (*_src & *_cmp) | (*_dst & ~(*_cmp));		\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	default:							\
-		SOCK_LOG_ERROR("Atomic operation type not supported\n"); \
-		break;							\
-	}								\
-} while (0)
-
-#define SOCK_ATOMIC_UPDATE_FLOAT(_cmp, _src, _dst) do {			\
-	switch (op) {							\
-	case FI_MIN:							\
-		*_cmp = *_dst;						\
-		if (*_src < *_dst)					\
-			*_dst = *_src;					\
-		break;							\
-									\
-	case FI_MAX:							\
-		*_cmp = *_dst;						\
-		if (*_src > *_dst)					\
-			*_dst = *_src;					\
-		break;							\
-									\
-	case FI_SUM:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst + *_src;					\
-		break;							\
-									\
-	case FI_PROD:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst * *_src;					\
-		break;							\
-									\
-	case FI_LOR:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst || *_src;					\
-		break;							\
-									\
-	case FI_LAND:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst && *_src;					\
-		break;							\
-									\
-	case FI_ATOMIC_READ:						\
-		*_cmp = *_dst;						\
-		break;							\
-									\
-	case FI_ATOMIC_WRITE:						\
-		*_cmp = *_dst;						\
-		*_dst = *_src;						\
-		break;							\
-									\
-	case FI_CSWAP:							\
-		if (*_cmp == *_dst)					\
-			*_dst = *_src;					\
-		else							\
-			*_cmp = *_dst;					\
-		break;							\
-									\
-	case FI_CSWAP_NE:						\
-		_tmp = *_dst;						\
-		if (*_cmp != *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	case FI_CSWAP_LE:						\
-		_tmp = *_dst;						\
-		if (*_cmp <= *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	case FI_CSWAP_LT:						\
-		_tmp = *_dst;						\
-		if (*_cmp < *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	case FI_CSWAP_GE:						\
-		_tmp = *_dst;						\
-		if (*_cmp >= *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	case FI_CSWAP_GT:						\
-		_tmp = *_dst;						\
-		if (*_cmp > *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	default:							\
-		SOCK_LOG_ERROR("Atomic operation type not supported\n"); \
-		break;							\
-	}								\
-} while (0)
-
-#define SOCK_ATOMIC_UPDATE_COMPLEX(_cmp, _src, _dst) do {		\
-	switch (op) {							\
-	case FI_SUM:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst + *_src;					\
-		break;							\
-									\
-	case FI_PROD:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst * *_src;					\
-		break;							\
-									\
-	case FI_LOR:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst || *_src;					\
-		break;							\
-									\
-	case FI_LAND:							\
-		*_cmp = *_dst;						\
-		*_dst = *_dst && *_src;					\
-		break;							\
-									\
-	case FI_ATOMIC_READ:						\
-		*_cmp = *_dst;						\
-		break;							\
-									\
-	case FI_ATOMIC_WRITE:						\
-		*_cmp = *_dst;						\
-		*_dst = *_src;						\
-		break;							\
-									\
-	case FI_CSWAP:							\
-		if (*_cmp == *_dst)					\
-			*_dst = *_src;					\
-		else							\
-			*_cmp = *_dst;					\
-		break;							\
-									\
-	case FI_CSWAP_NE:						\
-		_tmp = *_dst;						\
-		if (*_cmp != *_dst)					\
-			*_dst = *_src;					\
-		*_cmp = _tmp;						\
-		break;							\
-									\
-	default:							\
-		SOCK_LOG_ERROR("Atomic operation type not supported\n");\
-		break;							\
-	}								\
-} while (0)
-
-
-static int sock_pe_update_atomic(void *cmp, void *dst, void *src,
-				 enum fi_datatype datatype, enum fi_op op)
-{
-	switch (datatype) {
-	case FI_INT8:
-	{
-		int8_t *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_INT(_cmp, _src, _dst, _tmp);
-		break;
-	}
-
-	case FI_UINT8:
-	{
-		uint8_t *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_INT(_cmp, _src, _dst, _tmp);
-		break;
-	}
-
-	case FI_INT16:
-	{
-		int16_t *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_INT(_cmp, _src, _dst, _tmp);
-		break;
-	}
-
-	case FI_UINT16:
-	{
-		uint16_t *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_INT(_cmp, _src, _dst, _tmp);
-		break;
-	}
-
-	case FI_INT32:
-	{
-		int32_t *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_INT(_cmp, _src, _dst, _tmp);
-		break;
-	}
-
-	case FI_UINT32:
-	{
-		uint32_t *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_INT(_cmp, _src, _dst, _tmp);
-		break;
-	}
-
-	case FI_INT64:
-	{
-		int64_t *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_INT(_cmp, _src, _dst, _tmp);
-		break;
-	}
-
-	case FI_UINT64:
-	{
-		uint64_t *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_INT(_cmp, _src, _dst, _tmp);
-		break;
-	}
-
-	case FI_FLOAT:
-	{
-		float *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_FLOAT(_cmp, _src, _dst);
-		break;
-	}
-
-	case FI_DOUBLE:
-	{
-		double *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_FLOAT(_cmp, _src, _dst);
-		break;
-	}
-
-	case FI_LONG_DOUBLE:
-	{
-		long double *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_FLOAT(_cmp, _src, _dst);
-		break;
-	}
-
-	case FI_DOUBLE_COMPLEX:
-	{
-		double complex *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_COMPLEX(_cmp, _src, _dst);
-		break;
-	}
-
-	case FI_FLOAT_COMPLEX:
-	{
-		float complex *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_COMPLEX(_cmp, _src, _dst);
-		break;
-	}
-
-	case FI_LONG_DOUBLE_COMPLEX:
-	{
-		long double complex *_cmp, *_dst, *_src, _tmp;
-		_cmp = cmp, _src = src, _dst = dst;
-		SOCK_ATOMIC_UPDATE_COMPLEX(_cmp, _src, _dst);
-		break;
-	}
-
-	default:
-		SOCK_LOG_ERROR("Atomic datatype not supported\n");
-		break;
+static void sock_pe_update_atomic(void *cmp, void *dst, void *src,
+				  size_t cnt, enum fi_datatype datatype,
+				  enum fi_op op)
+{
+	if (ofi_atomic_isswap_op(op)) {
+		ofi_atomic_swap_handler(op, datatype, dst, src, cmp, cmp, cnt);
+		return;
 	}
-	return 0;
+	ofi_atomic_readwrite_handler(op, datatype, dst, src, cmp, cnt);
 }
 
-
 static int sock_pe_process_rx_atomic(struct sock_pe *pe,
 				struct sock_rx_ctx *rx_ctx,
 				struct sock_pe_entry *pe_entry)
 {
-	int i, j, ret = 0;
+	int i, ret = 0;
 	size_t datatype_sz;
 	struct sock_mr *mr;
 	uint64_t offset, len, entry_len;
@@ -1205,6 +900,17 @@ static int sock_pe_process_rx_atomic(struct sock_pe *pe,
 		len += entry_len;
 	}
 
+	if (!pe_entry->mr_checked &&
+	    ofi_atomic_valid(&sock_prov, pe_entry->pe.rx.rx_op.atomic.datatype,
+			     pe_entry->pe.rx.rx_op.atomic.op, 1)) {
+		SOCK_LOG_ERROR("Atomic operation not supported\n");
+		pe_entry->is_error = 1;
+		pe_entry->rem = pe_entry->total_len - pe_entry->done_len;
+		sock_pe_send_response(pe, rx_ctx, pe_entry, 0,
+				      SOCK_OP_ATOMIC_ERROR, FI_EOPNOTSUPP);
+		return 0;
+	}
+
 	for (i = 0; i < pe_entry->pe.rx.rx_op.dest_iov_len && !pe_entry->mr_checked; i++) {
 		mr = sock_mr_verify_key(rx_ctx->domain,
 					pe_entry->pe.rx.rx_iov[i].ioc.key,
@@ -1242,14 +948,13 @@ static int sock_pe_process_rx_atomic(struct sock_pe *pe,
 
 	offset = 0;
 	for (i = 0; i < pe_entry->pe.rx.rx_op.dest_iov_len; i++) {
-		for (j = 0; j < pe_entry->pe.rx.rx_iov[i].ioc.count; j++) {
-			sock_pe_update_atomic(pe_entry->pe.rx.atomic_cmp + offset,
-					      (char *) (uintptr_t) pe_entry->pe.rx.rx_iov[i].ioc.addr + j * datatype_sz,
-					      pe_entry->pe.rx.atomic_src + offset,
-					      pe_entry->pe.rx.rx_op.atomic.datatype,
-					      pe_entry->pe.rx.rx_op.atomic.op);
-			offset += datatype_sz;
-		}
+		sock_pe_update_atomic(pe_entry->pe.rx.atomic_cmp + offset,
+				      (void *) (uintptr_t) pe_entry->pe.rx.rx_iov[i].ioc.addr,
+				      pe_entry->pe.rx.atomic_src + offset,
+				      pe_entry->pe.rx.rx_iov[i].ioc.count,
+				      pe_entry->pe.rx.rx_op.atomic.datatype,
+				      pe_entry->pe.rx.rx_op.atomic.op);
+		offset += pe_entry->pe.rx.rx_iov[i].ioc.count * datatype_sz;
 	}
 
 	pe_entry->buf = pe_entry->pe.rx.rx_iov[0].iov.addr;
@@ -1478,9 +1183,10 @@ static int sock_pe_process_rx_send(struct sock_pe *pe,
 {
 	ssize_t i, ret = 0;
 	struct sock_rx_entry *rx_entry;
-	uint64_t len, rem, offset, data_len, done_data, used;
+	struct iovec iov[SOCK_EP_MAX_IOV_LIMIT];
+	uint64_t len, rem, data_len, done_data, used;
+	size_t iov_cnt, iov_len;
 
-	offset = 0;
 	len = sizeof(struct sock_msg_hdr);
 
 	if (pe_entry->msg_hdr.op_type == SOCK_OP_TSEND) {
@@ -1539,7 +1245,9 @@ static int sock_pe_process_rx_send(struct sock_pe *pe,
 	rem = pe_entry->data_len - done_data;
 	used = rx_entry->used;
 
-	for (i = 0; rem > 0 && i < rx_entry->rx_op.dest_iov_len; i++) {
+	/* scatter the payload straight into the matched receive buffers */
+	iov_cnt = iov_len = 0;
+	for (i = 0; iov_len < rem && i < rx_entry->rx_op.dest_iov_len; i++) {
 
 		/* skip used contents in rx_entry */
 		if (used >= rx_entry->iov[i].iov.len) {
@@ -1547,21 +1255,25 @@ static int sock_pe_process_rx_send(struct sock_pe *pe,
 			continue;
 		}
 
-		offset = used;
-		data_len = MIN(rx_entry->iov[i].iov.len - used, rem);
-		ret = sock_comm_recv(pe_entry,
-				     (char *) (uintptr_t) rx_entry->iov[i].iov.addr + offset,
-				     data_len);
+		iov[iov_cnt].iov_base =
+			(char *) (uintptr_t) rx_entry->iov[i].iov.addr + used;
+		iov[iov_cnt].iov_len = MIN(rx_entry->iov[i].iov.len - used,
+					   rem - iov_len);
+		iov_len += iov[iov_cnt++].iov_len;
+		used = 0;
+	}
+
+	if (iov_cnt) {
+		ret = sock_comm_recvv(pe_entry, iov, iov_cnt);
 		if (ret <= 0)
 			return ret;
 
 		if (!pe_entry->buf)
-			pe_entry->buf = rx_entry->iov[i].iov.addr + offset;
+			pe_entry->buf = (uintptr_t) iov[0].iov_base;
 		rem -= ret;
-		used = 0;
 		pe_entry->done_len += ret;
 		rx_entry->used += ret;
-		if (ret != data_len)
+		if (ret != iov_len)
 			return 0;
 	}
 
@@ -1898,6 +1610,7 @@ static int sock_pe_progress_tx_write(struct sock_pe *pe,
 				     struct sock_conn *conn)
 {
 	union sock_iov dest_iov[SOCK_EP_MAX_IOV_LIMIT];
+	struct iovec iov[SOCK_EP_MAX_IOV_LIMIT];
 	ssize_t len, i, dest_iov_len;
 
 	if (pe_entry->pe.tx.send_done)
@@ -1932,18 +1645,18 @@ static int sock_pe_progress_tx_write(struct sock_pe *pe,
 	} else {
 		pe_entry->data_len = 0;
 		for (i = 0; i < pe_entry->pe.tx.tx_op.src_iov_len; i++) {
-			if (sock_pe_send_field(
-				    pe_entry,
-				    (void *) (uintptr_t) pe_entry->pe.tx.tx_iov[i].src.iov.addr,
-				    pe_entry->pe.tx.tx_iov[i].src.iov.len, len))
-				return 0;
-			len += pe_entry->pe.tx.tx_iov[i].src.iov.len;
-			pe_entry->data_len += pe_entry->pe.tx.tx_iov[i].src.iov.len;
+			iov[i].iov_base = (void *) (uintptr_t)
+				pe_entry->pe.tx.tx_iov[i].src.iov.addr;
+			iov[i].iov_len = pe_entry->pe.tx.tx_iov[i].src.iov.len;
+			pe_entry->data_len += iov[i].iov_len;
 		}
+		if (sock_pe_send_iov(pe_entry, iov, i, len))
+			return 0;
+		len += pe_entry->data_len;
 	}
 
 	sock_comm_flush(pe_entry);
-	if (!sock_comm_tx_done(pe_entry))
+	if (!sock_comm_tx_done(pe_entry) || !sock_comm_zerocopy_done(pe_entry))
 		return 0;
 
 	if (pe_entry->done_len == pe_entry->total_len) {
@@ -2001,45 +1714,46 @@ static int sock_pe_progress_tx_send(struct sock_pe *pe,
 				    struct sock_pe_entry *pe_entry,
 				    struct sock_conn *conn)
 {
-	size_t len, i;
+	struct iovec iov[SOCK_EP_MAX_IOV_LIMIT + 2];
+	size_t i, iov_cnt = 0;
+
 	if (pe_entry->pe.tx.send_done)
 		return 0;
 
-	len = sizeof(struct sock_msg_hdr);
+	/*
+	 * The op header is staged in comm_buf; tag, cq data and payload
+	 * follow it out in a single gather write.
+	 */
 	if (pe_entry->pe.tx.tx_op.op == SOCK_OP_TSEND) {
-		if (sock_pe_send_field(pe_entry, &pe_entry->tag,
-				       SOCK_TAG_SIZE, len))
-			return 0;
-		len += SOCK_TAG_SIZE;
+		iov[iov_cnt].iov_base = &pe_entry->tag;
+		iov[iov_cnt++].iov_len = SOCK_TAG_SIZE;
 	}
 
 	if (pe_entry->flags & FI_REMOTE_CQ_DATA) {
-		if (sock_pe_send_field(pe_entry, &pe_entry->data,
-				       SOCK_CQ_DATA_SIZE, len))
-			return 0;
-		len += SOCK_CQ_DATA_SIZE;
+		iov[iov_cnt].iov_base = &pe_entry->data;
+		iov[iov_cnt++].iov_len = SOCK_CQ_DATA_SIZE;
 	}
 
 	if (pe_entry->flags & FI_INJECT) {
-		if (sock_pe_send_field(pe_entry, pe_entry->pe.tx.inject,
-				       pe_entry->pe.tx.tx_op.src_iov_len, len))
-			return 0;
-		len += pe_entry->pe.tx.tx_op.src_iov_len;
+		iov[iov_cnt].iov_base = pe_entry->pe.tx.inject;
+		iov[iov_cnt++].iov_len = pe_entry->pe.tx.tx_op.src_iov_len;
 		pe_entry->data_len = pe_entry->pe.tx.tx_op.src_iov_len;
 	} else {
 		pe_entry->data_len = 0;
 		for (i = 0; i < pe_entry->pe.tx.tx_op.src_iov_len; i++) {
-			if (sock_pe_send_field(pe_entry,
-				    (void *) (uintptr_t) pe_entry->pe.tx.tx_iov[i].src.iov.addr,
-				    pe_entry->pe.tx.tx_iov[i].src.iov.len, len))
-				return 0;
-			len += pe_entry->pe.tx.tx_iov[i].src.iov.len;
+			iov[iov_cnt].iov_base = (void *) (uintptr_t)
+				pe_entry->pe.tx.tx_iov[i].src.iov.addr;
+			iov[iov_cnt++].iov_len = pe_entry->pe.tx.tx_iov[i].src.iov.len;
 			pe_entry->data_len += pe_entry->pe.tx.tx_iov[i].src.iov.len;
 		}
 	}
 
+	if (sock_pe_send_iov(pe_entry, iov, iov_cnt,
+			     sizeof(struct sock_msg_hdr)))
+		return 0;
+
 	sock_comm_flush(pe_entry);
-	if (!sock_comm_tx_done(pe_entry))
+	if (!sock_comm_tx_done(pe_entry) || !sock_comm_zerocopy_done(pe_entry))
 		return 0;
 
 	pe_entry->tag = 0;
@@ -2874,6 +2588,8 @@ struct sock_pe *sock_pe_init(struct sock_domain *domain)
 		SOCK_LOG_ERROR("failed to create buffer pool\n");
 		goto err1;
 	}
+	util_buf_pool_set_stats(pe->pe_rx_pool, &domain->stats,
+				SOCK_STAT_PE_POOL_GROW);
 
 	pe->atomic_rx_pool = util_buf_pool_create(SOCK_EP_MAX_ATOMIC_SZ,
 						  16, 0, 32);
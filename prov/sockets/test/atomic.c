@@ -0,0 +1,455 @@
+/*
+ * Copyright (c) 2017 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks every atomic op and datatype the sockets provider reports as
+ * valid against a scalar reference, by issuing it to the local endpoint.
+ * The values used are small integers, so the reference is computed on
+ * longs and every result is exact in every datatype.  With -b, also
+ * reports the throughput of one op and datatype.
+ */
+
+#include "config.h"
+
+#include <complex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_atomic.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_errno.h>
+
+#define AT_COUNT	17
+#define AT_KEY		0xa7
+#define AT_BUF_SIZE	4096
+
+enum at_kind {
+	AT_WRITE,
+	AT_FETCH,
+	AT_COMPARE,
+	AT_KIND_LAST
+};
+
+static const char *at_kind_str[] = { "atomic", "fetch_atomic",
+				     "compare_atomic" };
+
+static struct fi_info *info;
+static struct fid_fabric *fabric;
+static struct fid_domain *domain;
+static struct fid_av *av;
+static struct fid_cq *cq;
+static struct fid_ep *ep;
+static struct fid_mr *mr;
+static fi_addr_t self;
+
+static char target[AT_BUF_SIZE], src[AT_BUF_SIZE], cmp[AT_BUF_SIZE];
+static char result[AT_BUF_SIZE];
+
+static void at_set(enum fi_datatype dt, void *buf, size_t i, long v)
+{
+	switch (dt) {
+	case FI_INT8: ((int8_t *) buf)[i] = (int8_t) v; break;
+	case FI_UINT8: ((uint8_t *) buf)[i] = (uint8_t) v; break;
+	case FI_INT16: ((int16_t *) buf)[i] = (int16_t) v; break;
+	case FI_UINT16: ((uint16_t *) buf)[i] = (uint16_t) v; break;
+	case FI_INT32: ((int32_t *) buf)[i] = (int32_t) v; break;
+	case FI_UINT32: ((uint32_t *) buf)[i] = (uint32_t) v; break;
+	case FI_INT64: ((int64_t *) buf)[i] = (int64_t) v; break;
+	case FI_UINT64: ((uint64_t *) buf)[i] = (uint64_t) v; break;
+	case FI_FLOAT: ((float *) buf)[i] = (float) v; break;
+	case FI_DOUBLE: ((double *) buf)[i] = (double) v; break;
+	case FI_FLOAT_COMPLEX: ((float complex *) buf)[i] = v; break;
+	case FI_DOUBLE_COMPLEX: ((double complex *) buf)[i] = v; break;
+	case FI_LONG_DOUBLE: ((long double *) buf)[i] = v; break;
+	case FI_LONG_DOUBLE_COMPLEX:
+		((long double complex *) buf)[i] = v;
+		break;
+	default:
+		break;
+	}
+}
+
+/* Returns 1 if element i of buf holds exactly v */
+static int at_equal(enum fi_datatype dt, const void *buf, size_t i, long v)
+{
+	switch (dt) {
+	case FI_INT8: return ((int8_t *) buf)[i] == (int8_t) v;
+	case FI_UINT8: return ((uint8_t *) buf)[i] == (uint8_t) v;
+	case FI_INT16: return ((int16_t *) buf)[i] == (int16_t) v;
+	case FI_UINT16: return ((uint16_t *) buf)[i] == (uint16_t) v;
+	case FI_INT32: return ((int32_t *) buf)[i] == (int32_t) v;
+	case FI_UINT32: return ((uint32_t *) buf)[i] == (uint32_t) v;
+	case FI_INT64: return ((int64_t *) buf)[i] == (int64_t) v;
+	case FI_UINT64: return ((uint64_t *) buf)[i] == (uint64_t) v;
+	case FI_FLOAT: return ((float *) buf)[i] == (float) v;
+	case FI_DOUBLE: return ((double *) buf)[i] == (double) v;
+	case FI_FLOAT_COMPLEX: return ((float complex *) buf)[i] == v;
+	case FI_DOUBLE_COMPLEX: return ((double complex *) buf)[i] == v;
+	case FI_LONG_DOUBLE: return ((long double *) buf)[i] == v;
+	case FI_LONG_DOUBLE_COMPLEX:
+		return ((long double complex *) buf)[i] == v;
+	default:
+		return 0;
+	}
+}
+
+static long at_ref(enum fi_op op, long dst, long s, long c)
+{
+	switch (op) {
+	case FI_MIN: return s < dst ? s : dst;
+	case FI_MAX: return s > dst ? s : dst;
+	case FI_SUM: return dst + s;
+	case FI_PROD: return dst * s;
+	case FI_LOR: return dst || s;
+	case FI_LAND: return dst && s;
+	case FI_BOR: return dst | s;
+	case FI_BAND: return dst & s;
+	case FI_LXOR: return !dst != !s;
+	case FI_BXOR: return dst ^ s;
+	case FI_ATOMIC_READ: return dst;
+	case FI_ATOMIC_WRITE: return s;
+	case FI_CSWAP: return c == dst ? s : dst;
+	case FI_CSWAP_NE: return c != dst ? s : dst;
+	case FI_CSWAP_LE: return c <= dst ? s : dst;
+	case FI_CSWAP_LT: return c < dst ? s : dst;
+	case FI_CSWAP_GE: return c >= dst ? s : dst;
+	case FI_CSWAP_GT: return c > dst ? s : dst;
+	case FI_MSWAP: return (s & c) | (dst & ~c);
+	default: return -1;
+	}
+}
+
+static long at_target_val(size_t i)	{ return i % 4; }
+static long at_src_val(size_t i)	{ return (i * 3 + 1) % 4; }
+static long at_cmp_val(size_t i)	{ return (i / 2) % 4; }
+
+static int at_valid(enum at_kind kind, enum fi_datatype dt, enum fi_op op,
+		    size_t *count)
+{
+	switch (kind) {
+	case AT_WRITE:
+		return fi_atomicvalid(ep, dt, op, count);
+	case AT_FETCH:
+		return fi_fetch_atomicvalid(ep, dt, op, count);
+	default:
+		return fi_compare_atomicvalid(ep, dt, op, count);
+	}
+}
+
+static int at_wait(void)
+{
+	struct fi_cq_err_entry err;
+	struct fi_cq_entry comp;
+	ssize_t ret;
+
+	do {
+		ret = fi_cq_read(cq, &comp, 1);
+	} while (ret == -FI_EAGAIN);
+
+	if (ret == -FI_EAVAIL) {
+		memset(&err, 0, sizeof err);
+		fi_cq_readerr(cq, &err, 0);
+		return -err.err;
+	}
+	return ret == 1 ? 0 : (int) ret;
+}
+
+static int at_post(enum at_kind kind, enum fi_datatype dt, enum fi_op op,
+		   size_t count)
+{
+	ssize_t ret;
+
+	do {
+		switch (kind) {
+		case AT_WRITE:
+			ret = fi_atomic(ep, src, count, NULL, self, 0, AT_KEY,
+					dt, op, NULL);
+			break;
+		case AT_FETCH:
+			ret = fi_fetch_atomic(ep, src, count, NULL, result,
+					      NULL, self, 0, AT_KEY, dt, op,
+					      NULL);
+			break;
+		default:
+			ret = fi_compare_atomic(ep, src, count, NULL, cmp,
+						NULL, result, NULL, self, 0,
+						AT_KEY, dt, op, NULL);
+			break;
+		}
+		if (ret == -FI_EAGAIN)
+			fi_cq_read(cq, NULL, 0);
+	} while (ret == -FI_EAGAIN);
+
+	return ret ? (int) ret : at_wait();
+}
+
+/* Returns the number of mismatched elements, or a negative error */
+static int at_check(enum at_kind kind, enum fi_datatype dt, enum fi_op op,
+		    size_t count)
+{
+	size_t i;
+	int ret, bad = 0;
+
+	memset(result, 0, sizeof result);
+	for (i = 0; i < count; i++) {
+		at_set(dt, target, i, at_target_val(i));
+		at_set(dt, src, i, at_src_val(i));
+		at_set(dt, cmp, i, at_cmp_val(i));
+	}
+
+	ret = at_post(kind, dt, op, count);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < count; i++) {
+		if (!at_equal(dt, target, i, at_ref(op, at_target_val(i),
+		    at_src_val(i), at_cmp_val(i))))
+			bad++;
+		if (kind != AT_WRITE &&
+		    !at_equal(dt, result, i, at_target_val(i)))
+			bad++;
+	}
+	return bad;
+}
+
+/* The valid calls must only accept the ops each call can carry. */
+static int at_kind_allows(enum at_kind kind, enum fi_op op)
+{
+	switch (kind) {
+	case AT_WRITE:
+		return op < FI_CSWAP && op != FI_ATOMIC_READ;
+	case AT_FETCH:
+		return op < FI_CSWAP;
+	default:
+		return op >= FI_CSWAP;
+	}
+}
+
+static int run_check(void)
+{
+	enum at_kind kind;
+	int op, dt, ret, tested = 0, failed = 0;
+	size_t count;
+
+	for (kind = AT_WRITE; kind < AT_KIND_LAST; kind++) {
+		for (op = 0; op < FI_ATOMIC_OP_LAST; op++) {
+			for (dt = 0; dt < FI_DATATYPE_LAST; dt++) {
+				if (at_valid(kind, dt, op, &count))
+					continue;
+
+				tested++;
+				if (!at_kind_allows(kind, op)) {
+					printf("%s accepts %s\n",
+					       at_kind_str[kind],
+					       fi_tostr(&op, FI_TYPE_ATOMIC_OP));
+					failed++;
+					continue;
+				}
+
+				ret = at_check(kind, dt, op, count < AT_COUNT ?
+					       count : AT_COUNT);
+				if (ret) {
+					/* fi_tostr returns a static buffer */
+					printf("%s %s ", at_kind_str[kind],
+					       fi_tostr(&op, FI_TYPE_ATOMIC_OP));
+					printf("%s: %s %d\n",
+					       fi_tostr(&dt, FI_TYPE_ATOMIC_TYPE),
+					       ret < 0 ? "error" : "mismatches",
+					       ret);
+					failed++;
+				}
+			}
+		}
+	}
+
+	printf("%d op/datatype pairs checked, %d failed\n", tested, failed);
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int run_bench(int iters)
+{
+	enum fi_datatype dt = FI_UINT64;
+	enum fi_op op = FI_SUM;
+	struct timespec start, end;
+	size_t count;
+	double sec;
+	int i, ret;
+
+	ret = fi_atomicvalid(ep, dt, op, &count);
+	if (ret)
+		return EXIT_FAILURE;
+	if (count > AT_BUF_SIZE / sizeof(uint64_t))
+		count = AT_BUF_SIZE / sizeof(uint64_t);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < iters; i++) {
+		ret = at_post(AT_WRITE, dt, op, count);
+		if (ret) {
+			printf("fi_atomic: %s\n", fi_strerror(-ret));
+			return EXIT_FAILURE;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	sec = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("FI_SUM FI_UINT64 x %zu: %.0f ops/s, %.1f MB/s\n", count,
+	       iters / sec, iters * count * sizeof(uint64_t) / sec / 1e6);
+	return EXIT_SUCCESS;
+}
+
+static int at_init(void)
+{
+	struct fi_info *hints;
+	struct fi_cq_attr cq_attr;
+	struct fi_av_attr av_attr;
+	char name[FI_NAME_MAX];
+	size_t len = sizeof name;
+	int ret;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return -FI_ENOMEM;
+
+	hints->fabric_attr->prov_name = strdup("sockets");
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_ATOMIC;
+	hints->domain_attr->mr_mode = FI_MR_SCALABLE;
+	hints->addr_format = FI_SOCKADDR_IN;
+
+	ret = fi_getinfo(FI_VERSION(1, 4), "127.0.0.1", NULL, FI_SOURCE,
+			 hints, &info);
+	fi_freeinfo(hints);
+	if (ret)
+		return ret;
+
+	ret = fi_fabric(info->fabric_attr, &fabric, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_domain(fabric, info, &domain, NULL);
+	if (ret)
+		return ret;
+
+	memset(&cq_attr, 0, sizeof cq_attr);
+	cq_attr.format = FI_CQ_FORMAT_CONTEXT;
+	ret = fi_cq_open(domain, &cq_attr, &cq, NULL);
+	if (ret)
+		return ret;
+
+	memset(&av_attr, 0, sizeof av_attr);
+	av_attr.type = FI_AV_MAP;
+	ret = fi_av_open(domain, &av_attr, &av, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_mr_reg(domain, target, sizeof target,
+			FI_REMOTE_READ | FI_REMOTE_WRITE, 0, AT_KEY, 0,
+			&mr, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_endpoint(domain, info, &ep, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_ep_bind(ep, &av->fid, 0);
+	if (ret)
+		return ret;
+
+	ret = fi_ep_bind(ep, &cq->fid, FI_TRANSMIT | FI_RECV);
+	if (ret)
+		return ret;
+
+	ret = fi_enable(ep);
+	if (ret)
+		return ret;
+
+	ret = fi_getname(&ep->fid, name, &len);
+	if (ret)
+		return ret;
+
+	ret = fi_av_insert(av, name, 1, &self, 0, NULL);
+	return ret == 1 ? 0 : -FI_EINVAL;
+}
+
+static void at_fini(void)
+{
+	if (ep)
+		fi_close(&ep->fid);
+	if (mr)
+		fi_close(&mr->fid);
+	if (av)
+		fi_close(&av->fid);
+	if (cq)
+		fi_close(&cq->fid);
+	if (domain)
+		fi_close(&domain->fid);
+	if (fabric)
+		fi_close(&fabric->fid);
+	fi_freeinfo(info);
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-b iterations]\n", name);
+	printf("\t-b\tmeasure FI_SUM FI_UINT64 throughput instead\n");
+}
+
+int main(int argc, char **argv)
+{
+	int op, iters = 0, ret;
+
+	while ((op = getopt(argc, argv, "b:h")) != -1) {
+		switch (op) {
+		case 'b':
+			iters = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return op == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	ret = at_init();
+	if (ret) {
+		printf("sockets provider setup failed: %s\n",
+		       fi_strerror(-ret));
+		at_fini();
+		return EXIT_FAILURE;
+	}
+
+	ret = iters > 0 ? run_bench(iters) : run_check();
+	at_fini();
+	return ret;
+}
@@ -104,16 +104,32 @@ struct udpx_ep {
 	udpx_rx_comp_func	rx_comp;
 	udpx_tx_comp_func	tx_comp;
 	struct udpx_rx_cirq	*rxq;    /* protected by rx_cq lock */
+	struct util_eq		*eq;
+	atomic_t		ref;     /* multicast groups joined */
 	int			sock;
 	int			is_bound;
 };
 
+struct udpx_mc {
+	struct fid_mc		mc_fid;
+	union {
+		struct sockaddr_in	sin;
+		struct sockaddr_in6	sin6;
+	} addr;
+	uint64_t		flags;
+	struct udpx_ep		*ep;
+};
+
+extern int udpx_mcast_loop;
+
 int udpx_endpoint(struct fid_domain *domain, struct fi_info *info,
 		  struct fid_ep **ep, void *context);
 
 
 int udpx_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 		 struct fid_cq **cq, void *context);
+int udpx_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
+		   struct fid_cntr **cntr, void *context);
 
 
 #endif
@@ -53,7 +53,7 @@ static struct fi_ops udpx_cq_fi_ops = {
 	.close = udpx_cq_close,
 	.bind = fi_no_bind,
 	.control = fi_no_control,
-	.ops_open = fi_no_ops_open,
+	.ops_open = ofi_stats_ops_open,
 };
 
 int udpx_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
@@ -77,3 +77,10 @@ int udpx_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 	(*cq_fid)->fid.ops = &udpx_cq_fi_ops;
 	return 0;
 }
+
+int udpx_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
+		   struct fid_cntr **cntr_fid, void *context)
+{
+	return ofi_cntr_open(&udpx_prov, domain, attr, cntr_fid,
+			     &ofi_cntr_progress, context);
+}
@@ -62,6 +62,246 @@ int udpx_getname(fid_t fid, void *addr, size_t *addrlen)
 	return ret ? -errno : 0;
 }
 
+static int udpx_mc_membership(struct udpx_mc *mc, int join)
+{
+	struct ip_mreq mreq;
+	struct ipv6_mreq mreq6;
+	int ret;
+
+	if (mc->addr.sin.sin_family == AF_INET) {
+		mreq.imr_multiaddr = mc->addr.sin.sin_addr;
+		mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+		ret = setsockopt(mc->ep->sock, IPPROTO_IP, join ?
+				 IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+				 &mreq, sizeof mreq);
+	} else {
+		mreq6.ipv6mr_multiaddr = mc->addr.sin6.sin6_addr;
+		mreq6.ipv6mr_interface = 0;
+		ret = setsockopt(mc->ep->sock, IPPROTO_IPV6, join ?
+				 IPV6_JOIN_GROUP : IPV6_LEAVE_GROUP,
+				 &mreq6, sizeof mreq6);
+	}
+	return ret ? -errno : 0;
+}
+
+static int udpx_mc_close(struct fid *fid)
+{
+	struct udpx_mc *mc;
+
+	mc = container_of(fid, struct udpx_mc, mc_fid.fid);
+	if (mc->flags & FI_RECV)
+		udpx_mc_membership(mc, 0);
+	ofi_av_remove_addr(mc->ep->util_ep.av, (int) mc->mc_fid.fi_addr);
+	atomic_dec(&mc->ep->ref);
+	free(mc);
+	return 0;
+}
+
+static struct fi_ops udpx_mc_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = udpx_mc_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+static int udpx_mc_init_addr(struct udpx_mc *mc, const void *addr)
+{
+	const struct sockaddr *sa = addr;
+	size_t addrlen;
+	int valid;
+
+	switch (sa->sa_family) {
+	case AF_INET:
+		addrlen = sizeof(struct sockaddr_in);
+		valid = IN_MULTICAST(ntohl(((struct sockaddr_in *) addr)->
+					   sin_addr.s_addr));
+		break;
+	case AF_INET6:
+		addrlen = sizeof(struct sockaddr_in6);
+		valid = IN6_IS_ADDR_MULTICAST(&((struct sockaddr_in6 *) addr)->
+					      sin6_addr);
+		break;
+	default:
+		valid = 0;
+		break;
+	}
+
+	if (!valid || addrlen != mc->ep->util_ep.av->addrlen) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"invalid multicast address\n");
+		return -FI_EINVAL;
+	}
+
+	memcpy(&mc->addr, addr, addrlen);
+	return 0;
+}
+
+/*
+ * The loopback and outgoing interface settings apply to every send on
+ * the socket, so they are (re)applied on each send-side join.
+ */
+static int udpx_mc_tx_init(struct udpx_mc *mc, const struct sockaddr *local)
+{
+	unsigned char loop = udpx_mcast_loop;
+	unsigned int loop6 = udpx_mcast_loop;
+	const struct sockaddr_in *sin;
+	int ret;
+
+	if (mc->addr.sin.sin_family == AF_INET6) {
+		ret = setsockopt(mc->ep->sock, IPPROTO_IPV6,
+				 IPV6_MULTICAST_LOOP, &loop6, sizeof loop6);
+		return ret ? -errno : 0;
+	}
+
+	ret = setsockopt(mc->ep->sock, IPPROTO_IP, IP_MULTICAST_LOOP,
+			 &loop, sizeof loop);
+	if (ret)
+		return -errno;
+
+	sin = (const struct sockaddr_in *) local;
+	if (sin->sin_addr.s_addr != htonl(INADDR_ANY)) {
+		ret = setsockopt(mc->ep->sock, IPPROTO_IP, IP_MULTICAST_IF,
+				 &sin->sin_addr, sizeof sin->sin_addr);
+		if (ret)
+			return -errno;
+	}
+	return 0;
+}
+
+/*
+ * Group traffic is only delivered to sockets bound to the group's port
+ * on the wildcard address.  An endpoint that has no address yet is bound
+ * to it, shared with any other local members of the group.  The port
+ * is at the same offset in sockaddr_in and sockaddr_in6.
+ */
+static int udpx_mc_rx_init(struct udpx_mc *mc, struct sockaddr *local)
+{
+	struct udpx_ep *ep = mc->ep;
+	struct sockaddr_in *sin;
+	struct sockaddr_in6 *sin6;
+	int one = 1, ret;
+
+	sin = (struct sockaddr_in *) local;
+	sin6 = (struct sockaddr_in6 *) local;
+	if (ep->is_bound) {
+		if (mc->addr.sin.sin_port != sin->sin_port ||
+		    (local->sa_family == AF_INET ?
+		     sin->sin_addr.s_addr != htonl(INADDR_ANY) :
+		     !IN6_IS_ADDR_UNSPECIFIED(&sin6->sin6_addr))) {
+			FI_WARN(&udpx_prov, FI_LOG_EP_CTRL, "endpoint must be "
+				"bound to the group port on any address\n");
+			return -FI_EINVAL;
+		}
+	} else {
+		ret = setsockopt(ep->sock, SOL_SOCKET, SO_REUSEADDR,
+				 &one, sizeof one);
+		if (ret)
+			return -errno;
+
+		sin->sin_port = mc->addr.sin.sin_port;
+		ret = udpx_setname(&ep->util_ep.ep_fid.fid, local,
+				   ep->util_ep.av->addrlen);
+		if (ret)
+			return ret;
+	}
+
+	return udpx_mc_membership(mc, 1);
+}
+
+static int udpx_join(struct fid_ep *ep_fid, const void *addr, uint64_t flags,
+		     struct fid_mc **mc_fid, void *context)
+{
+	struct udpx_ep *ep;
+	struct udpx_mc *mc;
+	struct fi_eq_entry entry;
+	union {
+		struct sockaddr		sa;
+		struct sockaddr_in	sin;
+		struct sockaddr_in6	sin6;
+	} local;
+	socklen_t len;
+	int index, ret;
+
+	ep = container_of(ep_fid, struct udpx_ep, util_ep.ep_fid.fid);
+	if (!flags)
+		flags = FI_SEND | FI_RECV;
+	if (flags & ~(FI_SEND | FI_RECV)) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL, "unsupported flags\n");
+		return -FI_EBADFLAGS;
+	}
+	if (!ep->util_ep.av)
+		return -FI_ENOAV;
+	if (!ep->eq)
+		return -FI_ENOEQ;
+
+	mc = calloc(1, sizeof(*mc));
+	if (!mc)
+		return -FI_ENOMEM;
+
+	mc->mc_fid.fid.fclass = FI_CLASS_MC;
+	mc->mc_fid.fid.context = context;
+	mc->mc_fid.fid.ops = &udpx_mc_fi_ops;
+	mc->ep = ep;
+	mc->flags = flags;
+
+	ret = udpx_mc_init_addr(mc, addr);
+	if (ret)
+		goto err1;
+
+	memset(&local, 0, sizeof local);
+	len = sizeof local;
+	if (getsockname(ep->sock, &local.sa, &len)) {
+		ret = -errno;
+		goto err1;
+	}
+	if (local.sa.sa_family != mc->addr.sin.sin_family) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"multicast address family does not match endpoint\n");
+		ret = -FI_EINVAL;
+		goto err1;
+	}
+
+	if (flags & FI_SEND) {
+		ret = udpx_mc_tx_init(mc, &local.sa);
+		if (ret)
+			goto err1;
+	}
+
+	if (flags & FI_RECV) {
+		ret = udpx_mc_rx_init(mc, &local.sa);
+		if (ret)
+			goto err1;
+	}
+
+	ret = ofi_av_insert_addr(ep->util_ep.av, &mc->addr, &index);
+	if (ret)
+		goto err2;
+	mc->mc_fid.fi_addr = (fi_addr_t) index;
+	atomic_inc(&ep->ref);
+
+	entry.fid = &mc->mc_fid.fid;
+	entry.context = context;
+	entry.data = 0;
+	ret = fi_eq_write(&ep->eq->eq_fid, FI_JOIN_COMPLETE, &entry,
+			  sizeof entry, 0);
+	if (ret != sizeof entry) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL, "error writing to EQ\n");
+		udpx_mc_close(&mc->mc_fid.fid);
+		return ret < 0 ? ret : -FI_EIO;
+	}
+
+	*mc_fid = &mc->mc_fid;
+	return 0;
+
+err2:
+	if (flags & FI_RECV)
+		udpx_mc_membership(mc, 0);
+err1:
+	free(mc);
+	return ret;
+}
+
 static struct fi_ops_cm udpx_cm_ops = {
 	.size = sizeof(struct fi_ops_cm),
 	.setname = udpx_setname,
@@ -72,6 +312,7 @@ static struct fi_ops_cm udpx_cm_ops = {
 	.accept = fi_no_accept,
 	.reject = fi_no_reject,
 	.shutdown = fi_no_shutdown,
+	.join = udpx_join,
 };
 
 int udpx_getopt(fid_t fid, int level, int optname,
@@ -178,6 +419,8 @@ void udpx_ep_progress(struct util_ep *util_ep)
 	ret = recvmsg(ep->sock, &hdr, 0);
 	if (ret >= 0) {
 		ep->rx_comp(ep, entry->context, 0, ret, NULL, &addr);
+		if (ep->util_ep.rx_cntr)
+			ofi_cntr_inc(ep->util_ep.rx_cntr);
 		ofi_cirque_discard(ep->rxq);
 	}
 out:
@@ -261,6 +504,7 @@ ssize_t udpx_send(struct fid_ep *ep_fid, const void *buf, size_t len, void *desc
 	ep = container_of(ep_fid, struct udpx_ep, util_ep.ep_fid.fid);
 	fastlock_acquire(&ep->util_ep.tx_cq->cq_lock);
 	if (ofi_cirque_isfull(ep->util_ep.tx_cq->cirq)) {
+		ofi_stats_inc(&ep->util_ep.tx_cq->stats, OFI_CQ_STAT_OVERFLOW);
 		ret = -FI_EAGAIN;
 		goto out;
 	}
@@ -270,6 +514,8 @@ ssize_t udpx_send(struct fid_ep *ep_fid, const void *buf, size_t len, void *desc
 		     ep->util_ep.av->addrlen);
 	if (ret == len) {
 		ep->tx_comp(ep, context);
+		if (ep->util_ep.tx_cntr)
+			ofi_cntr_inc(ep->util_ep.tx_cntr);
 		ret = 0;
 	} else {
 		ret = -errno;
@@ -297,6 +543,7 @@ ssize_t udpx_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 
 	fastlock_acquire(&ep->util_ep.tx_cq->cq_lock);
 	if (ofi_cirque_isfull(ep->util_ep.tx_cq->cirq)) {
+		ofi_stats_inc(&ep->util_ep.tx_cq->stats, OFI_CQ_STAT_OVERFLOW);
 		ret = -FI_EAGAIN;
 		goto out;
 	}
@@ -304,6 +551,8 @@ ssize_t udpx_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 	ret = sendmsg(ep->sock, &hdr, 0);
 	if (ret >= 0) {
 		ep->tx_comp(ep, msg->context);
+		if (ep->util_ep.tx_cntr)
+			ofi_cntr_inc(ep->util_ep.tx_cntr);
 		ret = 0;
 	} else {
 		ret = -errno;
@@ -336,7 +585,12 @@ ssize_t udpx_inject(struct fid_ep *ep_fid, const void *buf, size_t len,
 	ret = sendto(ep->sock, buf, len, 0,
 		     ip_av_get_addr(ep->util_ep.av, dest_addr),
 		     ep->util_ep.av->addrlen);
-	return ret == len ? 0 : -errno;
+	if (ret != len)
+		return -errno;
+
+	if (ep->util_ep.tx_cntr)
+		ofi_cntr_inc(ep->util_ep.tx_cntr);
+	return 0;
 }
 
 static struct fi_ops_msg udpx_msg_ops = {
@@ -352,12 +606,21 @@ static struct fi_ops_msg udpx_msg_ops = {
 	.injectdata = fi_no_msg_injectdata,
 };
 
+/* The socket is registered once with each wait object that can block
+ * on receive completions. */
+static int udpx_rx_cq_shares_wait(struct udpx_ep *ep, struct util_wait *wait)
+{
+	return ep->util_ep.rx_cq && ep->util_ep.rx_cq->wait == wait;
+}
+
 static int udpx_ep_close(struct fid *fid)
 {
 	struct udpx_ep *ep;
 	struct util_wait_fd *wait;
 
 	ep = container_of(fid, struct udpx_ep, util_ep.ep_fid.fid);
+	if (atomic_get(&ep->ref))
+		return -FI_EBUSY;
 
 	if (ep->util_ep.rx_cq) {
 		if (ep->util_ep.rx_cq->wait) {
@@ -374,9 +637,19 @@ static int udpx_ep_close(struct fid *fid)
 	if (ep->util_ep.tx_cq)
 		atomic_dec(&ep->util_ep.tx_cq->ref);
 
+	if (ep->eq)
+		atomic_dec(&ep->eq->ref);
+
+	if (ep->util_ep.rx_cntr && ep->util_ep.rx_cntr->wait &&
+	    !udpx_rx_cq_shares_wait(ep, ep->util_ep.rx_cntr->wait)) {
+		wait = container_of(ep->util_ep.rx_cntr->wait,
+				    struct util_wait_fd, util_wait);
+		fi_epoll_del(wait->epoll_fd, ep->sock);
+	}
+
+	ofi_endpoint_close(&ep->util_ep);
 	udpx_rx_cirq_free(ep->rxq);
 	close(ep->sock);
-	ofi_endpoint_close(&ep->util_ep);
 	free(ep);
 	return 0;
 }
@@ -414,12 +687,15 @@ static int udpx_ep_bind_cq(struct udpx_ep *ep, struct util_cq *cq, uint64_t flag
 				      udpx_rx_src_comp_signal :
 				      udpx_rx_comp_signal;
 
-			wait = container_of(cq->wait,
-					    struct util_wait_fd, util_wait);
-			ret = fi_epoll_add(wait->epoll_fd, ep->sock,
-					   &ep->util_ep.ep_fid.fid);
-			if (ret)
-				return ret;
+			if (!ep->util_ep.rx_cntr ||
+			    ep->util_ep.rx_cntr->wait != cq->wait) {
+				wait = container_of(cq->wait,
+						struct util_wait_fd, util_wait);
+				ret = fi_epoll_add(wait->epoll_fd, ep->sock,
+						   &ep->util_ep.ep_fid.fid);
+				if (ret)
+					return ret;
+			}
 		} else {
 			ep->rx_comp = (cq->domain->caps & FI_SOURCE) ?
 				      udpx_rx_src_comp : udpx_rx_comp;
@@ -435,6 +711,34 @@ static int udpx_ep_bind_cq(struct udpx_ep *ep, struct util_cq *cq, uint64_t flag
 	return 0;
 }
 
+static int udpx_ep_bind_cntr(struct udpx_ep *ep, struct util_cntr *cntr,
+			     uint64_t flags)
+{
+	struct util_wait_fd *wait;
+	int ret;
+
+	if (flags & ~(FI_SEND | FI_RECV)) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"unsupported flags\n");
+		return -FI_EBADFLAGS;
+	}
+
+	ret = ofi_ep_bind_cntr(&ep->util_ep, cntr, flags);
+	if (ret) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"duplicate counter binding\n");
+		return ret;
+	}
+
+	if ((flags & FI_RECV) && cntr->wait &&
+	    !udpx_rx_cq_shares_wait(ep, cntr->wait)) {
+		wait = container_of(cntr->wait, struct util_wait_fd, util_wait);
+		ret = fi_epoll_add(wait->epoll_fd, ep->sock,
+				   &ep->util_ep.ep_fid.fid);
+	}
+	return ret;
+}
+
 static int udpx_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 {
 	struct udpx_ep *ep;
@@ -455,7 +759,19 @@ static int udpx_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 		ret = udpx_ep_bind_cq(ep, container_of(bfid, struct util_cq,
 							cq_fid.fid), flags);
 		break;
+	case FI_CLASS_CNTR:
+		ret = udpx_ep_bind_cntr(ep, container_of(bfid,
+					struct util_cntr, cntr_fid.fid), flags);
+		break;
 	case FI_CLASS_EQ:
+		if (ep->eq) {
+			FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+				"duplicate EQ binding\n");
+			ret = -FI_EINVAL;
+			break;
+		}
+		ep->eq = container_of(bfid, struct util_eq, eq_fid.fid);
+		atomic_inc(&ep->eq->ref);
 		break;
 	default:
 		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
@@ -545,6 +861,7 @@ static int udpx_ep_init(struct udpx_ep *ep, struct fi_info *info)
 			ret = -errno;
 			goto err1;
 		}
+		ep->is_bound = 1;
 	}
 
 	ret = fi_fd_nonblock(ep->sock);
@@ -574,6 +891,7 @@ int udpx_endpoint(struct fid_domain *domain, struct fi_info *info,
 	if (ret)
 		goto err;
 
+	atomic_initialize(&ep->ref, 0);
 	ret = udpx_ep_init(ep, info);
 	if (ret) {
 		free(ep);
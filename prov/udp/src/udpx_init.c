@@ -113,6 +113,8 @@ static int udpx_getinfo(uint32_t version, const char *node, const char *service,
 	return 0;
 }
 
+int udpx_mcast_loop = 1;
+
 static void udpx_fini(void)
 {
 	/* yawn */
@@ -129,5 +131,9 @@ struct fi_provider udpx_prov = {
 
 UDP_INI
 {
+	fi_param_define(&udpx_prov, "mcast_loop", FI_PARAM_BOOL,
+			"Deliver multicast sends to group members on the "
+			"sending host (default: yes)");
+	fi_param_get_bool(&udpx_prov, "mcast_loop", &udpx_mcast_loop);
 	return &udpx_prov;
 }
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2017 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <complex.h>
+#include <stdint.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/providers/fi_log.h>
+#include <fi_atomic_op.h>
+
+/*
+ * Each kernel is a plain loop over the buffer so the compiler can
+ * vectorize it.  Where supported, x86 builds emit AVX-512, AVX2 and
+ * baseline copies of every kernel and the loader picks one on first use.
+ */
+#if HAVE_TARGET_CLONES_ATTRIBUTE
+#define OFI_SIMD_CLONES \
+	__attribute__ ((__target_clones__("avx512f", "avx2", "default")))
+#else
+#define OFI_SIMD_CLONES
+#endif
+
+/* Single token names for the multi-word types, used to build kernel names */
+typedef long double		long_double;
+typedef float complex		ofi_complex_float;
+typedef double complex		ofi_complex_double;
+typedef long double complex	ofi_complex_long_double;
+
+#define OFI_OP_MIN(dst, src)	((src) < (dst) ? (src) : (dst))
+#define OFI_OP_MAX(dst, src)	((src) > (dst) ? (src) : (dst))
+#define OFI_OP_SUM(dst, src)	((dst) + (src))
+#define OFI_OP_PROD(dst, src)	((dst) * (src))
+#define OFI_OP_LOR(dst, src)	((dst) || (src))
+#define OFI_OP_LAND(dst, src)	((dst) && (src))
+#define OFI_OP_BOR(dst, src)	((dst) | (src))
+#define OFI_OP_BAND(dst, src)	((dst) & (src))
+#define OFI_OP_LXOR(dst, src)	(((dst) && !(src)) || (!(dst) && (src)))
+#define OFI_OP_BXOR(dst, src)	((dst) ^ (src))
+#define OFI_OP_WRITE(dst, src)	(src)
+
+#define OFI_OP_CSWAP_EQ(dst, src, cmp)	((cmp) == (dst) ? (src) : (dst))
+#define OFI_OP_CSWAP_NE(dst, src, cmp)	((cmp) != (dst) ? (src) : (dst))
+#define OFI_OP_CSWAP_LE(dst, src, cmp)	((cmp) <= (dst) ? (src) : (dst))
+#define OFI_OP_CSWAP_LT(dst, src, cmp)	((cmp) < (dst) ? (src) : (dst))
+#define OFI_OP_CSWAP_GE(dst, src, cmp)	((cmp) >= (dst) ? (src) : (dst))
+#define OFI_OP_CSWAP_GT(dst, src, cmp)	((cmp) > (dst) ? (src) : (dst))
+#define OFI_OP_MSWAP(dst, src, cmp)	(((src) & (cmp)) | ((dst) & ~(cmp)))
+
+/*
+ * Kernel generators.  OFI_DEF_<kind>_FUNC defines a kernel and
+ * OFI_DEF_<kind>_NAME expands to its table entry.  NOOP fills the slots
+ * of datatypes an op does not apply to.
+ */
+#define OFI_ROW_FUNC(...)		__VA_ARGS__
+#define OFI_ROW_NAME(...)		{ __VA_ARGS__ },
+
+#define OFI_DEF_NOOP_FUNC(op, type)
+#define OFI_DEF_NOOP_NAME(op, type)	NULL,
+
+#define OFI_DEF_WRITE_FUNC(op, type)					\
+static void OFI_SIMD_CLONES						\
+ofi_write_## op ##_## type(void *dst, const void *src, size_t cnt)	\
+{									\
+	type *d = dst;							\
+	const type *s = src;						\
+	size_t i;							\
+									\
+	for (i = 0; i < cnt; i++)					\
+		d[i] = op(d[i], s[i]);					\
+}
+#define OFI_DEF_WRITE_NAME(op, type)	ofi_write_## op ##_## type,
+
+#define OFI_DEF_READWRITE_FUNC(op, type)				\
+static void OFI_SIMD_CLONES						\
+ofi_readwrite_## op ##_## type(void *dst, const void *src,		\
+			       void *res, size_t cnt)			\
+{									\
+	type *d = dst, *r = res;					\
+	const type *s = src;						\
+	type tmp;							\
+	size_t i;							\
+									\
+	for (i = 0; i < cnt; i++) {					\
+		tmp = d[i];						\
+		d[i] = op(tmp, s[i]);					\
+		r[i] = tmp;						\
+	}								\
+}
+#define OFI_DEF_READWRITE_NAME(op, type)	ofi_readwrite_## op ##_## type,
+
+/* Atomic read only fetches; src is unused and dst is never stored to. */
+#define OFI_DEF_READ_FUNC(op, type)					\
+static void OFI_SIMD_CLONES						\
+ofi_read_## type(void *dst, const void *src, void *res, size_t cnt)	\
+{									\
+	const type *d = dst;						\
+	type *r = res;							\
+	size_t i;							\
+									\
+	for (i = 0; i < cnt; i++)					\
+		r[i] = d[i];						\
+}
+#define OFI_DEF_READ_NAME(op, type)	ofi_read_## type,
+
+#define OFI_DEF_SWAP_FUNC(op, type)					\
+static void OFI_SIMD_CLONES						\
+ofi_swap_## op ##_## type(void *dst, const void *src, const void *cmp,	\
+			  void *res, size_t cnt)			\
+{									\
+	type *d = dst, *r = res;					\
+	const type *s = src, *c = cmp;					\
+	type tmp;							\
+	size_t i;							\
+									\
+	for (i = 0; i < cnt; i++) {					\
+		tmp = d[i];						\
+		d[i] = op(tmp, s[i], c[i]);				\
+		r[i] = tmp;						\
+	}								\
+}
+#define OFI_DEF_SWAP_NAME(op, type)	ofi_swap_## op ##_## type,
+
+/*
+ * Datatype coverage classes, in enum fi_datatype order.  INT covers the
+ * integer types, REAL adds floating point, and ALL adds complex.
+ */
+#define OFI_DEFINE_INT_HANDLERS(kind, call, op)			\
+	OFI_ROW_##call(							\
+		OFI_DEF_##kind##_##call(op, int8_t)			\
+		OFI_DEF_##kind##_##call(op, uint8_t)			\
+		OFI_DEF_##kind##_##call(op, int16_t)			\
+		OFI_DEF_##kind##_##call(op, uint16_t)			\
+		OFI_DEF_##kind##_##call(op, int32_t)			\
+		OFI_DEF_##kind##_##call(op, uint32_t)			\
+		OFI_DEF_##kind##_##call(op, int64_t)			\
+		OFI_DEF_##kind##_##call(op, uint64_t)			\
+		OFI_DEF_NOOP_##call(op, float)				\
+		OFI_DEF_NOOP_##call(op, double)				\
+		OFI_DEF_NOOP_##call(op, ofi_complex_float)		\
+		OFI_DEF_NOOP_##call(op, ofi_complex_double)		\
+		OFI_DEF_NOOP_##call(op, long_double)			\
+		OFI_DEF_NOOP_##call(op, ofi_complex_long_double))
+
+#define OFI_DEFINE_REAL_HANDLERS(kind, call, op)			\
+	OFI_ROW_##call(							\
+		OFI_DEF_##kind##_##call(op, int8_t)			\
+		OFI_DEF_##kind##_##call(op, uint8_t)			\
+		OFI_DEF_##kind##_##call(op, int16_t)			\
+		OFI_DEF_##kind##_##call(op, uint16_t)			\
+		OFI_DEF_##kind##_##call(op, int32_t)			\
+		OFI_DEF_##kind##_##call(op, uint32_t)			\
+		OFI_DEF_##kind##_##call(op, int64_t)			\
+		OFI_DEF_##kind##_##call(op, uint64_t)			\
+		OFI_DEF_##kind##_##call(op, float)			\
+		OFI_DEF_##kind##_##call(op, double)			\
+		OFI_DEF_NOOP_##call(op, ofi_complex_float)		\
+		OFI_DEF_NOOP_##call(op, ofi_complex_double)		\
+		OFI_DEF_##kind##_##call(op, long_double)		\
+		OFI_DEF_NOOP_##call(op, ofi_complex_long_double))
+
+#define OFI_DEFINE_ALL_HANDLERS(kind, call, op)			\
+	OFI_ROW_##call(							\
+		OFI_DEF_##kind##_##call(op, int8_t)			\
+		OFI_DEF_##kind##_##call(op, uint8_t)			\
+		OFI_DEF_##kind##_##call(op, int16_t)			\
+		OFI_DEF_##kind##_##call(op, uint16_t)			\
+		OFI_DEF_##kind##_##call(op, int32_t)			\
+		OFI_DEF_##kind##_##call(op, uint32_t)			\
+		OFI_DEF_##kind##_##call(op, int64_t)			\
+		OFI_DEF_##kind##_##call(op, uint64_t)			\
+		OFI_DEF_##kind##_##call(op, float)			\
+		OFI_DEF_##kind##_##call(op, double)			\
+		OFI_DEF_##kind##_##call(op, ofi_complex_float)		\
+		OFI_DEF_##kind##_##call(op, ofi_complex_double)		\
+		OFI_DEF_##kind##_##call(op, long_double)		\
+		OFI_DEF_##kind##_##call(op, ofi_complex_long_double))
+
+/*
+ * Op to datatype coverage, in enum fi_op order.  Each list is expanded
+ * once to define the kernels and once to build the table.
+ */
+#define OFI_WRITE_OPS(kind, call)					\
+	OFI_DEFINE_REAL_HANDLERS(kind, call, OFI_OP_MIN)		\
+	OFI_DEFINE_REAL_HANDLERS(kind, call, OFI_OP_MAX)		\
+	OFI_DEFINE_ALL_HANDLERS(kind, call, OFI_OP_SUM)			\
+	OFI_DEFINE_ALL_HANDLERS(kind, call, OFI_OP_PROD)		\
+	OFI_DEFINE_ALL_HANDLERS(kind, call, OFI_OP_LOR)			\
+	OFI_DEFINE_ALL_HANDLERS(kind, call, OFI_OP_LAND)		\
+	OFI_DEFINE_INT_HANDLERS(kind, call, OFI_OP_BOR)			\
+	OFI_DEFINE_INT_HANDLERS(kind, call, OFI_OP_BAND)		\
+	OFI_DEFINE_ALL_HANDLERS(kind, call, OFI_OP_LXOR)		\
+	OFI_DEFINE_INT_HANDLERS(kind, call, OFI_OP_BXOR)
+
+#define OFI_SWAP_OPS(kind, call)					\
+	OFI_DEFINE_ALL_HANDLERS(kind, call, OFI_OP_CSWAP_EQ)		\
+	OFI_DEFINE_ALL_HANDLERS(kind, call, OFI_OP_CSWAP_NE)		\
+	OFI_DEFINE_REAL_HANDLERS(kind, call, OFI_OP_CSWAP_LE)		\
+	OFI_DEFINE_REAL_HANDLERS(kind, call, OFI_OP_CSWAP_LT)		\
+	OFI_DEFINE_REAL_HANDLERS(kind, call, OFI_OP_CSWAP_GE)		\
+	OFI_DEFINE_REAL_HANDLERS(kind, call, OFI_OP_CSWAP_GT)		\
+	OFI_DEFINE_INT_HANDLERS(kind, call, OFI_OP_MSWAP)
+
+OFI_WRITE_OPS(WRITE, FUNC)
+OFI_DEFINE_ALL_HANDLERS(WRITE, FUNC, OFI_OP_WRITE)
+
+OFI_WRITE_OPS(READWRITE, FUNC)
+OFI_DEFINE_ALL_HANDLERS(READ, FUNC, _)
+OFI_DEFINE_ALL_HANDLERS(READWRITE, FUNC, OFI_OP_WRITE)
+
+OFI_SWAP_OPS(SWAP, FUNC)
+
+void (*ofi_atomic_write_handlers[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])
+	(void *dst, const void *src, size_t cnt) =
+{
+	OFI_WRITE_OPS(WRITE, NAME)
+	OFI_DEFINE_ALL_HANDLERS(NOOP, NAME, FI_ATOMIC_READ)
+	OFI_DEFINE_ALL_HANDLERS(WRITE, NAME, OFI_OP_WRITE)
+};
+
+void (*ofi_atomic_readwrite_handlers[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])
+	(void *dst, const void *src, void *res, size_t cnt) =
+{
+	OFI_WRITE_OPS(READWRITE, NAME)
+	OFI_DEFINE_ALL_HANDLERS(READ, NAME, _)
+	OFI_DEFINE_ALL_HANDLERS(READWRITE, NAME, OFI_OP_WRITE)
+};
+
+void (*ofi_atomic_swap_handlers[OFI_SWAP_OP_LAST][FI_DATATYPE_LAST])
+	(void *dst, const void *src, const void *cmp, void *res, size_t cnt) =
+{
+	OFI_SWAP_OPS(SWAP, NAME)
+};
+
+int ofi_atomic_valid(const struct fi_provider *prov,
+		     enum fi_datatype datatype, enum fi_op op, int fetch)
+{
+	int have_func;
+
+	if (datatype >= FI_DATATYPE_LAST || op >= FI_ATOMIC_OP_LAST) {
+		FI_INFO(prov, FI_LOG_DOMAIN, "Invalid datatype or op\n");
+		return -FI_EINVAL;
+	}
+
+	if (ofi_atomic_isswap_op(op))
+		have_func = ofi_atomic_swap_handlers[op - OFI_SWAP_OP_START]
+						    [datatype] != NULL;
+	else if (fetch)
+		have_func = ofi_atomic_readwrite_handlers[op][datatype] != NULL;
+	else
+		have_func = ofi_atomic_write_handlers[op][datatype] != NULL;
+
+	if (!have_func) {
+		FI_INFO(prov, FI_LOG_DOMAIN, "%s not supported for %s\n",
+			fi_tostr(&op, FI_TYPE_ATOMIC_OP),
+			fi_tostr(&datatype, FI_TYPE_ATOMIC_TYPE));
+		return -FI_ENOENT;
+	}
+	return 0;
+}
@@ -47,6 +47,7 @@
 #endif
 
 #include <fi_util.h>
+#include <fasthash.h>
 
 
 enum {
@@ -236,92 +237,110 @@ static int fi_verify_av_insert(struct util_av *av, uint64_t flags)
 }
 
 /*
- * Must hold AV lock
+ * FI_SOURCE hash.  Each bucket holds a chain of AV indices, linked
+ * through next[], which has one link per AV entry.  An AV never holds
+ * more than av->count addresses, so the chains cannot run out of links.
+ * All of these must be called with the AV lock held.
  */
-static int util_av_hash_insert(struct util_av_hash *hash, int slot, int index)
+static inline size_t util_av_hash_slot(struct util_av *av, const void *addr)
 {
-	int entry, i;
-
-	if (slot < 0 || slot >= hash->slots)
-		return -FI_EINVAL;
+	return fasthash32(addr, av->addrlen, 0) & (av->hash.slots - 1);
+}
 
-	if (hash->table[slot].index == UTIL_NO_ENTRY) {
-		hash->table[slot].index = index;
-		return 0;
+static int util_av_hash_init(struct util_av *av)
+{
+	struct util_av_hash *hash = &av->hash;
+	size_t i;
+
+	hash->slots = av->count;
+	hash->head = malloc(hash->slots * sizeof(*hash->head));
+	hash->next = malloc(av->count * sizeof(*hash->next));
+	if (!hash->head || !hash->next) {
+		free(hash->head);
+		free(hash->next);
+		return -FI_ENOMEM;
 	}
 
-	if (hash->free_list == UTIL_NO_ENTRY)
-		return -FI_ENOSPC;
+	for (i = 0; i < hash->slots; i++)
+		hash->head[i] = UTIL_NO_ENTRY;
+	return 0;
+}
 
-	entry = hash->free_list;
-	hash->free_list = hash->table[hash->free_list].next;
+static void util_av_hash_fini(struct util_av_hash *hash)
+{
+	free(hash->head);
+	free(hash->next);
+	memset(hash, 0, sizeof(*hash));
+}
 
-	for (i = slot; hash->table[i].next != UTIL_NO_ENTRY; )
-		i = hash->table[i].next;
+static int util_av_hash_find(struct util_av *av, const void *addr)
+{
+	int i;
 
-	hash->table[i].next = entry;
-	hash->table[entry].index = index;
-	hash->table[entry].next = UTIL_NO_ENTRY;
-	return 0;
+	if (!av->hash.slots)
+		return UTIL_NO_ENTRY;
+
+	for (i = av->hash.head[util_av_hash_slot(av, addr)];
+	     i != UTIL_NO_ENTRY; i = av->hash.next[i]) {
+		if (!memcmp(util_av_get_data(av, i), addr, av->addrlen))
+			return i;
+	}
+	return UTIL_NO_ENTRY;
 }
 
-int ofi_av_insert_addr(struct util_av *av, const void *addr, int slot, int *index)
+static void util_av_hash_insert(struct util_av *av, const void *addr, int index)
 {
-	int ret = 0;
+	struct util_av_hash *hash = &av->hash;
+	size_t slot;
 
-	fastlock_acquire(&av->lock);
-	if (av->free_list == UTIL_NO_ENTRY) {
-		FI_WARN(av->prov, FI_LOG_AV, "AV is full\n");
-		ret = -FI_ENOSPC;
-		goto out;
-	}
+	slot = util_av_hash_slot(av, addr);
+	hash->next[index] = hash->head[slot];
+	hash->head[slot] = index;
+}
 
-	if (av->flags & FI_SOURCE) {
-		ret = util_av_hash_insert(&av->hash, slot, av->free_list);
-		if (ret) {
-			FI_WARN(av->prov, FI_LOG_AV,
-				"failed to insert addr into hash table\n");
-			goto out;
+static void util_av_hash_remove(struct util_av *av, int index)
+{
+	struct util_av_hash *hash = &av->hash;
+	int *i;
+
+	for (i = &hash->head[util_av_hash_slot(av, util_av_get_data(av, index))];
+	     *i != UTIL_NO_ENTRY; i = &hash->next[*i]) {
+		if (*i == index) {
+			*i = hash->next[index];
+			return;
 		}
 	}
-
-	*index = av->free_list;
-	av->free_list = *(int *) util_av_get_data(av, av->free_list);
-	util_av_set_data(av, *index, addr, av->addrlen);
-out:
-	fastlock_release(&av->lock);
-	return ret;
 }
 
 /*
  * Must hold AV lock
  */
-static void util_av_hash_remove(struct util_av_hash *hash, int slot, int index)
+static int util_av_insert_addr(struct util_av *av, const void *addr, int *index)
 {
-	int i;
+	if (av->free_list == UTIL_NO_ENTRY) {
+		FI_WARN(av->prov, FI_LOG_AV, "AV is full\n");
+		return -FI_ENOSPC;
+	}
 
-	if (slot < 0 || slot >= hash->slots)
-		return;
+	*index = av->free_list;
+	av->free_list = *(int *) util_av_get_data(av, av->free_list);
+	util_av_set_data(av, *index, addr, av->addrlen);
+	if (av->flags & FI_SOURCE)
+		util_av_hash_insert(av, addr, *index);
+	return 0;
+}
 
-	if (slot == index) {
-		if (hash->table[slot].next == UTIL_NO_ENTRY) {
-			hash->table[slot].index = UTIL_NO_ENTRY;
-			return;
-		} else {
-			index = hash->table[slot].next;
-			hash->table[slot] = hash->table[index];
-		}
-	} else {
-		for (i = slot; hash->table[i].next != index; )
-			i = hash->table[i].next;
+int ofi_av_insert_addr(struct util_av *av, const void *addr, int *index)
+{
+	int ret;
 
-		hash->table[i].next = hash->table[index].next;
-	}
-	hash->table[index].next = hash->free_list;
-	hash->free_list = index;
+	fastlock_acquire(&av->lock);
+	ret = util_av_insert_addr(av, addr, index);
+	fastlock_release(&av->lock);
+	return ret;
 }
 
-static int fi_av_remove_addr(struct util_av *av, int slot, int index)
+int ofi_av_remove_addr(struct util_av *av, int index)
 {
 	struct util_ep *ep;
 	struct dlist_entry *av_entry;
@@ -334,7 +353,7 @@ static int fi_av_remove_addr(struct util_av *av, int slot, int index)
 
 	fastlock_acquire(&av->lock);
 	if (av->flags & FI_SOURCE)
-		util_av_hash_remove(&av->hash, slot, index);
+		util_av_hash_remove(av, index);
 
 	entry = util_av_get_data(av, index);
 	if (av->free_list == UTIL_NO_ENTRY || index < av->free_list) {
@@ -364,30 +383,14 @@ static int fi_av_remove_addr(struct util_av *av, int slot, int index)
 	return 0;
 }
 
-int ofi_av_lookup_index(struct util_av *av, const void *addr, int slot)
+int ofi_av_lookup_index(struct util_av *av, const void *addr)
 {
-	int i, ret = -FI_ENODATA;
-
-	if (slot < 0 || slot >= av->hash.slots) {
-		FI_WARN(av->prov, FI_LOG_AV, "invalid slot (%d)\n", slot);
-		return -FI_EINVAL;
-	}
+	int ret;
 
 	fastlock_acquire(&av->lock);
-	if (av->hash.table[slot].index == UTIL_NO_ENTRY) {
-		FI_DBG(av->prov, FI_LOG_AV, "no entry at slot (%d)\n", slot);
-		goto out;
-	}
-
-	for (i = slot; i != UTIL_NO_ENTRY; i = av->hash.table[i].next) {
-		if (!memcmp(ofi_av_get_addr(av, av->hash.table[i].index), addr,
-			    av->addrlen)) {
-			ret = av->hash.table[i].index;
-			FI_DBG(av->prov, FI_LOG_AV, "entry at index (%d)\n", ret);
-			break;
-		}
-	}
-out:
+	ret = util_av_hash_find(av, addr);
+	if (ret == UTIL_NO_ENTRY)
+		ret = -FI_ENODATA;
 	FI_DBG(av->prov, FI_LOG_AV, "%d\n", ret);
 	fastlock_release(&av->lock);
 	return ret;
@@ -415,8 +418,73 @@ int ofi_av_bind(struct fid *av_fid, struct fid *eq_fid, uint64_t flags)
 	return 0;
 }
 
+static void *util_av_insert_thread(void *arg)
+{
+	struct util_av *av = arg;
+	struct util_av_insert *insert;
+
+	fastlock_acquire(&av->lock);
+	while (!dlist_empty(&av->insert_list)) {
+		insert = container_of(av->insert_list.next,
+				      struct util_av_insert, entry);
+		fastlock_release(&av->lock);
+		insert->func(insert);
+		fastlock_acquire(&av->lock);
+		dlist_remove(&insert->entry);
+		free(insert);
+	}
+	av->insert_active = 0;
+	fastlock_release(&av->lock);
+	return NULL;
+}
+
+/*
+ * Must hold AV lock
+ */
+int ofi_av_queue_insert(struct util_av *av, struct util_av_insert *insert)
+{
+	int ret;
+
+	insert->av = av;
+	dlist_insert_tail(&insert->entry, &av->insert_list);
+	if (av->insert_active)
+		return 0;
+
+	/* The last insert thread found the queue empty and is exiting */
+	if (av->insert_joinable)
+		pthread_join(av->insert_thread, NULL);
+
+	ret = pthread_create(&av->insert_thread, NULL,
+			     util_av_insert_thread, av);
+	if (ret) {
+		FI_WARN(av->prov, FI_LOG_AV,
+			"unable to start insert thread: %s\n", strerror(ret));
+		dlist_remove(&insert->entry);
+		av->insert_joinable = 0;
+		return -ret;
+	}
+	av->insert_active = 1;
+	av->insert_joinable = 1;
+	return 0;
+}
+
+/* Returns once every queued insert has completed */
+static void util_av_wait_inserts(struct util_av *av)
+{
+	int joinable;
+
+	fastlock_acquire(&av->lock);
+	joinable = av->insert_joinable;
+	av->insert_joinable = 0;
+	fastlock_release(&av->lock);
+
+	if (joinable)
+		pthread_join(av->insert_thread, NULL);
+}
+
 int ofi_av_close(struct util_av *av)
 {
+	util_av_wait_inserts(av);
 	if (atomic_get(&av->ref)) {
 		FI_WARN(av->prov, FI_LOG_AV, "AV is busy\n");
 		return -FI_EBUSY;
@@ -429,26 +497,10 @@ int ofi_av_close(struct util_av *av)
 	fastlock_destroy(&av->lock);
 	/* TODO: unmap data? */
 	free(av->data);
+	util_av_hash_fini(&av->hash);
 	return 0;
 }
 
-static void util_av_hash_init(struct util_av_hash *hash)
-{
-	int i;
-
-	for (i = 0; i < hash->slots; i++) {
-		hash->table[i].index = UTIL_NO_ENTRY;
-		hash->table[i].next = UTIL_NO_ENTRY;
-	}
-
-	hash->free_list = hash->slots;
-	for (i = hash->slots; i < hash->total_count; i++) {
-		hash->table[i].index = UTIL_NO_ENTRY;
-		hash->table[i].next = i + 1;
-	}
-	hash->table[hash->total_count - 1].next = UTIL_NO_ENTRY;
-}
-
 static int util_av_init(struct util_av *av, const struct fi_av_attr *attr,
 			const struct util_av_attr *util_attr)
 {
@@ -459,6 +511,7 @@ static int util_av_init(struct util_av *av, const struct fi_av_attr *attr,
 	av->count = attr->count ? attr->count : UTIL_DEFAULT_AV_SIZE;
 	av->count = roundup_power_of_two(av->count);
 	av->addrlen = util_attr->addrlen;
+	av->rx_ctx_bits = attr->rx_ctx_bits;
 	av->flags = util_attr->flags | attr->flags;
 
 	FI_INFO(av->prov, FI_LOG_AV, "AV size %zu\n", av->count);
@@ -466,15 +519,7 @@ static int util_av_init(struct util_av *av, const struct fi_av_attr *attr,
 	/* TODO: Handle FI_READ */
 	/* TODO: Handle mmap - shared AV */
 
-	if (util_attr->flags & FI_SOURCE) {
-		av->hash.slots = av->count;
-		av->hash.total_count = av->count + util_attr->overhead;
-		FI_INFO(av->prov, FI_LOG_AV,
-		       "FI_SOURCE requested, hash size %zu\n", av->hash.total_count);
-	}
-
-	av->data = malloc((av->count * util_attr->addrlen) +
-			  (av->hash.total_count * sizeof(*av->hash.table)));
+	av->data = malloc(av->count * util_attr->addrlen);
 	if (!av->data)
 		return -FI_ENOMEM;
 
@@ -485,11 +530,12 @@ static int util_av_init(struct util_av *av, const struct fi_av_attr *attr,
 	entry = util_av_get_data(av, av->count - 1);
 	*entry = UTIL_NO_ENTRY;
 
-	if (util_attr->flags & FI_SOURCE) {
-		av->hash.table = util_av_get_data(av, av->count);
-		util_av_hash_init(&av->hash);
+	memset(&av->hash, 0, sizeof(av->hash));
+	if (av->flags & FI_SOURCE) {
+		ret = util_av_hash_init(av);
+		if (ret)
+			free(av->data);
 	}
-
 	return ret;
 }
 
@@ -516,6 +562,11 @@ static int util_verify_av_attr(struct util_domain *domain,
 		return -FI_EINVAL;
 	}
 
+	if (attr->rx_ctx_bits < 0 || attr->rx_ctx_bits >= 32) {
+		FI_WARN(domain->prov, FI_LOG_AV, "invalid rx_ctx_bits\n");
+		return -FI_EINVAL;
+	}
+
 	if (util_attr->flags & ~(FI_SOURCE)) {
 		FI_WARN(domain->prov, FI_LOG_AV, "invalid internal flags\n");
 		return -FI_EINVAL;
@@ -553,6 +604,9 @@ int ofi_av_init(struct util_domain *domain, const struct fi_av_attr *attr,
 	av->context = context;
 	av->domain = domain;
 	dlist_init(&av->ep_list);
+	dlist_init(&av->insert_list);
+	av->insert_active = 0;
+	av->insert_joinable = 0;
 	atomic_inc(&domain->ref);
 	return 0;
 }
@@ -564,39 +618,9 @@ int ofi_av_init(struct util_domain *domain, const struct fi_av_attr *attr,
  *
  *************************************************************************/
 
-static int ip_av_slot(struct util_av *av, const struct sockaddr *sa)
-{
-	uint32_t host;
-	uint16_t port;
-
-	if (!sa)
-		return UTIL_NO_ENTRY;
-
-	switch (((struct sockaddr *) sa)->sa_family) {
-	case AF_INET:
-		host = (uint16_t) ntohl(((struct sockaddr_in *) sa)->
-					sin_addr.s_addr);
-		port = ntohs(((struct sockaddr_in *) sa)->sin_port);
-		break;
-	case AF_INET6:
-		host = (uint16_t) ((struct sockaddr_in6 *) sa)->
-					sin6_addr.s6_addr[15];
-		port = ntohs(((struct sockaddr_in6 *) sa)->sin6_port);
-		break;
-	default:
-		assert(0);
-		return UTIL_NO_ENTRY;
-	}
-
-	/* TODO: Find a good hash function */
-	FI_DBG(av->prov, FI_LOG_AV, "slot %d\n",
-		((host << 16) | port) % av->hash.slots);
-	return ((host << 16) | port) % av->hash.slots;
-}
-
 int ip_av_get_index(struct util_av *av, const void *addr)
 {
-	return ofi_av_lookup_index(av, addr, ip_av_slot(av, addr));
+	return ofi_av_lookup_index(av, addr);
 }
 
 void ofi_av_write_event(struct util_av *av, uint64_t data,
@@ -650,7 +674,7 @@ static int ip_av_insert_addr(struct util_av *av, const void *addr,
 	int ret, index = -1;
 
 	if (ip_av_valid_addr(av, addr)) {
-		ret = ofi_av_insert_addr(av, addr, ip_av_slot(av, addr), &index);
+		ret = ofi_av_insert_addr(av, addr, &index);
 	} else {
 		ret = -FI_EADDRNOTAVAIL;
 		FI_WARN(av->prov, FI_LOG_AV, "invalid address\n");
@@ -661,11 +685,109 @@ static int ip_av_insert_addr(struct util_av *av, const void *addr,
 	return ret;
 }
 
+/*
+ * Inserts a batch of addresses.  Must hold AV lock, which is taken once
+ * for the whole batch.  Returns the number inserted.
+ */
+static int ip_av_insert_bulk(struct util_av *av, const void *addr,
+			     size_t addrlen, size_t count, fi_addr_t *fi_addr,
+			     void *context)
+{
+	const void *cur;
+	int index, ret, success_cnt = 0;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		cur = (const char *) addr + i * addrlen;
+		if (ip_av_valid_addr(av, cur)) {
+			ret = util_av_insert_addr(av, cur, &index);
+		} else {
+			ret = -FI_EADDRNOTAVAIL;
+			FI_WARN(av->prov, FI_LOG_AV, "invalid address\n");
+		}
+
+		if (fi_addr)
+			fi_addr[i] = !ret ? index : FI_ADDR_NOTAVAIL;
+		if (!ret)
+			success_cnt++;
+		else if (av->eq)
+			ofi_av_write_event(av, i, -ret, context);
+	}
+	return success_cnt;
+}
+
+struct ip_av_insert_req {
+	struct util_av_insert	insert;
+	size_t			addrlen;
+	size_t			count;
+	fi_addr_t		*fi_addr;
+	void			*context;
+	uint8_t			addr[];
+};
+
+static void ip_av_insert_work(struct util_av_insert *insert)
+{
+	struct ip_av_insert_req *req;
+	struct util_av *av = insert->av;
+	int success_cnt;
+
+	req = container_of(insert, struct ip_av_insert_req, insert);
+	fastlock_acquire(&av->lock);
+	success_cnt = ip_av_insert_bulk(av, req->addr, req->addrlen,
+					req->count, req->fi_addr, req->context);
+	fastlock_release(&av->lock);
+	FI_DBG(av->prov, FI_LOG_AV, "%d addresses successful\n", success_cnt);
+	ofi_av_write_event(av, success_cnt, 0, req->context);
+}
+
+/*
+ * Inserts into an AV opened with FI_EVENT.  Large inserts, and any insert
+ * made while others are still queued, go to the AV's insert thread.  The
+ * caller's addresses are copied, since only fi_addr must stay valid.
+ */
+static int ip_av_insert_async(struct util_av *av, const void *addr,
+			      size_t addrlen, size_t count,
+			      fi_addr_t *fi_addr, void *context)
+{
+	struct ip_av_insert_req *req;
+	int ret, success_cnt;
+
+	fastlock_acquire(&av->lock);
+	if (count < UTIL_AV_ASYNC_MIN && !ofi_av_insert_pending(av)) {
+		success_cnt = ip_av_insert_bulk(av, addr, addrlen, count,
+						fi_addr, context);
+		fastlock_release(&av->lock);
+		FI_DBG(av->prov, FI_LOG_AV, "%d addresses successful\n",
+		       success_cnt);
+		ofi_av_write_event(av, success_cnt, 0, context);
+		return 0;
+	}
+
+	req = malloc(sizeof(*req) + count * addrlen);
+	if (!req) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	memcpy(req->addr, addr, count * addrlen);
+	req->addrlen = addrlen;
+	req->count = count;
+	req->fi_addr = fi_addr;
+	req->context = context;
+	req->insert.func = ip_av_insert_work;
+	ret = ofi_av_queue_insert(av, &req->insert);
+	if (ret)
+		free(req);
+out:
+	fastlock_release(&av->lock);
+	return ret;
+}
+
 static int ip_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 			fi_addr_t *fi_addr, uint64_t flags, void *context)
 {
 	struct util_av *av;
-	int i, ret, success_cnt = 0;
+	int ret, success_cnt;
 	size_t addrlen;
 
 	av = container_of(av_fid, struct util_av, av_fid);
@@ -676,14 +798,14 @@ static int ip_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 	addrlen = ((struct sockaddr *) addr)->sa_family == AF_INET ?
 		  sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
 	FI_DBG(av->prov, FI_LOG_AV, "inserting %d addresses\n", count);
-	for (i = 0; i < count; i++) {
-		ret = ip_av_insert_addr(av, (const char *) addr + i * addrlen,
-					fi_addr ? &fi_addr[i] : NULL, context);
-		if (!ret)
-			success_cnt++;
-		else if (av->eq)
-			ofi_av_write_event(av, i, -ret, context);
-	}
+	if (av->flags & FI_EVENT)
+		return ip_av_insert_async(av, addr, addrlen, count,
+					  fi_addr, context);
+
+	fastlock_acquire(&av->lock);
+	success_cnt = ip_av_insert_bulk(av, addr, addrlen, count,
+					fi_addr, context);
+	fastlock_release(&av->lock);
 
 	FI_DBG(av->prov, FI_LOG_AV, "%d addresses successful\n", success_cnt);
 	if (av->eq) {
@@ -862,6 +984,10 @@ static int ip_av_insertsym(struct fid_av *av_fid, const char *node, size_t nodec
 		return -FI_ENOSYS;
 	}
 
+	/* Symmetric inserts are done here, after any queued inserts */
+	if (av->flags & FI_EVENT)
+		util_av_wait_inserts(av);
+
 	ret = inet_pton(AF_INET, node, &ip4);
 	if (ret == 1) {
 		FI_INFO(av->prov, FI_LOG_AV, "insert symmetric IPv4\n");
@@ -896,7 +1022,7 @@ static int ip_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr, size_t count,
 			uint64_t flags)
 {
 	struct util_av *av;
-	int i, slot, index, ret;
+	int i, index, ret;
 
 	av = container_of(av_fid, struct util_av, av_fid);
 	if (flags) {
@@ -912,8 +1038,7 @@ static int ip_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr, size_t count,
 	 */
 	for (i = count - 1; i >= 0; i--) {
 		index = (int) fi_addr[i];
-		slot = ip_av_slot(av, ip_av_get_addr(av, index));
-		ret = fi_av_remove_addr(av, slot, index);
+		ret = ofi_av_remove_addr(av, index);
 		if (ret) {
 			FI_WARN(av->prov, FI_LOG_AV,
 				"removal of fi_addr %d failed\n", index);
@@ -1003,7 +1128,6 @@ int ip_av_create(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 	else
 		util_attr.addrlen = sizeof(struct sockaddr_in6);
 
-	util_attr.overhead = attr->count >> 1;
 	util_attr.flags = domain->caps & FI_SOURCE ? FI_SOURCE : 0;
 
 	if (attr->type == FI_AV_UNSPEC)
@@ -1039,7 +1163,7 @@ static void util_cmap_set_key(struct util_cmap_handle *handle)
 static void util_cmap_clear_key(struct util_cmap_handle *handle)
 {
 	int index = ofi_key2idx(&handle->cmap->key_idx, handle->key);
-	if (index > handle->cmap->handles_idx.size) {
+	if (!ofi_idx_valid(&handle->cmap->handles_idx, index)) {
 		FI_WARN(handle->cmap->av->prov, FI_LOG_AV, "Invalid key\n");
 		return;
 	}
@@ -1051,7 +1175,7 @@ struct util_cmap_handle *ofi_cmap_key2handle(struct util_cmap *cmap, uint64_t ke
 	struct util_cmap_handle *handle;
 
 	int index = ofi_key2idx(&cmap->key_idx, key);
-	if (index > cmap->handles_idx.size) {
+	if (!ofi_idx_valid(&cmap->handles_idx, index)) {
 		FI_WARN(cmap->av->prov, FI_LOG_AV, "Invalid key\n");
 		return NULL;
 	}
@@ -1237,6 +1361,7 @@ void ofi_cmap_free(struct util_cmap *cmap)
 	ofi_cmap_del_handles(cmap);
 	fastlock_acquire(&cmap->lock);
 	free(cmap->handles_av);
+	ofi_idx_reset(&cmap->handles_idx);
 	fastlock_release(&cmap->lock);
 	free(cmap);
 }
@@ -37,6 +37,7 @@
 #include <fi_mem.h>
 #include <fi.h>
 #include <fi_osd.h>
+#include <fi_stats.h>
 
 static inline void util_buf_set_region(union util_buf *buf,
 				       struct util_buf_region *region,
@@ -84,6 +85,9 @@ int util_buf_grow(struct util_buf_pool *pool)
 		slist_insert_tail(&util_buf->entry, &pool->buf_list);
 	}
 
+	if (pool->stats && !slist_empty(&pool->region_list))
+		ofi_stats_inc(pool->stats, pool->grow_stat);
+
 	slist_insert_tail(&buf_region->entry, &pool->region_list);
 	pool->num_allocated += pool->chunk_cnt;
 	return 0;
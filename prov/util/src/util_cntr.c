@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2017 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <fi_enosys.h>
+#include <fi_util.h>
+
+
+int fi_check_cntr_attr(const struct fi_provider *prov,
+		       const struct fi_cntr_attr *attr)
+{
+	if (attr->events != FI_CNTR_EVENTS_COMP) {
+		FI_WARN(prov, FI_LOG_CQ, "unsupported event type\n");
+		return -FI_ENOSYS;
+	}
+
+	switch (attr->wait_obj) {
+	case FI_WAIT_NONE:
+	case FI_WAIT_UNSPEC:
+	case FI_WAIT_FD:
+		break;
+	case FI_WAIT_SET:
+		if (!attr->wait_set) {
+			FI_WARN(prov, FI_LOG_CQ, "invalid wait set\n");
+			return -FI_EINVAL;
+		}
+		break;
+	default:
+		FI_WARN(prov, FI_LOG_CQ, "unsupported wait object\n");
+		return -FI_EINVAL;
+	}
+
+	if (attr->flags) {
+		FI_WARN(prov, FI_LOG_CQ, "invalid flags\n");
+		return -FI_EINVAL;
+	}
+
+	return 0;
+}
+
+void ofi_cntr_signal(struct util_cntr *cntr)
+{
+	assert(cntr->wait);
+	cntr->wait->signal(cntr->wait);
+}
+
+static uint64_t ofi_cntr_read(struct fid_cntr *cntr_fid)
+{
+	struct util_cntr *cntr;
+
+	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+	cntr->progress(cntr);
+	return ofi_cntr_val_get(&cntr->cnt);
+}
+
+static uint64_t ofi_cntr_readerr(struct fid_cntr *cntr_fid)
+{
+	struct util_cntr *cntr;
+
+	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+	cntr->progress(cntr);
+	return ofi_cntr_val_get(&cntr->err);
+}
+
+static int ofi_cntr_add(struct fid_cntr *cntr_fid, uint64_t value)
+{
+	struct util_cntr *cntr;
+
+	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+	ofi_cntr_val_add(&cntr->cnt, value);
+	if (cntr->wait)
+		ofi_cntr_signal(cntr);
+	return FI_SUCCESS;
+}
+
+static int ofi_cntr_set(struct fid_cntr *cntr_fid, uint64_t value)
+{
+	struct util_cntr *cntr;
+
+	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+	ofi_cntr_val_set(&cntr->cnt, value);
+	if (cntr->wait)
+		ofi_cntr_signal(cntr);
+	return FI_SUCCESS;
+}
+
+/*
+ * Without a wait object the caller spins driving progress.  With one,
+ * fi_wait returns as soon as the pollset sees the counter move (or the
+ * wait is signaled), and the threshold is re-checked.
+ */
+static int ofi_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold,
+			 int timeout)
+{
+	struct util_cntr *cntr;
+	uint64_t start, errcnt;
+	int ret, remaining;
+
+	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+	errcnt = ofi_cntr_val_get(&cntr->err);
+	start = (timeout >= 0) ? fi_gettime_ms() : 0;
+	remaining = timeout;
+
+	while (1) {
+		cntr->progress(cntr);
+		if (ofi_cntr_val_get(&cntr->cnt) >= threshold)
+			return FI_SUCCESS;
+
+		if (ofi_cntr_val_get(&cntr->err) != errcnt)
+			return -FI_EAVAIL;
+
+		if (timeout >= 0) {
+			remaining = timeout - (int) (fi_gettime_ms() - start);
+			if (remaining <= 0)
+				return -FI_ETIMEDOUT;
+		}
+
+		if (cntr->wait) {
+			ret = fi_wait(&cntr->wait->wait_fid, remaining);
+			if (ret && ret != -FI_ETIMEDOUT)
+				return ret;
+		}
+	}
+}
+
+static struct fi_ops_cntr util_cntr_ops = {
+	.size = sizeof(struct fi_ops_cntr),
+	.read = ofi_cntr_read,
+	.readerr = ofi_cntr_readerr,
+	.add = ofi_cntr_add,
+	.set = ofi_cntr_set,
+	.wait = ofi_cntr_wait,
+};
+
+static int util_cntr_cleanup(struct util_cntr *cntr)
+{
+	if (atomic_get(&cntr->ref))
+		return -FI_EBUSY;
+
+	if (cntr->wait) {
+		fi_poll_del(&cntr->wait->pollset->poll_fid,
+			    &cntr->cntr_fid.fid, 0);
+		if (cntr->internal_wait)
+			fi_close(&cntr->wait->wait_fid.fid);
+	}
+
+	fastlock_destroy(&cntr->ep_list_lock);
+	ofi_cntr_val_fini(&cntr->cnt);
+	ofi_cntr_val_fini(&cntr->err);
+	atomic_dec(&cntr->domain->ref);
+	return 0;
+}
+
+static int util_cntr_close(struct fid *fid)
+{
+	struct util_cntr *cntr;
+	int ret;
+
+	cntr = container_of(fid, struct util_cntr, cntr_fid.fid);
+	ret = util_cntr_cleanup(cntr);
+	if (ret)
+		return ret;
+	free(cntr);
+	return 0;
+}
+
+static struct fi_ops util_cntr_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = util_cntr_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+void ofi_cntr_progress(struct util_cntr *cntr)
+{
+	struct util_ep *ep;
+	struct fid_list_entry *fid_entry;
+	struct dlist_entry *item;
+
+	fastlock_acquire(&cntr->ep_list_lock);
+	dlist_foreach(&cntr->ep_list, item) {
+		fid_entry = container_of(item, struct fid_list_entry, entry);
+		ep = container_of(fid_entry->fid, struct util_ep, ep_fid.fid);
+		ep->progress(ep);
+	}
+	fastlock_release(&cntr->ep_list_lock);
+}
+
+int ofi_cntr_open(const struct fi_provider *prov, struct fid_domain *domain,
+		  struct fi_cntr_attr *attr, struct fid_cntr **cntr_fid,
+		  ofi_cntr_progress_func progress, void *context)
+{
+	struct fi_cntr_attr default_attr = {
+		.events = FI_CNTR_EVENTS_COMP,
+		.wait_obj = FI_WAIT_NONE,
+	};
+	struct util_cntr *cntr;
+	struct fi_wait_attr wait_attr;
+	struct fid_wait *wait;
+	int ret;
+
+	assert(progress);
+	if (!attr)
+		attr = &default_attr;
+
+	ret = fi_check_cntr_attr(prov, attr);
+	if (ret)
+		return ret;
+
+	cntr = calloc(1, sizeof(*cntr));
+	if (!cntr)
+		return -FI_ENOMEM;
+
+	cntr->cntr_fid.fid.fclass = FI_CLASS_CNTR;
+	cntr->cntr_fid.fid.context = context;
+	cntr->cntr_fid.fid.ops = &util_cntr_fi_ops;
+	cntr->cntr_fid.ops = &util_cntr_ops;
+	cntr->domain = container_of(domain, struct util_domain, domain_fid);
+	cntr->progress = progress;
+
+	atomic_initialize(&cntr->ref, 0);
+	ofi_cntr_val_init(&cntr->cnt);
+	ofi_cntr_val_init(&cntr->err);
+	dlist_init(&cntr->ep_list);
+	fastlock_init(&cntr->ep_list_lock);
+
+	switch (attr->wait_obj) {
+	case FI_WAIT_NONE:
+		wait = NULL;
+		break;
+	case FI_WAIT_UNSPEC:
+	case FI_WAIT_FD:
+		memset(&wait_attr, 0, sizeof wait_attr);
+		wait_attr.wait_obj = attr->wait_obj;
+		cntr->internal_wait = 1;
+		ret = fi_wait_open(&cntr->domain->fabric->fabric_fid,
+				   &wait_attr, &wait);
+		if (ret)
+			goto err;
+		break;
+	case FI_WAIT_SET:
+		wait = attr->wait_set;
+		break;
+	default:
+		assert(0);
+		ret = -FI_EINVAL;
+		goto err;
+	}
+
+	atomic_inc(&cntr->domain->ref);
+
+	/* counter must be fully operational before adding to wait set */
+	if (wait) {
+		cntr->wait = container_of(wait, struct util_wait, wait_fid);
+		ret = fi_poll_add(&cntr->wait->pollset->poll_fid,
+				  &cntr->cntr_fid.fid, 0);
+		if (ret) {
+			if (cntr->internal_wait)
+				fi_close(&wait->fid);
+			cntr->wait = NULL;
+			util_cntr_cleanup(cntr);
+			free(cntr);
+			return ret;
+		}
+	}
+
+	*cntr_fid = &cntr->cntr_fid;
+	return 0;
+
+err:
+	fastlock_destroy(&cntr->ep_list_lock);
+	ofi_cntr_val_fini(&cntr->cnt);
+	ofi_cntr_val_fini(&cntr->err);
+	free(cntr);
+	return ret;
+}
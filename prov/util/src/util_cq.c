@@ -38,6 +38,10 @@
 
 #define UTIL_DEF_CQ_SIZE (1024)
 
+static const char * const util_cq_stat_names[] = {
+	[OFI_CQ_STAT_OVERFLOW] = "overflow",
+};
+
 int fi_check_cq_attr(const struct fi_provider *prov,
 		     const struct fi_cq_attr *attr)
 {
@@ -298,6 +302,7 @@ int ofi_cq_cleanup(struct util_cq *cq)
 	atomic_dec(&cq->domain->ref);
 	util_comp_cirq_free(cq->cirq);
 	free(cq->src);
+	ofi_stats_close(&cq->stats);
 	return 0;
 }
 
@@ -318,7 +323,7 @@ static struct fi_ops util_cq_fi_ops = {
 	.close = util_cq_close,
 	.bind = fi_no_bind,
 	.control = fi_no_control,
-	.ops_open = fi_no_ops_open,
+	.ops_open = ofi_stats_ops_open,
 };
 
 static int fi_cq_init(struct fid_domain *domain, struct fi_cq_attr *attr,
@@ -448,6 +453,11 @@ int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
 			goto err2;
 		}
 	}
+
+	ret = ofi_stats_init(&cq->stats, prov, &cq->cq_fid.fid, "cq",
+			     util_cq_stat_names, OFI_CQ_STAT_MAX);
+	if (ret)
+		goto err1;
 	return 0;
 
 err2:
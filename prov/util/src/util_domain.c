@@ -68,6 +68,8 @@ static int util_domain_init(struct util_domain *domain,
 	domain->mode = info->mode;
 	domain->addr_format = info->addr_format;
 	domain->av_type = info->domain_attr->av_type;
+	domain->max_ep_tx_ctx = info->domain_attr->max_ep_tx_ctx;
+	domain->max_ep_rx_ctx = info->domain_attr->max_ep_rx_ctx;
 	domain->name = strdup(info->domain_attr->name);
 	return domain->name ? 0 : -FI_ENOMEM;
 }
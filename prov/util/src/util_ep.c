@@ -53,6 +53,63 @@ int ofi_ep_bind_av(struct util_ep *util_ep, struct util_av *av)
 	return 0;
 }
 
+#define OFI_CNTR_FLAGS (FI_SEND | FI_RECV | FI_READ | FI_WRITE | \
+			FI_REMOTE_READ | FI_REMOTE_WRITE)
+
+static struct util_cntr **util_ep_cntr(struct util_ep *util_ep, uint64_t flag)
+{
+	switch (flag) {
+	case FI_SEND:
+		return &util_ep->tx_cntr;
+	case FI_RECV:
+		return &util_ep->rx_cntr;
+	case FI_READ:
+		return &util_ep->rd_cntr;
+	case FI_WRITE:
+		return &util_ep->wr_cntr;
+	case FI_REMOTE_READ:
+		return &util_ep->rem_rd_cntr;
+	case FI_REMOTE_WRITE:
+		return &util_ep->rem_wr_cntr;
+	default:
+		assert(0);
+		return NULL;
+	}
+}
+
+/*
+ * A counter may be bound for several event types at once; the endpoint
+ * is placed on the counter's list once so that reading the counter can
+ * drive progress for it.
+ */
+int ofi_ep_bind_cntr(struct util_ep *util_ep, struct util_cntr *cntr,
+		     uint64_t flags)
+{
+	uint64_t flag;
+	int ret;
+
+	if (!flags || (flags & ~OFI_CNTR_FLAGS))
+		return -FI_EBADFLAGS;
+
+	for (flag = FI_READ; flag <= FI_REMOTE_WRITE; flag <<= 1) {
+		if ((flags & flag) && *util_ep_cntr(util_ep, flag))
+			return -FI_EINVAL;
+	}
+
+	ret = fid_list_insert(&cntr->ep_list, &cntr->ep_list_lock,
+			      &util_ep->ep_fid.fid);
+	if (ret)
+		return ret;
+
+	for (flag = FI_READ; flag <= FI_REMOTE_WRITE; flag <<= 1) {
+		if (flags & flag) {
+			*util_ep_cntr(util_ep, flag) = cntr;
+			atomic_inc(&cntr->ref);
+		}
+	}
+	return 0;
+}
+
 int ofi_endpoint_init(struct fid_domain *domain, const struct util_prov *util_prov,
 		struct fi_info *info, struct util_ep *ep, void *context,
 		ofi_ep_progress_func progress, enum fi_match_type type)
@@ -79,6 +136,19 @@ int ofi_endpoint_init(struct fid_domain *domain, const struct util_prov *util_pr
 
 int ofi_endpoint_close(struct util_ep *util_ep)
 {
+	struct util_cntr *cntr;
+	uint64_t flag;
+
+	for (flag = FI_READ; flag <= FI_REMOTE_WRITE; flag <<= 1) {
+		cntr = *util_ep_cntr(util_ep, flag);
+		if (!cntr)
+			continue;
+
+		fid_list_remove(&cntr->ep_list, &cntr->ep_list_lock,
+				&util_ep->ep_fid.fid);
+		atomic_dec(&cntr->ref);
+	}
+
 	if (util_ep->av) {
 		fastlock_acquire(&util_ep->av->lock);
 		dlist_remove(&util_ep->av_entry);
@@ -35,6 +35,7 @@
 #include <sys/time.h>
 
 #include <fi_util.h>
+#include <fi_stats.h>
 #include <fi.h>
 
 
@@ -45,10 +46,12 @@ static fastlock_t lock;
 void fi_util_init(void)
 {
 	fastlock_init(&lock);
+	ofi_stats_ini();
 }
 
 void fi_util_fini(void)
 {
+	ofi_stats_fini();
 	fastlock_destroy(&lock);
 }
 
@@ -0,0 +1,1293 @@
+/*
+ * Copyright (c) 2017 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <rdma/fi_atomic.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_rma.h>
+#include <rdma/fi_tagged.h>
+
+#include <fi_enosys.h>
+#include <fi_util.h>
+
+/*
+ * Scalable endpoints for providers built on util.
+ *
+ * Context index i of a scalable endpoint is backed by its own provider
+ * endpoint, opened through the domain at fi_scalable_ep time.  Transmit
+ * context i and receive context i share that endpoint, but no two indices
+ * share anything, so threads driving different contexts never contend
+ * on endpoint locks, queues or buffer pools.  Context fids forward data
+ * transfer calls to their endpoint, translating fi_rx_addr() addresses
+ * on the way.
+ *
+ * The address of a scalable endpoint is the concatenation of the
+ * addresses of its receive contexts.  Peers insert it with a count equal
+ * to rx_ctx_cnt into an AV opened with rx_ctx_bits, so the receive
+ * contexts of one peer occupy consecutive AV entries.
+ */
+
+static inline fi_addr_t util_sep_addr(struct util_sep_ctx *ctx, fi_addr_t addr)
+{
+	int bits = ctx->sep->rx_ctx_bits;
+
+	if (!bits || addr == FI_ADDR_UNSPEC)
+		return addr;
+	return (addr & (~0ULL >> bits)) + (addr >> (64 - bits));
+}
+
+
+/*
+ * Data transfer forwarding
+ */
+static ssize_t util_sep_recv(struct fid_ep *ep_fid, void *buf, size_t len,
+			     void *desc, fi_addr_t src_addr, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_recv(ctx->ep, buf, len, desc, util_sep_addr(ctx, src_addr),
+		       context);
+}
+
+static ssize_t util_sep_recvv(struct fid_ep *ep_fid, const struct iovec *iov,
+			      void **desc, size_t count, fi_addr_t src_addr,
+			      void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_recvv(ctx->ep, iov, desc, count,
+			util_sep_addr(ctx, src_addr), context);
+}
+
+static ssize_t util_sep_recvmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
+				uint64_t flags)
+{
+	struct util_sep_ctx *ctx;
+	struct fi_msg ctx_msg;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	ctx_msg = *msg;
+	ctx_msg.addr = util_sep_addr(ctx, msg->addr);
+	return fi_recvmsg(ctx->ep, &ctx_msg, flags);
+}
+
+static ssize_t util_sep_send(struct fid_ep *ep_fid, const void *buf, size_t len,
+			     void *desc, fi_addr_t dest_addr, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_send(ctx->ep, buf, len, desc, util_sep_addr(ctx, dest_addr),
+		       context);
+}
+
+static ssize_t util_sep_sendv(struct fid_ep *ep_fid, const struct iovec *iov,
+			      void **desc, size_t count, fi_addr_t dest_addr,
+			      void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_sendv(ctx->ep, iov, desc, count,
+			util_sep_addr(ctx, dest_addr), context);
+}
+
+static ssize_t util_sep_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
+				uint64_t flags)
+{
+	struct util_sep_ctx *ctx;
+	struct fi_msg ctx_msg;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	ctx_msg = *msg;
+	ctx_msg.addr = util_sep_addr(ctx, msg->addr);
+	return fi_sendmsg(ctx->ep, &ctx_msg, flags);
+}
+
+static ssize_t util_sep_inject(struct fid_ep *ep_fid, const void *buf,
+			       size_t len, fi_addr_t dest_addr)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_inject(ctx->ep, buf, len, util_sep_addr(ctx, dest_addr));
+}
+
+static ssize_t util_sep_senddata(struct fid_ep *ep_fid, const void *buf,
+				 size_t len, void *desc, uint64_t data,
+				 fi_addr_t dest_addr, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_senddata(ctx->ep, buf, len, desc, data,
+			   util_sep_addr(ctx, dest_addr), context);
+}
+
+static ssize_t util_sep_injectdata(struct fid_ep *ep_fid, const void *buf,
+				   size_t len, uint64_t data,
+				   fi_addr_t dest_addr)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_injectdata(ctx->ep, buf, len, data,
+			     util_sep_addr(ctx, dest_addr));
+}
+
+static struct fi_ops_msg util_sep_tx_msg_ops = {
+	.size = sizeof(struct fi_ops_msg),
+	.recv = fi_no_msg_recv,
+	.recvv = fi_no_msg_recvv,
+	.recvmsg = fi_no_msg_recvmsg,
+	.send = util_sep_send,
+	.sendv = util_sep_sendv,
+	.sendmsg = util_sep_sendmsg,
+	.inject = util_sep_inject,
+	.senddata = util_sep_senddata,
+	.injectdata = util_sep_injectdata,
+};
+
+static struct fi_ops_msg util_sep_rx_msg_ops = {
+	.size = sizeof(struct fi_ops_msg),
+	.recv = util_sep_recv,
+	.recvv = util_sep_recvv,
+	.recvmsg = util_sep_recvmsg,
+	.send = fi_no_msg_send,
+	.sendv = fi_no_msg_sendv,
+	.sendmsg = fi_no_msg_sendmsg,
+	.inject = fi_no_msg_inject,
+	.senddata = fi_no_msg_senddata,
+	.injectdata = fi_no_msg_injectdata,
+};
+
+static ssize_t util_sep_trecv(struct fid_ep *ep_fid, void *buf, size_t len,
+			      void *desc, fi_addr_t src_addr, uint64_t tag,
+			      uint64_t ignore, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_trecv(ctx->ep, buf, len, desc, util_sep_addr(ctx, src_addr),
+			tag, ignore, context);
+}
+
+static ssize_t util_sep_trecvv(struct fid_ep *ep_fid, const struct iovec *iov,
+			       void **desc, size_t count, fi_addr_t src_addr,
+			       uint64_t tag, uint64_t ignore, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_trecvv(ctx->ep, iov, desc, count,
+			 util_sep_addr(ctx, src_addr), tag, ignore, context);
+}
+
+static ssize_t util_sep_trecvmsg(struct fid_ep *ep_fid,
+				 const struct fi_msg_tagged *msg,
+				 uint64_t flags)
+{
+	struct util_sep_ctx *ctx;
+	struct fi_msg_tagged ctx_msg;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	ctx_msg = *msg;
+	ctx_msg.addr = util_sep_addr(ctx, msg->addr);
+	return fi_trecvmsg(ctx->ep, &ctx_msg, flags);
+}
+
+static ssize_t util_sep_tsend(struct fid_ep *ep_fid, const void *buf,
+			      size_t len, void *desc, fi_addr_t dest_addr,
+			      uint64_t tag, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_tsend(ctx->ep, buf, len, desc, util_sep_addr(ctx, dest_addr),
+			tag, context);
+}
+
+static ssize_t util_sep_tsendv(struct fid_ep *ep_fid, const struct iovec *iov,
+			       void **desc, size_t count, fi_addr_t dest_addr,
+			       uint64_t tag, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_tsendv(ctx->ep, iov, desc, count,
+			 util_sep_addr(ctx, dest_addr), tag, context);
+}
+
+static ssize_t util_sep_tsendmsg(struct fid_ep *ep_fid,
+				 const struct fi_msg_tagged *msg,
+				 uint64_t flags)
+{
+	struct util_sep_ctx *ctx;
+	struct fi_msg_tagged ctx_msg;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	ctx_msg = *msg;
+	ctx_msg.addr = util_sep_addr(ctx, msg->addr);
+	return fi_tsendmsg(ctx->ep, &ctx_msg, flags);
+}
+
+static ssize_t util_sep_tinject(struct fid_ep *ep_fid, const void *buf,
+				size_t len, fi_addr_t dest_addr, uint64_t tag)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_tinject(ctx->ep, buf, len, util_sep_addr(ctx, dest_addr),
+			  tag);
+}
+
+static ssize_t util_sep_tsenddata(struct fid_ep *ep_fid, const void *buf,
+				  size_t len, void *desc, uint64_t data,
+				  fi_addr_t dest_addr, uint64_t tag,
+				  void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_tsenddata(ctx->ep, buf, len, desc, data,
+			    util_sep_addr(ctx, dest_addr), tag, context);
+}
+
+static ssize_t util_sep_tinjectdata(struct fid_ep *ep_fid, const void *buf,
+				    size_t len, uint64_t data,
+				    fi_addr_t dest_addr, uint64_t tag)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_tinjectdata(ctx->ep, buf, len, data,
+			      util_sep_addr(ctx, dest_addr), tag);
+}
+
+static struct fi_ops_tagged util_sep_tx_tagged_ops = {
+	.size = sizeof(struct fi_ops_tagged),
+	.recv = fi_no_tagged_recv,
+	.recvv = fi_no_tagged_recvv,
+	.recvmsg = fi_no_tagged_recvmsg,
+	.send = util_sep_tsend,
+	.sendv = util_sep_tsendv,
+	.sendmsg = util_sep_tsendmsg,
+	.inject = util_sep_tinject,
+	.senddata = util_sep_tsenddata,
+	.injectdata = util_sep_tinjectdata,
+};
+
+static struct fi_ops_tagged util_sep_rx_tagged_ops = {
+	.size = sizeof(struct fi_ops_tagged),
+	.recv = util_sep_trecv,
+	.recvv = util_sep_trecvv,
+	.recvmsg = util_sep_trecvmsg,
+	.send = fi_no_tagged_send,
+	.sendv = fi_no_tagged_sendv,
+	.sendmsg = fi_no_tagged_sendmsg,
+	.inject = fi_no_tagged_inject,
+	.senddata = fi_no_tagged_senddata,
+	.injectdata = fi_no_tagged_injectdata,
+};
+
+static ssize_t util_sep_read(struct fid_ep *ep_fid, void *buf, size_t len,
+			     void *desc, fi_addr_t src_addr, uint64_t addr,
+			     uint64_t key, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_read(ctx->ep, buf, len, desc, util_sep_addr(ctx, src_addr),
+		       addr, key, context);
+}
+
+static ssize_t util_sep_readv(struct fid_ep *ep_fid, const struct iovec *iov,
+			      void **desc, size_t count, fi_addr_t src_addr,
+			      uint64_t addr, uint64_t key, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_readv(ctx->ep, iov, desc, count,
+			util_sep_addr(ctx, src_addr), addr, key, context);
+}
+
+static ssize_t util_sep_readmsg(struct fid_ep *ep_fid,
+				const struct fi_msg_rma *msg, uint64_t flags)
+{
+	struct util_sep_ctx *ctx;
+	struct fi_msg_rma ctx_msg;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	ctx_msg = *msg;
+	ctx_msg.addr = util_sep_addr(ctx, msg->addr);
+	return fi_readmsg(ctx->ep, &ctx_msg, flags);
+}
+
+static ssize_t util_sep_write(struct fid_ep *ep_fid, const void *buf,
+			      size_t len, void *desc, fi_addr_t dest_addr,
+			      uint64_t addr, uint64_t key, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_write(ctx->ep, buf, len, desc, util_sep_addr(ctx, dest_addr),
+			addr, key, context);
+}
+
+static ssize_t util_sep_writev(struct fid_ep *ep_fid, const struct iovec *iov,
+			       void **desc, size_t count, fi_addr_t dest_addr,
+			       uint64_t addr, uint64_t key, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_writev(ctx->ep, iov, desc, count,
+			 util_sep_addr(ctx, dest_addr), addr, key, context);
+}
+
+static ssize_t util_sep_writemsg(struct fid_ep *ep_fid,
+				 const struct fi_msg_rma *msg, uint64_t flags)
+{
+	struct util_sep_ctx *ctx;
+	struct fi_msg_rma ctx_msg;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	ctx_msg = *msg;
+	ctx_msg.addr = util_sep_addr(ctx, msg->addr);
+	return fi_writemsg(ctx->ep, &ctx_msg, flags);
+}
+
+static ssize_t util_sep_inject_write(struct fid_ep *ep_fid, const void *buf,
+				     size_t len, fi_addr_t dest_addr,
+				     uint64_t addr, uint64_t key)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_inject_write(ctx->ep, buf, len,
+			       util_sep_addr(ctx, dest_addr), addr, key);
+}
+
+static ssize_t util_sep_writedata(struct fid_ep *ep_fid, const void *buf,
+				  size_t len, void *desc, uint64_t data,
+				  fi_addr_t dest_addr, uint64_t addr,
+				  uint64_t key, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_writedata(ctx->ep, buf, len, desc, data,
+			    util_sep_addr(ctx, dest_addr), addr, key, context);
+}
+
+static ssize_t util_sep_inject_writedata(struct fid_ep *ep_fid,
+					 const void *buf, size_t len,
+					 uint64_t data, fi_addr_t dest_addr,
+					 uint64_t addr, uint64_t key)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_inject_writedata(ctx->ep, buf, len, data,
+				   util_sep_addr(ctx, dest_addr), addr, key);
+}
+
+static struct fi_ops_rma util_sep_tx_rma_ops = {
+	.size = sizeof(struct fi_ops_rma),
+	.read = util_sep_read,
+	.readv = util_sep_readv,
+	.readmsg = util_sep_readmsg,
+	.write = util_sep_write,
+	.writev = util_sep_writev,
+	.writemsg = util_sep_writemsg,
+	.inject = util_sep_inject_write,
+	.writedata = util_sep_writedata,
+	.injectdata = util_sep_inject_writedata,
+};
+
+static struct fi_ops_rma util_sep_rx_rma_ops = {
+	.size = sizeof(struct fi_ops_rma),
+	.read = fi_no_rma_read,
+	.readv = fi_no_rma_readv,
+	.readmsg = fi_no_rma_readmsg,
+	.write = fi_no_rma_write,
+	.writev = fi_no_rma_writev,
+	.writemsg = fi_no_rma_writemsg,
+	.inject = fi_no_rma_inject,
+	.writedata = fi_no_rma_writedata,
+	.injectdata = fi_no_rma_injectdata,
+};
+
+static ssize_t util_sep_atomic(struct fid_ep *ep_fid, const void *buf,
+			       size_t count, void *desc, fi_addr_t dest_addr,
+			       uint64_t addr, uint64_t key,
+			       enum fi_datatype datatype, enum fi_op op,
+			       void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_atomic(ctx->ep, buf, count, desc,
+			 util_sep_addr(ctx, dest_addr), addr, key,
+			 datatype, op, context);
+}
+
+static ssize_t util_sep_atomicv(struct fid_ep *ep_fid,
+				const struct fi_ioc *iov, void **desc,
+				size_t count, fi_addr_t dest_addr,
+				uint64_t addr, uint64_t key,
+				enum fi_datatype datatype, enum fi_op op,
+				void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_atomicv(ctx->ep, iov, desc, count,
+			  util_sep_addr(ctx, dest_addr), addr, key,
+			  datatype, op, context);
+}
+
+static ssize_t util_sep_atomicmsg(struct fid_ep *ep_fid,
+				  const struct fi_msg_atomic *msg,
+				  uint64_t flags)
+{
+	struct util_sep_ctx *ctx;
+	struct fi_msg_atomic ctx_msg;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	ctx_msg = *msg;
+	ctx_msg.addr = util_sep_addr(ctx, msg->addr);
+	return fi_atomicmsg(ctx->ep, &ctx_msg, flags);
+}
+
+static ssize_t util_sep_inject_atomic(struct fid_ep *ep_fid, const void *buf,
+				      size_t count, fi_addr_t dest_addr,
+				      uint64_t addr, uint64_t key,
+				      enum fi_datatype datatype, enum fi_op op)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_inject_atomic(ctx->ep, buf, count,
+				util_sep_addr(ctx, dest_addr), addr, key,
+				datatype, op);
+}
+
+static ssize_t util_sep_fetch_atomic(struct fid_ep *ep_fid, const void *buf,
+				     size_t count, void *desc, void *result,
+				     void *result_desc, fi_addr_t dest_addr,
+				     uint64_t addr, uint64_t key,
+				     enum fi_datatype datatype, enum fi_op op,
+				     void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_fetch_atomic(ctx->ep, buf, count, desc, result, result_desc,
+			       util_sep_addr(ctx, dest_addr), addr, key,
+			       datatype, op, context);
+}
+
+static ssize_t util_sep_fetch_atomicv(struct fid_ep *ep_fid,
+				      const struct fi_ioc *iov, void **desc,
+				      size_t count, struct fi_ioc *resultv,
+				      void **result_desc, size_t result_count,
+				      fi_addr_t dest_addr, uint64_t addr,
+				      uint64_t key, enum fi_datatype datatype,
+				      enum fi_op op, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_fetch_atomicv(ctx->ep, iov, desc, count, resultv,
+				result_desc, result_count,
+				util_sep_addr(ctx, dest_addr), addr, key,
+				datatype, op, context);
+}
+
+static ssize_t util_sep_fetch_atomicmsg(struct fid_ep *ep_fid,
+					const struct fi_msg_atomic *msg,
+					struct fi_ioc *resultv,
+					void **result_desc,
+					size_t result_count, uint64_t flags)
+{
+	struct util_sep_ctx *ctx;
+	struct fi_msg_atomic ctx_msg;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	ctx_msg = *msg;
+	ctx_msg.addr = util_sep_addr(ctx, msg->addr);
+	return fi_fetch_atomicmsg(ctx->ep, &ctx_msg, resultv, result_desc,
+				  result_count, flags);
+}
+
+static ssize_t util_sep_compare_atomic(struct fid_ep *ep_fid, const void *buf,
+				       size_t count, void *desc,
+				       const void *compare,
+				       void *compare_desc, void *result,
+				       void *result_desc, fi_addr_t dest_addr,
+				       uint64_t addr, uint64_t key,
+				       enum fi_datatype datatype,
+				       enum fi_op op, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_compare_atomic(ctx->ep, buf, count, desc, compare,
+				 compare_desc, result, result_desc,
+				 util_sep_addr(ctx, dest_addr), addr, key,
+				 datatype, op, context);
+}
+
+static ssize_t util_sep_compare_atomicv(struct fid_ep *ep_fid,
+					const struct fi_ioc *iov, void **desc,
+					size_t count,
+					const struct fi_ioc *comparev,
+					void **compare_desc,
+					size_t compare_count,
+					struct fi_ioc *resultv,
+					void **result_desc,
+					size_t result_count,
+					fi_addr_t dest_addr, uint64_t addr,
+					uint64_t key, enum fi_datatype datatype,
+					enum fi_op op, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_compare_atomicv(ctx->ep, iov, desc, count, comparev,
+				  compare_desc, compare_count, resultv,
+				  result_desc, result_count,
+				  util_sep_addr(ctx, dest_addr), addr, key,
+				  datatype, op, context);
+}
+
+static ssize_t util_sep_compare_atomicmsg(struct fid_ep *ep_fid,
+					  const struct fi_msg_atomic *msg,
+					  const struct fi_ioc *comparev,
+					  void **compare_desc,
+					  size_t compare_count,
+					  struct fi_ioc *resultv,
+					  void **result_desc,
+					  size_t result_count, uint64_t flags)
+{
+	struct util_sep_ctx *ctx;
+	struct fi_msg_atomic ctx_msg;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	ctx_msg = *msg;
+	ctx_msg.addr = util_sep_addr(ctx, msg->addr);
+	return fi_compare_atomicmsg(ctx->ep, &ctx_msg, comparev, compare_desc,
+				    compare_count, resultv, result_desc,
+				    result_count, flags);
+}
+
+static int util_sep_atomicvalid(struct fid_ep *ep_fid,
+				enum fi_datatype datatype, enum fi_op op,
+				size_t *count)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_atomicvalid(ctx->ep, datatype, op, count);
+}
+
+static int util_sep_fetch_atomicvalid(struct fid_ep *ep_fid,
+				      enum fi_datatype datatype, enum fi_op op,
+				      size_t *count)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_fetch_atomicvalid(ctx->ep, datatype, op, count);
+}
+
+static int util_sep_compare_atomicvalid(struct fid_ep *ep_fid,
+					enum fi_datatype datatype,
+					enum fi_op op, size_t *count)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_compare_atomicvalid(ctx->ep, datatype, op, count);
+}
+
+static struct fi_ops_atomic util_sep_tx_atomic_ops = {
+	.size = sizeof(struct fi_ops_atomic),
+	.write = util_sep_atomic,
+	.writev = util_sep_atomicv,
+	.writemsg = util_sep_atomicmsg,
+	.inject = util_sep_inject_atomic,
+	.readwrite = util_sep_fetch_atomic,
+	.readwritev = util_sep_fetch_atomicv,
+	.readwritemsg = util_sep_fetch_atomicmsg,
+	.compwrite = util_sep_compare_atomic,
+	.compwritev = util_sep_compare_atomicv,
+	.compwritemsg = util_sep_compare_atomicmsg,
+	.writevalid = util_sep_atomicvalid,
+	.readwritevalid = util_sep_fetch_atomicvalid,
+	.compwritevalid = util_sep_compare_atomicvalid,
+};
+
+static struct fi_ops_atomic util_sep_rx_atomic_ops = {
+	.size = sizeof(struct fi_ops_atomic),
+	.write = fi_no_atomic_write,
+	.writev = fi_no_atomic_writev,
+	.writemsg = fi_no_atomic_writemsg,
+	.inject = fi_no_atomic_inject,
+	.readwrite = fi_no_atomic_readwrite,
+	.readwritev = fi_no_atomic_readwritev,
+	.readwritemsg = fi_no_atomic_readwritemsg,
+	.compwrite = fi_no_atomic_compwrite,
+	.compwritev = fi_no_atomic_compwritev,
+	.compwritemsg = fi_no_atomic_compwritemsg,
+	.writevalid = fi_no_atomic_writevalid,
+	.readwritevalid = fi_no_atomic_readwritevalid,
+	.compwritevalid = fi_no_atomic_compwritevalid,
+};
+
+
+/*
+ * Transmit and receive contexts
+ */
+static ssize_t util_sep_ctx_cancel(fid_t fid, void *context)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(fid, struct util_sep_ctx, ep_fid.fid);
+	return fi_cancel(&ctx->ep->fid, context);
+}
+
+static int util_sep_ctx_getopt(fid_t fid, int level, int optname,
+			       void *optval, size_t *optlen)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(fid, struct util_sep_ctx, ep_fid.fid);
+	return fi_getopt(&ctx->ep->fid, level, optname, optval, optlen);
+}
+
+static int util_sep_ctx_setopt(fid_t fid, int level, int optname,
+			       const void *optval, size_t optlen)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(fid, struct util_sep_ctx, ep_fid.fid);
+	return fi_setopt(&ctx->ep->fid, level, optname, optval, optlen);
+}
+
+static ssize_t util_sep_ctx_rx_size_left(struct fid_ep *ep_fid)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_rx_size_left(ctx->ep);
+}
+
+static ssize_t util_sep_ctx_tx_size_left(struct fid_ep *ep_fid)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(ep_fid, struct util_sep_ctx, ep_fid);
+	return fi_tx_size_left(ctx->ep);
+}
+
+static struct fi_ops_ep util_sep_ctx_ep_ops = {
+	.size = sizeof(struct fi_ops_ep),
+	.cancel = util_sep_ctx_cancel,
+	.getopt = util_sep_ctx_getopt,
+	.setopt = util_sep_ctx_setopt,
+	.tx_ctx = fi_no_tx_ctx,
+	.rx_ctx = fi_no_rx_ctx,
+	.rx_size_left = util_sep_ctx_rx_size_left,
+	.tx_size_left = util_sep_ctx_tx_size_left,
+};
+
+static int util_sep_ctx_getname(fid_t fid, void *addr, size_t *addrlen)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(fid, struct util_sep_ctx, ep_fid.fid);
+	return fi_getname(&ctx->ep->fid, addr, addrlen);
+}
+
+static struct fi_ops_cm util_sep_ctx_cm_ops = {
+	.size = sizeof(struct fi_ops_cm),
+	.setname = fi_no_setname,
+	.getname = util_sep_ctx_getname,
+	.getpeer = fi_no_getpeer,
+	.connect = fi_no_connect,
+	.listen = fi_no_listen,
+	.accept = fi_no_accept,
+	.reject = fi_no_reject,
+	.shutdown = fi_no_shutdown,
+	.join = fi_no_join,
+};
+
+/*
+ * The endpoint behind an index is enabled once every context opened at
+ * that index is enabled, so both contexts of an index must be opened
+ * before either is enabled.  When only one direction is in use, the other
+ * side of the endpoint reports to the same CQ; nothing is posted there.
+ */
+static int util_sep_enable_ep(struct util_sep *sep, int index)
+{
+	struct util_sep_ctx *tx, *rx;
+	int ret;
+
+	tx = (index < sep->tx_ctx_cnt) ? sep->tx_ctx[index] : NULL;
+	rx = (index < sep->rx_ctx_cnt) ? sep->rx_ctx[index] : NULL;
+
+	if ((tx && !tx->enabled) || (rx && !rx->enabled))
+		return 0;
+
+	if (!tx) {
+		ret = fi_ep_bind(sep->eps[index], rx->cq, FI_TRANSMIT);
+		if (ret)
+			return ret;
+	} else if (!rx) {
+		ret = fi_ep_bind(sep->eps[index], tx->cq, FI_RECV);
+		if (ret)
+			return ret;
+	}
+
+	ret = fi_enable(sep->eps[index]);
+	if (!ret)
+		sep->ep_enabled[index] = 1;
+	return ret;
+}
+
+static int util_sep_ctx_enable(struct util_sep_ctx *ctx)
+{
+	struct util_sep *sep = ctx->sep;
+	int ret;
+
+	if (!ctx->cq)
+		return -FI_ENOCQ;
+
+	fastlock_acquire(&sep->lock);
+	if (ctx->enabled) {
+		ret = 0;
+		goto out;
+	}
+
+	ctx->enabled = 1;
+	ret = util_sep_enable_ep(sep, ctx->index);
+	if (ret)
+		ctx->enabled = 0;
+out:
+	fastlock_release(&sep->lock);
+	return ret;
+}
+
+static int util_sep_ctx_bind(struct fid *fid, struct fid *bfid, uint64_t flags)
+{
+	struct util_sep_ctx *ctx;
+	uint64_t valid, dir;
+	int ret;
+
+	ctx = container_of(fid, struct util_sep_ctx, ep_fid.fid);
+	switch (bfid->fclass) {
+	case FI_CLASS_CQ:
+		dir = ctx->is_tx ? FI_TRANSMIT : FI_RECV;
+		valid = dir | FI_SELECTIVE_COMPLETION;
+		break;
+	case FI_CLASS_CNTR:
+		dir = 0;
+		valid = ctx->is_tx ? (FI_SEND | FI_READ | FI_WRITE) :
+			(FI_RECV | FI_REMOTE_READ | FI_REMOTE_WRITE);
+		break;
+	default:
+		FI_WARN(ctx->sep->domain->prov, FI_LOG_EP_CTRL,
+			"invalid fid class for context\n");
+		return -FI_EINVAL;
+	}
+
+	if (flags & ~valid) {
+		FI_WARN(ctx->sep->domain->prov, FI_LOG_EP_CTRL,
+			"invalid flags for context\n");
+		return -FI_EBADFLAGS;
+	}
+
+	if (bfid->fclass == FI_CLASS_CQ && ctx->cq) {
+		FI_WARN(ctx->sep->domain->prov, FI_LOG_EP_CTRL,
+			"duplicate CQ binding\n");
+		return -FI_EINVAL;
+	}
+
+	ret = fi_ep_bind(ctx->ep, bfid, flags | dir);
+	if (ret)
+		return ret;
+
+	fastlock_acquire(&ctx->sep->lock);
+	ctx->sep->ep_bound[ctx->index] = 1;
+	fastlock_release(&ctx->sep->lock);
+	if (bfid->fclass == FI_CLASS_CQ)
+		ctx->cq = bfid;
+	return 0;
+}
+
+static int util_sep_ctx_control(struct fid *fid, int command, void *arg)
+{
+	struct util_sep_ctx *ctx;
+
+	ctx = container_of(fid, struct util_sep_ctx, ep_fid.fid);
+	switch (command) {
+	case FI_ENABLE:
+		return util_sep_ctx_enable(ctx);
+	default:
+		return -FI_ENOSYS;
+	}
+}
+
+/*
+ * Bindings cannot be removed from an endpoint, so once the last context
+ * at an index is closed, the endpoint behind it is replaced with a new
+ * one at the same address.  That releases the CQs and counters the
+ * contexts bound, and lets the index be opened and enabled again.
+ */
+static int util_sep_reset_ep(struct util_sep *sep, int index)
+{
+	char name[FI_NAME_MAX];
+	size_t len = sizeof name;
+	int ret;
+
+	ret = fi_getname(&sep->eps[index]->fid, name, &len);
+	if (ret)
+		return ret;
+
+	free(sep->info->src_addr);
+	sep->info->src_addr = mem_dup(name, len);
+	if (!sep->info->src_addr) {
+		sep->info->src_addrlen = 0;
+		return -FI_ENOMEM;
+	}
+	sep->info->src_addrlen = len;
+
+	ret = fi_close(&sep->eps[index]->fid);
+	if (ret)
+		return ret;
+	sep->ep_enabled[index] = 0;
+	sep->ep_bound[index] = 0;
+
+	ret = fi_endpoint(&sep->domain->domain_fid, sep->info,
+			  &sep->eps[index], sep->ep_fid.fid.context);
+	if (ret)
+		goto err;
+
+	if (sep->av) {
+		ret = fi_ep_bind(sep->eps[index], sep->av, sep->av_flags);
+		if (ret)
+			goto err_close;
+	}
+	if (sep->eq) {
+		ret = fi_ep_bind(sep->eps[index], sep->eq, sep->eq_flags);
+		if (ret)
+			goto err_close;
+	}
+	return 0;
+err_close:
+	fi_close(&sep->eps[index]->fid);
+err:
+	sep->eps[index] = NULL;
+	return ret;
+}
+
+static int util_sep_ctx_close(struct fid *fid)
+{
+	struct util_sep_ctx *ctx;
+	struct util_sep *sep;
+	int ret;
+
+	ctx = container_of(fid, struct util_sep_ctx, ep_fid.fid);
+	sep = ctx->sep;
+
+	fastlock_acquire(&sep->lock);
+	if (ctx->is_tx)
+		sep->tx_ctx[ctx->index] = NULL;
+	else
+		sep->rx_ctx[ctx->index] = NULL;
+
+	if (sep->ep_bound[ctx->index] &&
+	    (ctx->index >= sep->tx_ctx_cnt || !sep->tx_ctx[ctx->index]) &&
+	    (ctx->index >= sep->rx_ctx_cnt || !sep->rx_ctx[ctx->index])) {
+		ret = util_sep_reset_ep(sep, ctx->index);
+		if (ret) {
+			FI_WARN(sep->domain->prov, FI_LOG_EP_CTRL,
+				"unable to reopen context endpoint: %s\n",
+				fi_strerror(-ret));
+		}
+	}
+	fastlock_release(&sep->lock);
+
+	atomic_dec(&sep->ref);
+	free(ctx);
+	return 0;
+}
+
+static struct fi_ops util_sep_ctx_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = util_sep_ctx_close,
+	.bind = util_sep_ctx_bind,
+	.control = util_sep_ctx_control,
+	.ops_open = fi_no_ops_open,
+};
+
+static int util_sep_ctx_open(struct util_sep *sep, int index, int is_tx,
+			     struct fid_ep **ctx_fid, void *context)
+{
+	struct util_sep_ctx *ctx, **slot;
+	struct fid_ep *ep;
+	int ret;
+
+	if (index < 0 || index >= (is_tx ? sep->tx_ctx_cnt : sep->rx_ctx_cnt)) {
+		FI_WARN(sep->domain->prov, FI_LOG_EP_CTRL,
+			"context index out of range\n");
+		return -FI_EINVAL;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx)
+		return -FI_ENOMEM;
+
+	fastlock_acquire(&sep->lock);
+	ep = sep->eps[index];
+	fastlock_release(&sep->lock);
+	if (!ep) {
+		FI_WARN(sep->domain->prov, FI_LOG_EP_CTRL,
+			"context endpoint unavailable\n");
+		free(ctx);
+		return -FI_EOPBADSTATE;
+	}
+
+	ctx->ep_fid.fid.fclass = is_tx ? FI_CLASS_TX_CTX : FI_CLASS_RX_CTX;
+	ctx->ep_fid.fid.context = context;
+	ctx->ep_fid.fid.ops = &util_sep_ctx_fi_ops;
+	ctx->ep_fid.ops = &util_sep_ctx_ep_ops;
+	ctx->ep_fid.cm = &util_sep_ctx_cm_ops;
+	if (is_tx) {
+		ctx->ep_fid.msg = ep->msg ? &util_sep_tx_msg_ops : NULL;
+		ctx->ep_fid.tagged = ep->tagged ? &util_sep_tx_tagged_ops : NULL;
+		ctx->ep_fid.rma = ep->rma ? &util_sep_tx_rma_ops : NULL;
+		ctx->ep_fid.atomic = ep->atomic ? &util_sep_tx_atomic_ops : NULL;
+	} else {
+		ctx->ep_fid.msg = ep->msg ? &util_sep_rx_msg_ops : NULL;
+		ctx->ep_fid.tagged = ep->tagged ? &util_sep_rx_tagged_ops : NULL;
+		ctx->ep_fid.rma = ep->rma ? &util_sep_rx_rma_ops : NULL;
+		ctx->ep_fid.atomic = ep->atomic ? &util_sep_rx_atomic_ops : NULL;
+	}
+	ctx->sep = sep;
+	ctx->ep = ep;
+	ctx->index = index;
+	ctx->is_tx = is_tx;
+
+	fastlock_acquire(&sep->lock);
+	slot = is_tx ? &sep->tx_ctx[index] : &sep->rx_ctx[index];
+	if (*slot) {
+		FI_WARN(sep->domain->prov, FI_LOG_EP_CTRL,
+			"context already open\n");
+		ret = -FI_EBUSY;
+		goto err;
+	}
+	if (sep->ep_enabled[index]) {
+		FI_WARN(sep->domain->prov, FI_LOG_EP_CTRL,
+			"context index already enabled\n");
+		ret = -FI_EOPBADSTATE;
+		goto err;
+	}
+	*slot = ctx;
+	fastlock_release(&sep->lock);
+
+	atomic_inc(&sep->ref);
+	*ctx_fid = &ctx->ep_fid;
+	return 0;
+err:
+	fastlock_release(&sep->lock);
+	free(ctx);
+	return ret;
+}
+
+static int util_sep_tx_ctx(struct fid_ep *ep_fid, int index,
+			   struct fi_tx_attr *attr, struct fid_ep **tx_ep,
+			   void *context)
+{
+	struct util_sep *sep;
+
+	sep = container_of(ep_fid, struct util_sep, ep_fid);
+	return util_sep_ctx_open(sep, index, 1, tx_ep, context);
+}
+
+static int util_sep_rx_ctx(struct fid_ep *ep_fid, int index,
+			   struct fi_rx_attr *attr, struct fid_ep **rx_ep,
+			   void *context)
+{
+	struct util_sep *sep;
+
+	sep = container_of(ep_fid, struct util_sep, ep_fid);
+	return util_sep_ctx_open(sep, index, 0, rx_ep, context);
+}
+
+
+/*
+ * Scalable endpoint
+ */
+static struct fi_ops_ep util_sep_ep_ops = {
+	.size = sizeof(struct fi_ops_ep),
+	.cancel = fi_no_cancel,
+	.getopt = fi_no_getopt,
+	.setopt = fi_no_setopt,
+	.tx_ctx = util_sep_tx_ctx,
+	.rx_ctx = util_sep_rx_ctx,
+	.rx_size_left = fi_no_rx_size_left,
+	.tx_size_left = fi_no_tx_size_left,
+};
+
+static int util_sep_getname(fid_t fid, void *addr, size_t *addrlen)
+{
+	struct util_sep *sep;
+	char name[FI_NAME_MAX];
+	size_t len, total = 0;
+	int i, ret;
+
+	sep = container_of(fid, struct util_sep, ep_fid.fid);
+	for (i = 0; i < sep->rx_ctx_cnt; i++) {
+		if (!sep->eps[i])
+			return -FI_EOPBADSTATE;
+		len = sizeof name;
+		ret = fi_getname(&sep->eps[i]->fid, name, &len);
+		if (ret)
+			return ret;
+
+		if (total + len <= *addrlen)
+			memcpy((char *) addr + total, name, len);
+		total += len;
+	}
+
+	ret = (total > *addrlen) ? -FI_ETOOSMALL : 0;
+	*addrlen = total;
+	return ret;
+}
+
+static struct fi_ops_cm util_sep_cm_ops = {
+	.size = sizeof(struct fi_ops_cm),
+	.setname = fi_no_setname,
+	.getname = util_sep_getname,
+	.getpeer = fi_no_getpeer,
+	.connect = fi_no_connect,
+	.listen = fi_no_listen,
+	.accept = fi_no_accept,
+	.reject = fi_no_reject,
+	.shutdown = fi_no_shutdown,
+	.join = fi_no_join,
+};
+
+static int util_sep_bind(struct fid *fid, struct fid *bfid, uint64_t flags)
+{
+	struct util_sep *sep;
+	struct util_av *av;
+	int i, ret;
+
+	sep = container_of(fid, struct util_sep, ep_fid.fid);
+	switch (bfid->fclass) {
+	case FI_CLASS_AV:
+		av = container_of(bfid, struct util_av, av_fid.fid);
+		sep->rx_ctx_bits = av->rx_ctx_bits;
+		break;
+	case FI_CLASS_EQ:
+		break;
+	default:
+		FI_WARN(sep->domain->prov, FI_LOG_EP_CTRL,
+			"CQs and counters are bound to contexts\n");
+		return -FI_EINVAL;
+	}
+
+	for (i = 0; i < sep->ep_cnt; i++) {
+		ret = fi_ep_bind(sep->eps[i], bfid, flags);
+		if (ret)
+			return ret;
+	}
+
+	if (bfid->fclass == FI_CLASS_AV) {
+		sep->av = bfid;
+		sep->av_flags = flags;
+	} else {
+		sep->eq = bfid;
+		sep->eq_flags = flags;
+	}
+	return 0;
+}
+
+static int util_sep_control(struct fid *fid, int command, void *arg)
+{
+	switch (command) {
+	case FI_ENABLE:
+		/* contexts are enabled individually */
+		return 0;
+	default:
+		return -FI_ENOSYS;
+	}
+}
+
+static void util_sep_free(struct util_sep *sep)
+{
+	int i;
+
+	for (i = 0; i < sep->ep_cnt; i++) {
+		if (sep->eps[i])
+			fi_close(&sep->eps[i]->fid);
+	}
+	fi_freeinfo(sep->info);
+	fastlock_destroy(&sep->lock);
+	atomic_dec(&sep->domain->ref);
+	free(sep);
+}
+
+static int util_sep_close(struct fid *fid)
+{
+	struct util_sep *sep;
+
+	sep = container_of(fid, struct util_sep, ep_fid.fid);
+	if (atomic_get(&sep->ref))
+		return -FI_EBUSY;
+
+	util_sep_free(sep);
+	return 0;
+}
+
+static struct fi_ops util_sep_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = util_sep_close,
+	.bind = util_sep_bind,
+	.control = util_sep_control,
+	.ops_open = fi_no_ops_open,
+};
+
+/* Endpoints after the first must not collide on an explicit port. */
+static void util_sep_clear_port(struct fi_info *info)
+{
+	struct sockaddr *sa = info->src_addr;
+
+	if (!sa || info->src_addrlen < sizeof(*sa))
+		return;
+
+	switch (sa->sa_family) {
+	case AF_INET:
+		((struct sockaddr_in *) sa)->sin_port = 0;
+		break;
+	case AF_INET6:
+		((struct sockaddr_in6 *) sa)->sin6_port = 0;
+		break;
+	}
+}
+
+int ofi_scalable_ep(struct fid_domain *domain_fid, struct fi_info *info,
+		    struct fid_ep **sep_fid, void *context)
+{
+	struct util_domain *domain;
+	struct util_sep *sep;
+	size_t ep_cnt;
+	int i, ret;
+
+	domain = container_of(domain_fid, struct util_domain, domain_fid);
+	if (!info || !info->ep_attr || !info->ep_attr->tx_ctx_cnt ||
+	    !info->ep_attr->rx_ctx_cnt ||
+	    info->ep_attr->tx_ctx_cnt == FI_SHARED_CONTEXT ||
+	    info->ep_attr->rx_ctx_cnt == FI_SHARED_CONTEXT) {
+		FI_WARN(domain->prov, FI_LOG_EP_CTRL,
+			"invalid context counts\n");
+		return -FI_EINVAL;
+	}
+
+	if (info->ep_attr->tx_ctx_cnt > domain->max_ep_tx_ctx ||
+	    info->ep_attr->rx_ctx_cnt > domain->max_ep_rx_ctx) {
+		FI_WARN(domain->prov, FI_LOG_EP_CTRL,
+			"context count exceeds domain limit\n");
+		return -FI_EINVAL;
+	}
+
+	ep_cnt = MAX(info->ep_attr->tx_ctx_cnt, info->ep_attr->rx_ctx_cnt);
+	sep = calloc(1, sizeof(*sep) + ep_cnt * (sizeof(*sep->eps) +
+		     sizeof(*sep->tx_ctx) + sizeof(*sep->rx_ctx) +
+		     sizeof(*sep->ep_enabled) + sizeof(*sep->ep_bound)));
+	if (!sep)
+		return -FI_ENOMEM;
+
+	sep->eps = (struct fid_ep **) (sep + 1);
+	sep->tx_ctx = (struct util_sep_ctx **) (sep->eps + ep_cnt);
+	sep->rx_ctx = sep->tx_ctx + ep_cnt;
+	sep->ep_enabled = (uint8_t *) (sep->rx_ctx + ep_cnt);
+	sep->ep_bound = sep->ep_enabled + ep_cnt;
+	sep->ep_cnt = (int) ep_cnt;
+	sep->tx_ctx_cnt = (int) info->ep_attr->tx_ctx_cnt;
+	sep->rx_ctx_cnt = (int) info->ep_attr->rx_ctx_cnt;
+	sep->domain = domain;
+	atomic_initialize(&sep->ref, 0);
+	fastlock_init(&sep->lock);
+	atomic_inc(&domain->ref);
+
+	sep->info = fi_dupinfo(info);
+	if (!sep->info) {
+		ret = -FI_ENOMEM;
+		goto err;
+	}
+	sep->info->ep_attr->tx_ctx_cnt = 1;
+	sep->info->ep_attr->rx_ctx_cnt = 1;
+
+	for (i = 0; i < sep->ep_cnt; i++) {
+		ret = fi_endpoint(domain_fid, sep->info, &sep->eps[i], context);
+		if (ret)
+			goto err;
+		if (!i)
+			util_sep_clear_port(sep->info);
+	}
+
+	sep->ep_fid.fid.fclass = FI_CLASS_SEP;
+	sep->ep_fid.fid.context = context;
+	sep->ep_fid.fid.ops = &util_sep_fi_ops;
+	sep->ep_fid.ops = &util_sep_ep_ops;
+	sep->ep_fid.cm = &util_sep_cm_ops;
+
+	*sep_fid = &sep->ep_fid;
+	return 0;
+err:
+	FI_WARN(domain->prov, FI_LOG_EP_CTRL,
+		"unable to open context endpoint\n");
+	util_sep_free(sep);
+	return ret;
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2017 Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <fi.h>
+#include <fi_atom.h>
+#include <fi_stats.h>
+
+#define OFI_STATS_LINE_LEN	1024
+#define OFI_STATS_PER_LINE	(64 / sizeof(ofi_stat_t))
+
+__thread int ofi_stats_tid = -1;
+
+static DEFINE_LIST(stats_list);
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stats_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t stats_thread;
+static int stats_thread_started, stats_stop;
+static atomic_t stats_next_tid;
+
+static int stats_dump;
+static int stats_interval;
+
+int ofi_stats_next_shard(void)
+{
+	return atomic_inc(&stats_next_tid) % OFI_STATS_SHARDS;
+}
+
+static void ofi_stats_sum(struct ofi_stats *stats, uint64_t *values)
+{
+	int i, j;
+
+	memset(values, 0, sizeof(*values) * stats->cnt);
+	for (i = 0; i < OFI_STATS_SHARDS; i++) {
+		for (j = 0; j < stats->cnt; j++)
+			values[j] += ofi_stat_load(&stats->shards[i * stats->stride + j]);
+	}
+}
+
+uint64_t ofi_stats_get(struct ofi_stats *stats, int id)
+{
+	uint64_t value = 0;
+	int i;
+
+	for (i = 0; i < OFI_STATS_SHARDS; i++)
+		value += ofi_stat_load(&stats->shards[i * stats->stride + id]);
+	return value;
+}
+
+/* Written to the log sink whatever FI_LOG_LEVEL is */
+void ofi_stats_dump(struct ofi_stats *stats)
+{
+	char buf[OFI_STATS_LINE_LEN];
+	size_t len;
+	int i;
+
+	len = snprintf(buf, sizeof(buf), "%s %p:", stats->label,
+		       (void *) stats->fid);
+	for (i = 0; i < stats->cnt && len < sizeof(buf); i++) {
+		len += snprintf(buf + len, sizeof(buf) - len, " %s=%" PRIu64,
+				stats->names[i], ofi_stats_get(stats, i));
+	}
+
+	fi_log(stats->prov, FI_LOG_WARN, FI_LOG_CORE, __func__, __LINE__,
+	       "%s\n", buf);
+}
+
+static void *ofi_stats_thread(void *arg)
+{
+	struct dlist_entry *item;
+	struct timespec ts;
+	uint64_t next;
+
+	pthread_mutex_lock(&stats_lock);
+	while (!stats_stop) {
+		next = fi_gettime_ms() + stats_interval * 1000ULL;
+		ts.tv_sec = next / 1000;
+		ts.tv_nsec = (next % 1000) * 1000000;
+		pthread_cond_timedwait(&stats_cond, &stats_lock, &ts);
+		if (stats_stop)
+			break;
+
+		dlist_foreach(&stats_list, item)
+			ofi_stats_dump(container_of(item, struct ofi_stats,
+						    entry));
+	}
+	pthread_mutex_unlock(&stats_lock);
+	return NULL;
+}
+
+int ofi_stats_init(struct ofi_stats *stats, const struct fi_provider *prov,
+		   struct fid *fid, const char *label,
+		   const char * const *names, int cnt)
+{
+	int ret;
+
+	stats->fid = fid;
+	stats->prov = prov;
+	stats->label = label;
+	stats->names = names;
+	stats->cnt = cnt;
+	stats->stride = fi_get_aligned_sz(cnt, OFI_STATS_PER_LINE);
+
+	ret = ofi_memalign((void **) &stats->shards, 64, OFI_STATS_SHARDS *
+			   stats->stride * sizeof(*stats->shards));
+	if (ret) {
+		stats->shards = NULL;
+		return -FI_ENOMEM;
+	}
+	memset(stats->shards, 0, OFI_STATS_SHARDS * stats->stride *
+	       sizeof(*stats->shards));
+
+	pthread_mutex_lock(&stats_lock);
+	dlist_insert_tail(&stats->entry, &stats_list);
+	if (stats_interval > 0 && !stats_thread_started) {
+		if (pthread_create(&stats_thread, NULL, ofi_stats_thread, NULL))
+			FI_WARN(prov, FI_LOG_CORE,
+				"unable to start statistics thread\n");
+		else
+			stats_thread_started = 1;
+	}
+	pthread_mutex_unlock(&stats_lock);
+	return 0;
+}
+
+void ofi_stats_close(struct ofi_stats *stats)
+{
+	if (!stats->shards)
+		return;
+
+	pthread_mutex_lock(&stats_lock);
+	dlist_remove(&stats->entry);
+	pthread_mutex_unlock(&stats_lock);
+
+	if (stats_dump)
+		ofi_stats_dump(stats);
+
+	ofi_freealign(stats->shards);
+	stats->shards = NULL;
+}
+
+static int ofi_stats_match_fid(struct dlist_entry *item, const void *arg)
+{
+	return container_of(item, struct ofi_stats, entry)->fid == arg;
+}
+
+static struct ofi_stats *ofi_stats_find(struct fid *fid)
+{
+	struct dlist_entry *item;
+
+	item = dlist_find_first_match(&stats_list, ofi_stats_match_fid, fid);
+	return item ? container_of(item, struct ofi_stats, entry) : NULL;
+}
+
+static ssize_t ofi_stats_read(struct fid *fid, struct fi_stat *buf,
+			      size_t count)
+{
+	struct ofi_stats *stats;
+	uint64_t *values;
+	ssize_t ret;
+	size_t i;
+
+	pthread_mutex_lock(&stats_lock);
+	stats = ofi_stats_find(fid);
+	if (!stats) {
+		ret = -FI_ENOENT;
+		goto out;
+	}
+
+	values = malloc(sizeof(*values) * stats->cnt);
+	if (!values) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	ofi_stats_sum(stats, values);
+	for (i = 0; i < count && i < (size_t) stats->cnt; i++) {
+		buf[i].name = stats->names[i];
+		buf[i].value = values[i];
+	}
+	free(values);
+	ret = stats->cnt;
+out:
+	pthread_mutex_unlock(&stats_lock);
+	return ret;
+}
+
+static int ofi_stats_reset(struct fid *fid)
+{
+	struct ofi_stats *stats;
+	int i;
+
+	pthread_mutex_lock(&stats_lock);
+	stats = ofi_stats_find(fid);
+	if (stats) {
+		for (i = 0; i < OFI_STATS_SHARDS * stats->stride; i++)
+			ofi_stat_store(&stats->shards[i], 0);
+	}
+	pthread_mutex_unlock(&stats_lock);
+	return stats ? 0 : -FI_ENOENT;
+}
+
+static struct fi_ops_stats ofi_stats_ops = {
+	.size = sizeof(struct fi_ops_stats),
+	.read = ofi_stats_read,
+	.reset = ofi_stats_reset,
+};
+
+int ofi_stats_ops_open(struct fid *fid, const char *name, uint64_t flags,
+		       void **ops, void *context)
+{
+	struct ofi_stats *stats;
+
+	if (strcmp(name, FI_STATS_OPS_1))
+		return -FI_ENOSYS;
+
+	pthread_mutex_lock(&stats_lock);
+	stats = ofi_stats_find(fid);
+	pthread_mutex_unlock(&stats_lock);
+	if (!stats)
+		return -FI_ENOSYS;
+
+	*ops = &ofi_stats_ops;
+	return 0;
+}
+
+void ofi_stats_ini(void)
+{
+	atomic_initialize(&stats_next_tid, 0);
+
+	fi_param_define(NULL, "stats_dump", FI_PARAM_BOOL,
+			"Log the statistics of an object when it is closed "
+			"(default: no)");
+	fi_param_define(NULL, "stats_interval", FI_PARAM_INT,
+			"Log the statistics of all open objects every given "
+			"number of seconds (default: 0, never)");
+	fi_param_get_bool(NULL, "stats_dump", &stats_dump);
+	fi_param_get_int(NULL, "stats_interval", &stats_interval);
+}
+
+void ofi_stats_fini(void)
+{
+	pthread_mutex_lock(&stats_lock);
+	stats_stop = 1;
+	pthread_cond_signal(&stats_cond);
+	pthread_mutex_unlock(&stats_lock);
+
+	if (stats_thread_started) {
+		pthread_join(stats_thread, NULL);
+		stats_thread_started = 0;
+	}
+}
@@ -39,28 +39,51 @@
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
+#include <inttypes.h>
+#include <unistd.h>
 
 #include <rdma/fi_errno.h>
 #include "fi.h"
 #include "prov.h"
+#include "fasthash.h"
 
 #ifdef HAVE_LIBDL
 #include <dlfcn.h>
 #endif
 
+/*
+ * Providers are discovered by fi_ini(), but their init routines are not
+ * called, nor their libraries opened, until the provider is first needed.
+ * Until then, a provider is only known by the name it was built under,
+ * which is what the FI_PROVIDER filter and the prov_name hint are
+ * matched against.
+ */
+enum {
+	FI_PROV_PENDING,
+	FI_PROV_LOADED,
+	FI_PROV_FAILED,
+};
+
 struct fi_prov {
 	struct fi_prov		*next;
 	struct fi_provider	*provider;
 	void			*dlhandle;
+	char			*name;
+	char			*lib;
+	struct fi_provider	*(*inif)(void);
+	int			state;
 };
 
 static struct fi_prov *fi_getprov(const char *prov_name);
+static void fi_getinfo_cache_fini(void);
 
 static struct fi_prov *prov_head, *prov_tail;
 int ofi_init = 0;
 pthread_mutex_t ofi_ini_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static struct fi_filter prov_filter;
+static int getinfo_cache = 1;
+static int getinfo_threads;
 
 static int fi_find_name(char **names, const char *name)
 {
@@ -99,7 +122,76 @@ static void cleanup_provider(struct fi_provider *provider, void *dlhandle)
 #endif
 }
 
-static int fi_register_provider(struct fi_provider *provider, void *dlhandle)
+static void fi_add_provider(const char *name, struct fi_provider *(*inif)(void),
+			    char *lib)
+{
+	struct fi_prov *prov;
+
+	if (!inif && !lib)
+		return;
+
+	if (fi_apply_filter(&prov_filter, name)) {
+		FI_INFO(&core_prov, FI_LOG_CORE,
+			"\"%s\" filtered by provider include/exclude list, skipping\n",
+			name);
+		goto err;
+	}
+
+	prov = calloc(sizeof *prov, 1);
+	if (!prov)
+		goto err;
+
+	prov->name = strdup(name);
+	if (!prov->name) {
+		free(prov);
+		goto err;
+	}
+
+	prov->inif = inif;
+	prov->lib = lib;
+	prov->state = FI_PROV_PENDING;
+	if (prov_tail)
+		prov_tail->next = prov;
+	else
+		prov_head = prov;
+	prov_tail = prov;
+	return;
+err:
+	free(lib);
+}
+
+static struct fi_provider *fi_call_prov_ini(struct fi_prov *prov,
+					    void **dlhandle)
+{
+	struct fi_provider* (*inif)(void) = prov->inif;
+
+	*dlhandle = NULL;
+#ifdef HAVE_LIBDL
+	if (prov->lib) {
+		FI_DBG(&core_prov, FI_LOG_CORE, "opening provider lib %s\n",
+		       prov->lib);
+
+		*dlhandle = dlopen(prov->lib, RTLD_NOW);
+		if (*dlhandle == NULL) {
+			FI_WARN(&core_prov, FI_LOG_CORE,
+			       "dlopen(%s): %s\n", prov->lib, dlerror());
+			return NULL;
+		}
+
+		inif = dlsym(*dlhandle, "fi_prov_ini");
+		if (inif == NULL) {
+			FI_WARN(&core_prov, FI_LOG_CORE, "dlsym: %s\n", dlerror());
+			dlclose(*dlhandle);
+			*dlhandle = NULL;
+			return NULL;
+		}
+	}
+#endif
+	return inif ? inif() : NULL;
+}
+
+static int fi_register_provider(struct fi_prov *slot,
+				struct fi_provider *provider, void *dlhandle)
 {
 	struct fi_prov_context *ctx;
 	struct fi_prov *prov;
@@ -169,19 +261,9 @@ static int fi_register_provider(struct fi_provider *provider, void *dlhandle)
 		return 0;
 	}
 
-	prov = calloc(sizeof *prov, 1);
-	if (!prov) {
-		ret = -FI_ENOMEM;
-		goto cleanup;
-	}
-
-	prov->dlhandle = dlhandle;
-	prov->provider = provider;
-	if (prov_tail)
-		prov_tail->next = prov;
-	else
-		prov_head = prov;
-	prov_tail = prov;
+	slot->dlhandle = dlhandle;
+	slot->provider = provider;
+	slot->state = FI_PROV_LOADED;
 	return 0;
 
 cleanup:
@@ -189,6 +271,47 @@ cleanup:
 	return ret;
 }
 
+/* Load every pending provider built under the same name as prov, so that
+ * the version check in fi_register_provider() sees all of them.  Called
+ * with ofi_ini_lock held.
+ */
+static void fi_load_provider(struct fi_prov *prov)
+{
+	struct fi_provider *provider;
+	struct fi_prov *cur;
+	void *dlhandle;
+
+	for (cur = prov; cur; cur = cur->next) {
+		if (cur->state != FI_PROV_PENDING ||
+		    strcasecmp(cur->name, prov->name))
+			continue;
+
+		cur->state = FI_PROV_FAILED;
+		provider = fi_call_prov_ini(cur, &dlhandle);
+		fi_register_provider(cur, provider, dlhandle);
+	}
+}
+
+static int fi_prov_ready(struct fi_prov *prov)
+{
+	int ret;
+
+	pthread_mutex_lock(&ofi_ini_lock);
+	if (prov->state == FI_PROV_PENDING)
+		fi_load_provider(prov);
+	ret = (prov->state == FI_PROV_LOADED);
+	pthread_mutex_unlock(&ofi_ini_lock);
+	return ret;
+}
+
+void ofi_load_providers(void)
+{
+	struct fi_prov *prov;
+
+	for (prov = prov_head; prov; prov = prov->next)
+		fi_prov_ready(prov);
+}
+
 #ifdef HAVE_LIBDL
 static int lib_filter(const struct dirent *entry)
 {
@@ -291,13 +414,26 @@ void fi_create_filter(struct fi_filter *filter, const char *raw_filter)
 }
 
 #ifdef HAVE_LIBDL
+/* Derive the provider name from its library name, libfoo-fi.so */
+static char *fi_lib_prov_name(const char *lib)
+{
+	size_t len = strlen(lib) - (sizeof(FI_LIB_SUFFIX) - 1);
+
+	if (!strncmp(lib, "lib", 3)) {
+		lib += 3;
+		len -= 3;
+	}
+	if (len && lib[len - 1] == '-')
+		len--;
+
+	return strndup(lib, len);
+}
+
 static void fi_ini_dir(const char *dir)
 {
 	int n = 0;
-	char *lib;
-	void *dlhandle;
+	char *lib, *name;
 	struct dirent **liblist = NULL;
-	struct fi_provider* (*inif)(void);
 
 	n = scandir(dir, &liblist, lib_filter, NULL);
 	if (n < 0)
@@ -309,24 +445,17 @@ static void fi_ini_dir(const char *dir)
 			       "asprintf failed to allocate memory\n");
 			goto libdl_done;
 		}
-		FI_DBG(&core_prov, FI_LOG_CORE, "opening provider lib %s\n", lib);
 
-		dlhandle = dlopen(lib, RTLD_NOW);
+		name = fi_lib_prov_name(liblist[n]->d_name);
 		free(liblist[n]);
-		if (dlhandle == NULL) {
-			FI_WARN(&core_prov, FI_LOG_CORE,
-			       "dlopen(%s): %s\n", lib, dlerror());
+		if (!name) {
 			free(lib);
 			continue;
 		}
-		free(lib);
 
-		inif = dlsym(dlhandle, "fi_prov_ini");
-		if (inif == NULL) {
-			FI_WARN(&core_prov, FI_LOG_CORE, "dlsym: %s\n", dlerror());
-			dlclose(dlhandle);
-		} else
-			fi_register_provider((inif)(), dlhandle);
+		FI_DBG(&core_prov, FI_LOG_CORE, "found provider lib %s\n", lib);
+		fi_add_provider(name, NULL, lib);
+		free(name);
 	}
 
 libdl_done:
@@ -357,8 +486,17 @@ void fi_ini(void)
 			" (default: no). Setting this to yes could improve"
 			" performance at the expense of making fork() potentially"
 			" unsafe");
+	fi_param_define(NULL, "getinfo_cache", FI_PARAM_BOOL,
+			"Reuse the results of earlier fi_getinfo calls made with"
+			" the same arguments (default: yes)");
 	fi_param_get_str(NULL, "provider", &param_val);
 	fi_create_filter(&prov_filter, param_val);
+	fi_param_define(NULL, "getinfo_threads", FI_PARAM_INT,
+			"Number of threads used to query providers during"
+			" fi_getinfo (default: one per CPU, up to 4)");
+	fi_param_get_bool(NULL, "getinfo_cache", &getinfo_cache);
+	getinfo_threads = MIN(4, sysconf(_SC_NPROCESSORS_ONLN));
+	fi_param_get_int(NULL, "getinfo_threads", &getinfo_threads);
 
 #ifdef HAVE_LIBDL
 	int n = 0;
@@ -390,20 +528,21 @@ void fi_ini(void)
 libdl_done:
 #endif
 
-	fi_register_provider(PSM2_INIT, NULL);
-	fi_register_provider(PSM_INIT, NULL);
-	fi_register_provider(USNIC_INIT, NULL);
-	fi_register_provider(MLX_INIT, NULL);
-	fi_register_provider(VERBS_INIT, NULL);
-	fi_register_provider(GNI_INIT, NULL);
-	fi_register_provider(RXM_INIT, NULL);
-	fi_register_provider(RXD_INIT, NULL);
-	fi_register_provider(BGQ_INIT, NULL);
+	fi_add_provider("psm2", PSM2_INIT, NULL);
+	fi_add_provider("psm", PSM_INIT, NULL);
+	fi_add_provider("usnic", USNIC_INIT, NULL);
+	fi_add_provider("mlx", MLX_INIT, NULL);
+	fi_add_provider("verbs", VERBS_INIT, NULL);
+	fi_add_provider("gni", GNI_INIT, NULL);
+	fi_add_provider("rxm", RXM_INIT, NULL);
+	fi_add_provider("rxd", RXD_INIT, NULL);
+	fi_add_provider("shm", SHM_INIT, NULL);
+	fi_add_provider("bgq", BGQ_INIT, NULL);
 
         /* Initialize the socket(s) provider last.  This will result in
            it being the least preferred provider. */
-	fi_register_provider(UDP_INIT, NULL);
-	fi_register_provider(SOCKETS_INIT, NULL);
+	fi_add_provider("UDP", UDP_INIT, NULL);
+	fi_add_provider("sockets", SOCKETS_INIT, NULL);
 	/* Before you add ANYTHING here, read the comment above!!! */
 
 	/* Seriously, read it! */
@@ -424,10 +563,14 @@ FI_DESTRUCTOR(fi_fini(void))
 	while (prov_head) {
 		prov = prov_head;
 		prov_head = prov->next;
-		cleanup_provider(prov->provider, prov->dlhandle);
+		if (prov->state == FI_PROV_LOADED)
+			cleanup_provider(prov->provider, prov->dlhandle);
+		free(prov->name);
+		free(prov->lib);
 		free(prov);
 	}
 
+	fi_getinfo_cache_fini();
 	fi_free_filter(&prov_filter);
 	fi_log_fini();
 	fi_param_fini();
@@ -440,13 +583,38 @@ static struct fi_prov *fi_getprov(const char *prov_name)
 	struct fi_prov *prov;
 
 	for (prov = prov_head; prov; prov = prov->next) {
-		if (!strcmp(prov_name, prov->provider->name))
+		if (prov->state == FI_PROV_LOADED &&
+		    !strcmp(prov_name, prov->provider->name))
 			return prov;
 	}
 
 	return NULL;
 }
 
+/* Look up a provider by name, loading it first if needed */
+static struct fi_prov *fi_findprov(const char *prov_name)
+{
+	struct fi_prov *prov;
+
+	for (prov = prov_head; prov; prov = prov->next) {
+		if (!strcasecmp(prov->name, prov_name))
+			fi_prov_ready(prov);
+	}
+
+	pthread_mutex_lock(&ofi_ini_lock);
+	prov = fi_getprov(prov_name);
+	pthread_mutex_unlock(&ofi_ini_lock);
+	if (prov)
+		return prov;
+
+	/* The provider may live in a library named after something else */
+	ofi_load_providers();
+	pthread_mutex_lock(&ofi_ini_lock);
+	prov = fi_getprov(prov_name);
+	pthread_mutex_unlock(&ofi_ini_lock);
+	return prov;
+}
+
 __attribute__((visibility ("default")))
 void DEFAULT_SYMVER_PRE(fi_freeinfo)(struct fi_info *info)
 {
@@ -484,6 +652,9 @@ static int fi_getprovinfo(struct fi_info **info)
 
 	*info = tail = NULL;
 	for (prov = prov_head; prov; prov = prov->next) {
+		if (!fi_prov_ready(prov))
+			continue;
+
 		cur = fi_allocinfo();
 		if (!cur) {
 			ret = -FI_ENOMEM;
@@ -516,42 +687,142 @@ err:
 	return ret;
 }
 
-__attribute__((visibility ("default")))
-int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node, const char *service,
-	       uint64_t flags, struct fi_info *hints, struct fi_info **info)
+/*
+ * Providers are probed concurrently by up to getinfo_threads threads,
+ * the calling thread included.  Each probe fills its own slot, and the
+ * slots are merged in provider order afterwards, so the result does not
+ * depend on which probe finishes first.  Layered providers call back
+ * into fi_getinfo() from a probe; those nested calls probe serially.
+ */
+struct fi_probe {
+	struct fi_prov		*prov;
+	struct fi_info		*info;
+	uint64_t		time;
+	int			ret;
+};
+
+struct fi_probe_set {
+	uint32_t		version;
+	const char		*node;
+	const char		*service;
+	uint64_t		flags;
+	struct fi_info		*hints;
+	struct fi_probe		*probes;
+	int			cnt;
+	atomic_t		next;
+};
+
+static __thread int fi_probing;
+
+static void fi_probe_run(struct fi_probe_set *set)
 {
+	struct fi_probe *probe;
+	uint64_t start;
+	int i, probing;
+
+	probing = fi_probing;
+	fi_probing = 1;
+	while ((i = atomic_inc(&set->next) - 1) < set->cnt) {
+		probe = &set->probes[i];
+		start = fi_gettime_us();
+		probe->ret = probe->prov->provider->getinfo(set->version,
+					set->node, set->service, set->flags,
+					set->hints, &probe->info);
+		probe->time = fi_gettime_us() - start;
+	}
+	fi_probing = probing;
+}
+
+static void *fi_probe_thread(void *arg)
+{
+	fi_probe_run(arg);
+	return NULL;
+}
+
+static void fi_probe_all(struct fi_probe_set *set)
+{
+	pthread_t *threads;
+	int i, cnt;
+
+	cnt = fi_probing ? 0 : MIN(getinfo_threads, set->cnt) - 1;
+	threads = cnt > 0 ? calloc(cnt, sizeof(*threads)) : NULL;
+	if (!threads)
+		cnt = 0;
+
+	for (i = 0; i < cnt; i++) {
+		if (pthread_create(&threads[i], NULL, fi_probe_thread, set)) {
+			FI_INFO(&core_prov, FI_LOG_CORE,
+				"unable to start probe thread\n");
+			break;
+		}
+	}
+	cnt = i;
+
+	fi_probe_run(set);
+	for (i = 0; i < cnt; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+static int fi_getinfo_providers(uint32_t version, const char *node,
+				const char *service, uint64_t flags,
+				struct fi_info *hints, struct fi_info **info)
+{
+	struct fi_probe_set set;
 	struct fi_prov *prov;
 	struct fi_info *tail, *cur;
-	int ret;
+	const char *prov_name;
+	int i;
 
-	if (!ofi_init)
-		fi_ini();
+	prov_name = (hints && hints->fabric_attr) ?
+		    hints->fabric_attr->prov_name : NULL;
 
-	if (FI_VERSION_LT(fi_version(), version)) {
-		FI_WARN(&core_prov, FI_LOG_CORE,
-			"Requested version is newer than library\n");
-		return -FI_ENOSYS;
-	}
+	memset(&set, 0, sizeof(set));
+	for (prov = prov_head; prov; prov = prov->next)
+		set.cnt++;
+	if (!set.cnt)
+		return -FI_ENODATA;
 
-	if (flags == FI_PROV_ATTR_ONLY) {
-		return fi_getprovinfo(info);
-	}
+	set.probes = calloc(set.cnt, sizeof(*set.probes));
+	if (!set.probes)
+		return -FI_ENOMEM;
 
-	*info = tail = NULL;
+	set.cnt = 0;
 	for (prov = prov_head; prov; prov = prov->next) {
-		if (!prov->provider->getinfo)
+		/* Filter on the name before loading the provider */
+		if (prov_name && strcasecmp(prov->name, prov_name))
+			continue;
+
+		if (!fi_prov_ready(prov) || !prov->provider->getinfo)
 			continue;
 
-		if (hints && hints->fabric_attr && hints->fabric_attr->prov_name &&
-		    strcasecmp(prov->provider->name, hints->fabric_attr->prov_name))
+		if (prov_name && strcasecmp(prov->provider->name, prov_name))
 			continue;
 
-		ret = prov->provider->getinfo(version, node, service, flags,
-					      hints, &cur);
-		if (ret) {
+		set.probes[set.cnt++].prov = prov;
+	}
+
+	set.version = version;
+	set.node = node;
+	set.service = service;
+	set.flags = flags;
+	set.hints = hints;
+	atomic_initialize(&set.next, 0);
+	fi_probe_all(&set);
+
+	*info = tail = NULL;
+	for (i = 0; i < set.cnt; i++) {
+		prov = set.probes[i].prov;
+		cur = set.probes[i].info;
+		FI_INFO(&core_prov, FI_LOG_CORE,
+			"fi_getinfo: provider %s probed in %" PRIu64 " usec\n",
+			prov->provider->name, set.probes[i].time);
+
+		if (set.probes[i].ret) {
 			FI_WARN(&core_prov, FI_LOG_CORE,
 			       "fi_getinfo: provider %s returned -%d (%s)\n",
-			       prov->provider->name, -ret, fi_strerror(-ret));
+			       prov->provider->name, -set.probes[i].ret,
+			       fi_strerror(-set.probes[i].ret));
 			continue;
 		}
 
@@ -582,8 +853,271 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node, const cha
 		tail->fabric_attr->prov_version = prov->provider->version;
 	}
 
+	free(set.probes);
 	return *info ? 0 : -FI_ENODATA;
 }
+
+/*
+ * fi_getinfo() results are cached, keyed by a flat copy of the call's
+ * arguments.  Pointers to owned attributes and strings are replaced by
+ * their contents, each field prefixed by its length.  Calls whose hints
+ * refer to open objects are not cached, since a new object may later
+ * reuse the same address.
+ */
+#define FI_GETINFO_CACHE_SIZE	16
+
+struct fi_getinfo_key {
+	uint8_t			*data;
+	size_t			len;
+	size_t			size;
+	int			err;
+};
+
+struct fi_getinfo_entry {
+	struct dlist_entry	entry;
+	uint64_t		digest;
+	struct fi_getinfo_key	key;
+	struct fi_info		*info;
+	int			ret;
+};
+
+static DEFINE_LIST(getinfo_cache_list);
+static int getinfo_cache_cnt;
+static pthread_mutex_t getinfo_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void fi_getinfo_key_add(struct fi_getinfo_key *key, const void *data,
+			       size_t len)
+{
+	size_t hdr = data ? len : SIZE_MAX;
+	size_t need = key->len + sizeof(hdr) + (data ? len : 0);
+	uint8_t *buf;
+
+	if (key->err)
+		return;
+
+	if (need > key->size) {
+		buf = realloc(key->data, MAX(need, key->size * 2));
+		if (!buf) {
+			key->err = 1;
+			return;
+		}
+		key->data = buf;
+		key->size = MAX(need, key->size * 2);
+	}
+
+	memcpy(key->data + key->len, &hdr, sizeof(hdr));
+	key->len += sizeof(hdr);
+	if (data) {
+		memcpy(key->data + key->len, data, len);
+		key->len += len;
+	}
+}
+
+static void fi_getinfo_key_str(struct fi_getinfo_key *key, const char *str)
+{
+	fi_getinfo_key_add(key, str, str ? strlen(str) : 0);
+}
+
+static int fi_getinfo_key_init(struct fi_getinfo_key *key, uint32_t version,
+			       const char *node, const char *service,
+			       uint64_t flags, const struct fi_info *hints)
+{
+	struct fi_info info;
+	struct fi_domain_attr domain_attr;
+	struct fi_fabric_attr fabric_attr;
+
+	if (hints && (hints->handle ||
+		      (hints->domain_attr && hints->domain_attr->domain) ||
+		      (hints->fabric_attr && hints->fabric_attr->fabric)))
+		return -FI_EINVAL;
+
+	memset(key, 0, sizeof(*key));
+	fi_getinfo_key_add(key, &version, sizeof(version));
+	fi_getinfo_key_add(key, &flags, sizeof(flags));
+	fi_getinfo_key_str(key, node);
+	fi_getinfo_key_str(key, service);
+	if (!hints)
+		goto out;
+
+	memcpy(&info, hints, sizeof(info));
+	info.next = NULL;
+	info.src_addr = info.dest_addr = NULL;
+	info.tx_attr = NULL;
+	info.rx_attr = NULL;
+	info.ep_attr = NULL;
+	info.domain_attr = NULL;
+	info.fabric_attr = NULL;
+	fi_getinfo_key_add(key, &info, sizeof(info));
+	fi_getinfo_key_add(key, hints->src_addr, hints->src_addrlen);
+	fi_getinfo_key_add(key, hints->dest_addr, hints->dest_addrlen);
+	fi_getinfo_key_add(key, hints->tx_attr, sizeof(*hints->tx_attr));
+	fi_getinfo_key_add(key, hints->rx_attr, sizeof(*hints->rx_attr));
+	fi_getinfo_key_add(key, hints->ep_attr, sizeof(*hints->ep_attr));
+
+	if (hints->domain_attr) {
+		memcpy(&domain_attr, hints->domain_attr, sizeof(domain_attr));
+		domain_attr.name = NULL;
+		fi_getinfo_key_add(key, &domain_attr, sizeof(domain_attr));
+		fi_getinfo_key_str(key, hints->domain_attr->name);
+	} else {
+		fi_getinfo_key_add(key, NULL, 0);
+	}
+
+	if (hints->fabric_attr) {
+		memcpy(&fabric_attr, hints->fabric_attr, sizeof(fabric_attr));
+		fabric_attr.name = NULL;
+		fabric_attr.prov_name = NULL;
+		fi_getinfo_key_add(key, &fabric_attr, sizeof(fabric_attr));
+		fi_getinfo_key_str(key, hints->fabric_attr->name);
+		fi_getinfo_key_str(key, hints->fabric_attr->prov_name);
+	} else {
+		fi_getinfo_key_add(key, NULL, 0);
+	}
+out:
+	if (key->err) {
+		free(key->data);
+		return -FI_ENOMEM;
+	}
+	return 0;
+}
+
+static struct fi_info *fi_dupinfo_list(const struct fi_info *info)
+{
+	struct fi_info *head = NULL, *tail = NULL, *cur;
+
+	for (; info; info = info->next) {
+		cur = fi_dupinfo(info);
+		if (!cur) {
+			fi_freeinfo(head);
+			return NULL;
+		}
+
+		if (tail)
+			tail->next = cur;
+		else
+			head = cur;
+		tail = cur;
+	}
+	return head;
+}
+
+static void fi_getinfo_cache_free(struct fi_getinfo_entry *entry)
+{
+	dlist_remove(&entry->entry);
+	getinfo_cache_cnt--;
+	fi_freeinfo(entry->info);
+	free(entry->key.data);
+	free(entry);
+}
+
+/* Returns 1 and a copy of the cached result on a hit */
+static int fi_getinfo_cache_get(struct fi_getinfo_key *key, uint64_t digest,
+				struct fi_info **info, int *ret)
+{
+	struct fi_getinfo_entry *entry;
+	struct dlist_entry *item;
+	int hit = 0;
+
+	pthread_mutex_lock(&getinfo_cache_lock);
+	dlist_foreach(&getinfo_cache_list, item) {
+		entry = container_of(item, struct fi_getinfo_entry, entry);
+		if (entry->digest != digest || entry->key.len != key->len ||
+		    memcmp(entry->key.data, key->data, key->len))
+			continue;
+
+		*info = fi_dupinfo_list(entry->info);
+		if (entry->info && !*info)
+			break;
+
+		*ret = entry->ret;
+		dlist_remove(&entry->entry);
+		dlist_insert_head(&entry->entry, &getinfo_cache_list);
+		hit = 1;
+		break;
+	}
+	pthread_mutex_unlock(&getinfo_cache_lock);
+	return hit;
+}
+
+/* Takes ownership of the key */
+static void fi_getinfo_cache_put(struct fi_getinfo_key *key, uint64_t digest,
+				 const struct fi_info *info, int ret)
+{
+	struct fi_getinfo_entry *entry;
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		goto err;
+
+	entry->info = fi_dupinfo_list(info);
+	if (info && !entry->info) {
+		free(entry);
+		goto err;
+	}
+	entry->digest = digest;
+	entry->key = *key;
+	entry->ret = ret;
+
+	pthread_mutex_lock(&getinfo_cache_lock);
+	if (getinfo_cache_cnt == FI_GETINFO_CACHE_SIZE)
+		fi_getinfo_cache_free(container_of(getinfo_cache_list.prev,
+					struct fi_getinfo_entry, entry));
+	dlist_insert_head(&entry->entry, &getinfo_cache_list);
+	getinfo_cache_cnt++;
+	pthread_mutex_unlock(&getinfo_cache_lock);
+	return;
+err:
+	free(key->data);
+}
+
+static void fi_getinfo_cache_fini(void)
+{
+	while (!dlist_empty(&getinfo_cache_list))
+		fi_getinfo_cache_free(container_of(getinfo_cache_list.next,
+					struct fi_getinfo_entry, entry));
+}
+
+__attribute__((visibility ("default")))
+int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node, const char *service,
+	       uint64_t flags, struct fi_info *hints, struct fi_info **info)
+{
+	struct fi_getinfo_key key;
+	uint64_t digest = 0;
+	int ret, cached;
+
+	if (!ofi_init)
+		fi_ini();
+
+	if (FI_VERSION_LT(fi_version(), version)) {
+		FI_WARN(&core_prov, FI_LOG_CORE,
+			"Requested version is newer than library\n");
+		return -FI_ENOSYS;
+	}
+
+	if (flags == FI_PROV_ATTR_ONLY) {
+		return fi_getprovinfo(info);
+	}
+
+	cached = getinfo_cache &&
+		 !fi_getinfo_key_init(&key, version, node, service, flags, hints);
+	if (cached) {
+		digest = fasthash64(key.data, key.len, 0);
+		if (fi_getinfo_cache_get(&key, digest, info, &ret)) {
+			free(key.data);
+			return ret;
+		}
+	}
+
+	ret = fi_getinfo_providers(version, node, service, flags, hints, info);
+
+	/* Other errors may be transient */
+	if (cached && (!ret || ret == -FI_ENODATA))
+		fi_getinfo_cache_put(&key, digest, *info, ret);
+	else if (cached)
+		free(key.data);
+
+	return ret;
+}
 DEFAULT_SYMVER(fi_getinfo_, fi_getinfo);
 
 static struct fi_info *fi_allocinfo_internal(void)
@@ -702,7 +1236,7 @@ int DEFAULT_SYMVER_PRE(fi_fabric)(struct fi_fabric_attr *attr, struct fid_fabric
 	if (!ofi_init)
 		fi_ini();
 
-	prov = fi_getprov(attr->prov_name);
+	prov = fi_findprov(attr->prov_name);
 	if (!prov || !prov->provider->fabric)
 		return -FI_ENODEV;
 
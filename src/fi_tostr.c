@@ -101,6 +101,7 @@ static void fi_tostr_flags(char *buf, uint64_t flags)
 	IFFLAGSTR(flags, FI_RMA);
 	IFFLAGSTR(flags, FI_TAGGED);
 	IFFLAGSTR(flags, FI_ATOMIC);
+	IFFLAGSTR(flags, FI_MULTICAST);
 
 	IFFLAGSTR(flags, FI_READ);
 	IFFLAGSTR(flags, FI_WRITE);
@@ -230,6 +231,7 @@ static void fi_tostr_protocol(char *buf, uint32_t protocol)
 	CASEENUMSTR(FI_PROTO_RXM);
 	CASEENUMSTR(FI_PROTO_RXD);
 	CASEENUMSTR(FI_PROTO_MLX);
+	CASEENUMSTR(FI_PROTO_SHM);
 	default:
 		if (protocol & FI_PROV_SPECIFIC)
 			strcatf(buf, "Provider specific");
@@ -581,6 +583,7 @@ static void fi_tostr_eq_event(char *buf, int type)
 	CASEENUMSTR(FI_SHUTDOWN);
 	CASEENUMSTR(FI_MR_COMPLETE);
 	CASEENUMSTR(FI_AV_COMPLETE);
+	CASEENUMSTR(FI_JOIN_COMPLETE);
 	default:
 		strcatf(buf, "Unknown");
 		break;
@@ -36,6 +36,7 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <fi_indexer.h>
 
@@ -44,33 +45,85 @@
  *
  * We store pointers using a double lookup and return an index to the
  * user which is then used to retrieve the pointer.  The upper bits of
- * the index are itself an index into an array of memory allocations.
+ * the index are itself an index into a directory of memory allocations.
  * The lower bits specify the offset into the allocated memory where
  * the pointer is stored.
  *
- * This allows us to adjust the number of pointers stored by the index
- * list without taking a lock during data lookups.
+ * The directory starts small and doubles as leaves are added.  A grown
+ * directory is a new allocation; the old one is kept until reset, so
+ * lookups that raced with the growth still read valid memory.
  */
 
+#define OFI_IDX_DIR_INIT_SIZE 64
+
+/* Size of the directory after growing it to hold min_size slots */
+static int ofi_idx_dir_next_size(struct ofi_idx_dir *dir, int min_size)
+{
+	int size;
+
+	if (min_size > OFI_IDX_ARRAY_SIZE) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	size = dir ? dir->size * 2 : OFI_IDX_DIR_INIT_SIZE;
+	while (size < min_size)
+		size *= 2;
+	return size < OFI_IDX_ARRAY_SIZE ? size : OFI_IDX_ARRAY_SIZE;
+}
+
+static int ofi_idx_dir_grow(struct ofi_idx_dir **dir, int size)
+{
+	struct ofi_idx_dir *new_dir;
+
+	new_dir = calloc(1, sizeof(*new_dir) + size * sizeof(void *));
+	if (!new_dir) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	new_dir->size = size;
+	if (*dir)
+		memcpy(new_dir->slot, (*dir)->slot, (*dir)->size * sizeof(void *));
+	new_dir->prev = *dir;
+	*dir = new_dir;
+	return 0;
+}
+
+static void ofi_idx_dir_free(struct ofi_idx_dir **dir)
+{
+	struct ofi_idx_dir *prev;
+
+	while (*dir) {
+		prev = (*dir)->prev;
+		free(*dir);
+		*dir = prev;
+	}
+}
+
 static int ofi_idx_grow(struct indexer *idx)
 {
 	union ofi_idx_entry *entry;
-	int i, start_index;
+	int i, start_index, size;
 
-	if (idx->size >= OFI_IDX_ARRAY_SIZE)
-		goto nomem;
+	if (!idx->dir || idx->size == idx->dir->size) {
+		size = ofi_idx_dir_next_size(idx->dir, idx->size + 1);
+		if (size < 0 || ofi_idx_dir_grow(&idx->dir, size))
+			return -1;
+	}
 
-	idx->array[idx->size] = calloc(OFI_IDX_ENTRY_SIZE, sizeof(union ofi_idx_entry));
-	if (!idx->array[idx->size])
+	entry = calloc(OFI_IDX_ENTRY_SIZE, sizeof(union ofi_idx_entry));
+	if (!entry)
 		goto nomem;
 
-	entry = idx->array[idx->size];
 	start_index = idx->size << OFI_IDX_ENTRY_BITS;
 	entry[OFI_IDX_ENTRY_SIZE - 1].next = idx->free_list;
 
 	for (i = OFI_IDX_ENTRY_SIZE - 2; i >= 0; i--)
 		entry[i].next = start_index + i + 1;
 
+	idx->dir->slot[idx->size] = entry;
+
 	/* Index 0 is reserved */
 	if (start_index == 0)
 		start_index++;
@@ -93,9 +146,9 @@ int ofi_idx_insert(struct indexer *idx, void *item)
 			return index;
 	}
 
-	entry = idx->array[ofi_idx_array_index(index)];
-	idx->free_list = entry[ofi_idx_entry_index(index)].next;
-	entry[ofi_idx_entry_index(index)].item = item;
+	entry = ofi_idx_entry(idx, index);
+	idx->free_list = entry->next;
+	entry->item = item;
 	return index;
 }
 
@@ -104,35 +157,54 @@ void *ofi_idx_remove(struct indexer *idx, int index)
 	union ofi_idx_entry *entry;
 	void *item;
 
-	entry = idx->array[ofi_idx_array_index(index)];
-	item = entry[ofi_idx_entry_index(index)].item;
-	entry[ofi_idx_entry_index(index)].next = idx->free_list;
+	entry = ofi_idx_entry(idx, index);
+	item = entry->item;
+	entry->next = idx->free_list;
 	idx->free_list = index;
 	return item;
 }
 
 void ofi_idx_replace(struct indexer *idx, int index, void *item)
 {
-	union ofi_idx_entry *entry;
-
-	entry = idx->array[ofi_idx_array_index(index)];
-	entry[ofi_idx_entry_index(index)].item = item;
+	ofi_idx_entry(idx, index)->item = item;
 }
 
 void ofi_idx_reset(struct indexer *idx)
 {
 	while (idx->size) {
-		free(idx->array[idx->size - 1]);
-		idx->array[idx->size - 1] = NULL;
+		free(idx->dir->slot[idx->size - 1]);
 		idx->size--;
 	}
+	ofi_idx_dir_free(&idx->dir);
 	idx->free_list = 0;
 }
 
 static int ofi_idm_grow(struct index_map *idm, int index)
 {
-	idm->array[ofi_idx_array_index(index)] = calloc(OFI_IDX_ENTRY_SIZE, sizeof(void *));
-	if (!idm->array[ofi_idx_array_index(index)])
+	int *count;
+	int old_size, size;
+
+	if (!idm->dir || ofi_idx_array_index(index) >= idm->dir->size) {
+		old_size = idm->dir ? idm->dir->size : 0;
+		size = ofi_idx_dir_next_size(idm->dir,
+					     ofi_idx_array_index(index) + 1);
+		if (size < 0)
+			return -1;
+
+		/* Grow the counts first, so they always cover the directory */
+		count = realloc(idm->count, size * sizeof(*count));
+		if (!count)
+			goto nomem;
+		memset(count + old_size, 0, (size - old_size) * sizeof(*count));
+		idm->count = count;
+
+		if (ofi_idx_dir_grow(&idm->dir, size))
+			return -1;
+	}
+
+	idm->dir->slot[ofi_idx_array_index(index)] =
+		calloc(OFI_IDX_ENTRY_SIZE, sizeof(void *));
+	if (!idm->dir->slot[ofi_idx_array_index(index)])
 		goto nomem;
 
 	return index;
@@ -146,17 +218,18 @@ int ofi_idm_set(struct index_map *idm, int index, void *item)
 {
 	void **entry;
 
-	if (index > OFI_IDX_MAX_INDEX) {
+	if (index < 0) {
 		errno = ENOMEM;
 		return -1;
 	}
 
-	if (!idm->array[ofi_idx_array_index(index)]) {
+	if (!idm->dir || ofi_idx_array_index(index) >= idm->dir->size ||
+	    !idm->dir->slot[ofi_idx_array_index(index)]) {
 		if (ofi_idm_grow(idm, index) < 0)
 			return -1;
 	}
 
-	entry = idm->array[ofi_idx_array_index(index)];
+	entry = idm->dir->slot[ofi_idx_array_index(index)];
 	entry[ofi_idx_entry_index(index)] = item;
 	idm->count[ofi_idx_array_index(index)]++;
 	return index;
@@ -167,12 +240,12 @@ void *ofi_idm_clear(struct index_map *idm, int index)
 	void **entry;
 	void *item;
 
-	entry = idm->array[ofi_idx_array_index(index)];
+	entry = idm->dir->slot[ofi_idx_array_index(index)];
 	item = entry[ofi_idx_entry_index(index)];
 	entry[ofi_idx_entry_index(index)] = NULL;
 	if (--idm->count[ofi_idx_array_index(index)] == 0) {
-		free(idm->array[ofi_idx_array_index(index)]);
-		idm->array[ofi_idx_array_index(index)] = NULL;
+		free(idm->dir->slot[ofi_idx_array_index(index)]);
+		idm->dir->slot[ofi_idx_array_index(index)] = NULL;
 	}
 	return item;
 }
@@ -181,12 +254,12 @@ void ofi_idm_reset(struct index_map *idm)
 {
 	int i;
 
-	for (i=0; i<OFI_IDX_ARRAY_SIZE; i++) {
-		if (idm->array[i]) {
-			free(idm->array[i]);
-			idm->array[i] = NULL;
-			idm->count[i] = 0;
-		}
-	}
-}
+	if (!idm->dir)
+		return;
 
+	for (i = 0; i < idm->dir->size; i++)
+		free(idm->dir->slot[i]);
+	ofi_idx_dir_free(&idm->dir);
+	free(idm->count);
+	idm->count = NULL;
+}
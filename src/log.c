@@ -32,13 +32,17 @@
  *
  */
 
+#include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <signal.h>
 
 #include <rdma/fi_errno.h>
 
 #include "fi.h"
+#include "fi_atom.h"
 
 static const char * const log_subsys[] = {
 	[FI_LOG_CORE] = "core",
@@ -79,6 +83,56 @@ enum {
 uint64_t log_mask;
 struct fi_filter prov_log_filter;
 
+/*
+ * Asynchronous backend.  Each logging thread formats its messages into its
+ * own single producer ring and returns; a flusher thread drains all rings
+ * in timestamp order and writes them to the sink.  A full ring drops the
+ * message rather than wait for the flusher.
+ */
+#define LOG_MSG_SIZE		1024
+#define LOG_RING_SIZE		1024
+#define LOG_FLUSH_INTERVAL_MS	10
+
+struct log_record {
+	uint64_t time;
+	char msg[LOG_MSG_SIZE];
+};
+
+struct log_ring {
+	struct log_ring *next;
+	atomic_t head, tail;
+	atomic_t dropped;
+	atomic_t exited;
+	int size;
+	struct log_record rec[];
+};
+
+enum log_sink {
+	LOG_SINK_STDERR,
+	LOG_SINK_FILE,
+	LOG_SINK_MEM,
+};
+
+static int log_async;
+static enum log_sink log_sink;
+static FILE *log_file;
+static int log_ring_size = LOG_RING_SIZE;
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t log_thread;
+static pthread_key_t log_key;
+static int log_stop;
+static struct log_ring *log_rings;
+static __thread struct log_ring *log_ring;
+
+/* Sink LOG_SINK_MEM keeps the newest records until a dump is requested */
+static struct log_record *log_hist;
+static int log_hist_next, log_hist_cnt;
+static volatile sig_atomic_t log_dump;
+static struct sigaction log_old_action;
+static int log_sig_installed;
+
 static int fi_convert_log_str(const char *value)
 {
 	int i;
@@ -93,6 +147,291 @@ static int fi_convert_log_str(const char *value)
 	return 0;
 }
 
+static void log_dump_signal(int sig)
+{
+	log_dump = 1;
+}
+
+static void log_ring_exit(void *arg)
+{
+	struct log_ring *ring = arg;
+
+	/* Later destructors that log get a new ring */
+	log_ring = NULL;
+	atomic_set(&ring->exited, 1);
+}
+
+static struct log_ring *log_ring_get(void)
+{
+	struct log_ring *ring;
+
+	if (log_ring)
+		return log_ring;
+
+	ring = calloc(1, sizeof(*ring) + log_ring_size * sizeof(ring->rec[0]));
+	if (!ring)
+		return NULL;
+
+	ring->size = log_ring_size;
+	atomic_initialize(&ring->head, 0);
+	atomic_initialize(&ring->tail, 0);
+	atomic_initialize(&ring->dropped, 0);
+	atomic_initialize(&ring->exited, 0);
+
+	pthread_mutex_lock(&log_lock);
+	ring->next = log_rings;
+	log_rings = ring;
+	pthread_mutex_unlock(&log_lock);
+
+	pthread_setspecific(log_key, ring);
+	log_ring = ring;
+	return ring;
+}
+
+static void log_write(const char *msg)
+{
+	if (log_sink != LOG_SINK_MEM) {
+		fputs(msg, log_file);
+		return;
+	}
+
+	strcpy(log_hist[log_hist_next].msg, msg);
+	log_hist_next = (log_hist_next + 1) % log_ring_size;
+	if (log_hist_cnt < log_ring_size)
+		log_hist_cnt++;
+}
+
+static void log_write_hist(void)
+{
+	int i, start;
+
+	start = (log_hist_next - log_hist_cnt + log_ring_size) % log_ring_size;
+	for (i = 0; i < log_hist_cnt; i++)
+		fputs(log_hist[(start + i) % log_ring_size].msg, stderr);
+	fflush(stderr);
+	log_hist_cnt = 0;
+}
+
+/*
+ * Write out what the rings held when the pass started, oldest record
+ * first.  Called with log_lock held, which keeps the ring list stable.
+ */
+static void log_flush(void)
+{
+	struct log_ring *ring, *min, **prev;
+	struct log_record *rec;
+	char msg[64];
+	int dropped;
+
+	for (;;) {
+		min = NULL;
+		for (ring = log_rings; ring; ring = ring->next) {
+			if (atomic_get(&ring->tail) == atomic_get(&ring->head))
+				continue;
+			if (!min || ring->rec[atomic_get(&ring->tail)].time <
+				    min->rec[atomic_get(&min->tail)].time)
+				min = ring;
+		}
+		if (!min)
+			break;
+
+		rec = &min->rec[atomic_get(&min->tail)];
+		log_write(rec->msg);
+		atomic_set(&min->tail, (atomic_get(&min->tail) + 1) % min->size);
+	}
+
+	for (prev = &log_rings; (ring = *prev); ) {
+		dropped = atomic_get(&ring->dropped);
+		if (dropped) {
+			atomic_sub(&ring->dropped, dropped);
+			snprintf(msg, sizeof(msg), "%s:core:log:%d messages "
+				 "dropped\n", PACKAGE, dropped);
+			log_write(msg);
+		}
+
+		if (atomic_get(&ring->exited) &&
+		    atomic_get(&ring->tail) == atomic_get(&ring->head)) {
+			*prev = ring->next;
+			free(ring);
+		} else {
+			prev = &ring->next;
+		}
+	}
+
+	if (log_sink != LOG_SINK_MEM)
+		fflush(log_file);
+	else if (log_dump) {
+		log_dump = 0;
+		log_write_hist();
+	}
+}
+
+static void *log_flush_thread(void *arg)
+{
+	struct timespec ts;
+	uint64_t next;
+
+	pthread_mutex_lock(&log_lock);
+	while (!log_stop) {
+		log_flush();
+
+		next = fi_gettime_ms() + LOG_FLUSH_INTERVAL_MS;
+		ts.tv_sec = next / 1000;
+		ts.tv_nsec = (next % 1000) * 1000000;
+		pthread_cond_timedwait(&log_cond, &log_lock, &ts);
+	}
+	log_flush();
+	pthread_mutex_unlock(&log_lock);
+	return NULL;
+}
+
+/*
+ * SIGUSR2 belongs to the application if it has set a disposition for it.
+ * Only take it over while it is still SIG_DFL, which would terminate the
+ * process.
+ */
+static int log_sig_init(void)
+{
+	struct sigaction act;
+
+	if (sigaction(SIGUSR2, NULL, &log_old_action))
+		return errno;
+
+	if (log_old_action.sa_handler != SIG_DFL ||
+	    (log_old_action.sa_flags & SA_SIGINFO)) {
+		fprintf(stderr, "%s:core:log:SIGUSR2 is in use by the "
+			"application, log_sink mem is not available\n",
+			PACKAGE);
+		return FI_EBUSY;
+	}
+
+	memset(&act, 0, sizeof(act));
+	act.sa_handler = log_dump_signal;
+	act.sa_flags = SA_RESTART;
+	sigemptyset(&act.sa_mask);
+	if (sigaction(SIGUSR2, &act, NULL))
+		return errno;
+
+	log_sig_installed = 1;
+	return 0;
+}
+
+static void log_sig_fini(void)
+{
+	if (!log_sig_installed)
+		return;
+
+	sigaction(SIGUSR2, &log_old_action, NULL);
+	log_sig_installed = 0;
+}
+
+static int log_async_init(void)
+{
+	int ret;
+
+	if (log_sink == LOG_SINK_MEM) {
+		log_hist = calloc(log_ring_size, sizeof(*log_hist));
+		if (!log_hist)
+			return -FI_ENOMEM;
+		ret = log_sig_init();
+		if (ret)
+			goto err1;
+	}
+
+	ret = pthread_key_create(&log_key, log_ring_exit);
+	if (ret)
+		goto err1;
+
+	ret = pthread_create(&log_thread, NULL, log_flush_thread, NULL);
+	if (ret)
+		goto err2;
+
+	log_async = 1;
+	return 0;
+err2:
+	pthread_key_delete(log_key);
+err1:
+	log_sig_fini();
+	free(log_hist);
+	log_hist = NULL;
+	return -ret;
+}
+
+static void log_async_fini(void)
+{
+	struct log_ring *ring;
+
+	if (!log_async)
+		return;
+
+	log_async = 0;
+	pthread_mutex_lock(&log_lock);
+	log_stop = 1;
+	pthread_cond_signal(&log_cond);
+	pthread_mutex_unlock(&log_lock);
+	pthread_join(log_thread, NULL);
+
+	while ((ring = log_rings)) {
+		log_rings = ring->next;
+		free(ring);
+	}
+	pthread_key_delete(log_key);
+	log_sig_fini();
+	free(log_hist);
+	log_hist = NULL;
+}
+
+static void log_sink_init(void)
+{
+	char *sinkstr = NULL;
+	int async = 0;
+
+	fi_param_define(NULL, "log_sink", FI_PARAM_STRING,
+			"Where log messages are written: stderr, a file path, "
+			"or mem to keep the newest messages in memory and write "
+			"them to stderr on SIGUSR2; mem implies log_async "
+			"(default: stderr)");
+	fi_param_define(NULL, "log_async", FI_PARAM_BOOL,
+			"Write log messages from a background thread, so "
+			"logging threads do not block on the sink (default: no)");
+	fi_param_define(NULL, "log_ring_size", FI_PARAM_INT,
+			"Number of messages buffered per thread by log_async "
+			"before new messages are dropped (default: 1024)");
+
+	fi_param_get_str(NULL, "log_sink", &sinkstr);
+	fi_param_get_bool(NULL, "log_async", &async);
+	fi_param_get_int(NULL, "log_ring_size", &log_ring_size);
+	if (log_ring_size < 2)
+		log_ring_size = LOG_RING_SIZE;
+
+	log_file = stderr;
+	if (!sinkstr || !strcasecmp(sinkstr, "stderr")) {
+		log_sink = LOG_SINK_STDERR;
+	} else if (!strcasecmp(sinkstr, "mem")) {
+		log_sink = LOG_SINK_MEM;
+		async = 1;
+	} else {
+		log_file = fopen(sinkstr, "a");
+		if (log_file) {
+			log_sink = LOG_SINK_FILE;
+		} else {
+			log_file = stderr;
+			fprintf(stderr, "%s:core:log:cannot open log_sink %s, "
+				"using stderr\n", PACKAGE, sinkstr);
+		}
+	}
+
+	if (async && log_async_init()) {
+		fprintf(stderr, "%s:core:log:cannot start log_async, logging "
+			"synchronously\n", PACKAGE);
+		if (log_sink == LOG_SINK_MEM)
+			log_sink = LOG_SINK_STDERR;
+	}
+
+	if (log_sink == LOG_SINK_FILE && !log_async)
+		setvbuf(log_file, NULL, _IOLBF, 0);
+}
+
 void fi_log_init(void)
 {
 	struct fi_filter subsys_filter;
@@ -120,13 +459,62 @@ void fi_log_init(void)
 			log_mask |= (1 << (i + FI_LOG_SUBSYS_OFFSET));
 	}
 	fi_free_filter(&subsys_filter);
+
+	log_sink_init();
 }
 
 void fi_log_fini(void)
 {
+	log_async_fini();
+	if (log_sink == LOG_SINK_FILE) {
+		log_sink = LOG_SINK_STDERR;
+		fclose(log_file);
+		log_file = stderr;
+	}
 	fi_free_filter(&prov_log_filter);
 }
 
+static void log_format(char *buf, size_t len, const struct fi_provider *prov,
+		       enum fi_log_level level, enum fi_log_subsys subsys,
+		       const char *func, int line, const char *fmt,
+		       va_list vargs)
+{
+	int size;
+
+	size = snprintf(buf, len, "%s:%s:%s:%s():%d<%s> ", PACKAGE,
+			prov->name, log_subsys[subsys], func, line,
+			log_levels[level]);
+	if (size < (int) len)
+		vsnprintf(buf + size, len - size, fmt, vargs);
+}
+
+static void log_async_post(const struct fi_provider *prov,
+			   enum fi_log_level level, enum fi_log_subsys subsys,
+			   const char *func, int line, const char *fmt,
+			   va_list vargs)
+{
+	struct log_ring *ring;
+	struct log_record *rec;
+	int head, next;
+
+	ring = log_ring_get();
+	if (!ring)
+		return;
+
+	head = atomic_get(&ring->head);
+	next = (head + 1) % ring->size;
+	if (next == atomic_get(&ring->tail)) {
+		atomic_inc(&ring->dropped);
+		return;
+	}
+
+	rec = &ring->rec[head];
+	rec->time = fi_gettime_us();
+	log_format(rec->msg, sizeof(rec->msg), prov, level, subsys, func, line,
+		   fmt, vargs);
+	atomic_set(&ring->head, next);
+}
+
 __attribute__((visibility ("default")))
 int DEFAULT_SYMVER_PRE(fi_log_enabled)(const struct fi_provider *prov, enum fi_log_level level,
 		   enum fi_log_subsys subsys)
@@ -144,19 +532,17 @@ void DEFAULT_SYMVER_PRE(fi_log)(const struct fi_provider *prov, enum fi_log_leve
 	    enum fi_log_subsys subsys, const char *func, int line,
 	    const char *fmt, ...)
 {
-	char buf[1024];
-	int size;
-
+	char buf[LOG_MSG_SIZE];
 	va_list vargs;
 
-	size = snprintf(buf, sizeof(buf), "%s:%s:%s:%s():%d<%s> ", PACKAGE,
-			prov->name, log_subsys[subsys], func, line,
-			log_levels[level]);
-
 	va_start(vargs, fmt);
-	vsnprintf(buf + size, sizeof(buf) - size, fmt, vargs);
+	if (log_async) {
+		log_async_post(prov, level, subsys, func, line, fmt, vargs);
+	} else {
+		log_format(buf, sizeof(buf), prov, level, subsys, func, line,
+			   fmt, vargs);
+		fputs(buf, log_file ? log_file : stderr);
+	}
 	va_end(vargs);
-
-	fprintf(stderr, "%s", buf);
 }
 DEFAULT_SYMVER(fi_log_, fi_log);
@@ -33,6 +33,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <time.h>
+#include <inttypes.h>
 
 #include <rdma/fabric.h>
 #include <rdma/fi_errno.h>
@@ -42,6 +44,7 @@ static char *node, *port;
 static int ver = 0;
 static int list_providers = 0;
 static int verbose = 0, env = 0;
+static int time_iters = -1;
 
 /* options and matching help strings need to be kept in sync */
 
@@ -58,6 +61,7 @@ static const struct option longopts[] = {
 	{"provider", required_argument, NULL, 'p'},
 	{"env", no_argument, NULL, 'e'},
 	{"list", no_argument, NULL, 'l'},
+	{"time", required_argument, NULL, 'T'},
 	{"verbose", no_argument, NULL, 'v'},
 	{"version", no_argument, &ver, 1},
 	{0,0,0,0}
@@ -76,6 +80,7 @@ static const char *help_strings[][2] = {
 	{"PROV", "\t\tspecify provider explicitly"},
 	{"", "\t\tprint libfabric environment variables"},
 	{"", "\t\tlist available libfabric providers"},
+	{"ITER", "\t\ttime the first and ITER more fi_getinfo calls"},
 	{"", "\t\tverbose output"},
 	{"", "\t\tprint version info and exit"},
 	{"", ""}
@@ -278,6 +283,43 @@ static int print_long_info(struct fi_info *info)
 	return EXIT_SUCCESS;
 }
 
+static uint64_t gettime_us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+/* The first call includes library and provider initialization */
+static int time_getinfo(struct fi_info *hints, char *node, char *port)
+{
+	struct fi_info *info;
+	uint64_t start, first = 0, total = 0;
+	int i, ret;
+
+	for (i = 0; i <= time_iters; i++) {
+		start = gettime_us();
+		ret = fi_getinfo(FI_VERSION(FI_MAJOR_VERSION, FI_MINOR_VERSION),
+				node, port, 0, hints, &info);
+		if (i)
+			total += gettime_us() - start;
+		else
+			first = gettime_us() - start;
+		if (ret) {
+			fprintf(stderr, "fi_getinfo: %d\n", ret);
+			return ret;
+		}
+		fi_freeinfo(info);
+	}
+
+	printf("first call: %" PRIu64 " usec\n", first);
+	if (time_iters)
+		printf("next %d calls: %.2f usec/call\n", time_iters,
+		       (double) total / time_iters);
+	return EXIT_SUCCESS;
+}
+
 static int run(struct fi_info *hints, char *node, char *port)
 {
 	struct fi_info *info;
@@ -314,7 +356,7 @@ int main(int argc, char **argv)
 
 	hints->mode = ~0;
 
-	while ((op = getopt_long(argc, argv, "n:P:c:m:t:a:p:d:f:elhv", longopts,
+	while ((op = getopt_long(argc, argv, "n:P:c:m:t:a:p:d:f:elT:hv", longopts,
 				 &option_index)) != -1) {
 		switch (op) {
 		case 0:
@@ -375,6 +417,14 @@ int main(int argc, char **argv)
 		case 'l':
 			list_providers = 1;
 			break;
+		case 'T':
+			time_iters = atoi(optarg);
+			if (time_iters < 0) {
+				fprintf(stderr, "invalid iteration count\n");
+				ret = -FI_EINVAL;
+				goto out;
+			}
+			break;
 		case 'v':
 			verbose = 1;
 			break;
@@ -398,7 +448,10 @@ int main(int argc, char **argv)
 		goto out;
 	}
 
-	ret = run(use_hints ? hints : NULL, node, port);
+	if (time_iters >= 0)
+		ret = time_getinfo(use_hints ? hints : NULL, node, port);
+	else
+		ret = run(use_hints ? hints : NULL, node, port);
 out:
 	fi_freeinfo(hints);
 	return -ret;
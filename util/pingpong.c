@@ -40,6 +40,7 @@
 #include <inttypes.h>
 #include <netdb.h>
 #include <poll.h>
+#include <pthread.h>
 #include <limits.h>
 
 #include <stdbool.h>
@@ -58,6 +59,9 @@
 #include <rdma/fi_endpoint.h>
 #include <rdma/fi_eq.h>
 #include <rdma/fi_errno.h>
+#include <rdma/fi_rma.h>
+#include <rdma/fi_tagged.h>
+#include <rdma/fi_atomic.h>
 
 #ifndef PP_FIVERSION
 #define PP_FIVERSION FI_VERSION(1, 4)
@@ -82,6 +86,67 @@ enum {
 	PP_OPT_VERIFY_DATA = 1 << 3,
 };
 
+enum pp_test {
+	PP_TEST_PINGPONG,
+	PP_TEST_BW,
+	PP_TEST_BIBW,
+	PP_TEST_RATE,
+	PP_TEST_MAX
+};
+
+static const char *pp_test_names[PP_TEST_MAX] = {
+	[PP_TEST_PINGPONG] = "pingpong",
+	[PP_TEST_BW] = "bw",
+	[PP_TEST_BIBW] = "bibw",
+	[PP_TEST_RATE] = "rate",
+};
+
+enum pp_op {
+	PP_OP_MSG,
+	PP_OP_TAGGED,
+	PP_OP_WRITE,
+	PP_OP_READ,
+	PP_OP_ATOMIC,
+	PP_OP_FETCH_ATOMIC,
+	PP_OP_MAX
+};
+
+static const char *pp_op_names[PP_OP_MAX] = {
+	[PP_OP_MSG] = "msg",
+	[PP_OP_TAGGED] = "tagged",
+	[PP_OP_WRITE] = "write",
+	[PP_OP_READ] = "read",
+	[PP_OP_ATOMIC] = "atomic",
+	[PP_OP_FETCH_ATOMIC] = "fetch",
+};
+
+static const char *pp_datatype_names[FI_DATATYPE_LAST] = {
+	[FI_INT8] = "int8",
+	[FI_UINT8] = "uint8",
+	[FI_INT16] = "int16",
+	[FI_UINT16] = "uint16",
+	[FI_INT32] = "int32",
+	[FI_UINT32] = "uint32",
+	[FI_INT64] = "int64",
+	[FI_UINT64] = "uint64",
+	[FI_FLOAT] = "float",
+	[FI_DOUBLE] = "double",
+	[FI_FLOAT_COMPLEX] = "float_complex",
+	[FI_DOUBLE_COMPLEX] = "double_complex",
+	[FI_LONG_DOUBLE] = "long_double",
+	[FI_LONG_DOUBLE_COMPLEX] = "long_double_complex",
+};
+
+static inline int pp_op_is_msg(enum pp_op op)
+{
+	return op == PP_OP_MSG || op == PP_OP_TAGGED;
+}
+
+static inline int pp_op_is_atomic(enum pp_op op)
+{
+	return op == PP_OP_ATOMIC || op == PP_OP_FETCH_ATOMIC;
+}
+
 struct pp_opts {
 	uint16_t src_port;
 	uint16_t dst_port;
@@ -90,6 +155,14 @@ struct pp_opts {
 	int transfer_size;
 	int sizes_enabled;
 	int options;
+	enum pp_test test;
+	int window;
+	int pairs;
+	enum pp_op op;
+	int datatype;
+	int nomatch_cnt;
+	int warmup;
+	int latency;
 };
 
 #define PP_SIZE_MAX_POWER_TWO 22
@@ -100,6 +173,22 @@ struct pp_opts {
 #define PP_MAX_CTRL_MSG 64
 #define PP_CTRL_BUF_LEN 64
 #define PP_MR_KEY 0xC0DE
+#define PP_CTRL_PORT 47592
+#define PP_DEFAULT_WINDOW 64
+#define PP_MAX_PAIRS 64
+#define PP_DATATYPE_ALL (-1)
+#define PP_TAG 0x50ULL
+#define PP_TAG_NOMATCH 0x51ULL
+
+/*
+ * Log-linear latency histogram, in nanoseconds.  Values below
+ * PP_HIST_SUB_CNT are counted exactly; above that every power of two is
+ * split into PP_HIST_SUB_CNT buckets, so a reported percentile is within
+ * 1/PP_HIST_SUB_CNT of the measured value.
+ */
+#define PP_HIST_SUB_BITS 5
+#define PP_HIST_SUB_CNT (1 << PP_HIST_SUB_BITS)
+#define PP_HIST_BUCKETS ((64 - PP_HIST_SUB_BITS + 1) * PP_HIST_SUB_CNT)
 
 #define INTEG_SEED 7
 #define PP_ENABLE_ALL (~0)
@@ -122,6 +211,21 @@ struct pp_opts {
 
 int pp_debug;
 
+enum pp_format {
+	PP_FORMAT_TEXT,
+	PP_FORMAT_CSV,
+	PP_FORMAT_JSON,
+	PP_FORMAT_MAX
+};
+
+static const char *pp_format_names[PP_FORMAT_MAX] = {
+	[PP_FORMAT_TEXT] = "text",
+	[PP_FORMAT_CSV] = "csv",
+	[PP_FORMAT_JSON] = "json",
+};
+
+enum pp_format pp_format;
+
 #define PP_DEBUG(fmt, ...)                                                     \
 	do {                                                                   \
 		if (pp_debug) {                                                \
@@ -160,6 +264,28 @@ int pp_debug;
 	})
 #endif
 
+/* Barrier for the threads of a multi-pair run; a failed pair aborts it */
+struct pp_barrier {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int count, waiting, generation, aborted;
+};
+
+struct pp_hist {
+	uint64_t count, max;
+	uint64_t buckets[PP_HIST_BUCKETS];
+};
+
+/* Per test size measurement, collected instead of printed by pair threads */
+struct pp_result {
+	const char *name;
+	int tsize;
+	int sent, acked;
+	uint64_t start, end;
+	int xfers_per_iter;
+	struct pp_hist *hist;
+};
+
 struct ct_pingpong {
 	struct fi_info *fi_pep, *fi, *hints;
 	struct fid_fabric *fabric;
@@ -173,6 +299,11 @@ struct ct_pingpong {
 
 	struct fid_mr no_mr;
 	struct fi_context tx_ctx, rx_ctx;
+	struct fi_context *tx_ctx_arr, *rx_ctx_arr;
+	struct fi_context *nomatch_ctx;
+	int window;
+	struct fi_rma_iov remote;
+	const char *perf_name;
 	uint64_t remote_cq_data;
 
 	uint64_t tx_seq, rx_seq, tx_cq_cntr, rx_cq_cntr;
@@ -183,6 +314,8 @@ struct ct_pingpong {
 
 	int timeout_sec;
 	uint64_t start, end;
+	struct pp_hist *hist;
+	int warmup;
 
 	struct fi_av_attr av_attr;
 	struct fi_eq_attr eq_attr;
@@ -194,6 +327,12 @@ struct ct_pingpong {
 	int ctrl_connfd;
 	char ctrl_buf[PP_CTRL_BUF_LEN + 1];
 	char rem_name[PP_MAX_CTRL_MSG];
+
+	unsigned int fill_iter, check_iter;
+
+	struct pp_barrier *barrier;
+	struct pp_result *results;
+	int result_cnt, result_max;
 };
 
 static const char integ_alphabet[] =
@@ -214,6 +353,76 @@ uint64_t pp_gettime_us(void)
 	return now.tv_sec * 1000000 + now.tv_usec;
 }
 
+uint64_t pp_gettime_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static inline int pp_hist_index(uint64_t val)
+{
+	int shift;
+
+	if (val < PP_HIST_SUB_CNT)
+		return (int) val;
+
+	shift = 63 - __builtin_clzll(val) - PP_HIST_SUB_BITS;
+	return shift * PP_HIST_SUB_CNT + (int) (val >> shift);
+}
+
+/* Highest value counted in a bucket */
+static uint64_t pp_hist_value(int index)
+{
+	uint64_t mant;
+	int shift;
+
+	if (index < PP_HIST_SUB_CNT)
+		return index;
+
+	shift = index / PP_HIST_SUB_CNT - 1;
+	mant = index - shift * PP_HIST_SUB_CNT;
+	return ((mant + 1) << shift) - 1;
+}
+
+static inline void pp_hist_record(struct pp_hist *hist, uint64_t val)
+{
+	hist->buckets[pp_hist_index(val)]++;
+	hist->count++;
+	if (val > hist->max)
+		hist->max = val;
+}
+
+void pp_hist_merge(struct pp_hist *dst, const struct pp_hist *src)
+{
+	int i;
+
+	for (i = 0; i < PP_HIST_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+	dst->count += src->count;
+	dst->max = MAX(dst->max, src->max);
+}
+
+uint64_t pp_hist_percentile(const struct pp_hist *hist, double pct)
+{
+	uint64_t target, total = 0;
+	double rank;
+	int i;
+
+	rank = hist->count * pct / 100.0;
+	target = (uint64_t) rank;
+	if (target < rank || !target)
+		target++;
+
+	for (i = 0; i < PP_HIST_BUCKETS; i++) {
+		total += hist->buckets[i];
+		if (total >= target)
+			return MIN(pp_hist_value(i), hist->max);
+	}
+	return hist->max;
+}
+
 long parse_ulong(char *str, long max)
 {
 	long ret;
@@ -482,7 +691,7 @@ fail_close_socket:
 
 int pp_ctrl_init(struct ct_pingpong *ct)
 {
-	const uint32_t default_ctrl = 47592;
+	const uint32_t default_ctrl = PP_CTRL_PORT;
 	struct timeval tv = {
 		.tv_sec = 5
 	};
@@ -794,6 +1003,8 @@ static inline void pp_start(struct ct_pingpong *ct)
 {
 	PP_DEBUG("Starting test chrono\n");
 	ct->opts.options |= PP_OPT_ACTIVE;
+	if (ct->hist)
+		memset(ct->hist, 0, sizeof(*ct->hist));
 	ct->start = pp_gettime_us();
 }
 
@@ -813,14 +1024,13 @@ static inline int pp_check_opts(struct ct_pingpong *ct, uint64_t flags)
  *                                         Data Verification
  ******************************************************************************/
 
-void pp_fill_buf(void *buf, int size)
+void pp_fill_buf(struct ct_pingpong *ct, void *buf, int size)
 {
 	char *msg_buf;
 	int msg_index;
-	static unsigned int iter;
 	int i;
 
-	msg_index = ((iter++) * INTEG_SEED) % integ_alphabet_length;
+	msg_index = ((ct->fill_iter++) * INTEG_SEED) % integ_alphabet_length;
 	msg_buf = (char *)buf;
 	for (i = 0; i < size; i++) {
 		PP_DEBUG("index=%d msg_index=%d\n", i, msg_index);
@@ -830,17 +1040,16 @@ void pp_fill_buf(void *buf, int size)
 	}
 }
 
-int pp_check_buf(void *buf, int size)
+int pp_check_buf(struct ct_pingpong *ct, void *buf, int size)
 {
 	char *recv_data;
 	char c;
-	static unsigned int iter;
 	int msg_index;
 	int i;
 
 	PP_DEBUG("Verifying buffer content\n");
 
-	msg_index = ((iter++) * INTEG_SEED) % integ_alphabet_length;
+	msg_index = ((ct->check_iter++) * INTEG_SEED) % integ_alphabet_length;
 	recv_data = (char *)buf;
 
 	for (i = 0; i < size; i++) {
@@ -855,8 +1064,8 @@ int pp_check_buf(void *buf, int size)
 	}
 	if (i != size) {
 		PP_DEBUG("Finished veryfing buffer: content is corrupted\n");
-		printf("Error at iteration=%d size=%d byte=%d\n", iter, size,
-		       i);
+		printf("Error at iteration=%d size=%d byte=%d\n",
+		       ct->check_iter, size, i);
 		return 1;
 	}
 
@@ -1005,19 +1214,29 @@ char *cnt_str(char *str, size_t size, uint64_t cnt)
 	return str;
 }
 
-void show_perf(char *name, int tsize, int sent, int acked,
-	       uint64_t start, uint64_t end, int xfers_per_iter)
+/* Latency percentiles reported from the histogram, followed by the max */
+static const double pp_percentiles[] = { 50, 90, 99, 99.9 };
+static const char *pp_lat_names[] = { "p50", "p90", "p99", "p99.9", "max" };
+#define PP_LAT_CNT (sizeof(pp_lat_names) / sizeof(*pp_lat_names))
+
+struct pp_perf {
+	char *name;
+	int tsize;
+	int sent, acked;
+	uint64_t bytes;
+	int64_t elapsed;
+	float usec_per_xfer;
+	double lat[PP_LAT_CNT];
+	int lat_cnt;
+};
+
+static void show_perf_text(const struct pp_perf *perf)
 {
 	static int header = 1;
 	char str[PP_STR_LEN];
-	int64_t elapsed = end - start;
-	uint64_t bytes = (uint64_t)sent * tsize * xfers_per_iter;
-	float usec_per_xfer;
-
-	if (sent == 0)
-		return;
+	int i;
 
-	if (name) {
+	if (perf->name) {
 		if (header) {
 			printf("%-50s%-8s%-8s%-9s%-8s%8s %10s%13s%13s\n",
 			       "name", "bytes", "#sent", "#ack", "total",
@@ -1025,7 +1244,7 @@ void show_perf(char *name, int tsize, int sent, int acked,
 			header = 0;
 		}
 
-		printf("%-50s", name);
+		printf("%-50s", perf->name);
 	} else {
 		if (header) {
 			printf("%-8s%-8s%-9s%-8s%8s %10s%13s%13s\n", "bytes",
@@ -1035,21 +1254,175 @@ void show_perf(char *name, int tsize, int sent, int acked,
 		}
 	}
 
-	printf("%-8s", size_str(str, tsize));
-	printf("%-8s", cnt_str(str, sizeof(str), sent));
+	printf("%-8s", size_str(str, perf->tsize));
+	printf("%-8s", cnt_str(str, sizeof(str), perf->sent));
 
-	if (sent == acked)
-		printf("=%-8s", cnt_str(str, sizeof(str), acked));
-	else if (sent < acked)
-		printf("-%-8s", cnt_str(str, sizeof(str), acked - sent));
+	if (perf->sent == perf->acked)
+		printf("=%-8s", cnt_str(str, sizeof(str), perf->acked));
+	else if (perf->sent < perf->acked)
+		printf("-%-8s", cnt_str(str, sizeof(str),
+					perf->acked - perf->sent));
 	else
-		printf("+%-8s", cnt_str(str, sizeof(str), sent - acked));
+		printf("+%-8s", cnt_str(str, sizeof(str),
+					perf->sent - perf->acked));
+
+	printf("%-8s", size_str(str, perf->bytes));
+
+	printf("%8.2fs%10.2f%11.2f%11.2f\n", perf->elapsed / 1000000.0,
+	       perf->bytes / (1.0 * perf->elapsed), perf->usec_per_xfer,
+	       1.0 / perf->usec_per_xfer);
+
+	if (!perf->lat_cnt)
+		return;
+
+	printf("%-*s", perf->name ? 58 : 8, "");
+	printf("usec/xfer");
+	for (i = 0; i < perf->lat_cnt; i++)
+		printf(" %s %.2f", pp_lat_names[i], perf->lat[i]);
+	printf("\n");
+}
+
+static void show_perf_csv(const struct pp_perf *perf)
+{
+	static int header = 1;
+	int i;
+
+	if (header) {
+		printf("name,bytes,sent,acked,total_bytes,time_usec,mb_per_sec,"
+		       "usec_per_xfer,mxfers_per_sec");
+		for (i = 0; i < (int) PP_LAT_CNT; i++)
+			printf(",%s_usec", pp_lat_names[i]);
+		printf("\n");
+		header = 0;
+	}
+
+	printf("%s,%d,%d,%d,%" PRIu64 ",%" PRId64 ",%.2f,%.3f,%.3f",
+	       perf->name ? perf->name : "", perf->tsize, perf->sent,
+	       perf->acked, perf->bytes, perf->elapsed,
+	       perf->bytes / (1.0 * perf->elapsed), perf->usec_per_xfer,
+	       1.0 / perf->usec_per_xfer);
+	for (i = 0; i < (int) PP_LAT_CNT; i++) {
+		if (i < perf->lat_cnt)
+			printf(",%.3f", perf->lat[i]);
+		else
+			printf(",");
+	}
+	printf("\n");
+}
+
+/* One JSON object per line */
+static void show_perf_json(const struct pp_perf *perf)
+{
+	int i;
+
+	printf("{");
+	if (perf->name)
+		printf("\"name\":\"%s\",", perf->name);
+	printf("\"bytes\":%d,\"sent\":%d,\"acked\":%d,\"total_bytes\":%"
+	       PRIu64 ",\"time_usec\":%" PRId64 ",\"mb_per_sec\":%.2f,"
+	       "\"usec_per_xfer\":%.3f,\"mxfers_per_sec\":%.3f",
+	       perf->tsize, perf->sent, perf->acked, perf->bytes,
+	       perf->elapsed, perf->bytes / (1.0 * perf->elapsed),
+	       perf->usec_per_xfer, 1.0 / perf->usec_per_xfer);
+	if (perf->lat_cnt) {
+		printf(",\"latency_usec\":{");
+		for (i = 0; i < perf->lat_cnt; i++)
+			printf("%s\"%s\":%.3f", i ? "," : "",
+			       pp_lat_names[i], perf->lat[i]);
+		printf("}");
+	}
+	printf("}\n");
+}
+
+void show_perf(char *name, int tsize, int sent, int acked,
+	       uint64_t start, uint64_t end, int xfers_per_iter,
+	       const struct pp_hist *hist)
+{
+	struct pp_perf perf = {
+		.name = name,
+		.tsize = tsize,
+		.sent = sent,
+		.acked = acked,
+		.bytes = (uint64_t)sent * tsize * xfers_per_iter,
+		.elapsed = end - start,
+	};
+	int i;
+
+	if (sent == 0)
+		return;
+
+	perf.usec_per_xfer = ((float)perf.elapsed / sent / xfers_per_iter);
+
+	/* Histogram values are per iteration, in nanoseconds */
+	if (hist && hist->count) {
+		for (i = 0; i < (int) PP_LAT_CNT - 1; i++)
+			perf.lat[i] = pp_hist_percentile(hist,
+							 pp_percentiles[i]);
+		perf.lat[i] = hist->max;
+		perf.lat_cnt = PP_LAT_CNT;
+		for (i = 0; i < perf.lat_cnt; i++)
+			perf.lat[i] /= 1000.0 * xfers_per_iter;
+	}
+
+	switch (pp_format) {
+	case PP_FORMAT_CSV:
+		show_perf_csv(&perf);
+		break;
+	case PP_FORMAT_JSON:
+		show_perf_json(&perf);
+		break;
+	default:
+		show_perf_text(&perf);
+		break;
+	}
+}
+
+void pp_report_perf(struct ct_pingpong *ct, int sent, int xfers_per_iter)
+{
+	struct pp_result *res;
+
+	if (ct->warmup)
+		return;
 
-	printf("%-8s", size_str(str, bytes));
+	if (!ct->barrier) {
+		show_perf((char *) ct->perf_name, ct->opts.transfer_size, sent,
+			  ct->cnt_ack_msg, ct->start, ct->end, xfers_per_iter,
+			  ct->hist);
+		return;
+	}
+
+	if (ct->result_cnt == ct->result_max) {
+		res = realloc(ct->results, (ct->result_max + 64) *
+				      sizeof(*ct->results));
+		if (!res) {
+			PP_ERR("Out of memory storing the results of %d bytes",
+			       ct->opts.transfer_size);
+			return;
+		}
+		ct->results = res;
+		ct->result_max += 64;
+	}
+
+	res = &ct->results[ct->result_cnt];
+	memset(res, 0, sizeof(*res));
+	if (ct->hist && ct->hist->count) {
+		res->hist = malloc(sizeof(*res->hist));
+		if (!res->hist) {
+			PP_ERR("Out of memory storing the results of %d bytes",
+			       ct->opts.transfer_size);
+			return;
+		}
+		memcpy(res->hist, ct->hist, sizeof(*res->hist));
+	}
 
-	usec_per_xfer = ((float)elapsed / sent / xfers_per_iter);
-	printf("%8.2fs%10.2f%11.2f%11.2f\n", elapsed / 1000000.0,
-	       bytes / (1.0 * elapsed), usec_per_xfer, 1.0 / usec_per_xfer);
+	res->name = ct->perf_name;
+	res->tsize = ct->opts.transfer_size;
+	res->sent = sent;
+	res->acked = ct->cnt_ack_msg;
+	res->start = ct->start;
+	res->end = ct->end;
+	res->xfers_per_iter = xfers_per_iter;
+	ct->result_cnt++;
 }
 
 /*******************************************************************************
@@ -1171,8 +1544,14 @@ int pp_get_tx_comp(struct ct_pingpong *ct, uint64_t total)
 ssize_t pp_post_tx(struct ct_pingpong *ct, struct fid_ep *ep, size_t size,
 		   struct fi_context *ctx)
 {
-	PP_POST(fi_send, pp_get_tx_comp, ct->tx_seq, "transmit", ep, ct->tx_buf,
-		size, fi_mr_desc(ct->mr), ct->remote_fi_addr, ctx);
+	if (ct->opts.op == PP_OP_TAGGED)
+		PP_POST(fi_tsend, pp_get_tx_comp, ct->tx_seq, "t-transmit", ep,
+			ct->tx_buf, size, fi_mr_desc(ct->mr),
+			ct->remote_fi_addr, PP_TAG, ctx);
+	else
+		PP_POST(fi_send, pp_get_tx_comp, ct->tx_seq, "transmit", ep,
+			ct->tx_buf, size, fi_mr_desc(ct->mr),
+			ct->remote_fi_addr, ctx);
 	return 0;
 }
 
@@ -1181,7 +1560,7 @@ ssize_t pp_tx(struct ct_pingpong *ct, struct fid_ep *ep, size_t size)
 	ssize_t ret;
 
 	if (pp_check_opts(ct, PP_OPT_VERIFY_DATA | PP_OPT_ACTIVE))
-		pp_fill_buf((char *)ct->tx_buf, size);
+		pp_fill_buf(ct, (char *)ct->tx_buf, size);
 
 	ret = pp_post_tx(ct, ep, size, &(ct->tx_ctx));
 	if (ret)
@@ -1194,8 +1573,12 @@ ssize_t pp_tx(struct ct_pingpong *ct, struct fid_ep *ep, size_t size)
 
 ssize_t pp_post_inject(struct ct_pingpong *ct, struct fid_ep *ep, size_t size)
 {
-	PP_POST(fi_inject, pp_get_tx_comp, ct->tx_seq, "inject", ep, ct->tx_buf,
-		size, ct->remote_fi_addr);
+	if (ct->opts.op == PP_OP_TAGGED)
+		PP_POST(fi_tinject, pp_get_tx_comp, ct->tx_seq, "t-inject", ep,
+			ct->tx_buf, size, ct->remote_fi_addr, PP_TAG);
+	else
+		PP_POST(fi_inject, pp_get_tx_comp, ct->tx_seq, "inject", ep,
+			ct->tx_buf, size, ct->remote_fi_addr);
 	ct->tx_cq_cntr++;
 	return 0;
 }
@@ -1205,7 +1588,7 @@ ssize_t pp_inject(struct ct_pingpong *ct, struct fid_ep *ep, size_t size)
 	ssize_t ret;
 
 	if (pp_check_opts(ct, PP_OPT_VERIFY_DATA | PP_OPT_ACTIVE))
-		pp_fill_buf((char *)ct->tx_buf, size);
+		pp_fill_buf(ct, (char *)ct->tx_buf, size);
 
 	ret = pp_post_inject(ct, ep, size);
 	if (ret)
@@ -1217,8 +1600,14 @@ ssize_t pp_inject(struct ct_pingpong *ct, struct fid_ep *ep, size_t size)
 ssize_t pp_post_rx(struct ct_pingpong *ct, struct fid_ep *ep, size_t size,
 		   struct fi_context *ctx)
 {
-	PP_POST(fi_recv, pp_get_rx_comp, ct->rx_seq, "receive", ep, ct->rx_buf,
-		MAX(size, PP_MAX_CTRL_MSG), fi_mr_desc(ct->mr), 0, ctx);
+	if (ct->opts.op == PP_OP_TAGGED)
+		PP_POST(fi_trecv, pp_get_rx_comp, ct->rx_seq, "t-receive", ep,
+			ct->rx_buf, MAX(size, PP_MAX_CTRL_MSG),
+			fi_mr_desc(ct->mr), 0, PP_TAG, 0, ctx);
+	else
+		PP_POST(fi_recv, pp_get_rx_comp, ct->rx_seq, "receive", ep,
+			ct->rx_buf, MAX(size, PP_MAX_CTRL_MSG),
+			fi_mr_desc(ct->mr), 0, ctx);
 	return 0;
 }
 
@@ -1231,7 +1620,7 @@ ssize_t pp_rx(struct ct_pingpong *ct, struct fid_ep *ep, size_t size)
 		return ret;
 
 	if (pp_check_opts(ct, PP_OPT_VERIFY_DATA | PP_OPT_ACTIVE)) {
-		ret = pp_check_buf((char *)ct->rx_buf, size);
+		ret = pp_check_buf(ct, (char *)ct->rx_buf, size);
 		if (ret)
 			return ret;
 	}
@@ -1276,6 +1665,7 @@ uint64_t pp_init_cq_data(struct fi_info *info)
 
 int pp_alloc_msgs(struct ct_pingpong *ct)
 {
+	uint64_t access;
 	int ret;
 	long alignment = 1;
 
@@ -1309,10 +1699,14 @@ int pp_alloc_msgs(struct ct_pingpong *ct)
 
 	ct->remote_cq_data = pp_init_cq_data(ct->fi);
 
-	if (ct->fi->mode & FI_LOCAL_MR) {
-		ret = fi_mr_reg(ct->domain, ct->buf, ct->buf_size,
-				FI_SEND | FI_RECV, 0, PP_MR_KEY, 0, &(ct->mr),
-				NULL);
+	if ((ct->fi->mode & FI_LOCAL_MR) || !pp_op_is_msg(ct->opts.op)) {
+		access = FI_SEND | FI_RECV;
+		if (!pp_op_is_msg(ct->opts.op))
+			access |= FI_READ | FI_WRITE |
+				  FI_REMOTE_READ | FI_REMOTE_WRITE;
+
+		ret = fi_mr_reg(ct->domain, ct->buf, ct->buf_size, access, 0,
+				PP_MR_KEY, 0, &(ct->mr), NULL);
 		if (ret) {
 			PP_PRINTERR("fi_mr_reg", ret);
 			return ret;
@@ -1789,6 +2183,13 @@ void pp_free_res(struct ct_pingpong *ct)
 		ct->buf = ct->rx_buf = ct->tx_buf = NULL;
 		ct->buf_size = ct->rx_size = ct->tx_size = 0;
 	}
+	free(ct->tx_ctx_arr);
+	free(ct->rx_ctx_arr);
+	ct->tx_ctx_arr = ct->rx_ctx_arr = NULL;
+	free(ct->nomatch_ctx);
+	ct->nomatch_ctx = NULL;
+	free(ct->hist);
+	ct->hist = NULL;
 	if (ct->fi_pep) {
 		fi_freeinfo(ct->fi_pep);
 		ct->fi_pep = NULL;
@@ -1811,6 +2212,7 @@ int pp_finalize(struct ct_pingpong *ct)
 	int ret;
 	struct fi_context ctx;
 	struct fi_msg msg;
+	struct fi_msg_tagged tmsg;
 
 	PP_DEBUG("Terminating test\n");
 
@@ -1818,13 +2220,26 @@ int pp_finalize(struct ct_pingpong *ct)
 	iov.iov_base = ct->tx_buf;
 	iov.iov_len = 4;
 
-	memset(&msg, 0, sizeof(msg));
-	msg.msg_iov = &iov;
-	msg.iov_count = 1;
-	msg.addr = ct->remote_fi_addr;
-	msg.context = &ctx;
+	if (ct->opts.op == PP_OP_TAGGED) {
+		memset(&tmsg, 0, sizeof(tmsg));
+		tmsg.msg_iov = &iov;
+		tmsg.iov_count = 1;
+		tmsg.addr = ct->remote_fi_addr;
+		tmsg.tag = PP_TAG;
+		tmsg.context = &ctx;
+
+		ret = fi_tsendmsg(ct->ep, &tmsg,
+				  FI_INJECT | FI_TRANSMIT_COMPLETE);
+	} else {
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.iov_count = 1;
+		msg.addr = ct->remote_fi_addr;
+		msg.context = &ctx;
 
-	ret = fi_sendmsg(ct->ep, &msg, FI_INJECT | FI_TRANSMIT_COMPLETE);
+		ret = fi_sendmsg(ct->ep, &msg,
+				 FI_INJECT | FI_TRANSMIT_COMPLETE);
+	}
 	if (ret) {
 		PP_PRINTERR("transmit", ret);
 		return ret;
@@ -1879,6 +2294,24 @@ void pp_pingpong_usage(char *name, char *desc)
 		"specific transfer size or 'all' (all)");
 
 	fprintf(stderr, " %-20s %s\n", "-c", "enables data_integrity checks");
+	fprintf(stderr, " %-20s %s\n", "-t <test>",
+		"test type: pingpong|bw|bibw|rate (pingpong)");
+	fprintf(stderr, " %-20s %s\n", "-W <window>",
+		"outstanding operations for bw|bibw|rate (64)");
+	fprintf(stderr, " %-20s %s\n", "-T <pairs>",
+		"number of concurrent endpoint pairs (1)");
+	fprintf(stderr, " %-20s %s\n", "-o <op>",
+		"operation: msg|tagged|write|read|atomic|fetch (msg)");
+	fprintf(stderr, " %-20s %s\n", "-D <datatype>",
+		"atomic datatype, eg uint64, double, or 'all' (all)");
+	fprintf(stderr, " %-20s %s\n", "-U <count>",
+		"pre-posted non-matching tagged receives (0)");
+	fprintf(stderr, " %-20s %s\n", "-w <number>",
+		"warmup iterations excluded from results (0)");
+	fprintf(stderr, " %-20s %s\n", "-L",
+		"report latency percentiles for pingpong tests");
+	fprintf(stderr, " %-20s %s\n", "-F <format>",
+		"output format: text|csv|json (text)");
 
 	fprintf(stderr, " %-20s %s\n", "-h", "display this help output");
 	fprintf(stderr, " %-20s %s\n", "-v", "enable debugging output");
@@ -1886,6 +2319,8 @@ void pp_pingpong_usage(char *name, char *desc)
 
 void pp_parse_opts(struct ct_pingpong *ct, int op, char *optarg)
 {
+	int i;
+
 	switch (op) {
 
 	/* Domain */
@@ -1941,6 +2376,95 @@ void pp_parse_opts(struct ct_pingpong *ct, int op, char *optarg)
 		ct->opts.options |= PP_OPT_VERIFY_DATA;
 		break;
 
+	/* Test type */
+	case 't':
+		for (i = 0; i < PP_TEST_MAX; i++) {
+			if (!strcasecmp(pp_test_names[i], optarg))
+				break;
+		}
+		if (i == PP_TEST_MAX) {
+			fprintf(stderr, "Unknown test : %s\n", optarg);
+			exit(EXIT_FAILURE);
+		}
+		ct->opts.test = i;
+		break;
+
+	/* Window size */
+	case 'W':
+		ct->opts.window = (int)parse_ulong(optarg, INT_MAX);
+		if (ct->opts.window < 1)
+			ct->opts.window = 1;
+		break;
+
+	/* Operation */
+	case 'o':
+		for (i = 0; i < PP_OP_MAX; i++) {
+			if (!strcasecmp(pp_op_names[i], optarg))
+				break;
+		}
+		if (i == PP_OP_MAX) {
+			fprintf(stderr, "Unknown operation : %s\n", optarg);
+			exit(EXIT_FAILURE);
+		}
+		ct->opts.op = i;
+		break;
+
+	/* Atomic datatype */
+	case 'D':
+		if (!strcasecmp("all", optarg)) {
+			ct->opts.datatype = PP_DATATYPE_ALL;
+			break;
+		}
+		for (i = 0; i < FI_DATATYPE_LAST; i++) {
+			if (!strcasecmp(pp_datatype_names[i], optarg))
+				break;
+		}
+		if (i == FI_DATATYPE_LAST) {
+			fprintf(stderr, "Unknown datatype : %s\n", optarg);
+			exit(EXIT_FAILURE);
+		}
+		ct->opts.datatype = i;
+		break;
+
+	/* Non-matching receives */
+	case 'U':
+		ct->opts.nomatch_cnt = (int)parse_ulong(optarg, INT_MAX);
+		if (ct->opts.nomatch_cnt < 0)
+			ct->opts.nomatch_cnt = 0;
+		break;
+
+	/* Warmup iterations */
+	case 'w':
+		ct->opts.warmup = (int)parse_ulong(optarg, INT_MAX);
+		if (ct->opts.warmup < 0)
+			ct->opts.warmup = 0;
+		break;
+
+	/* Latency percentiles */
+	case 'L':
+		ct->opts.latency = 1;
+		break;
+
+	/* Output format */
+	case 'F':
+		for (i = 0; i < PP_FORMAT_MAX; i++) {
+			if (!strcasecmp(pp_format_names[i], optarg))
+				break;
+		}
+		if (i == PP_FORMAT_MAX) {
+			fprintf(stderr, "Unknown format : %s\n", optarg);
+			exit(EXIT_FAILURE);
+		}
+		pp_format = i;
+		break;
+
+	/* Endpoint pairs */
+	case 'T':
+		ct->opts.pairs = (int)parse_ulong(optarg, PP_MAX_PAIRS);
+		if (ct->opts.pairs < 1)
+			ct->opts.pairs = 1;
+		break;
+
 	/* Source Port */
 	case 'B':
 		ct->opts.src_port = parse_ulong(optarg, UINT16_MAX);
@@ -1961,12 +2485,69 @@ void pp_parse_opts(struct ct_pingpong *ct, int op, char *optarg)
 	}
 }
 
+/*******************************************************************************
+ *                                Multiple endpoint pairs
+ ******************************************************************************/
+
+int pp_barrier_init(struct pp_barrier *barrier, int count)
+{
+	int ret;
+
+	memset(barrier, 0, sizeof(*barrier));
+	barrier->count = count;
+
+	ret = pthread_mutex_init(&barrier->lock, NULL);
+	if (ret)
+		return -ret;
+
+	ret = pthread_cond_init(&barrier->cond, NULL);
+	if (ret) {
+		pthread_mutex_destroy(&barrier->lock);
+		return -ret;
+	}
+	return 0;
+}
+
+void pp_barrier_destroy(struct pp_barrier *barrier)
+{
+	pthread_cond_destroy(&barrier->cond);
+	pthread_mutex_destroy(&barrier->lock);
+}
+
+int pp_barrier_wait(struct pp_barrier *barrier)
+{
+	int generation, ret;
+
+	pthread_mutex_lock(&barrier->lock);
+	generation = barrier->generation;
+	if (++barrier->waiting == barrier->count) {
+		barrier->waiting = 0;
+		barrier->generation++;
+		pthread_cond_broadcast(&barrier->cond);
+	} else {
+		while (generation == barrier->generation && !barrier->aborted)
+			pthread_cond_wait(&barrier->cond, &barrier->lock);
+	}
+	ret = barrier->aborted ? -FI_ECANCELED : 0;
+	pthread_mutex_unlock(&barrier->lock);
+	return ret;
+}
+
+void pp_barrier_abort(struct pp_barrier *barrier)
+{
+	pthread_mutex_lock(&barrier->lock);
+	barrier->aborted = 1;
+	pthread_cond_broadcast(&barrier->cond);
+	pthread_mutex_unlock(&barrier->lock);
+}
+
 /*******************************************************************************
  *      PingPong core and implemenations for endpoints
  ******************************************************************************/
 
 int pingpong(struct ct_pingpong *ct)
 {
+	uint64_t iter_start = 0;
 	int ret, i;
 
 	ret = pp_ctrl_sync(ct);
@@ -1976,6 +2557,8 @@ int pingpong(struct ct_pingpong *ct)
 	pp_start(ct);
 	if (ct->opts.dst_addr) {
 		for (i = 0; i < ct->opts.iterations; i++) {
+			if (ct->hist)
+				iter_start = pp_gettime_ns();
 
 			if (ct->opts.transfer_size <
 			    ct->fi->tx_attr->inject_size)
@@ -1989,9 +2572,15 @@ int pingpong(struct ct_pingpong *ct)
 			ret = pp_rx(ct, ct->ep, ct->opts.transfer_size);
 			if (ret)
 				return ret;
+
+			if (ct->hist)
+				pp_hist_record(ct->hist,
+					       pp_gettime_ns() - iter_start);
 		}
 	} else {
 		for (i = 0; i < ct->opts.iterations; i++) {
+			if (ct->hist)
+				iter_start = pp_gettime_ns();
 
 			ret = pp_rx(ct, ct->ep, ct->opts.transfer_size);
 			if (ret)
@@ -2005,6 +2594,10 @@ int pingpong(struct ct_pingpong *ct)
 				ret = pp_tx(ct, ct->ep, ct->opts.transfer_size);
 			if (ret)
 				return ret;
+
+			if (ct->hist)
+				pp_hist_record(ct->hist,
+					       pp_gettime_ns() - iter_start);
 		}
 	}
 	pp_stop(ct);
@@ -2014,79 +2607,611 @@ int pingpong(struct ct_pingpong *ct)
 		return ret;
 
 	PP_DEBUG("Results:\n");
-	show_perf(NULL, ct->opts.transfer_size, ct->opts.iterations,
-		  ct->cnt_ack_msg, ct->start, ct->end, 2);
+	pp_report_perf(ct, ct->opts.iterations, 2);
 
 	return 0;
 }
 
-int run_suite_pingpong(struct ct_pingpong *ct)
+/*
+ * Streaming tests keep a window of operations outstanding.  Between windows
+ * every side has exactly one receive posted, as in the pingpong test; the
+ * receiving side tops this up to a full window while a window is in flight.
+ */
+static int pp_post_rx_window(struct ct_pingpong *ct, int cnt)
 {
-	int i, sizes_cnt;
-	int ret = 0;
-	int *sizes = NULL;
-
-	pp_banner_fabric_info(ct);
+	ssize_t ret;
+	int i;
 
-	sizes_cnt = generate_test_sizes(&ct->opts, ct->tx_size, &sizes);
+	for (i = 0; i < cnt; i++) {
+		ret = pp_post_rx(ct, ct->ep, ct->rx_size, &ct->rx_ctx_arr[i]);
+		if (ret)
+			return (int) ret;
+	}
+	return 0;
+}
 
-	PP_DEBUG("Count of sizes to test: %d\n", sizes_cnt);
+static int pp_tx_window(struct ct_pingpong *ct, int cnt, int inject)
+{
+	ssize_t ret;
+	int i;
 
-	for (i = 0; i < sizes_cnt; i++) {
-		ct->opts.transfer_size = sizes[i];
-		init_test(ct, &(ct->opts));
-		ret = pingpong(ct);
+	for (i = 0; i < cnt; i++) {
+		if (inject)
+			ret = pp_post_inject(ct, ct->ep,
+					     ct->opts.transfer_size);
+		else
+			ret = pp_post_tx(ct, ct->ep, ct->opts.transfer_size,
+					 &ct->tx_ctx_arr[i]);
 		if (ret)
-			goto out;
+			return (int) ret;
 	}
-
-out:
-	free(sizes);
-	return ret;
+	return pp_get_tx_comp(ct, ct->tx_seq);
 }
 
-static int run_pingpong_dgram(struct ct_pingpong *ct)
+/* Wait for a full window, then re-arm for the next one (or just one recv) */
+static int pp_rx_window(struct ct_pingpong *ct, int cnt, int next)
 {
-	int ret;
-
-	PP_DEBUG("Selected endpoint: DGRAM\n");
+	ssize_t ret;
 
-	ret = pp_init_fabric(ct);
+	ret = pp_get_rx_comp(ct, ct->rx_seq);
 	if (ret)
-		return ret;
-
-	/* Post an extra receive to avoid lacking a posted receive in the
-	 * finalize.
-	 */
-	ret = fi_recv(ct->ep, ct->rx_buf, ct->rx_size, fi_mr_desc(ct->mr), 0,
-		      &ct->rx_ctx);
+		return (int) ret;
 
-	ret = run_suite_pingpong(ct);
+	ret = pp_post_rx(ct, ct->ep, ct->rx_size, &ct->rx_ctx);
 	if (ret)
-		return ret;
+		return (int) ret;
 
-	return pp_finalize(ct);
+	ct->cnt_ack_msg += cnt;
+	return next > 1 ? pp_post_rx_window(ct, next - 1) : 0;
 }
 
-static int run_pingpong_rdm(struct ct_pingpong *ct)
+static int pp_window_cnt(struct ct_pingpong *ct, int done)
 {
-	int ret;
+	return MIN(ct->window, ct->opts.iterations - done);
+}
 
-	PP_DEBUG("Selected endpoint: RDM\n");
+/*
+ * Unidirectional bandwidth / message rate: the client streams windows of
+ * messages and the server returns one small ack per window, which credits
+ * the client with the window's messages.
+ */
+int pp_stream(struct ct_pingpong *ct)
+{
+	int ret, done, cnt, inject;
 
-	ret = pp_init_fabric(ct);
-	if (ret)
-		return ret;
+	inject = ct->opts.test == PP_TEST_RATE &&
+		 ct->opts.transfer_size < ct->fi->tx_attr->inject_size;
 
-	ret = run_suite_pingpong(ct);
+	ret = pp_ctrl_sync(ct);
 	if (ret)
 		return ret;
 
-	return pp_finalize(ct);
-}
+	if (!ct->opts.dst_addr) {
+		ret = pp_post_rx_window(ct, pp_window_cnt(ct, 0) - 1);
+		if (ret)
+			return ret;
+	}
 
-static int run_pingpong_msg(struct ct_pingpong *ct)
-{
+	pp_start(ct);
+	for (done = 0; done < ct->opts.iterations; done += cnt) {
+		cnt = pp_window_cnt(ct, done);
+		if (ct->opts.dst_addr) {
+			ret = pp_tx_window(ct, cnt, inject);
+			if (ret)
+				return ret;
+
+			ret = pp_get_rx_comp(ct, ct->rx_seq);
+			if (ret)
+				return ret;
+
+			ret = pp_post_rx(ct, ct->ep, ct->rx_size,
+					 &ct->rx_ctx);
+			if (ret)
+				return ret;
+			ct->cnt_ack_msg += cnt;
+		} else {
+			ret = pp_rx_window(ct, cnt,
+					   pp_window_cnt(ct, done + cnt));
+			if (ret)
+				return ret;
+
+			if (ct->fi->tx_attr->inject_size)
+				ret = pp_inject(ct, ct->ep, 0);
+			else
+				ret = pp_tx(ct, ct->ep, 0);
+			if (ret)
+				return ret;
+		}
+	}
+	pp_stop(ct);
+
+	ret = pp_ctrl_txrx_msg_count(ct);
+	if (ret)
+		return ret;
+
+	PP_DEBUG("Results:\n");
+	pp_report_perf(ct, ct->opts.iterations, 1);
+
+	return 0;
+}
+
+/* Bidirectional bandwidth: both sides stream a window at each other */
+int pp_stream_bidir(struct ct_pingpong *ct)
+{
+	int ret, done, cnt;
+
+	ret = pp_ctrl_sync(ct);
+	if (ret)
+		return ret;
+
+	ret = pp_post_rx_window(ct, pp_window_cnt(ct, 0) - 1);
+	if (ret)
+		return ret;
+
+	/* Receives are posted on both sides before anyone starts sending */
+	ret = pp_ctrl_sync(ct);
+	if (ret)
+		return ret;
+
+	pp_start(ct);
+	for (done = 0; done < ct->opts.iterations; done += cnt) {
+		cnt = pp_window_cnt(ct, done);
+		ret = pp_tx_window(ct, cnt, 0);
+		if (ret)
+			return ret;
+
+		ret = pp_rx_window(ct, cnt, pp_window_cnt(ct, done + cnt));
+		if (ret)
+			return ret;
+	}
+	pp_stop(ct);
+
+	ret = pp_ctrl_txrx_msg_count(ct);
+	if (ret)
+		return ret;
+
+	PP_DEBUG("Results:\n");
+	pp_report_perf(ct, ct->opts.iterations, 2);
+
+	return 0;
+}
+
+/*
+ * Exchange the address and key of each side's receive buffer, which is the
+ * target of the RMA and atomic tests.
+ */
+int pp_exchange_mr(struct ct_pingpong *ct)
+{
+	struct fi_rma_iov local;
+	int ret;
+
+	local.addr = ct->fi->domain_attr->mr_mode == FI_MR_SCALABLE ?
+		     0 : (uintptr_t) ct->rx_buf;
+	local.len = ct->rx_size;
+	local.key = fi_mr_key(ct->mr);
+
+	if (ct->opts.dst_addr) {
+		ret = pp_ctrl_send(ct, (char *) &local, sizeof(local));
+		if (ret < 0)
+			return ret;
+		ret = pp_ctrl_recv(ct, (char *) &ct->remote,
+				   sizeof(ct->remote));
+	} else {
+		ret = pp_ctrl_recv(ct, (char *) &ct->remote,
+				   sizeof(ct->remote));
+		if (ret < 0)
+			return ret;
+		ret = pp_ctrl_send(ct, (char *) &local, sizeof(local));
+	}
+	if (ret < 0)
+		return ret;
+
+	PP_DEBUG("Remote buffer: addr 0x%" PRIx64 " key 0x%" PRIx64 "\n",
+		 ct->remote.addr, ct->remote.key);
+	return 0;
+}
+
+static size_t pp_atomic_count(struct ct_pingpong *ct)
+{
+	static const size_t size[FI_DATATYPE_LAST] = {
+		[FI_INT8] = sizeof(int8_t),
+		[FI_UINT8] = sizeof(uint8_t),
+		[FI_INT16] = sizeof(int16_t),
+		[FI_UINT16] = sizeof(uint16_t),
+		[FI_INT32] = sizeof(int32_t),
+		[FI_UINT32] = sizeof(uint32_t),
+		[FI_INT64] = sizeof(int64_t),
+		[FI_UINT64] = sizeof(uint64_t),
+		[FI_FLOAT] = sizeof(float),
+		[FI_DOUBLE] = sizeof(double),
+		[FI_FLOAT_COMPLEX] = 2 * sizeof(float),
+		[FI_DOUBLE_COMPLEX] = 2 * sizeof(double),
+		[FI_LONG_DOUBLE] = sizeof(long double),
+		[FI_LONG_DOUBLE_COMPLEX] = 2 * sizeof(long double),
+	};
+
+	return ct->opts.transfer_size / size[ct->opts.datatype];
+}
+
+static ssize_t pp_post_rma(struct ct_pingpong *ct, struct fi_context *ctx,
+			   int inject)
+{
+	size_t size = ct->opts.transfer_size;
+	void *desc = fi_mr_desc(ct->mr);
+
+	switch (ct->opts.op) {
+	case PP_OP_WRITE:
+		if (inject) {
+			PP_POST(fi_inject_write, pp_get_tx_comp, ct->tx_seq,
+				"fi_inject_write", ct->ep, ct->tx_buf, size,
+				ct->remote_fi_addr, ct->remote.addr,
+				ct->remote.key);
+			ct->tx_cq_cntr++;
+		} else {
+			PP_POST(fi_write, pp_get_tx_comp, ct->tx_seq,
+				"fi_write", ct->ep, ct->tx_buf, size, desc,
+				ct->remote_fi_addr, ct->remote.addr,
+				ct->remote.key, ctx);
+		}
+		break;
+	case PP_OP_READ:
+		PP_POST(fi_read, pp_get_tx_comp, ct->tx_seq, "fi_read", ct->ep,
+			ct->rx_buf, size, desc, ct->remote_fi_addr,
+			ct->remote.addr, ct->remote.key, ctx);
+		break;
+	case PP_OP_ATOMIC:
+		if (inject) {
+			PP_POST(fi_inject_atomic, pp_get_tx_comp, ct->tx_seq,
+				"fi_inject_atomic", ct->ep, ct->tx_buf,
+				pp_atomic_count(ct), ct->remote_fi_addr,
+				ct->remote.addr, ct->remote.key,
+				ct->opts.datatype, FI_SUM);
+			ct->tx_cq_cntr++;
+		} else {
+			PP_POST(fi_atomic, pp_get_tx_comp, ct->tx_seq,
+				"fi_atomic", ct->ep, ct->tx_buf,
+				pp_atomic_count(ct), desc, ct->remote_fi_addr,
+				ct->remote.addr, ct->remote.key,
+				ct->opts.datatype, FI_SUM, ctx);
+		}
+		break;
+	case PP_OP_FETCH_ATOMIC:
+		PP_POST(fi_fetch_atomic, pp_get_tx_comp, ct->tx_seq,
+			"fi_fetch_atomic", ct->ep, ct->tx_buf,
+			pp_atomic_count(ct), desc, ct->rx_buf, desc,
+			ct->remote_fi_addr, ct->remote.addr, ct->remote.key,
+			ct->opts.datatype, FI_SUM, ctx);
+		break;
+	default:
+		return -FI_EINVAL;
+	}
+	return 0;
+}
+
+/*
+ * One-sided tests.  The initiator (the client, or both sides for bibw)
+ * issues windows of operations, one at a time for the pingpong test, and
+ * then sends a message telling the target it is done.  The target polls
+ * its receive CQ meanwhile, which also drives manual progress providers.
+ */
+int pp_rma(struct ct_pingpong *ct)
+{
+	int initiator, target, window, inject;
+	int ret, done, cnt, i;
+	uint64_t iter_start = 0;
+	size_t inject_size;
+
+	initiator = ct->opts.dst_addr || ct->opts.test == PP_TEST_BIBW;
+	target = !ct->opts.dst_addr || ct->opts.test == PP_TEST_BIBW;
+	window = ct->opts.test == PP_TEST_PINGPONG ? 1 : ct->window;
+
+	inject_size = ct->fi->tx_attr->inject_size;
+	inject = ct->opts.test == PP_TEST_RATE &&
+		 ct->opts.transfer_size <= inject_size &&
+		 (ct->opts.op == PP_OP_WRITE || ct->opts.op == PP_OP_ATOMIC);
+
+	ret = pp_ctrl_sync(ct);
+	if (ret)
+		return ret;
+
+	pp_start(ct);
+	if (initiator) {
+		for (done = 0; done < ct->opts.iterations; done += cnt) {
+			cnt = MIN(window, ct->opts.iterations - done);
+			if (ct->hist && window == 1)
+				iter_start = pp_gettime_ns();
+			for (i = 0; i < cnt; i++) {
+				ret = pp_post_rma(ct, &ct->tx_ctx_arr[i],
+						  inject);
+				if (ret)
+					return ret;
+			}
+			ret = pp_get_tx_comp(ct, ct->tx_seq);
+			if (ret)
+				return ret;
+			if (ct->hist && window == 1)
+				pp_hist_record(ct->hist,
+					       pp_gettime_ns() - iter_start);
+			ct->cnt_ack_msg += cnt;
+		}
+		pp_stop(ct);
+
+		ret = inject_size ? pp_inject(ct, ct->ep, 0) :
+				    pp_tx(ct, ct->ep, 0);
+		if (ret)
+			return ret;
+	}
+
+	if (target) {
+		ret = pp_get_rx_comp(ct, ct->rx_seq);
+		if (ret)
+			return ret;
+
+		ret = pp_post_rx(ct, ct->ep, ct->rx_size, &ct->rx_ctx);
+		if (ret)
+			return ret;
+		if (!initiator)
+			pp_stop(ct);
+	}
+
+	ret = pp_ctrl_txrx_msg_count(ct);
+	if (ret)
+		return ret;
+
+	PP_DEBUG("Results:\n");
+	pp_report_perf(ct, ct->opts.iterations,
+		       ct->opts.test == PP_TEST_BIBW ? 2 : 1);
+
+	return 0;
+}
+
+/*
+ * Post receives with a tag that never matches.  They stay queued for the
+ * life of the endpoint, ahead of the receives posted by the test, so each
+ * match has to step over them.
+ */
+static int pp_post_nomatch(struct ct_pingpong *ct)
+{
+	ssize_t ret;
+	int i;
+
+	ct->nomatch_ctx = calloc(ct->opts.nomatch_cnt,
+				 sizeof(*ct->nomatch_ctx));
+	if (!ct->nomatch_ctx)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < ct->opts.nomatch_cnt; i++) {
+		ret = fi_trecv(ct->ep, ct->rx_buf, ct->rx_size,
+			       fi_mr_desc(ct->mr), 0, PP_TAG_NOMATCH, 0,
+			       &ct->nomatch_ctx[i]);
+		if (ret) {
+			PP_PRINTERR("fi_trecv", ret);
+			return (int) ret;
+		}
+	}
+
+	PP_DEBUG("Posted %d non-matching receives\n", ct->opts.nomatch_cnt);
+	return 0;
+}
+
+static int pp_init_window(struct ct_pingpong *ct)
+{
+	ct->window = MIN(ct->opts.window, (int) ct->fi->tx_attr->size);
+	ct->window = MIN(ct->window, (int) ct->fi->rx_attr->size);
+	if (ct->window < 1)
+		ct->window = 1;
+
+	ct->tx_ctx_arr = calloc(ct->window, sizeof(*ct->tx_ctx_arr));
+	ct->rx_ctx_arr = calloc(ct->window, sizeof(*ct->rx_ctx_arr));
+	if (!ct->tx_ctx_arr || !ct->rx_ctx_arr)
+		return -FI_ENOMEM;
+
+	PP_DEBUG("Window of %d outstanding operations\n", ct->window);
+	return 0;
+}
+
+static int pp_atomic_valid(struct ct_pingpong *ct)
+{
+	size_t count;
+	int ret;
+
+	if (!pp_atomic_count(ct))
+		return 0;
+
+	if (ct->opts.op == PP_OP_FETCH_ATOMIC)
+		ret = fi_fetch_atomicvalid(ct->ep, ct->opts.datatype, FI_SUM,
+					   &count);
+	else
+		ret = fi_atomicvalid(ct->ep, ct->opts.datatype, FI_SUM, &count);
+
+	return !ret && pp_atomic_count(ct) <= count;
+}
+
+static int pp_run_test(struct ct_pingpong *ct);
+
+/*
+ * Atomic tests run once per datatype, or for every datatype the provider
+ * supports at this size; rows are labeled with the datatype.
+ */
+static int pp_run_atomic_test(struct ct_pingpong *ct)
+{
+	int datatype, first, last, ret = 0;
+
+	if (ct->opts.datatype == PP_DATATYPE_ALL) {
+		first = 0;
+		last = FI_DATATYPE_LAST - 1;
+	} else {
+		first = last = ct->opts.datatype;
+	}
+
+	for (datatype = first; datatype <= last; datatype++) {
+		ct->opts.datatype = datatype;
+		ct->perf_name = pp_datatype_names[datatype];
+		if (!pp_atomic_valid(ct)) {
+			PP_DEBUG("Skipping %s for size %d\n", ct->perf_name,
+				 ct->opts.transfer_size);
+			continue;
+		}
+
+		ct->cnt_ack_msg = 0;
+		ret = pp_run_test(ct);
+		if (ret)
+			break;
+	}
+
+	if (first != last)
+		ct->opts.datatype = PP_DATATYPE_ALL;
+	return ret;
+}
+
+static int pp_run_test_once(struct ct_pingpong *ct)
+{
+	if (!pp_op_is_msg(ct->opts.op))
+		return pp_rma(ct);
+
+	switch (ct->opts.test) {
+	case PP_TEST_BW:
+	case PP_TEST_RATE:
+		return pp_stream(ct);
+	case PP_TEST_BIBW:
+		return pp_stream_bidir(ct);
+	default:
+		return pingpong(ct);
+	}
+}
+
+/*
+ * Warmup iterations run the same test, so both sides stay in step, but
+ * their results are dropped.
+ */
+static int pp_run_test(struct ct_pingpong *ct)
+{
+	int iterations, ret;
+
+	if (ct->opts.warmup) {
+		iterations = ct->opts.iterations;
+		ct->opts.iterations = ct->opts.warmup;
+		ct->warmup = 1;
+		ret = pp_run_test_once(ct);
+		ct->warmup = 0;
+		ct->opts.iterations = iterations;
+		ct->cnt_ack_msg = 0;
+		if (ret)
+			return ret;
+	}
+
+	return pp_run_test_once(ct);
+}
+
+int run_suite_pingpong(struct ct_pingpong *ct)
+{
+	int i, sizes_cnt;
+	int ret = 0;
+	int *sizes = NULL;
+
+	pp_banner_fabric_info(ct);
+
+	if (ct->opts.test != PP_TEST_PINGPONG ||
+	    !pp_op_is_msg(ct->opts.op)) {
+		if (ct->fi->ep_attr->type == FI_EP_DGRAM) {
+			PP_ERR("%s %s test requires a reliable endpoint "
+			       "(msg|rdm)", pp_op_names[ct->opts.op],
+			       pp_test_names[ct->opts.test]);
+			return -FI_EINVAL;
+		}
+
+		ret = pp_init_window(ct);
+		if (ret)
+			return ret;
+	}
+
+	if (ct->opts.latency) {
+		ct->hist = calloc(1, sizeof(*ct->hist));
+		if (!ct->hist)
+			return -FI_ENOMEM;
+	}
+
+	if (!pp_op_is_msg(ct->opts.op)) {
+		ret = pp_exchange_mr(ct);
+		if (ret)
+			return ret;
+	}
+
+	if (ct->opts.op == PP_OP_TAGGED && ct->opts.nomatch_cnt) {
+		ret = pp_post_nomatch(ct);
+		if (ret)
+			return ret;
+	}
+
+	sizes_cnt = generate_test_sizes(&ct->opts, ct->tx_size, &sizes);
+
+	PP_DEBUG("Count of sizes to test: %d\n", sizes_cnt);
+
+	for (i = 0; i < sizes_cnt; i++) {
+		ct->opts.transfer_size = sizes[i];
+		init_test(ct, &(ct->opts));
+
+		if (ct->barrier) {
+			ret = pp_barrier_wait(ct->barrier);
+			if (ret)
+				goto out;
+		}
+
+		if (pp_op_is_atomic(ct->opts.op))
+			ret = pp_run_atomic_test(ct);
+		else
+			ret = pp_run_test(ct);
+		if (ret)
+			goto out;
+	}
+
+out:
+	free(sizes);
+	return ret;
+}
+
+static int run_pingpong_dgram(struct ct_pingpong *ct)
+{
+	int ret;
+
+	PP_DEBUG("Selected endpoint: DGRAM\n");
+
+	ret = pp_init_fabric(ct);
+	if (ret)
+		return ret;
+
+	/* Post an extra receive to avoid lacking a posted receive in the
+	 * finalize.
+	 */
+	ret = fi_recv(ct->ep, ct->rx_buf, ct->rx_size, fi_mr_desc(ct->mr), 0,
+		      &ct->rx_ctx);
+
+	ret = run_suite_pingpong(ct);
+	if (ret)
+		return ret;
+
+	return pp_finalize(ct);
+}
+
+static int run_pingpong_rdm(struct ct_pingpong *ct)
+{
+	int ret;
+
+	PP_DEBUG("Selected endpoint: RDM\n");
+
+	ret = pp_init_fabric(ct);
+	if (ret)
+		return ret;
+
+	ret = run_suite_pingpong(ct);
+	if (ret)
+		return ret;
+
+	return pp_finalize(ct);
+}
+
+static int run_pingpong_msg(struct ct_pingpong *ct)
+{
 	int ret;
 
 	PP_DEBUG("Selected endpoint: MSG\n");
@@ -2122,6 +3247,156 @@ out:
 	return ret;
 }
 
+static int run_pingpong(struct ct_pingpong *ct)
+{
+	switch (ct->hints->ep_attr->type) {
+	case FI_EP_DGRAM:
+		if (ct->opts.options & PP_OPT_SIZE)
+			ct->hints->ep_attr->max_msg_size = ct->opts.transfer_size;
+		return run_pingpong_dgram(ct);
+	case FI_EP_RDM:
+		return run_pingpong_rdm(ct);
+	case FI_EP_MSG:
+		return run_pingpong_msg(ct);
+	default:
+		fprintf(stderr, "Endpoint unsupported: %d\n",
+			ct->hints->ep_attr->type);
+		return EXIT_FAILURE;
+	}
+}
+
+struct pp_pair {
+	pthread_t thread;
+	struct ct_pingpong ct;
+	int ret;
+};
+
+static void *pp_pair_thread(void *arg)
+{
+	struct pp_pair *pair = arg;
+
+	pair->ret = run_pingpong(&pair->ct);
+	if (pair->ret)
+		pp_barrier_abort(pair->ct.barrier);
+	pp_free_res(&pair->ct);
+	return NULL;
+}
+
+/* One row per size: total messages over the span from first start to last end */
+static void pp_show_pairs_perf(struct pp_pair *pairs, int pair_cnt)
+{
+	struct pp_result *res;
+	struct pp_hist *hist;
+	uint64_t start, end;
+	int sent, acked, result_cnt;
+	int i, j;
+
+	hist = malloc(sizeof(*hist));
+	if (!hist)
+		PP_ERR("Out of memory merging latency histograms");
+
+	result_cnt = pairs[0].ct.result_cnt;
+	for (j = 1; j < pair_cnt; j++)
+		result_cnt = MIN(result_cnt, pairs[j].ct.result_cnt);
+
+	for (i = 0; i < result_cnt; i++) {
+		sent = acked = 0;
+		start = UINT64_MAX;
+		end = 0;
+		if (hist)
+			memset(hist, 0, sizeof(*hist));
+		for (j = 0; j < pair_cnt; j++) {
+			res = &pairs[j].ct.results[i];
+			sent += res->sent;
+			acked += res->acked;
+			start = MIN(start, res->start);
+			end = MAX(end, res->end);
+			if (hist && res->hist)
+				pp_hist_merge(hist, res->hist);
+		}
+		res = &pairs[0].ct.results[i];
+		show_perf((char *) res->name, res->tsize, sent, acked, start, end,
+			  res->xfers_per_iter, hist);
+	}
+	free(hist);
+}
+
+/*
+ * Run opts.pairs independent client/server pairs, one per thread, each with
+ * its own fabric resources and control connection on consecutive ports.
+ */
+static int run_pingpong_pairs(struct ct_pingpong *ct)
+{
+	struct pp_barrier barrier;
+	struct pp_pair *pairs;
+	int i, j, started = 0, ret;
+
+	if (ct->opts.dst_addr) {
+		if (!ct->opts.dst_port)
+			ct->opts.dst_port = PP_CTRL_PORT;
+	} else if (!ct->opts.src_port) {
+		ct->opts.src_port = PP_CTRL_PORT;
+	}
+
+	pairs = calloc(ct->opts.pairs, sizeof(*pairs));
+	if (!pairs)
+		return -FI_ENOMEM;
+
+	ret = pp_barrier_init(&barrier, ct->opts.pairs);
+	if (ret)
+		goto free;
+
+	for (i = 0; i < ct->opts.pairs; i++) {
+		pairs[i].ct = *ct;
+		pairs[i].ct.hints = fi_dupinfo(ct->hints);
+		if (!pairs[i].ct.hints) {
+			ret = -FI_ENOMEM;
+			goto destroy;
+		}
+		pairs[i].ct.barrier = &barrier;
+		if (ct->opts.dst_addr) {
+			pairs[i].ct.opts.dst_port += i;
+			if (ct->opts.src_port)
+				pairs[i].ct.opts.src_port += i;
+		} else {
+			pairs[i].ct.opts.src_port += i;
+		}
+	}
+
+	for (started = 0; started < ct->opts.pairs; started++) {
+		ret = pthread_create(&pairs[started].thread, NULL,
+				     pp_pair_thread, &pairs[started]);
+		if (ret) {
+			PP_PRINTERR("pthread_create", -ret);
+			ret = -ret;
+			pp_barrier_abort(&barrier);
+			break;
+		}
+	}
+
+	for (i = 0; i < started; i++) {
+		pthread_join(pairs[i].thread, NULL);
+		if (!ret)
+			ret = pairs[i].ret;
+	}
+
+	if (!ret)
+		pp_show_pairs_perf(pairs, ct->opts.pairs);
+
+destroy:
+	for (i = 0; i < ct->opts.pairs; i++) {
+		if (pairs[i].ct.hints)
+			fi_freeinfo(pairs[i].ct.hints);
+		for (j = 0; j < pairs[i].ct.result_cnt; j++)
+			free(pairs[i].ct.results[j].hist);
+		free(pairs[i].ct.results);
+	}
+	pp_barrier_destroy(&barrier);
+free:
+	free(pairs);
+	return ret;
+}
+
 int main(int argc, char **argv)
 {
 	int ret, op;
@@ -2134,7 +3409,10 @@ int main(int argc, char **argv)
 		.opts = {
 			.iterations = 1000,
 			.transfer_size = 1024,
-			.sizes_enabled = PP_DEFAULT_SIZE
+			.sizes_enabled = PP_DEFAULT_SIZE,
+			.window = PP_DEFAULT_WINDOW,
+			.pairs = 1,
+			.datatype = PP_DATATYPE_ALL,
 		},
 		.eq_attr.wait_obj = FI_WAIT_UNSPEC,
 	};
@@ -2146,7 +3424,7 @@ int main(int argc, char **argv)
 	ct.hints->caps = FI_MSG;
 	ct.hints->mode = FI_CONTEXT | FI_LOCAL_MR;
 
-	while ((op = getopt(argc, argv, "hvd:p:e:I:S:B:P:c")) != -1) {
+	while ((op = getopt(argc, argv, "hvd:p:e:I:S:B:P:ct:W:T:o:D:U:w:LF:")) != -1) {
 		switch (op) {
 		default:
 			pp_parse_opts(&ct, op, optarg);
@@ -2162,26 +3440,29 @@ int main(int argc, char **argv)
 	if (optind < argc)
 		ct.opts.dst_addr = argv[optind];
 
-	pp_banner_options(&ct);
-
-	switch (ct.hints->ep_attr->type) {
-	case FI_EP_DGRAM:
-		if (ct.opts.options & PP_OPT_SIZE)
-			ct.hints->ep_attr->max_msg_size = ct.opts.transfer_size;
-		ret = run_pingpong_dgram(&ct);
+	switch (ct.opts.op) {
+	case PP_OP_TAGGED:
+		ct.hints->caps |= FI_TAGGED;
 		break;
-	case FI_EP_RDM:
-		ret = run_pingpong_rdm(&ct);
+	case PP_OP_WRITE:
+	case PP_OP_READ:
+		ct.hints->caps |= FI_RMA;
 		break;
-	case FI_EP_MSG:
-		ret = run_pingpong_msg(&ct);
+	case PP_OP_ATOMIC:
+	case PP_OP_FETCH_ATOMIC:
+		ct.hints->caps |= FI_ATOMIC;
 		break;
 	default:
-		fprintf(stderr, "Endpoint unsupported: %d\n",
-			ct.hints->ep_attr->type);
-		ret = EXIT_FAILURE;
+		break;
 	}
 
+	pp_banner_options(&ct);
+
+	if (ct.opts.pairs > 1)
+		ret = run_pingpong_pairs(&ct);
+	else
+		ret = run_pingpong(&ct);
+
 	pp_free_res(&ct);
 	return -ret;
 }